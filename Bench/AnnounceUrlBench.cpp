@@ -0,0 +1,70 @@
+#include <Core/AnnounceUrl.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <vector>
+
+namespace {
+std::atomic<uint64_t> allocations{0};
+}  // namespace
+
+// Counts every heap allocation of the process so the benchmark can report allocations per announce.
+void* operator new(size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1))
+    {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    std::free(p);
+}
+
+using namespace Torrent::Core;
+
+// Re-announce URLs for 10k sessions, round robin, from templates compiled up front.
+static void BM_ReannounceUrl(benchmark::State& state)
+{
+    std::mt19937_64 rng(3);
+    std::vector<AnnounceUrl> urls;
+    urls.reserve(10'000);
+    for (size_t i = 0; i < 10'000; ++i)
+    {
+        std::string infoHash(20, '\0');
+        for (auto& c : infoHash)
+        {
+            c = static_cast<char>(rng());
+        }
+        urls.emplace_back("http://tracker.example:6969/announce", infoHash, "-SK0001-" + std::to_string(100'000'000'000 + i),
+            6'881);
+    }
+
+    size_t i     = 0;
+    uint64_t sum = 0;
+    auto before  = allocations.load(std::memory_order_relaxed);
+    for (auto _ : state)
+    {
+        auto url  = urls[i].build(i * 16'384, i * 32'768, 1'000'000'000 - i, AnnounceEvent::None);
+        sum      += url.size();
+        i         = i + 1 == urls.size() ? 0 : i + 1;
+    }
+    auto after = allocations.load(std::memory_order_relaxed);
+    benchmark::DoNotOptimize(sum);
+    state.SetItemsProcessed(state.iterations());
+    state.counters["allocs_per_announce"] =
+        static_cast<double>(after - before) / static_cast<double>(std::max<int64_t>(state.iterations(), 1));
+}
+BENCHMARK(BM_ReannounceUrl);
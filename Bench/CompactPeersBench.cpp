@@ -0,0 +1,88 @@
+#include <Core/PeerStore.hpp>
+#include <Core/TrackerResponse.hpp>
+#include <Utils/CompactPeers.hpp>
+
+#include <benchmark/benchmark.h>
+#include <random>
+
+namespace {
+std::string randomBlob(size_t peers, size_t stride)
+{
+    std::mt19937 rng(42);
+    std::string blob(peers * stride, '\0');
+    for (auto& c : blob)
+    {
+        c = static_cast<char>(rng());
+    }
+    return blob;
+}
+
+std::string announceBody(size_t peers)
+{
+    auto v4 = randomBlob(peers, 6);
+    auto v6 = randomBlob(peers / 4, 18);
+    return "d8:intervali1800e5:peers" + std::to_string(v4.size()) + ":" + v4 + "6:peers6" + std::to_string(v6.size()) + ":" +
+        v6 + "e";
+}
+}  // namespace
+
+static void BM_DecodeCompactV4(benchmark::State& state)
+{
+    auto blob = randomBlob(static_cast<size_t>(state.range(0)), 6);
+    std::vector<Torrent::Net::Endpoint> out;
+    for (auto _ : state)
+    {
+        out.clear();
+        Torrent::Utils::decodeCompactPeers4(blob, out);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK(BM_DecodeCompactV4)->Arg(200)->Arg(10'000);
+
+static void BM_DecodeCompactV6(benchmark::State& state)
+{
+    auto blob = randomBlob(static_cast<size_t>(state.range(0)), 18);
+    std::vector<Torrent::Net::Endpoint> out;
+    for (auto _ : state)
+    {
+        out.clear();
+        Torrent::Utils::decodeCompactPeers6(blob, out);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK(BM_DecodeCompactV6)->Arg(10'000);
+
+static void BM_ParseAnnounceResponse(benchmark::State& state)
+{
+    auto body = announceBody(static_cast<size_t>(state.range(0)));
+    Torrent::Core::AnnounceResponse resp;
+    for (auto _ : state)
+    {
+        Torrent::Core::parseAnnounceResponse(body, resp);
+        benchmark::DoNotOptimize(resp.peers.data());
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(body.size()));
+}
+
+BENCHMARK(BM_ParseAnnounceResponse)->Arg(10'000);
+
+static void BM_PeerStoreMerge(benchmark::State& state)
+{
+    auto blob = randomBlob(static_cast<size_t>(state.range(0)), 6);
+    std::vector<Torrent::Net::Endpoint> peers;
+    Torrent::Utils::decodeCompactPeers4(blob, peers);
+    for (auto _ : state)
+    {
+        Torrent::Core::PeerStore store;
+        store.merge(peers);
+        // second merge is the steady-state re-announce case: everything is a duplicate
+        benchmark::DoNotOptimize(store.merge(peers));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0) * 2);
+}
+
+BENCHMARK(BM_PeerStoreMerge)->Arg(10'000);
@@ -0,0 +1,193 @@
+#include <Async/Executor.hpp>
+#include <Core/IpFilter.hpp>
+
+#include <Logger.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <random>
+#include <thread>
+
+using namespace Torrent;
+using namespace Torrent::Core;
+
+// A blocklist the size of the big public ones: 3M IPv4 ranges in P2P format plus a few IPv6 ones, about 130 MB
+// of text. Load time is the whole parse, merge and layout, on the caller alone or with a pool. Lookups draw
+// addresses from a table much larger than the caches, half of them inside ranges; the sorted-array binary
+// search over the same ranges is the baseline for the Eytzinger layout, and the blocklist adds the reader
+// bookkeeping of the hot-swappable holder.
+namespace {
+constexpr size_t kRanges  = 3'000'000;
+constexpr size_t kQueries = 1 << 20;
+
+struct Blocklist
+{
+    std::string text;
+    std::vector<std::pair<uint32_t, uint32_t>> sorted;  // disjoint IPv4 ranges
+    std::vector<Net::Endpoint> queries;
+};
+
+std::string dotted(uint32_t address)
+{
+    return std::to_string(address >> 24) + '.' + std::to_string(address >> 16 & 0xff) + '.'
+        + std::to_string(address >> 8 & 0xff) + '.' + std::to_string(address & 0xff);
+}
+
+Net::Endpoint endpoint(uint32_t address)
+{
+    uint8_t bytes[4] = {static_cast<uint8_t>(address >> 24), static_cast<uint8_t>(address >> 16),
+        static_cast<uint8_t>(address >> 8), static_cast<uint8_t>(address)};
+    return Net::Endpoint::fromV4(bytes, 6'881);
+}
+
+const Blocklist& blocklist()
+{
+    static const Blocklist list = []
+    {
+        Blocklist list;
+        std::mt19937 rng(3);
+        std::vector<uint32_t> starts(kRanges);
+        for (auto& start : starts)
+        {
+            start = rng();
+        }
+        std::sort(starts.begin(), starts.end());
+        starts.erase(std::unique(starts.begin(), starts.end()), starts.end());
+        for (size_t i = 0; i < starts.size(); ++i)
+        {
+            // a gap to the next range so that merging leaves them all
+            uint32_t room = i + 1 < starts.size() ? starts[i + 1] - starts[i] - 1 : 0;
+            list.sorted.emplace_back(starts[i], starts[i] + std::min<uint32_t>(room > 0 ? room - 1 : 0, rng() % 1'024));
+        }
+        // shuffled, like lists concatenated from several sources
+        std::vector<size_t> order(list.sorted.size());
+        for (size_t i = 0; i < order.size(); ++i)
+        {
+            order[i] = i;
+        }
+        std::shuffle(order.begin(), order.end(), rng);
+        list.text.reserve(order.size() * 48);
+        for (size_t i : order)
+        {
+            const auto& [first, last] = list.sorted[i];
+            list.text += "Range " + std::to_string(i) + ':' + dotted(first) + '-' + dotted(last) + '\n';
+        }
+        for (int i = 0; i < 1'000; ++i)
+        {
+            list.text += "Six:2001:db8:" + std::to_string(i) + "::-2001:db8:" + std::to_string(i) + "::ffff\n";
+        }
+        for (size_t i = 0; i < kQueries; ++i)
+        {
+            const auto& range = list.sorted[rng() % list.sorted.size()];
+            uint32_t inside   = range.first + (range.second - range.first) / 2;
+            list.queries.push_back(endpoint(i % 2 ? static_cast<uint32_t>(rng()) : inside));
+        }
+        return list;
+    }();
+    return list;
+}
+
+const IpFilter& filter()
+{
+    static const IpFilter filter = IpFilter::parse(blocklist().text, nullptr);
+    return filter;
+}
+
+uint32_t addressOf(const Net::Endpoint& ep)
+{
+    const auto& a = ep.address;
+    return static_cast<uint32_t>(a[12]) << 24 | static_cast<uint32_t>(a[13]) << 16 | static_cast<uint32_t>(a[14]) << 8 | a[15];
+}
+
+void reportLookups(benchmark::State& state, size_t blocked)
+{
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+    state.counters["lookup_s"] =
+        benchmark::Counter(static_cast<double>(state.iterations()), benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+    double share                    = static_cast<double>(blocked) / static_cast<double>(state.iterations());
+    state.counters["blocked_share"] = benchmark::Counter(share, benchmark::Counter::kAvgThreads);
+}
+}  // namespace
+
+static void BM_IpFilterLoad(benchmark::State& state)
+{
+    Logger::instance().setConsoleEnabled(false);
+    const auto& list = blocklist();
+    auto threads     = static_cast<size_t>(state.range(0));
+    std::unique_ptr<Async::Executor> executor = threads ? std::make_unique<Async::Executor>(threads) : nullptr;
+    size_t ranges                             = 0;
+    for (auto _ : state)
+    {
+        auto loaded = IpFilter::parse(list.text, executor.get());
+        ranges      = loaded.size();
+        benchmark::DoNotOptimize(ranges);
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * list.text.size()));
+    state.counters["ranges"] = static_cast<double>(ranges);
+}
+
+BENCHMARK(BM_IpFilterLoad)->Arg(0)->Arg(2)->Arg(4)->Iterations(3)->Unit(benchmark::kMillisecond);
+
+static void BM_IpFilterLookup(benchmark::State& state)
+{
+    const auto& queries = blocklist().queries;
+    const auto& f       = filter();
+    size_t i            = 0;
+    size_t blocked      = 0;
+    for (auto _ : state)
+    {
+        blocked += f.blocked(queries[i++ & (kQueries - 1)]);
+    }
+    reportLookups(state, blocked);
+}
+
+BENCHMARK(BM_IpFilterLookup);
+
+static void BM_SortedArrayLookup(benchmark::State& state)
+{
+    const auto& list = blocklist();
+    std::vector<uint32_t> firsts;
+    std::vector<uint32_t> lasts;
+    for (const auto& [first, last] : list.sorted)
+    {
+        firsts.push_back(first);
+        lasts.push_back(last);
+    }
+    size_t i       = 0;
+    size_t blocked = 0;
+    for (auto _ : state)
+    {
+        uint32_t address = addressOf(list.queries[i++ & (kQueries - 1)]);
+        auto it          = std::upper_bound(firsts.begin(), firsts.end(), address);
+        blocked += it != firsts.begin() && address <= lasts[static_cast<size_t>(it - firsts.begin()) - 1];
+    }
+    reportLookups(state, blocked);
+}
+
+BENCHMARK(BM_SortedArrayLookup);
+
+static void BM_IpBlocklistLookup(benchmark::State& state)
+{
+    static std::unique_ptr<IpBlocklist> holder;
+    static Metrics::Registry metrics;
+    if (state.thread_index() == 0)
+    {
+        holder = std::make_unique<IpBlocklist>(&metrics);
+        holder->replace(std::make_unique<const IpFilter>(filter()));
+    }
+    const auto& queries = blocklist().queries;
+    size_t i            = static_cast<size_t>(state.thread_index()) * 7'919;
+    size_t blocked      = 0;
+    for (auto _ : state)
+    {
+        blocked += holder->blocked(queries[i++ & (kQueries - 1)]);
+    }
+    reportLookups(state, blocked);
+    if (state.thread_index() == 0)
+    {
+        holder.reset();
+    }
+}
+
+BENCHMARK(BM_IpBlocklistLookup)->Threads(1)->Threads(4);
@@ -0,0 +1,87 @@
+#include <Logger.hpp>
+
+#include <benchmark/benchmark.h>
+
+// Lines per second from N threads into the file sink; Arg 0 blocks when a ring is full, Arg 1 drops.
+static void BM_LogThroughput(benchmark::State& state)
+{
+    auto& logger = Logger::instance();
+    if (state.thread_index() == 0)
+    {
+        logger.setConsoleEnabled(false);
+        logger.setOverflowPolicy(state.range(0) ? LogOverflow::Drop : LogOverflow::Block);
+    }
+    uint64_t i = 0;
+    for (auto _ : state)
+    {
+        LOG_INFO(Bench, "Block received", LOG_MD(Piece, i), LOG_MD(Offset, i * 16'384));
+        ++i;
+    }
+    state.SetItemsProcessed(state.iterations());
+    if (state.thread_index() == 0)
+    {
+        logger.flush();
+        state.counters["dropped"] = static_cast<double>(logger.droppedLines());
+    }
+}
+BENCHMARK(BM_LogThroughput)->Arg(0)->Arg(1)->Threads(1)->Threads(4)->UseRealTime();
+
+// A per-peer event into the text sink (Arg 0) or the binary one (Arg 1), writer included.
+static void BM_LogFileFormat(benchmark::State& state)
+{
+    auto& logger = Logger::instance();
+    logger.setConsoleEnabled(false);
+    logger.setOverflowPolicy(LogOverflow::Block);
+    logger.setFileFormat(state.range(0) ? LogFileFormat::Binary : LogFileFormat::Text);
+    std::string infoHash(20, '\x5a');
+    std::string_view client = "-SK0001-";
+    uint64_t i              = 0;
+    for (auto _ : state)
+    {
+        LOG_DEBUG(Peer, "Block received", LOG_MD(Hash, infoHash), LOG_MD(Client, client), LOG_MD(Piece, i),
+            LOG_MD(Offset, i * 16'384), LOG_MD(Rate, 1.5 * static_cast<double>(i)));
+        ++i;
+    }
+    logger.flush();
+    logger.setFileFormat(LogFileFormat::Text);
+    state.SetItemsProcessed(state.iterations());
+    state.SetLabel(state.range(0) ? "binary" : "text");
+}
+BENCHMARK(BM_LogFileFormat)->Arg(0)->Arg(1)->UseRealTime();
+
+namespace {
+std::string expensive(uint64_t i)
+{
+    return std::to_string(i) + std::string(64, 'x');
+}
+}  // namespace
+
+// A debug line with a costly argument in a module raised to warning: one relaxed load, no formatting.
+static void BM_LogDisabledAtRuntime(benchmark::State& state)
+{
+    Logger::instance().setModuleLevel("Quiet", LogLevel::Warning);
+    uint64_t i = 0;
+    for (auto _ : state)
+    {
+        LOG_DEBUG(Quiet, "Block received", LOG_MD(Piece, i), LOG_MD(Detail, expensive(i)));
+        benchmark::DoNotOptimize(++i);
+    }
+}
+BENCHMARK(BM_LogDisabledAtRuntime);
+
+// Formatting of typical LOG_MD values into a reused buffer, without the ring and the writer.
+static void BM_FormatFields(benchmark::State& state)
+{
+    std::string line;
+    uint64_t i = 0;
+    for (auto _ : state)
+    {
+        line.clear();
+        appendLogValue(line, i);
+        appendLogValue(line, i * 16'384);
+        appendLogValue(line, "peer");
+        benchmark::DoNotOptimize(line.data());
+        ++i;
+    }
+}
+BENCHMARK(BM_FormatFields);
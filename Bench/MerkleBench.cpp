@@ -0,0 +1,36 @@
+#include <Async/Executor.hpp>
+#include <Core/MerkleTree.hpp>
+
+#include <benchmark/benchmark.h>
+#include <random>
+
+namespace {
+std::vector<uint8_t> randomData(size_t size)
+{
+    std::mt19937 rng(42);
+    std::vector<uint8_t> data(size);
+    for (auto& b : data)
+    {
+        b = static_cast<uint8_t>(rng());
+    }
+    return data;
+}
+}  // namespace
+
+// Arg is the number of hashing threads; 0 hashes on the calling thread only.
+static void BM_HashFile(benchmark::State& state)
+{
+    static const auto data = randomData(64 * 1'024 * 1'024);
+    std::unique_ptr<Torrent::Async::Executor> executor;
+    if (state.range(0) > 0)
+    {
+        executor = std::make_unique<Torrent::Async::Executor>(static_cast<size_t>(state.range(0)));
+    }
+    for (auto _ : state)
+    {
+        auto hashes = Torrent::Core::Merkle::hashFile(data, 1 << 20, executor.get());
+        benchmark::DoNotOptimize(hashes.root.data());
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(data.size()));
+}
+BENCHMARK(BM_HashFile)->Arg(0)->Arg(2)->Arg(4)->Unit(benchmark::kMillisecond)->UseRealTime();
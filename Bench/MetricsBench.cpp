@@ -0,0 +1,60 @@
+#include <Metrics/Metrics.hpp>
+#include <Metrics/Trace.hpp>
+
+#include <benchmark/benchmark.h>
+
+using namespace Torrent::Metrics;
+
+// Counter::add from N threads against one shared atomic, which every thread's add bounces between cores.
+static void BM_CounterAdd(benchmark::State& state)
+{
+    static Counter counter;
+    for (auto _ : state)
+    {
+        counter.add();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_CounterAdd)->Threads(1)->Threads(4)->UseRealTime();
+
+static void BM_SharedAtomicAdd(benchmark::State& state)
+{
+    static std::atomic<uint64_t> counter{0};
+    for (auto _ : state)
+    {
+        counter.fetch_add(1, std::memory_order_relaxed);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SharedAtomicAdd)->Threads(1)->Threads(4)->UseRealTime();
+
+static void BM_HistogramRecord(benchmark::State& state)
+{
+    static Histogram histogram;
+    uint64_t v = 1;
+    for (auto _ : state)
+    {
+        histogram.record(v);
+        v = v * 6'364'136'223'846'793'005ULL + 1;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_HistogramRecord);
+
+// A TRACE_SCOPE with tracing off (Arg 0) and on (Arg 1).
+static void BM_TraceScope(benchmark::State& state)
+{
+    if (state.range(0))
+    {
+        Tracer::instance().start();
+    }
+    for (auto _ : state)
+    {
+        TRACE_SCOPE("bench");
+        benchmark::ClobberMemory();
+    }
+    Tracer::instance().stop();
+    Tracer::instance().clear();
+    state.SetLabel(state.range(0) ? "enabled" : "disabled");
+}
+BENCHMARK(BM_TraceScope)->Arg(0)->Arg(1);
@@ -0,0 +1,87 @@
+#include <Core/SessionManager.hpp>
+
+#include <benchmark/benchmark.h>
+#include <filesystem>
+#include <fstream>
+
+namespace {
+std::string writeTorrent()
+{
+    std::string torrent = "d4:infod6:lengthi4096e4:name5:bench12:piece lengthi16384e6:pieces20:" + std::string(20, 'A') + "ee";
+    auto path           = std::filesystem::temp_directory_path() / "sk_session_bench.torrent";
+    std::ofstream ofs(path, std::ios::binary);
+    ofs.write(torrent.data(), static_cast<std::streamsize>(torrent.size()));
+    return path.string();
+}
+
+// Resident set size in KiB, from /proc/self/status.
+long rssKb()
+{
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line))
+    {
+        if (line.starts_with("VmRSS:"))
+        {
+            return std::stol(line.substr(6));
+        }
+    }
+    return 0;
+}
+
+long threadCount()
+{
+    return static_cast<long>(std::distance(std::filesystem::directory_iterator("/proc/self/task"), {}));
+}
+}  // namespace
+
+static void BM_SessionManagerStart(benchmark::State& state)
+{
+    const auto sessions = static_cast<size_t>(state.range(0));
+    const auto path     = writeTorrent();
+
+    for (auto _ : state)
+    {
+        long rssBefore = rssKb();
+        auto begin     = std::chrono::steady_clock::now();
+
+        Torrent::Core::SessionManager::Options opts;
+        opts.tickInterval = std::chrono::milliseconds(10);
+        Torrent::Core::SessionManager manager(opts);
+
+        std::vector<std::shared_ptr<Torrent::Core::TorrentSession>> handles;
+        handles.reserve(sessions);
+        for (size_t i = 0; i < sessions; ++i)
+        {
+            handles.push_back(manager.find(manager.add("-SK0001-000000000000", path)));
+        }
+        auto added = std::chrono::steady_clock::now();
+
+        for (const auto& session : handles)
+        {
+            while (session->status().state != Torrent::Core::SessionState::Running)
+            {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+            }
+        }
+        auto running = std::chrono::steady_clock::now();
+
+        state.counters["add_ms"]             = std::chrono::duration<double, std::milli>(added - begin).count();
+        state.counters["all_running_ms"]     = std::chrono::duration<double, std::milli>(running - begin).count();
+        state.counters["rss_kb_per_session"] = static_cast<double>(rssKb() - rssBefore) / static_cast<double>(sessions);
+        state.counters["threads"]            = static_cast<double>(threadCount());
+
+        // status() is what dashboards poll: it must stay cheap while workers are busy
+        auto pollBegin = std::chrono::steady_clock::now();
+        uint64_t peers = 0;
+        for (const auto& session : handles)
+        {
+            peers += session->status().knownPeers;
+        }
+        benchmark::DoNotOptimize(peers);
+        auto pollTime               = std::chrono::steady_clock::now() - pollBegin;
+        state.counters["status_ns"] = std::chrono::duration<double, std::nano>(pollTime).count() / static_cast<double>(sessions);
+    }
+}
+
+BENCHMARK(BM_SessionManagerStart)->Arg(1'000)->Arg(10'000)->Iterations(1)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,190 @@
+#include <Async/DiskIo.hpp>
+#include <Async/Executor.hpp>
+#include <Async/IoAwaitables.hpp>
+#include <Core/PeerRouter.hpp>
+#include <Core/Swarm.hpp>
+#include <Utils/BencodeEncoder.hpp>
+
+#include <Logger.hpp>
+
+#include <benchmark/benchmark.h>
+#include <openssl/sha.h>
+
+#include <sys/resource.h>
+
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <thread>
+
+using namespace Torrent;
+using namespace std::chrono_literals;
+
+// Loopback throughput against the number of network shards. Eight torrents, each seeded on its own shard and
+// reachable only through the PeerRouter port; each torrent's leecher lives on the next shard, so both the
+// accept path and the peer traffic cross shards. The executor and disk pool grow with the shards so that
+// hashing and storage do not cap the network side. Expect near-linear scaling up to the number of free cores.
+namespace {
+constexpr uint64_t kPiece   = 256 * 1'024;
+constexpr size_t kTorrents  = 8;
+constexpr uint64_t kPayload = 8 * 1'024 * 1'024;
+
+template <typename F>
+void onLoop(Net::EventLoop& loop, F fn)
+{
+    Async::syncWait(
+        [](Net::EventLoop& loop, F fn) -> Async::Task<void>
+        {
+            co_await Async::resumeOn(loop);
+            fn();
+        }(loop, std::move(fn)));
+}
+
+double cpuSeconds()
+{
+    rusage usage{};
+    ::getrusage(RUSAGE_SELF, &usage);
+    auto seconds = [](const timeval& tv) { return static_cast<double>(tv.tv_sec) + static_cast<double>(tv.tv_usec) / 1e6; };
+    return seconds(usage.ru_utime) + seconds(usage.ru_stime);
+}
+
+// Payload on disk under root/seed<i> and its parsed metadata.
+Metadata writeTorrent(const std::filesystem::path& root, size_t index)
+{
+    std::vector<uint8_t> data(kPayload);
+    std::mt19937_64 rng(index);
+    for (auto& b : data)
+    {
+        b = static_cast<uint8_t>(rng());
+    }
+    std::string pieces;
+    for (uint64_t offset = 0; offset < kPayload; offset += kPiece)
+    {
+        unsigned char hash[SHA_DIGEST_LENGTH];
+        SHA1(data.data() + offset, kPiece, hash);
+        pieces.append(reinterpret_cast<const char*>(hash), SHA_DIGEST_LENGTH);
+    }
+    auto dir = root / ("seed" + std::to_string(index));
+    std::filesystem::create_directories(dir);
+    std::ofstream(dir / "payload.bin", std::ios::binary)
+        .write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+
+    using namespace Utils::Bencode;
+    std::string torrent;
+    encode(Value(Dict{{"info", Value(Dict{{"length", Value(kPayload)}, {"name", Value(std::string("payload.bin"))},
+                                   {"piece length", Value(kPiece)}, {"pieces", Value(pieces)}})}}),
+        torrent);
+    return Utils::parseMetadata(torrent);
+}
+
+struct Seed
+{
+    Metadata meta;
+    size_t shard = 0;
+    std::unique_ptr<Core::Storage> storage;
+    std::unique_ptr<Core::Swarm> swarm;
+};
+
+struct Leech
+{
+    std::unique_ptr<Core::Storage> storage;
+    std::unique_ptr<Core::Swarm> swarm;
+    Net::EventLoop* loop = nullptr;
+};
+}  // namespace
+
+// Arg: network shards.
+static void BM_ShardedLoopback(benchmark::State& state)
+{
+    auto shards = static_cast<size_t>(state.range(0));
+    auto root   = std::filesystem::temp_directory_path() / "sk_shard_bench";
+    Logger::instance().setConsoleEnabled(false);
+    std::filesystem::remove_all(root);
+
+    Net::LoopGroup loops({.shards = shards});
+    Async::Executor executor{shards + 1};
+    Async::DiskIo disk{2 * shards, &executor};
+    Metrics::Registry metrics;
+    Core::PeerRouter router(loops, Net::Endpoint::parse("127.0.0.1", 0), {.metrics = &metrics});
+
+    std::vector<Seed> seeds(kTorrents);
+    for (size_t i = 0; i < kTorrents; ++i)
+    {
+        auto& s   = seeds[i];
+        s.meta    = writeTorrent(root, i);
+        s.shard   = i % shards;
+        s.storage = std::make_unique<Core::Storage>(s.meta, (root / ("seed" + std::to_string(i))).string());
+        s.swarm   = std::make_unique<Core::Swarm>(loops.loop(s.shard), executor, disk, s.meta, *s.storage,
+            "-SK0001-" + std::to_string(100'000'000'000 + i));
+        Async::syncWait(s.swarm->checkFiles());
+        router.add(s.meta.infoHash, s.shard,
+            [swarm = s.swarm.get()](std::unique_ptr<Net::TcpStream> stream) { swarm->acceptPeer(std::move(stream)); });
+    }
+
+    double wallSeconds = 0;
+    double cpuTotal    = 0;
+    size_t failures    = 0;
+    for (auto _ : state)
+    {
+        std::vector<Leech> leeches(kTorrents);
+        for (size_t i = 0; i < kTorrents; ++i)
+        {
+            auto& l   = leeches[i];
+            l.loop    = &loops.loop((seeds[i].shard + 1) % shards);
+            l.storage = std::make_unique<Core::Storage>(seeds[i].meta, (root / ("leech" + std::to_string(i))).string());
+            l.swarm   = std::make_unique<Core::Swarm>(*l.loop, executor, disk, seeds[i].meta, *l.storage,
+                "-SK0001-" + std::to_string(200'000'000'000 + i));
+        }
+
+        auto start  = std::chrono::steady_clock::now();
+        double cpu0 = cpuSeconds();
+        for (auto& l : leeches)
+        {
+            onLoop(*l.loop, [&] { l.swarm->addPeer(router.localEndpoint()); });
+        }
+        size_t remaining = kTorrents;
+        while (remaining > 0 && std::chrono::steady_clock::now() - start < 120s)
+        {
+            std::this_thread::sleep_for(2ms);
+            remaining = 0;
+            for (auto& l : leeches)
+            {
+                bool complete = false;
+                onLoop(*l.loop, [&] { complete = l.swarm->picker().complete(); });
+                remaining += complete ? 0 : 1;
+            }
+        }
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        state.SetIterationTime(elapsed);
+        wallSeconds += elapsed;
+        cpuTotal += cpuSeconds() - cpu0;
+        failures += remaining;
+
+        for (auto& l : leeches)
+        {
+            Async::syncWait(l.swarm->shutdown());
+        }
+        leeches.clear();
+        for (size_t i = 0; i < kTorrents; ++i)
+        {
+            std::filesystem::remove_all(root / ("leech" + std::to_string(i)));
+        }
+    }
+
+    for (size_t i = 0; i < kTorrents; ++i)
+    {
+        router.remove(seeds[i].meta.infoHash);
+        Async::syncWait(seeds[i].swarm->shutdown());
+    }
+    seeds.clear();
+    std::filesystem::remove_all(root);
+
+    double bytes                       = static_cast<double>(kPayload * kTorrents * state.iterations());
+    auto routed                        = router.stats();
+    state.counters["throughput_MiBps"] = bytes / wallSeconds / (1'024.0 * 1'024.0);
+    state.counters["cpu_s"]            = cpuTotal / static_cast<double>(state.iterations());
+    state.counters["cross_shard"]      = static_cast<double>(routed.crossShard);
+    state.counters["routed"]           = static_cast<double>(routed.routed);
+    state.counters["failures"]         = static_cast<double>(failures);
+}
+BENCHMARK(BM_ShardedLoopback)->Arg(1)->Arg(2)->Arg(4)->Iterations(3)->UseManualTime()->Unit(benchmark::kMillisecond);
@@ -0,0 +1,100 @@
+#include <Core/StateFile.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <filesystem>
+#include <random>
+
+using namespace Torrent;
+using namespace Torrent::Core;
+
+namespace {
+constexpr size_t kSessions = 200;
+
+// kSessions single-file torrents of pieces pieces each, as .torrent bytes and as one state file.
+struct Fixture
+{
+    explicit Fixture(size_t pieces)
+    {
+        std::mt19937 rng(5);
+        std::vector<Metadata> parsed;
+        for (size_t i = 0; i < kSessions; ++i)
+        {
+            std::string hashes(pieces * 20, '\0');
+            for (auto& c : hashes)
+            {
+                c = static_cast<char>(rng());
+            }
+            auto name = "session" + std::to_string(i);
+            torrents.push_back("d8:announce27:http://127.0.0.1:1/announce4:infod6:lengthi" +
+                               std::to_string(pieces * 262'144) + "e4:name" + std::to_string(name.size()) + ":" + name +
+                               "12:piece lengthi262144e6:pieces" + std::to_string(hashes.size()) + ":" + hashes + "ee");
+            parsed.push_back(Utils::parseMetadata(torrents.back()));
+        }
+        std::vector<StateFile::Entry> entries;
+        for (const auto& meta : parsed)
+        {
+            entries.push_back({"/torrents/" + meta.name + ".torrent", &meta, false});
+        }
+        StateFile::write(path, entries);
+    }
+
+    ~Fixture()
+    {
+        std::filesystem::remove(path);
+    }
+
+    std::vector<std::string> torrents;
+    std::string path = (std::filesystem::temp_directory_path() / "sk_state_bench").string();
+};
+}  // namespace
+
+// The boot path without a state file: every .torrent parsed again.
+static void BM_ParseTorrents(benchmark::State& state)
+{
+    Fixture fixture(static_cast<size_t>(state.range(0)));
+    for (auto _ : state)
+    {
+        for (const auto& torrent : fixture.torrents)
+        {
+            auto meta = Utils::parseMetadata(torrent);
+            benchmark::DoNotOptimize(meta);
+        }
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * kSessions));
+}
+BENCHMARK(BM_ParseTorrents)->Arg(1'000)->Arg(8'000);
+
+// Mapping the state file and verifying every session's block; the views read straight out of the mapping.
+static void BM_MapStateFile(benchmark::State& state)
+{
+    Fixture fixture(static_cast<size_t>(state.range(0)));
+    for (auto _ : state)
+    {
+        auto file = StateFile::open(fixture.path);
+        for (size_t i = 0; i < file->size(); ++i)
+        {
+            auto view = file->session(i);
+            benchmark::DoNotOptimize(view->pieceHash(view->pieceCount() - 1));
+        }
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * kSessions));
+}
+BENCHMARK(BM_MapStateFile)->Arg(1'000)->Arg(8'000);
+
+// What restoreState does today: map, verify and copy into the Metadata the sessions own.
+static void BM_RestoreMetadata(benchmark::State& state)
+{
+    Fixture fixture(static_cast<size_t>(state.range(0)));
+    for (auto _ : state)
+    {
+        auto file = StateFile::open(fixture.path);
+        for (size_t i = 0; i < file->size(); ++i)
+        {
+            auto meta = file->session(i)->toMetadata();
+            benchmark::DoNotOptimize(meta);
+        }
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * kSessions));
+}
+BENCHMARK(BM_RestoreMetadata)->Arg(1'000)->Arg(8'000);
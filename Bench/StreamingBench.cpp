@@ -0,0 +1,154 @@
+#include <Async/DiskIo.hpp>
+#include <Async/Executor.hpp>
+#include <Async/IoAwaitables.hpp>
+#include <Core/Swarm.hpp>
+#include <Net/TcpStream.hpp>
+#include <Utils/BencodeEncoder.hpp>
+#include <Utils/MetaUtils.hpp>
+
+#include <benchmark/benchmark.h>
+#include <openssl/sha.h>
+
+#include <filesystem>
+#include <random>
+#include <thread>
+
+using namespace Torrent;
+using namespace std::chrono_literals;
+
+namespace {
+constexpr uint64_t kPiece     = 256 * 1'024;
+constexpr size_t kTorrentSize = 32 * 1'024 * 1'024;
+constexpr size_t kReadSize    = 64 * 1'024;
+
+template <typename F>
+void onLoop(Net::EventLoop& loop, F fn)
+{
+    Async::syncWait(
+        [](Net::EventLoop& loop, F fn) -> Async::Task<void>
+        {
+            co_await Async::resumeOn(loop);
+            fn();
+        }(loop, std::move(fn)));
+}
+
+// One fast seeder and three slow ones on loopback, shared by every iteration.
+struct LoopbackSwarm
+{
+    struct Seeder
+    {
+        std::unique_ptr<Core::Storage> storage;
+        std::unique_ptr<Core::Swarm> swarm;
+        std::unique_ptr<Net::TcpListener> listener;
+    };
+
+    LoopbackSwarm()
+    {
+        std::vector<uint8_t> data(kTorrentSize);
+        std::mt19937 rng(7);
+        for (auto& b : data)
+        {
+            b = static_cast<uint8_t>(rng());
+        }
+        std::string pieces;
+        for (size_t offset = 0; offset < data.size(); offset += kPiece)
+        {
+            unsigned char hash[SHA_DIGEST_LENGTH];
+            SHA1(data.data() + offset, kPiece, hash);
+            pieces.append(reinterpret_cast<const char*>(hash), SHA_DIGEST_LENGTH);
+        }
+        using namespace Utils::Bencode;
+        std::string raw;
+        encode(Value(Dict{{"length", Value(uint64_t{kTorrentSize})}, {"name", Value(std::string("movie.bin"))},
+                   {"piece length", Value(kPiece)}, {"pieces", Value(pieces)}}),
+            raw);
+        meta = Utils::parseInfoDict(raw);
+
+        Core::Storage source(meta, seedDir.string());
+        Async::syncWait(source.write(disk, 0, data));
+
+        for (uint64_t rate : {8 * 1'024 * 1'024, 256 * 1'024, 256 * 1'024, 256 * 1'024})
+        {
+            Core::Swarm::Options options;
+            options.uploadRateLimit = rate;
+            auto& seeder            = seeders.emplace_back();
+            seeder.storage          = std::make_unique<Core::Storage>(meta, seedDir.string());
+            seeder.swarm =
+                std::make_unique<Core::Swarm>(loop, executor, disk, meta, *seeder.storage, std::string(20, 'S'), options);
+            Async::syncWait(seeder.swarm->checkFiles());
+            onLoop(loop,
+                [&]
+                {
+                    seeder.listener = std::make_unique<Net::TcpListener>(loop, Net::Endpoint::parse("127.0.0.1", 0),
+                        [swarm = seeder.swarm.get()](std::unique_ptr<Net::TcpStream> s) { swarm->acceptPeer(std::move(s)); });
+                });
+        }
+    }
+
+    ~LoopbackSwarm()
+    {
+        for (auto& seeder : seeders)
+        {
+            Async::syncWait(seeder.swarm->shutdown());
+            onLoop(loop, [&] { seeder.listener.reset(); });
+        }
+        loop.stop();
+        std::filesystem::remove_all(seedDir);
+    }
+
+    std::filesystem::path seedDir = std::filesystem::temp_directory_path() / "sk_streaming_bench_seed";
+    Net::EventLoop loop;
+    std::jthread thread{[this] { loop.run(); }};
+    Async::Executor executor{2};
+    Async::DiskIo disk{2, &executor};
+    Metadata meta;
+    std::vector<Seeder> seeders;
+};
+}  // namespace
+
+// Time from read() to data for a 64 KiB range of a fresh leecher that has been downloading rarest first for
+// 300 ms, so peer rates are known. Arg 1 trusts every peer with urgent blocks, which shows what fast-peer gating buys.
+static void BM_TimeToFirstByte(benchmark::State& state)
+{
+    static LoopbackSwarm swarm;
+    std::mt19937 rng(1);
+    auto leechDir = std::filesystem::temp_directory_path() / "sk_streaming_bench_leech";
+    std::vector<uint8_t> buffer(kReadSize);
+
+    for (auto _ : state)
+    {
+        Core::Swarm::Options options;
+        options.fastPeerShare = state.range(0) ? 1.0 : 0.25;
+        Core::Storage storage(swarm.meta, leechDir.string());
+        Core::Swarm leecher(swarm.loop, swarm.executor, swarm.disk, swarm.meta, storage, std::string(20, 'L'), options);
+        onLoop(swarm.loop,
+            [&]
+            {
+                for (auto& seeder : swarm.seeders)
+                {
+                    leecher.addPeer(seeder.listener->localEndpoint());
+                }
+            });
+        std::this_thread::sleep_for(300ms);
+
+        uint64_t offset = 0;
+        onLoop(swarm.loop,
+            [&]
+            {
+                do
+                {
+                    offset = std::uniform_int_distribution<uint64_t>(0, kTorrentSize - kReadSize)(rng);
+                } while (leecher.picker().have(static_cast<uint32_t>(offset / kPiece)) ||
+                         leecher.picker().have(static_cast<uint32_t>((offset + kReadSize - 1) / kPiece)));
+            });
+
+        auto start = std::chrono::steady_clock::now();
+        leecher.readBlocking(0, offset, buffer);
+        state.SetIterationTime(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+
+        Async::syncWait(leecher.shutdown());
+    }
+    std::filesystem::remove_all(leechDir);
+    state.SetLabel(state.range(0) ? "no gating" : "fast peers only");
+}
+BENCHMARK(BM_TimeToFirstByte)->Arg(0)->Arg(1)->Iterations(20)->UseManualTime()->Unit(benchmark::kMillisecond);
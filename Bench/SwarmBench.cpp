@@ -0,0 +1,317 @@
+#include <Async/DiskIo.hpp>
+#include <Async/Executor.hpp>
+#include <Async/IoAwaitables.hpp>
+#include <Core/Swarm.hpp>
+#include <Core/TorrentSession.hpp>
+#include <Net/TcpStream.hpp>
+#include <Utils/BencodeEncoder.hpp>
+
+#include <Logger.hpp>
+
+#include <benchmark/benchmark.h>
+#include <openssl/sha.h>
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <array>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <random>
+#include <thread>
+
+using namespace Torrent;
+using namespace std::chrono_literals;
+
+// End to end transfer on loopback: one seeder and N leecher TorrentSessions in this process. Leechers parse the
+// .torrent, announce over HTTP to a tracker stand-in and download through Swarm, storage and the disk pool.
+// Run with --benchmark_format=json (or --benchmark_out=<file>) for machine-readable results; the counters
+// carry throughput, time-to-complete percentiles, CPU time and peak RSS.
+namespace {
+constexpr uint64_t kPiece = 256 * 1'024;
+
+template <typename F>
+void onLoop(Net::EventLoop& loop, F fn)
+{
+    Async::syncWait(
+        [](Net::EventLoop& loop, F fn) -> Async::Task<void>
+        {
+            co_await Async::resumeOn(loop);
+            fn();
+        }(loop, std::move(fn)));
+}
+
+// Answers every announce with every endpoint registered so far, in compact form. Create and destroy it on the
+// loop thread.
+class LoopbackTracker
+{
+public:
+    explicit LoopbackTracker(Net::EventLoop& loop)
+        : m_listener(loop, Net::Endpoint::parse("127.0.0.1", 0),
+              [this](std::unique_ptr<Net::TcpStream> stream) { serve(std::move(stream)); })
+    {}
+
+    std::string announceUrl() const
+    {
+        return "http://127.0.0.1:" + std::to_string(m_listener.localEndpoint().port) + "/announce";
+    }
+
+    void clear()
+    {
+        std::scoped_lock lk(m_mutex);
+        m_compact.clear();
+    }
+
+    void add(const Net::Endpoint& endpoint)
+    {
+        std::scoped_lock lk(m_mutex);
+        m_compact.append(reinterpret_cast<const char*>(endpoint.address.data()) + 12, 4);
+        m_compact += static_cast<char>(endpoint.port >> 8);
+        m_compact += static_cast<char>(endpoint.port & 0xFF);
+    }
+
+private:
+    Async::Detached serve(std::unique_ptr<Net::TcpStream> stream)
+    {
+        try
+        {
+            std::string request;
+            std::array<uint8_t, 1'024> buffer;
+            while (request.find("\r\n\r\n") == std::string::npos)
+            {
+                size_t n = co_await stream->read(buffer);
+                if (n == 0)
+                {
+                    break;
+                }
+                request.append(reinterpret_cast<const char*>(buffer.data()), n);
+            }
+            std::string body = "d8:intervali1800e5:peers";
+            {
+                std::scoped_lock lk(m_mutex);
+                Utils::Bencode::encodeString(m_compact, body);
+            }
+            body += 'e';
+            auto response = "HTTP/1.0 200 OK\r\nContent-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+            co_await stream->write({reinterpret_cast<const uint8_t*>(response.data()), response.size()});
+        }
+        catch (const std::exception&)
+        {
+            // the announce fails and the benchmark reports it
+        }
+        stream->close();
+    }
+
+    Net::TcpListener m_listener;
+    std::mutex m_mutex;
+    std::string m_compact;
+};
+
+struct Leecher
+{
+    std::unique_ptr<Core::TorrentSession> session;
+    std::unique_ptr<Core::Storage> storage;
+    std::unique_ptr<Core::Swarm> swarm;
+    std::unique_ptr<Net::TcpListener> listener;
+    std::optional<double> completedAfter;  // seconds since the first announce
+};
+
+double cpuSeconds()
+{
+    rusage usage{};
+    ::getrusage(RUSAGE_SELF, &usage);
+    auto seconds = [](const timeval& tv) { return static_cast<double>(tv.tv_sec) + static_cast<double>(tv.tv_usec) / 1e6; };
+    return seconds(usage.ru_utime) + seconds(usage.ru_stime);
+}
+
+double peakRssMiB()
+{
+    rusage usage{};
+    ::getrusage(RUSAGE_SELF, &usage);
+    return static_cast<double>(usage.ru_maxrss) / 1'024.0;  // ru_maxrss is in KiB on Linux
+}
+
+double percentile(std::vector<double> values, double q)
+{
+    if (values.empty())
+    {
+        return 0;
+    }
+    std::sort(values.begin(), values.end());
+    auto rank = static_cast<size_t>(std::ceil(q * static_cast<double>(values.size())));
+    return values[std::clamp<size_t>(rank, 1, values.size()) - 1];
+}
+}  // namespace
+
+// Args: leechers, payload in MiB.
+static void BM_LoopbackSwarm(benchmark::State& state)
+{
+    auto leecherCount = static_cast<size_t>(state.range(0));
+    auto payloadSize  = static_cast<uint64_t>(state.range(1)) * 1'024 * 1'024;
+    auto root         = std::filesystem::temp_directory_path() / "sk_swarm_bench";
+    Logger::instance().setConsoleEnabled(false);
+    std::filesystem::remove_all(root);
+    std::filesystem::create_directories(root / "seed");
+
+    Net::EventLoop loop;
+    std::jthread loopThread([&] { loop.run(); });
+    Async::Executor executor{2};
+    Async::DiskIo disk{2, &executor};
+    std::unique_ptr<LoopbackTracker> tracker;
+    onLoop(loop, [&] { tracker = std::make_unique<LoopbackTracker>(loop); });
+
+    // payload and its .torrent, written once per run
+    std::vector<uint8_t> data(payloadSize);
+    std::mt19937_64 rng(42);
+    for (auto& b : data)
+    {
+        b = static_cast<uint8_t>(rng());
+    }
+    std::string pieces;
+    for (uint64_t offset = 0; offset < payloadSize; offset += kPiece)
+    {
+        unsigned char hash[SHA_DIGEST_LENGTH];
+        SHA1(data.data() + offset, std::min(kPiece, payloadSize - offset), hash);
+        pieces.append(reinterpret_cast<const char*>(hash), SHA_DIGEST_LENGTH);
+    }
+    using namespace Utils::Bencode;
+    std::string torrent;
+    encode(Value(Dict{{"announce", Value(tracker->announceUrl())},
+               {"info", Value(Dict{{"length", Value(payloadSize)}, {"name", Value(std::string("payload.bin"))},
+                            {"piece length", Value(kPiece)}, {"pieces", Value(pieces)}})}}),
+        torrent);
+    auto torrentPath = (root / "payload.torrent").string();
+    std::ofstream(torrentPath, std::ios::binary) << torrent;
+    std::ofstream(root / "seed" / "payload.bin", std::ios::binary)
+        .write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+    data = {};
+
+    Core::TorrentSession seedSession(std::string(20, 'S'), torrentPath);
+    Async::syncWait(seedSession.prepareSession({disk, executor, loop}));
+    Core::Storage seedStorage(seedSession.metadata(), (root / "seed").string());
+    Core::Swarm seeder(loop, executor, disk, seedSession.metadata(), seedStorage, std::string(20, 'S'));
+    Async::syncWait(seeder.checkFiles());
+    std::unique_ptr<Net::TcpListener> seedListener;
+    onLoop(loop,
+        [&]
+        {
+            seedListener = std::make_unique<Net::TcpListener>(loop, Net::Endpoint::parse("127.0.0.1", 0),
+                [&seeder](std::unique_ptr<Net::TcpStream> s) { seeder.acceptPeer(std::move(s)); });
+        });
+
+    std::vector<double> completionTimes;
+    double wallSeconds = 0;
+    double cpuTotal    = 0;
+    size_t failures    = 0;
+    for (auto _ : state)
+    {
+        // the swarm starts over with the seeder only
+        tracker->clear();
+        tracker->add(seedListener->localEndpoint());
+
+        std::vector<Leecher> leechers(leecherCount);
+        for (size_t i = 0; i < leecherCount; ++i)
+        {
+            auto& l   = leechers[i];
+            auto dir  = root / ("leech" + std::to_string(i));
+            auto id   = "-SK0001-" + std::string(11, '0') + static_cast<char>('a' + i % 26);
+            l.session = std::make_unique<Core::TorrentSession>(id, torrentPath);
+            Async::syncWait(l.session->prepareSession({disk, executor, loop}));
+            l.storage = std::make_unique<Core::Storage>(l.session->metadata(), dir.string());
+            l.swarm   = std::make_unique<Core::Swarm>(loop, executor, disk, l.session->metadata(), *l.storage, id);
+            onLoop(loop,
+                [&]
+                {
+                    l.listener = std::make_unique<Net::TcpListener>(loop, Net::Endpoint::parse("127.0.0.1", 0),
+                        [swarm = l.swarm.get()](std::unique_ptr<Net::TcpStream> s) { swarm->acceptPeer(std::move(s)); });
+                });
+        }
+
+        auto start  = std::chrono::steady_clock::now();
+        double cpu0 = cpuSeconds();
+        for (auto& l : leechers)
+        {
+            if (!l.session->announce())
+            {
+                ++failures;
+            }
+            onLoop(loop,
+                [&]
+                {
+                    for (const auto& peer : l.session->peers())
+                    {
+                        if (peer.port != l.listener->localEndpoint().port)
+                        {
+                            l.swarm->addPeer(peer);
+                        }
+                    }
+                    tracker->add(l.listener->localEndpoint());
+                });
+        }
+
+        size_t remaining = leecherCount;
+        while (remaining > 0 && std::chrono::steady_clock::now() - start < 120s)
+        {
+            std::this_thread::sleep_for(5ms);
+            onLoop(loop,
+                [&]
+                {
+                    double now = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                    for (auto& l : leechers)
+                    {
+                        if (!l.completedAfter && l.swarm->picker().complete())
+                        {
+                            l.completedAfter = now;
+                            --remaining;
+                        }
+                    }
+                });
+        }
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        cpuTotal += cpuSeconds() - cpu0;
+        wallSeconds += elapsed;
+        state.SetIterationTime(elapsed);
+        for (auto& l : leechers)
+        {
+            completionTimes.push_back(l.completedAfter.value_or(elapsed));
+            failures += l.completedAfter ? 0 : 1;
+        }
+
+        for (auto& l : leechers)
+        {
+            Async::syncWait(l.swarm->shutdown());
+            onLoop(loop, [&] { l.listener.reset(); });
+        }
+        leechers.clear();
+        for (size_t i = 0; i < leecherCount; ++i)
+        {
+            std::filesystem::remove_all(root / ("leech" + std::to_string(i)));
+        }
+    }
+
+    Async::syncWait(seeder.shutdown());
+    onLoop(loop,
+        [&]
+        {
+            seedListener.reset();
+            tracker.reset();
+        });
+    loop.stop();
+    std::filesystem::remove_all(root);
+
+    double bytes                       = static_cast<double>(payloadSize * leecherCount * state.iterations());
+    state.counters["throughput_MiBps"] = bytes / wallSeconds / (1'024.0 * 1'024.0);
+    state.counters["ttc_p50_ms"]       = percentile(completionTimes, 0.50) * 1e3;
+    state.counters["ttc_p90_ms"]       = percentile(completionTimes, 0.90) * 1e3;
+    state.counters["ttc_p99_ms"]       = percentile(completionTimes, 0.99) * 1e3;
+    state.counters["cpu_s"]            = cpuTotal / static_cast<double>(state.iterations());
+    state.counters["peak_rss_MiB"]     = peakRssMiB();
+    state.counters["failures"]         = static_cast<double>(failures);
+}
+BENCHMARK(BM_LoopbackSwarm)
+    ->Args({1, 16})
+    ->Args({4, 16})
+    ->Iterations(3)
+    ->UseManualTime()
+    ->Unit(benchmark::kMillisecond);
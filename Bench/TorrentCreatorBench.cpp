@@ -0,0 +1,60 @@
+#include <Async/Executor.hpp>
+#include <Core/TorrentCreator.hpp>
+#include <Logger.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <filesystem>
+#include <fstream>
+#include <random>
+
+using namespace Torrent;
+
+namespace {
+constexpr size_t kFiles    = 8;
+constexpr size_t kFileSize = 16 * 1'024 * 1'024 + 4'321;  // off piece boundaries, so pieces span files
+
+// Written once; after the first iteration it is read from the page cache, so this measures hashing and the
+// read path rather than the disk.
+const std::filesystem::path& content()
+{
+    static const auto root = []
+    {
+        auto dir = std::filesystem::temp_directory_path() / "sk_creator_bench";
+        std::filesystem::remove_all(dir);
+        std::filesystem::create_directories(dir);
+        std::mt19937_64 rng(5);
+        std::string data(kFileSize, '\0');
+        for (size_t f = 0; f < kFiles; ++f)
+        {
+            for (auto& c : data)
+            {
+                c = static_cast<char>(rng());
+            }
+            std::ofstream(dir / ("part" + std::to_string(f)), std::ios::binary) << data;
+        }
+        return dir;
+    }();
+    return root;
+}
+}  // namespace
+
+// Args: executor workers (the caller hashes too), format.
+static void BM_CreateTorrent(benchmark::State& state)
+{
+    Logger::instance().setConsoleEnabled(false);
+    Async::Executor executor{static_cast<size_t>(state.range(0))};
+    Core::CreateOptions options;
+    options.format = static_cast<Core::TorrentFormat>(state.range(1));
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(Core::createTorrent(content().string(), options, &executor));
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * kFiles * kFileSize));
+    constexpr const char* labels[] = {"v1", "v2", "hybrid"};
+    state.SetLabel(labels[state.range(1)]);
+}
+BENCHMARK(BM_CreateTorrent)
+    ->ArgsProduct({{1, 3}, {0, 1, 2}})
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
@@ -1,10 +1,305 @@
 #include <iostream>
+#include <Core/ControlServer.hpp>
+#include <Core/TorrentCreator.hpp>
 #include <Core/TorrentSession.hpp>
 
-int main()
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string_view>
+
+namespace {
+void printCreateUsage()
+{
+    std::cerr << "usage: skTorrent create <file or directory> [-o out.torrent] [--v1 | --v2 | --hybrid]\n"
+                 "                        [--piece-length bytes] [-t tracker]... [--tier] [--comment text] [--private]\n"
+                 "  -t adds a tracker to the current tier, --tier starts a new one\n";
+}
+
+int create(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        printCreateUsage();
+        return 2;
+    }
+    std::string root = argv[2];
+    std::string output;
+    Torrent::Core::CreateOptions options;
+    options.creationDate = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+    for (int i = 3; i < argc; ++i)
+    {
+        std::string_view arg = argv[i];
+        bool hasValue        = i + 1 < argc;
+        if (arg == "--v1" || arg == "--v2" || arg == "--hybrid")
+        {
+            options.format = arg == "--v1" ? Torrent::Core::TorrentFormat::V1
+                           : arg == "--v2" ? Torrent::Core::TorrentFormat::V2
+                                           : Torrent::Core::TorrentFormat::Hybrid;
+        }
+        else if (arg == "--private")
+        {
+            options.isPrivate = true;
+        }
+        else if (arg == "--tier")
+        {
+            options.trackers.emplace_back();
+        }
+        else if (arg == "-o" && hasValue)
+        {
+            output = argv[++i];
+        }
+        else if (arg == "-t" && hasValue)
+        {
+            if (options.trackers.empty())
+            {
+                options.trackers.emplace_back();
+            }
+            options.trackers.back().emplace_back(argv[++i]);
+        }
+        else if (arg == "--piece-length" && hasValue)
+        {
+            options.pieceLength = std::stoull(argv[++i]);
+        }
+        else if (arg == "--comment" && hasValue)
+        {
+            options.comment = argv[++i];
+        }
+        else
+        {
+            printCreateUsage();
+            return 2;
+        }
+    }
+    std::erase_if(options.trackers, [](const auto& tier) { return tier.empty(); });
+    if (output.empty())
+    {
+        output = std::filesystem::path(root).lexically_normal().filename().string();
+        if (output.empty())
+        {
+            output = std::filesystem::path(root).lexically_normal().parent_path().filename().string();
+        }
+        output += ".torrent";
+    }
+
+    auto torrent = Torrent::Core::createTorrent(root, options);
+    std::ofstream out(output, std::ios::binary);
+    out.write(torrent.data(), static_cast<std::streamsize>(torrent.size()));
+    out.close();
+    if (!out)
+    {
+        std::cerr << "cannot write " << output << ": " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+    auto meta = Torrent::Utils::parseMetadata(torrent);
+    std::cout << output << ": " << meta.files.size() << " files, " << meta.totalSize << " bytes, piece length "
+              << meta.pieceLength << std::endl;
+    return 0;
+}
+
+std::string defaultSocket()
+{
+    const char* runtimeDir = std::getenv("XDG_RUNTIME_DIR");
+    return std::string(runtimeDir ? runtimeDir : "/tmp") + "/skTorrent.sock";
+}
+
+// Takes "<name> value" out of the arguments following the mode.
+std::string takeOption(std::vector<std::string>& args, std::string_view name, std::string fallback)
+{
+    auto it = std::find(args.begin(), args.end(), name);
+    if (it == args.end() || it + 1 == args.end())
+    {
+        return fallback;
+    }
+    std::string value = *(it + 1);
+    args.erase(it, it + 2);
+    return value;
+}
+
+// Takes every "<name> value" out of the arguments following the mode, in order.
+std::vector<std::string> takeOptions(std::vector<std::string>& args, std::string_view name)
+{
+    std::vector<std::string> values;
+    for (auto value = takeOption(args, name, {}); !value.empty(); value = takeOption(args, name, {}))
+    {
+        values.push_back(std::move(value));
+    }
+    return values;
+}
+
+std::string socketOption(std::vector<std::string>& args)
 {
-    std::string filePath = "/home/f1xdsl/dev/skeborrent/build/cms14.torrent";
-    Torrent::TorrentSession torrent(filePath);
+    return takeOption(args, "--socket", defaultSocket());
+}
+
+int runDaemon(std::vector<std::string> args)
+{
+    using namespace Torrent::Utils::Bencode;
+    auto socket     = socketOption(args);
+    auto state      = takeOption(args, "--state", {});
+    auto blocklists = takeOptions(args, "--blocklist");
+
+    // blocked before any thread starts so that only sigwait below sees them
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    sigaddset(&signals, SIGHUP);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    Torrent::Core::SessionManager sessions;
+    Torrent::Core::ControlServer control(sessions, socket, blocklists);
+    if (!blocklists.empty())
+    {
+        // before any session, so that none talks to a blocked peer; a list that cannot be read stops the start
+        auto loaded = control.handle({{"op", Value(std::string("blocklist"))}});
+        if (loaded.at("ok").asInt() != 1)
+        {
+            std::cerr << "cannot load blocklist: " << loaded.at("error").asStr() << std::endl;
+            return 1;
+        }
+        std::cout << "blocklist: " << loaded.at("ranges").asInt() << " ranges, " << loaded.at("rejected").asInt()
+                  << " lines rejected" << std::endl;
+    }
+    if (!state.empty() && std::filesystem::exists(state))
+    {
+        try
+        {
+            auto restored = sessions.restoreState(state);
+            std::cout << "restored " << restored.restored << " sessions, " << restored.reparsed << " from their source"
+                      << std::endl;
+        }
+        catch (const std::exception& e)
+        {
+            // starting empty would overwrite the file with no sessions on the way out
+            std::cerr << "cannot restore " << state << ": " << e.what() << "; move it aside to start without it"
+                      << std::endl;
+            return 1;
+        }
+    }
+    for (const auto& source : args)
+    {
+        control.handle({{"op", Value(std::string("add"))}, {"source", Value(source)}});
+    }
+    std::cout << "skTorrent daemon listening on " << socket << std::endl;
+    int received = 0;
+    while (sigwait(&signals, &received) == 0 && received == SIGHUP)
+    {
+        // reloads the blocklist files, as the blocklist control op does
+        auto reloaded = control.handle({{"op", Value(std::string("blocklist"))}});
+        if (reloaded.at("ok").asInt() == 1)
+        {
+            std::cout << "blocklist reloaded: " << reloaded.at("ranges").asInt() << " ranges" << std::endl;
+        }
+        else
+        {
+            std::cerr << "blocklist not reloaded: " << reloaded.at("error").asStr() << std::endl;
+        }
+    }
+    std::cout << "stopping on signal " << received << std::endl;
+    if (!state.empty())
+    {
+        std::cout << "saved " << sessions.saveState(state) << " sessions to " << state << std::endl;
+    }
+    return 0;
+}
+
+void print(const Torrent::Utils::Bencode::Value& value, int indent)
+{
+    using namespace Torrent::Utils::Bencode;
+    std::string pad(static_cast<size_t>(indent) * 2, ' ');
+    if (value.isInt())
+    {
+        std::cout << value.asInt();
+    }
+    else if (value.isStr())
+    {
+        std::cout << '"' << value.asStr() << '"';
+    }
+    else if (value.isList())
+    {
+        std::cout << "[";
+        for (const auto& item : value.asList())
+        {
+            std::cout << "\n" << pad << "  ";
+            print(item, indent + 1);
+        }
+        std::cout << (value.asList().empty() ? "]" : "\n" + pad + "]");
+    }
+    else
+    {
+        std::cout << "{";
+        for (const auto& [key, item] : value.asDict())
+        {
+            std::cout << "\n" << pad << "  " << key << ": ";
+            print(item, indent + 1);
+        }
+        std::cout << (value.asDict().empty() ? "}" : "\n" + pad + "}");
+    }
+}
+
+int runControl(std::vector<std::string> args)
+{
+    using namespace Torrent::Utils::Bencode;
+    auto socket = socketOption(args);
+    if (args.empty())
+    {
+        std::cerr << "usage: skTorrent ctl [--socket path] add <source> | remove <id> | pause <id> | resume <id> |"
+                     " status [id] | stats | blocklist\n";
+        return 2;
+    }
+    Dict request{{"op", Value(args[0])}};
+    if (args.size() > 1)
+    {
+        if (args[0] == "add")
+        {
+            request.emplace("source", Value(args[1]));
+        }
+        else
+        {
+            request.emplace("id", Value(uint64_t{std::stoull(args[1])}));
+        }
+    }
+    Torrent::Core::ControlClient client(socket);
+    auto response = client.request(request);
+    print(Value(response), 0);
+    std::cout << std::endl;
+    auto ok = response.find("ok");
+    return ok != response.end() && ok->second.isInt() && ok->second.asInt() == 1 ? 0 : 1;
+}
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    if (argc > 1 && (std::strcmp(argv[1], "create") == 0 || std::strcmp(argv[1], "daemon") == 0 ||
+                        std::strcmp(argv[1], "ctl") == 0))
+    {
+        std::string_view mode = argv[1];
+        try
+        {
+            if (mode == "create")
+            {
+                return create(argc, argv);
+            }
+            std::vector<std::string> args(argv + 2, argv + argc);
+            return mode == "daemon" ? runDaemon(std::move(args)) : runControl(std::move(args));
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << mode << " failed: " << e.what() << std::endl;
+            return 1;
+        }
+    }
+
+    std::string filePath = argc > 1 ? argv[1] : "/home/f1xdsl/dev/skeborrent/build/cms14.torrent";
+    std::string peerId   = "-SK0001-000000000000";
+    Torrent::Core::TorrentSession torrent(peerId, filePath);
     auto request = torrent.getAnnounceRequest();
     std::cout << request << std::endl;
     return 0;
@@ -0,0 +1,298 @@
+#ifndef LOGBINARY_HPP
+#define LOGBINARY_HPP
+
+#include <bit>
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Compact log file format. A file starts with Magic and is a sequence of frames <type:1><length:varint><payload>.
+// A Definition frame describes one call site once per file: id, level, module, title and the LOG_MD keys. An
+// Event frame carries the site id, the time in microseconds since the epoch and the raw arguments, each a tag byte
+// and its value. Definitions always precede the events that use them.
+namespace LogBinary {
+
+constexpr std::string_view Magic = "SKLOGB1\n";
+
+enum class FrameType : uint8_t
+{
+    Definition = 'D',
+    Event      = 'E'
+};
+
+enum class ArgType : uint8_t
+{
+    UInt,    // varint
+    Int,     // zigzag varint
+    Float,   // 4 bytes, little endian
+    Double,  // 8 bytes, little endian
+    Bytes    // varint length and raw bytes; strings, hashes and anything pre-rendered
+};
+
+// Indexed by LogLevel.
+inline std::string_view levelLetter(uint8_t level)
+{
+    constexpr std::string_view letters = "TDIWEC";
+    return level < letters.size() ? letters.substr(level, 1) : "U";
+}
+
+inline void putVarint(std::string& out, uint64_t v)
+{
+    while (v >= 0x80)
+    {
+        out += static_cast<char>((v & 0x7F) | 0x80);
+        v >>= 7;
+    }
+    out += static_cast<char>(v);
+}
+
+inline void putBytes(std::string& out, std::string_view bytes)
+{
+    putVarint(out, bytes.size());
+    out += bytes;
+}
+
+inline void putUInt(std::string& out, uint64_t v)
+{
+    out += static_cast<char>(ArgType::UInt);
+    putVarint(out, v);
+}
+
+inline void putInt(std::string& out, int64_t v)
+{
+    out += static_cast<char>(ArgType::Int);
+    putVarint(out, (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63));
+}
+
+template <typename F>
+void putFloating(std::string& out, F v)
+{
+    static_assert(std::endian::native == std::endian::little, "binary logs are written little endian");
+    out += static_cast<char>(sizeof(F) == 4 ? ArgType::Float : ArgType::Double);
+    out.append(reinterpret_cast<const char*>(&v), sizeof(v));
+}
+
+inline void putString(std::string& out, std::string_view s)
+{
+    out += static_cast<char>(ArgType::Bytes);
+    putBytes(out, s);
+}
+
+inline void putFrame(std::string& out, FrameType type, std::string_view payload)
+{
+    out += static_cast<char>(type);
+    putVarint(out, payload.size());
+    out += payload;
+}
+
+// Reads back what the put* functions wrote; throws std::runtime_error on truncated or malformed input.
+class Reader
+{
+public:
+    explicit Reader(std::string_view data)
+        : m_data(data)
+    {}
+
+    bool done() const
+    {
+        return m_data.empty();
+    }
+
+    uint8_t byte()
+    {
+        need(1);
+        auto b = static_cast<uint8_t>(m_data[0]);
+        m_data.remove_prefix(1);
+        return b;
+    }
+
+    uint64_t varint()
+    {
+        uint64_t v = 0;
+        for (unsigned shift = 0; shift < 64; shift += 7)
+        {
+            uint8_t b  = byte();
+            v         |= uint64_t{b & 0x7Fu} << shift;
+            if (!(b & 0x80))
+            {
+                return v;
+            }
+        }
+        throw std::runtime_error("Malformed varint in binary log");
+    }
+
+    std::string_view bytes()
+    {
+        return take(varint());
+    }
+
+    std::string_view take(size_t n)
+    {
+        need(n);
+        auto out = m_data.substr(0, n);
+        m_data.remove_prefix(n);
+        return out;
+    }
+
+private:
+    void need(size_t n) const
+    {
+        if (m_data.size() < n)
+        {
+            throw std::runtime_error("Truncated binary log");
+        }
+    }
+
+    std::string_view m_data;
+};
+
+// Renders binary log files back into the text format of the text sink.
+class Decoder
+{
+public:
+    // Decodes one whole file; definitions carry over, so rotated files may be fed in order.
+    std::string decode(std::string_view file)
+    {
+        if (!file.starts_with(Magic))
+        {
+            throw std::runtime_error("Not a binary log file");
+        }
+        Reader in(file.substr(Magic.size()));
+        std::string out;
+        while (!in.done())
+        {
+            auto type = static_cast<FrameType>(in.byte());
+            Reader frame(in.bytes());
+            if (type == FrameType::Definition)
+            {
+                define(frame);
+            }
+            else if (type == FrameType::Event)
+            {
+                render(frame, out);
+            }
+        }
+        return out;
+    }
+
+private:
+    struct Definition
+    {
+        uint8_t level = 0;
+        std::string module;
+        std::string title;
+        std::vector<std::string> keys;
+    };
+
+    void define(Reader& frame)
+    {
+        uint64_t id = frame.varint();
+        Definition def;
+        def.level  = frame.byte();
+        def.module = frame.bytes();
+        def.title  = frame.bytes();
+        for (uint64_t n = frame.varint(); n > 0; --n)
+        {
+            def.keys.emplace_back(frame.bytes());
+        }
+        m_definitions[id] = std::move(def);
+    }
+
+    static void appendTime(std::string& out, uint64_t micros)
+    {
+        auto t = static_cast<std::time_t>(micros / 1'000'000);
+        std::tm tmv{};
+        localtime_r(&t, &tmv);
+        char buf[32];
+        int n = std::snprintf(buf, sizeof(buf), "%04d-%02d-%02d %02d:%02d:%02d", tmv.tm_year + 1'900, tmv.tm_mon + 1,
+            tmv.tm_mday, tmv.tm_hour, tmv.tm_min, tmv.tm_sec);
+        out.append(buf, static_cast<size_t>(n));
+    }
+
+    template <typename T>
+    static void appendNumber(std::string& out, T v)
+    {
+        char buf[64];
+        auto result = std::to_chars(buf, buf + sizeof(buf), v);
+        out.append(buf, result.ptr);
+    }
+
+    static void appendArg(Reader& frame, std::string& out)
+    {
+        switch (static_cast<ArgType>(frame.byte()))
+        {
+        case ArgType::UInt:
+            appendNumber(out, frame.varint());
+            break;
+        case ArgType::Int:
+        {
+            uint64_t z = frame.varint();
+            appendNumber(out, static_cast<int64_t>((z >> 1) ^ (~(z & 1) + 1)));
+            break;
+        }
+        case ArgType::Float:
+        {
+            float v;
+            std::memcpy(&v, frame.take(sizeof(v)).data(), sizeof(v));
+            appendNumber(out, v);
+            break;
+        }
+        case ArgType::Double:
+        {
+            double v;
+            std::memcpy(&v, frame.take(sizeof(v)).data(), sizeof(v));
+            appendNumber(out, v);
+            break;
+        }
+        case ArgType::Bytes:
+            out += frame.bytes();
+            break;
+        default:
+            throw std::runtime_error("Unknown argument type in binary log");
+        }
+    }
+
+    void render(Reader& frame, std::string& out)
+    {
+        auto it = m_definitions.find(frame.varint());
+        if (it == m_definitions.end())
+        {
+            throw std::runtime_error("Binary log event without a definition");
+        }
+        const auto& def = it->second;
+        appendTime(out, frame.varint());
+        out += " [";
+        out += levelLetter(def.level);
+        out += "] [";
+        out += def.module;
+        out += "] ";
+        out += def.title;
+        for (size_t i = 0; i < def.keys.size(); ++i)
+        {
+            out += ' ';
+            if (def.keys[i].empty())
+            {
+                appendArg(frame, out);
+                continue;
+            }
+            out += def.keys[i];
+            out += '[';
+            appendArg(frame, out);
+            out += ']';
+        }
+        out += '\n';
+    }
+
+    std::unordered_map<uint64_t, Definition> m_definitions;
+};
+
+}  // namespace LogBinary
+
+#endif  // LOGBINARY_HPP
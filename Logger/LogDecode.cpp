@@ -0,0 +1,36 @@
+#include "LogBinary.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+// Prints binary log files as text. Rotated files are given oldest first: skLogDecode skTorrent.2.sklog ...
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        std::cerr << "usage: " << argv[0] << " <file.sklog>...\n";
+        return 2;
+    }
+    LogBinary::Decoder decoder;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::ifstream in(argv[i], std::ios::binary);
+        if (!in)
+        {
+            std::cerr << argv[i] << ": cannot open\n";
+            return 1;
+        }
+        std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        try
+        {
+            std::cout << decoder.decode(data);
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << argv[i] << ": " << e.what() << '\n';
+            return 1;
+        }
+    }
+    return 0;
+}
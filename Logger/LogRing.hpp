@@ -0,0 +1,115 @@
+#ifndef LOGRING_HPP
+#define LOGRING_HPP
+
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Single-producer single-consumer byte ring of length-prefixed records. The owning thread pushes, the logger's
+// writer thread consumes, and neither takes a lock. Positions grow without bound and are masked on access.
+class LogRing
+{
+public:
+    explicit LogRing(size_t capacity)
+        : m_buffer(std::bit_ceil(capacity))
+        , m_mask(m_buffer.size() - 1)
+    {}
+
+    LogRing(const LogRing&) = delete;
+
+    size_t capacity() const
+    {
+        return m_buffer.size();
+    }
+
+    // False when the record does not fit right now.
+    bool tryPush(std::string_view record)
+    {
+        auto len      = static_cast<uint32_t>(record.size());
+        size_t need   = sizeof(len) + len;
+        uint64_t head = m_head.load(std::memory_order_relaxed);
+        if (need > m_buffer.size() - (head - m_tail.load(std::memory_order_acquire)))
+        {
+            return false;
+        }
+        copyIn(head, &len, sizeof(len));
+        copyIn(head + sizeof(len), record.data(), len);
+        m_head.store(head + need, std::memory_order_release);
+        return true;
+    }
+
+    // Hands every complete record to onRecord; the view is only valid during the call.
+    template <typename F>
+    size_t consume(F&& onRecord)
+    {
+        uint64_t tail = m_tail.load(std::memory_order_relaxed);
+        uint64_t head = m_head.load(std::memory_order_acquire);
+        size_t count  = 0;
+        while (tail != head)
+        {
+            uint32_t len = 0;
+            copyOut(tail, &len, sizeof(len));
+            size_t begin = (tail + sizeof(len)) & m_mask;
+            if (begin + len <= m_buffer.size())
+            {
+                onRecord(std::string_view(m_buffer.data() + begin, len));
+            }
+            else
+            {
+                m_scratch.resize(len);
+                copyOut(tail + sizeof(len), m_scratch.data(), len);
+                onRecord(std::string_view(m_scratch));
+            }
+            tail += sizeof(len) + len;
+            ++count;
+        }
+        m_tail.store(tail, std::memory_order_release);
+        return count;
+    }
+
+    bool empty() const
+    {
+        return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+    }
+
+    // The owning thread exited; the writer drops the ring once it is drained.
+    void retire()
+    {
+        m_retired.store(true, std::memory_order_release);
+    }
+
+    bool retired() const
+    {
+        return m_retired.load(std::memory_order_acquire);
+    }
+
+private:
+    void copyIn(uint64_t pos, const void* data, size_t len)
+    {
+        size_t at    = pos & m_mask;
+        size_t first = std::min(len, m_buffer.size() - at);
+        std::memcpy(m_buffer.data() + at, data, first);
+        std::memcpy(m_buffer.data(), static_cast<const char*>(data) + first, len - first);
+    }
+
+    void copyOut(uint64_t pos, void* out, size_t len) const
+    {
+        size_t at    = pos & m_mask;
+        size_t first = std::min(len, m_buffer.size() - at);
+        std::memcpy(out, m_buffer.data() + at, first);
+        std::memcpy(static_cast<char*>(out) + first, m_buffer.data(), len - first);
+    }
+
+    std::vector<char> m_buffer;
+    size_t m_mask;
+    alignas(64) std::atomic<uint64_t> m_head{0};  // written by the producer
+    alignas(64) std::atomic<uint64_t> m_tail{0};  // written by the consumer
+    std::atomic<bool> m_retired{false};
+    std::string m_scratch;  // consumer only, for records that wrap
+};
+
+#endif  // LOGRING_HPP
@@ -12,17 +12,165 @@
 #include <cstdio>
 #include <filesystem>
 #include <cstdint>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <charconv>
+#include <functional>
+#include <iterator>
+#include <version>
+#ifdef __cpp_lib_format
+#include <format>
+#endif
+
+#include "LogBinary.hpp"
+#include "LogRing.hpp"
 
-enum class LogLevel
+// Ordered by severity; a threshold lets through its own level and everything above it.
+enum class LogLevel : uint8_t
 {
-    Info,
-    Debug,
     Trace,
+    Debug,
+    Info,
     Warning,
     Error,
     Critical
 };
 
+// Lowest level compiled in at all, as the numeric LogLevel; calls below it generate no code.
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL 0
+#endif
+
+// At level 0 every level is in: the comparison would be always true and warn under -Wtype-limits at every call.
+#if LOG_COMPILE_LEVEL > 0
+#define LOG_COMPILED_IN(lvl) (static_cast<int>(lvl) >= LOG_COMPILE_LEVEL)
+#else
+#define LOG_COMPILED_IN(lvl) true
+#endif
+
+template <typename T>
+concept Ostreamable = requires(std::ostream& os, const T& v) {
+    { os << v } -> std::same_as<std::ostream&>;
+};
+
+// Appends a value the way operator<< would print it, without a stream for the common types: integers and
+// enums as numbers, floating point in shortest form, bool as 0/1, anything string-like verbatim.
+template <typename T>
+void appendLogValue(std::string& out, const T& v)
+{
+    if constexpr (std::is_same_v<T, bool>)
+    {
+        out += v ? '1' : '0';
+    }
+    else if constexpr (std::is_same_v<T, char>)
+    {
+        out += v;
+    }
+    else if constexpr (std::is_enum_v<T>)
+    {
+        appendLogValue(out, static_cast<std::underlying_type_t<T>>(v));
+    }
+    else if constexpr (std::is_arithmetic_v<T>)
+    {
+        char buf[64];
+        auto result = std::to_chars(buf, buf + sizeof(buf), v);
+        out.append(buf, result.ptr);
+    }
+    else if constexpr (std::is_convertible_v<const T&, std::string_view>)
+    {
+        out += std::string_view(v);
+    }
+#ifdef __cpp_lib_format
+    else if constexpr (std::formattable<T, char>)
+    {
+        std::format_to(std::back_inserter(out), "{}", v);
+    }
+#endif
+    else
+    {
+        static_assert(Ostreamable<T>, "LOG_MD value has no text form");
+        thread_local std::ostringstream oss;
+        oss.str({});
+        oss << v;
+        out += oss.view();
+    }
+}
+
+// What LOG_MD captures: the key and a reference to the value, formatted only if the line is emitted.
+template <typename T>
+struct LogField
+{
+    std::string_view key;
+    const T& value;
+};
+
+// What a logging thread does when its ring is full: drop the line (counted in droppedLines) or wait for the
+// writer to make room.
+enum class LogOverflow
+{
+    Drop,
+    Block
+};
+
+// Text writes the lines as they appear on the console. Binary writes a format id and the raw arguments per line
+// (see LogBinary.hpp) and skLogDecode turns the file back into text; the console stays text either way.
+enum class LogFileFormat
+{
+    Text,
+    Binary
+};
+
+#ifndef LOG_RING_CAPACITY
+#define LOG_RING_CAPACITY (256 * 1'024)
+#endif
+
+#ifndef LOG_ROTATE_BYTES
+#define LOG_ROTATE_BYTES (64 * 1'024 * 1'024)
+#endif
+
+// Resolves the module's runtime threshold once per call site. In binary mode the site also stands for its level,
+// module, title and field keys, written to the file once under formatId(); the title must therefore be constant.
+class LogSite
+{
+public:
+    explicit LogSite(std::string_view module);
+
+    bool enabled(LogLevel lvl) const
+    {
+        return lvl >= m_level->load(std::memory_order_relaxed);
+    }
+
+    std::string_view name() const
+    {
+        return m_module;
+    }
+
+    // 0 until the site first logs in binary mode.
+    uint32_t formatId() const
+    {
+        return m_formatId.load(std::memory_order_acquire);
+    }
+
+private:
+    friend class Logger;
+
+    std::string_view m_module;
+    const std::atomic<LogLevel>* m_level;
+    mutable std::atomic<uint32_t> m_formatId{0};
+};
+
+// Lines are formatted on the calling thread into a thread-local buffer and pushed into that thread's lock-free
+// ring; one background thread drains all rings and writes them to stdout and the log file in batches. Output is
+// asynchronous: call flush() when a line must be on disk, e.g. before reading the file back.
+//
+// The file is skTorrent.log (skTorrent.sklog when binary) in the log directory, shared by every run. Once it would
+// grow past the rotation size it becomes skTorrent.1.log, older files shift up by one and the oldest is deleted.
 class Logger
 {
 public:
@@ -33,50 +181,119 @@ public:
     }
 
     template <typename... Args>
-    static void logInfo(std::string_view module, std::string_view title, Args&&... args)
+    static void log(const LogSite& site, LogLevel lvl, std::string_view title, const Args&... args)
+    {
+        auto& logger = instance();
+        if (logger.m_binary.load(std::memory_order_relaxed))
+        {
+            logger.logBinary(site, lvl, title, args...);
+            if (!logger.m_console.load(std::memory_order_relaxed))
+            {
+                return;
+            }
+        }
+        logText(lvl, site.name(), title, args...);
+    }
+
+    // Runtime threshold for every module, replacing earlier per-module settings; also the default for modules
+    // that have not logged yet.
+    void setLevel(LogLevel lvl)
     {
-        logImpl(LogLevel::Info, module, title, std::forward<Args>(args)...);
+        std::scoped_lock lk(m_levelsMutex);
+        m_defaultLevel = lvl;
+        for (auto& [name, level] : m_levels)
+        {
+            level.store(lvl, std::memory_order_relaxed);
+        }
     }
 
-    template <typename... Args>
-    static void logDebug(std::string_view module, std::string_view title, Args&&... args)
+    void setModuleLevel(std::string_view module, LogLevel lvl)
     {
-        logImpl(LogLevel::Debug, module, title, std::forward<Args>(args)...);
+        levelSlot(module).store(lvl, std::memory_order_relaxed);
     }
 
-    template <typename... Args>
-    static void logTrace(std::string_view module, std::string_view title, Args&&... args)
+    // Threshold cell of a module; stays valid for the life of the logger, so call sites can keep a pointer.
+    std::atomic<LogLevel>& levelSlot(std::string_view module)
+    {
+        std::scoped_lock lk(m_levelsMutex);
+        auto it = m_levels.find(module);
+        if (it == m_levels.end())
+        {
+            it = m_levels.try_emplace(std::string(module), m_defaultLevel).first;
+        }
+        return it->second;
+    }
+
+    void setOverflowPolicy(LogOverflow policy)
     {
-        logImpl(LogLevel::Trace, module, title, std::forward<Args>(args)...);
+        m_overflow.store(policy, std::memory_order_relaxed);
     }
 
-    template <typename... Args>
-    static void logWarning(std::string_view module, std::string_view title, Args&&... args)
+    void setConsoleEnabled(bool enabled)
     {
-        logImpl(LogLevel::Warning, module, title, std::forward<Args>(args)...);
+        m_console.store(enabled, std::memory_order_relaxed);
     }
 
-    template <typename... Args>
-    static void logError(std::string_view module, std::string_view title, Args&&... args)
+    uint64_t droppedLines() const
     {
-        logImpl(LogLevel::Error, module, title, std::forward<Args>(args)...);
+        return m_dropped.load(std::memory_order_relaxed);
     }
 
-    template <typename... Args>
-    static void logCritical(std::string_view module, std::string_view title, Args&&... args)
+    std::string path() const
     {
-        logImpl(LogLevel::Critical, module, title, std::forward<Args>(args)...);
+        std::scoped_lock lk(m_fileMutex);
+        return m_path;
+    }
+
+    // Switches the file sink and reopens the file. Meant for startup: lines logged concurrently with the switch
+    // may miss the file.
+    void setFileFormat(LogFileFormat format)
+    {
+        flush();
+        std::scoped_lock lk(m_fileMutex);
+        m_format = format;
+        openFile();
+        m_binary.store(format == LogFileFormat::Binary, std::memory_order_relaxed);
+    }
+
+    // keepFiles rotated files are kept next to the current one; 0 deletes the file when it is full.
+    void setRotation(uint64_t maxBytes, unsigned keepFiles)
+    {
+        std::scoped_lock lk(m_fileMutex);
+        m_rotateBytes = maxBytes;
+        m_keepFiles   = keepFiles;
+    }
+
+    // Returns once every line logged before the call has been written.
+    void flush()
+    {
+        std::unique_lock lk(m_wakeMutex);
+        uint64_t target = m_passStarted + 1;
+        m_writerIdle.store(false);
+        m_wake.notify_one();
+        m_flushed.wait(lk, [&] { return m_passDone >= target || m_stopping; });
     }
 
 private:
     Logger()
     {
-        m_path = defaultLogPath();
-        openFile(m_path);
+#ifdef LOG_DEFAULT_DIR
+        m_dir = LOG_DEFAULT_DIR;
+#else
+        m_dir = "logs";
+#endif
+        openFile();
+        m_writer = std::thread([this] { writerLoop(); });
     }
 
     ~Logger()
     {
+        {
+            std::scoped_lock lk(m_wakeMutex);
+            m_stopping = true;
+        }
+        m_wake.notify_one();
+        m_writer.join();
         if (m_file)
         {
             std::fflush(m_file);
@@ -85,75 +302,88 @@ private:
         }
     }
 
-    static std::string timestampForFile()
+    // generation 0 is the current file
+    std::string filePath(unsigned generation) const
     {
-        std::time_t t = std::time(nullptr);
-        std::tm tmv{};
-#if defined(_POSIX_VERSION)
-        localtime_r(&t, &tmv);
-#else
-        tmv = *std::localtime(&t);
-#endif
-        char buf[32]{0};
-        std::snprintf(buf, sizeof(buf), "%04d-%02d-%02d_%02d-%02d-%02d", tmv.tm_year + 1'900, tmv.tm_mon + 1, tmv.tm_mday,
-            tmv.tm_hour, tmv.tm_min, tmv.tm_sec);
-        return std::string(buf);
-    }
-
-    static std::string defaultLogPath()
-    {
-#ifdef LOG_DEFAULT_DIR
-        std::filesystem::create_directories(LOG_DEFAULT_DIR);
-        return std::string(LOG_DEFAULT_DIR) + "/" + timestampForFile() + "_log.log";
-#else
-        std::filesystem::create_directories("logs");
-        return std::string("logs/") + timestampForFile() + "_log.log";
-#endif
+        std::string path = m_dir + "/skTorrent";
+        if (generation > 0)
+        {
+            path += '.';
+            path += std::to_string(generation);
+        }
+        path += m_format == LogFileFormat::Binary ? ".sklog" : ".log";
+        return path;
     }
 
-    void openFile(const std::string& path)
+    // Called with m_fileMutex held. A binary file gets every definition again, as ids are per process.
+    void openFile()
     {
-        std::scoped_lock lk(m_fileMutex);
         if (m_file)
         {
             std::fflush(m_file);
             std::fclose(m_file);
             m_file = nullptr;
         }
-        std::filesystem::create_directories(std::filesystem::path(path).parent_path());
-        m_file = std::fopen(path.c_str(), "ab");
+        m_path = filePath(0);
+        std::filesystem::create_directories(m_dir);
+        m_file = std::fopen(m_path.c_str(), "ab");
+        std::error_code ec;
+        m_fileSize           = m_file ? std::filesystem::file_size(m_path, ec) : 0;
+        m_definitionsWritten = 0;
+        if (m_file && m_format == LogFileFormat::Binary && m_fileSize == 0)
+        {
+            writeFile(LogBinary::Magic);
+        }
+    }
+
+    void rotate()
+    {
+        std::fclose(m_file);
+        m_file = nullptr;
+        std::error_code ec;
+        std::filesystem::remove(filePath(m_keepFiles), ec);
+        for (unsigned generation = m_keepFiles; generation > 0; --generation)
+        {
+            std::filesystem::rename(filePath(generation - 1), filePath(generation), ec);
+        }
+        openFile();
     }
 
-    static std::string nowString()
+    void writeFile(std::string_view bytes)
+    {
+        std::fwrite(bytes.data(), 1, bytes.size(), m_file);
+        m_fileSize += bytes.size();
+    }
+
+    static constexpr size_t TimestampSize = 19;  // "YYYY-MM-DD HH:MM:SS"
+
+    // localtime_r and snprintf run once per second per thread, not once per line.
+    static void appendTimestamp(std::string& out)
     {
+        thread_local std::time_t cachedSecond = -1;
+        thread_local char cached[TimestampSize + 1]{0};
         std::time_t t = std::time(nullptr);
-        std::tm tmv{};
+        if (t != cachedSecond)
+        {
+            std::tm tmv{};
 #if defined(_POSIX_VERSION)
-        localtime_r(&t, &tmv);
+            localtime_r(&t, &tmv);
 #else
-        tmv = *std::localtime(&t);
+            tmv = *std::localtime(&t);
 #endif
-        char buf[20]{0};
-        std::snprintf(buf, sizeof(buf), "%04d-%02d-%02d %02d:%02d:%02d", tmv.tm_year + 1'900, tmv.tm_mon + 1, tmv.tm_mday,
-            tmv.tm_hour, tmv.tm_min, tmv.tm_sec);
-        return std::string(buf);
+            std::snprintf(cached, sizeof(cached), "%04d-%02d-%02d %02d:%02d:%02d", tmv.tm_year + 1'900, tmv.tm_mon + 1,
+                tmv.tm_mday, tmv.tm_hour, tmv.tm_min, tmv.tm_sec);
+            cachedSecond = t;
+        }
+        out.append(cached, TimestampSize);
     }
 
-    static std::string levelToString(LogLevel lvl)
+    static std::string_view levelToString(LogLevel lvl)
     {
-        switch (lvl)
-        {
-            case LogLevel::Info:     return "I";
-            case LogLevel::Debug:    return "D";
-            case LogLevel::Trace:    return "T";
-            case LogLevel::Warning:  return "W";
-            case LogLevel::Error:    return "E";
-            case LogLevel::Critical: return "C";
-            default:                 return "U";
-        }
+        return LogBinary::levelLetter(static_cast<uint8_t>(lvl));
     }
 
-    static std::string levelColor(LogLevel lvl)
+    static std::string_view levelColor(LogLevel lvl)
     {
         switch (lvl)
         {
@@ -167,125 +397,430 @@ private:
         }
     }
 
-    template <typename... Args>
-    static void appendMeta(std::ostringstream& line, const std::string& meta, Args&&... args)
+    template <typename T>
+    static void appendField(std::string& line, const LogField<T>& field)
+    {
+        line += field.key;
+        line += '[';
+        appendLogValue(line, field.value);
+        line += ']';
+    }
+
+    static void appendField(std::string& line, std::string_view text)
+    {
+        line += text;
+    }
+
+    template <typename Field, typename... Args>
+    static void appendMeta(std::string& line, const Field& field, const Args&... args)
     {
-        line << meta;
+        appendField(line, field);
         if constexpr (sizeof...(args) > 0)
         {
-            line << " ";
-            appendMeta(line, std::forward<Args>(args)...);
+            line += ' ';
+            appendMeta(line, args...);
         }
     }
 
+    static std::string& lineBuffer()
+    {
+        thread_local std::string buffer;
+        return buffer;
+    }
+
+    static std::string& payloadBuffer()
+    {
+        thread_local std::string buffer;
+        return buffer;
+    }
+
+    // What a ring record holds after its kind and level bytes.
+    enum class RecordKind : char
+    {
+        Text,   // the text line; the writer adds the console colour itself
+        Binary  // an Event frame
+    };
+
     template <typename... Args>
-    static void logImpl(LogLevel lvl, std::string_view module, std::string_view title, Args&&... args)
-    {
-        std::ostringstream consoleLine;
-        consoleLine << nowString();
-        consoleLine << " [";
-        consoleLine << levelColor(lvl);
-        consoleLine << levelToString(lvl);
-        consoleLine << "\033[0m";
-        consoleLine << "] ";
-        consoleLine << '[' << module << "] ";
-        consoleLine << title;
+    static void logText(LogLevel lvl, std::string_view module, std::string_view title, const Args&... args)
+    {
+        auto& record = lineBuffer();
+        record.clear();
+        record += static_cast<char>(RecordKind::Text);
+        record += static_cast<char>(lvl);
+        appendTimestamp(record);
+        record += " [";
+        record += levelToString(lvl);
+        record += "] [";
+        record += module;
+        record += "] ";
+        record += title;
         if constexpr (sizeof...(args) > 0)
         {
-            consoleLine << ' ';
-            appendMeta(consoleLine, std::forward<Args>(args)...);
+            record += ' ';
+            appendMeta(record, args...);
         }
-        consoleLine << '\n';
+        record += '\n';
+        Logger::instance().submit(record);
+    }
 
-        std::ostringstream fileLine;
-        fileLine << nowString();
-        fileLine << " [" << levelToString(lvl) << "] ";
-        fileLine << '[' << module << "] ";
-        fileLine << title;
-        if constexpr (sizeof...(args) > 0)
+    template <typename T>
+    static std::string_view fieldKey(const LogField<T>& field)
+    {
+        return field.key;
+    }
+
+    static std::string_view fieldKey(std::string_view)
+    {
+        return {};
+    }
+
+    template <typename T>
+    static void encodeValue(std::string& out, const T& v)
+    {
+        if constexpr (std::is_same_v<T, bool>)
         {
-            fileLine << ' ';
-            appendMeta(fileLine, std::forward<Args>(args)...);
+            LogBinary::putUInt(out, v);
         }
-        fileLine << '\n';
+        else if constexpr (std::is_same_v<T, char>)
+        {
+            LogBinary::putString(out, std::string_view(&v, 1));
+        }
+        else if constexpr (std::is_enum_v<T>)
+        {
+            encodeValue(out, static_cast<std::underlying_type_t<T>>(v));
+        }
+        else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>)
+        {
+            LogBinary::putInt(out, v);
+        }
+        else if constexpr (std::is_integral_v<T>)
+        {
+            LogBinary::putUInt(out, v);
+        }
+        else if constexpr (std::is_same_v<T, float> || std::is_same_v<T, double>)
+        {
+            LogBinary::putFloating(out, v);
+        }
+        else if constexpr (std::is_convertible_v<const T&, std::string_view>)
+        {
+            LogBinary::putString(out, std::string_view(v));
+        }
+        else
+        {
+            // no raw form: carried as the text it would have printed
+            thread_local std::string text;
+            text.clear();
+            appendLogValue(text, v);
+            LogBinary::putString(out, text);
+        }
+    }
 
-        auto& inst = Logger::instance();
+    template <typename T>
+    static void encodeField(std::string& out, const LogField<T>& field)
+    {
+        encodeValue(out, field.value);
+    }
 
+    static void encodeField(std::string& out, std::string_view text)
+    {
+        LogBinary::putString(out, text);
+    }
+
+    template <typename... Args>
+    void logBinary(const LogSite& site, LogLevel lvl, std::string_view title, const Args&... args)
+    {
+        uint32_t id = site.formatId();
+        if (id == 0)
         {
-            std::scoped_lock lk(inst.m_consoleMutex);
-            const auto& s = consoleLine.str();
-            std::fwrite(s.data(), 1, s.size(), stdout);
-            std::fflush(stdout);
+            id = defineFormat(site, lvl, title, {fieldKey(args)...});
         }
+        auto micros = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::now().time_since_epoch());
+        auto& payload = payloadBuffer();
+        payload.clear();
+        LogBinary::putVarint(payload, id);
+        LogBinary::putVarint(payload, static_cast<uint64_t>(micros.count()));
+        (encodeField(payload, args), ...);
+
+        auto& record = lineBuffer();
+        record.clear();
+        record += static_cast<char>(RecordKind::Binary);
+        record += static_cast<char>(lvl);
+        LogBinary::putFrame(record, LogBinary::FrameType::Event, payload);
+        submit(record);
+    }
+
+    uint32_t defineFormat(const LogSite& site, LogLevel lvl, std::string_view title, std::initializer_list<std::string_view> keys)
+    {
+        std::scoped_lock lk(m_definitionsMutex);
+        if (uint32_t id = site.m_formatId.load(std::memory_order_relaxed))
+        {
+            return id;
+        }
+        auto id = static_cast<uint32_t>(m_definitions.size() + 1);
+        std::string payload;
+        LogBinary::putVarint(payload, id);
+        payload += static_cast<char>(lvl);
+        LogBinary::putBytes(payload, site.name());
+        LogBinary::putBytes(payload, title);
+        LogBinary::putVarint(payload, keys.size());
+        for (auto key : keys)
+        {
+            LogBinary::putBytes(payload, key);
+        }
+        LogBinary::putFrame(m_definitions.emplace_back(), LogBinary::FrameType::Definition, payload);
+        site.m_formatId.store(id, std::memory_order_release);
+        return id;
+    }
+
+    struct ThreadRing
+    {
+        std::shared_ptr<LogRing> ring;
+
+        ~ThreadRing()
         {
-            std::scoped_lock lk(inst.m_fileMutex);
-            if (inst.m_file)
+            if (ring)
             {
-                const auto& s = fileLine.str();
-                std::fwrite(s.data(), 1, s.size(), inst.m_file);
-                std::fflush(inst.m_file);
+                ring->retire();
             }
         }
+    };
+
+    LogRing& localRing()
+    {
+        thread_local ThreadRing local;
+        if (!local.ring)
+        {
+            local.ring = std::make_shared<LogRing>(LOG_RING_CAPACITY);
+            std::scoped_lock lk(m_ringsMutex);
+            m_rings.push_back(local.ring);
+        }
+        return *local.ring;
     }
 
-private:
-    std::mutex m_consoleMutex;
-    std::mutex m_fileMutex;
-    std::string m_path;
-    std::FILE* m_file = nullptr;
-};
+    void submit(std::string_view record)
+    {
+        auto& ring = localRing();
+        while (!ring.tryPush(record))
+        {
+            if (m_overflow.load(std::memory_order_relaxed) == LogOverflow::Drop || record.size() + 4 > ring.capacity())
+            {
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            wakeWriter();
+            std::this_thread::yield();
+        }
+        // pairs with the fence in writerLoop: either the writer sees this record or we see it idle
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_writerIdle.load(std::memory_order_relaxed))
+        {
+            wakeWriter();
+        }
+    }
 
-template <typename T>
-concept Ostreamable = requires(std::ostream& os, const T& v) {
-    { os << v } -> std::same_as<std::ostream&>;
-};
+    void wakeWriter()
+    {
+        if (m_writerIdle.exchange(false))
+        {
+            std::scoped_lock lk(m_wakeMutex);
+            m_wake.notify_one();
+        }
+    }
 
-template <std::integral T>
-requires(!std::same_as<T, bool>)
-std::string toString(T v)
-{
-    std::ostringstream oss;
-    if constexpr (std::is_signed_v<T>)
+    // Drains every ring once; returns the number of lines written.
+    size_t drain()
     {
-        oss << static_cast<long long>(v);
+        {
+            std::scoped_lock lk(m_ringsMutex);
+            m_snapshot = m_rings;
+            std::erase_if(m_rings, [](const auto& ring) { return ring->retired() && ring->empty(); });
+        }
+        std::scoped_lock fileLock(m_fileMutex);
+        m_fileBatch.clear();
+        m_consoleBatch.clear();
+        bool console = m_console.load(std::memory_order_relaxed);
+        size_t lines = 0;
+        for (const auto& ring : m_snapshot)
+        {
+            lines += ring->consume(
+                [&](std::string_view record)
+                {
+                    auto kind = static_cast<RecordKind>(record[0]);
+                    auto lvl  = static_cast<LogLevel>(record[1]);
+                    auto line = record.substr(2);
+                    if ((kind == RecordKind::Binary) == (m_format == LogFileFormat::Binary))
+                    {
+                        m_fileBatch += line;
+                    }
+                    if (kind == RecordKind::Text && console)
+                    {
+                        // the level letter follows "<timestamp> ["
+                        constexpr size_t letter = TimestampSize + 2;
+                        m_consoleBatch += line.substr(0, letter);
+                        m_consoleBatch += levelColor(lvl);
+                        m_consoleBatch += line.substr(letter, 1);
+                        m_consoleBatch += "\033[0m";
+                        m_consoleBatch += line.substr(letter + 1);
+                    }
+                });
+        }
+        m_snapshot.clear();
+
+        if (!m_consoleBatch.empty())
+        {
+            std::fwrite(m_consoleBatch.data(), 1, m_consoleBatch.size(), stdout);
+            std::fflush(stdout);
+        }
+        if (!m_fileBatch.empty())
+        {
+            writeBatch();
+        }
+        return lines;
     }
-    else
+
+    // Called with m_fileMutex held. Definitions made since the last batch go first, so they precede their events.
+    void writeBatch()
     {
-        oss << static_cast<unsigned long long>(v);
+        if (m_file && m_fileSize > 0 && m_fileSize + m_fileBatch.size() > m_rotateBytes)
+        {
+            rotate();
+        }
+        if (!m_file)
+        {
+            return;
+        }
+        if (m_format == LogFileFormat::Binary)
+        {
+            std::scoped_lock lk(m_definitionsMutex);
+            for (; m_definitionsWritten < m_definitions.size(); ++m_definitionsWritten)
+            {
+                writeFile(m_definitions[m_definitionsWritten]);
+            }
+        }
+        writeFile(m_fileBatch);
+        std::fflush(m_file);
     }
-    return oss.str();
-}
 
-template <typename T>
-requires(Ostreamable<T> && (!std::integral<T> || std::same_as<T, bool>))
-std::string toString(const T& v)
-{
-    std::ostringstream oss;
-    oss << v;
-    return oss.str();
-}
+    bool pending()
+    {
+        std::scoped_lock lk(m_ringsMutex);
+        return std::any_of(m_rings.begin(), m_rings.end(), [](const auto& ring) { return !ring->empty(); });
+    }
 
-template <typename T>
-requires std::is_enum_v<T>
-std::string toString(T v)
-{
-    using U = std::underlying_type_t<T>;
-    return toString(static_cast<U>(v));
-}
+    void writerLoop()
+    {
+        while (true)
+        {
+            uint64_t pass;
+            bool stopping;
+            {
+                std::scoped_lock lk(m_wakeMutex);
+                pass     = ++m_passStarted;
+                stopping = m_stopping;
+            }
+            size_t lines = drain();
+            {
+                std::scoped_lock lk(m_wakeMutex);
+                m_passDone = pass;
+            }
+            m_flushed.notify_all();
+            if (stopping)
+            {
+                return;
+            }
+            if (lines > 0)
+            {
+                continue;
+            }
 
-static std::string writePair(std::string_view k, std::string_view v)
-{
-    std::ostringstream oss;
-    oss << k << "[" << v << "]";
-    return oss.str();
-}
+            m_writerIdle.store(true);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (pending())
+            {
+                m_writerIdle.store(false);
+                continue;
+            }
+            std::unique_lock lk(m_wakeMutex);
+            m_wake.wait_for(lk, std::chrono::milliseconds(100), [&] { return !m_writerIdle.load() || m_stopping; });
+            m_writerIdle.store(false);
+        }
+    }
+
+    struct NameHash
+    {
+        using is_transparent = void;
+
+        size_t operator()(std::string_view name) const
+        {
+            return std::hash<std::string_view>{}(name);
+        }
+    };
+
+    mutable std::mutex m_fileMutex;  // the writer holds it for a whole pass
+    std::string m_dir;
+    std::string m_path;
+    std::FILE* m_file           = nullptr;
+    uint64_t m_fileSize         = 0;
+    LogFileFormat m_format      = LogFileFormat::Text;
+    uint64_t m_rotateBytes      = LOG_ROTATE_BYTES;
+    unsigned m_keepFiles        = 5;
+    size_t m_definitionsWritten = 0;
+    std::atomic<bool> m_binary{false};
+
+    std::mutex m_definitionsMutex;
+    std::vector<std::string> m_definitions;  // Definition frames, index id - 1
+
+    std::mutex m_levelsMutex;
+    std::unordered_map<std::string, std::atomic<LogLevel>, NameHash, std::equal_to<>> m_levels;
+    LogLevel m_defaultLevel = LogLevel::Trace;
+
+    std::mutex m_ringsMutex;
+    std::vector<std::shared_ptr<LogRing>> m_rings;
+    std::vector<std::shared_ptr<LogRing>> m_snapshot;
+    std::string m_fileBatch;
+    std::string m_consoleBatch;
+
+    std::atomic<LogOverflow> m_overflow{LogOverflow::Block};
+    std::atomic<bool> m_console{true};
+    std::atomic<uint64_t> m_dropped{0};
+
+    std::mutex m_wakeMutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_flushed;
+    std::atomic<bool> m_writerIdle{false};
+    uint64_t m_passStarted = 0;
+    uint64_t m_passDone    = 0;
+    bool m_stopping        = false;
+    std::thread m_writer;
+};
+
+inline LogSite::LogSite(std::string_view module)
+    : m_module(module)
+    , m_level(&Logger::instance().levelSlot(module))
+{}
+
+// Arguments, LOG_MD values included, are evaluated only when the level passes both filters.
+#define LOG_AT(lvl, module, title, ...)                                                                        \
+    do                                                                                                         \
+    {                                                                                                          \
+        if constexpr (LOG_COMPILED_IN(lvl))                                                                    \
+        {                                                                                                      \
+            static const LogSite logSite(#module);                                                             \
+            if (logSite.enabled(lvl))                                                                          \
+            {                                                                                                  \
+                Logger::log(logSite, lvl, title __VA_OPT__(, ) __VA_ARGS__);                                    \
+            }                                                                                                  \
+        }                                                                                                      \
+    } while (false)
 
-#define LOG_MD(key, value) writePair(#key, toString(value))
-#define LOG_INFO(module, title, ...) Logger::instance().logInfo(#module, title __VA_OPT__(, ) __VA_ARGS__)
-#define LOG_DEBUG(module, title, ...) Logger::instance().logDebug(#module, title __VA_OPT__(, ) __VA_ARGS__)
-#define LOG_TRACE(module, title, ...) Logger::instance().logTrace(#module, title __VA_OPT__(, ) __VA_ARGS__)
-#define LOG_WARNING(module, title, ...) Logger::instance().logWarning(#module, title __VA_OPT__(, ) __VA_ARGS__)
-#define LOG_ERROR(module, title, ...) Logger::instance().logError(#module, title __VA_OPT__(, ) __VA_ARGS__)
-#define LOG_CRITICAL(module, title, ...) Logger::instance().logCritical(#module, title __VA_OPT__(, ) __VA_ARGS__)
+#define LOG_MD(key, value) LogField<std::remove_cvref_t<decltype(value)>>{#key, value}
+#define LOG_INFO(module, title, ...) LOG_AT(LogLevel::Info, module, title __VA_OPT__(, ) __VA_ARGS__)
+#define LOG_DEBUG(module, title, ...) LOG_AT(LogLevel::Debug, module, title __VA_OPT__(, ) __VA_ARGS__)
+#define LOG_TRACE(module, title, ...) LOG_AT(LogLevel::Trace, module, title __VA_OPT__(, ) __VA_ARGS__)
+#define LOG_WARNING(module, title, ...) LOG_AT(LogLevel::Warning, module, title __VA_OPT__(, ) __VA_ARGS__)
+#define LOG_ERROR(module, title, ...) LOG_AT(LogLevel::Error, module, title __VA_OPT__(, ) __VA_ARGS__)
+#define LOG_CRITICAL(module, title, ...) LOG_AT(LogLevel::Critical, module, title __VA_OPT__(, ) __VA_ARGS__)
 
 #endif
@@ -0,0 +1,49 @@
+#include <Core/AnnounceUrl.hpp>
+#include <Utils/MetaUtils.hpp>
+
+#include <gtest/gtest.h>
+
+using namespace Torrent::Core;
+
+namespace {
+const std::string kInfoHash = std::string("\x12\x34\x56\x78\x9a\xbc\xde\xf0", 8) + "AZaz09-_.~ /%" + std::string(3, '\xff');
+}  // namespace
+
+TEST(AnnounceUrlTest, WritesParametersInAFixedOrder)
+{
+    AnnounceUrl url("http://tracker.example/announce", kInfoHash, "-SK0001-000000000000", 6'881);
+    EXPECT_EQ(url.build(1, 22, 333, AnnounceEvent::Started),
+        "http://tracker.example/announce?info_hash=%124Vx%9A%BC%DE%F0AZaz09-_.~%20%2F%25%FF%FF%FF"
+        "&peer_id=-SK0001-000000000000&port=6881&uploaded=1&downloaded=22&left=333&compact=1&event=started");
+}
+
+TEST(AnnounceUrlTest, KeepsAnExistingQuery)
+{
+    AnnounceUrl url("http://tracker.example/announce?passkey=abc", "h", "p", 1);
+    EXPECT_EQ(url.build(0, 0, 0, AnnounceEvent::None),
+        "http://tracker.example/announce?passkey=abc&info_hash=h&peer_id=p&port=1&uploaded=0&downloaded=0&left=0&compact=1");
+}
+
+TEST(AnnounceUrlTest, RebuildsInPlace)
+{
+    AnnounceUrl url("udp://t", kInfoHash, "-SK0001-000000000000", 51'413);
+    auto first = url.build(UINT64_MAX, UINT64_MAX, UINT64_MAX, AnnounceEvent::Completed);
+    EXPECT_TRUE(first.ends_with("&left=18446744073709551615&compact=1&event=completed"));
+    auto second = url.build(5, 6, 7, AnnounceEvent::None);
+    EXPECT_EQ(second.data(), first.data());
+    EXPECT_TRUE(second.ends_with("&port=51413&uploaded=5&downloaded=6&left=7&compact=1"));
+    auto unknown = url.build(0, 0, std::nullopt, AnnounceEvent::Started);
+    EXPECT_TRUE(unknown.ends_with("&port=51413&uploaded=0&downloaded=0&compact=1&event=started"));
+}
+
+TEST(AnnounceUrlTest, EncodesOnlyReservedBytes)
+{
+    for (int c = 0; c < 256; ++c)
+    {
+        std::string in(1, static_cast<char>(c));
+        bool unreserved = std::isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~';
+        char expected[4];
+        std::snprintf(expected, sizeof(expected), "%%%02X", c);
+        EXPECT_EQ(Torrent::Utils::urlEncode(in), unreserved ? in : std::string(expected)) << c;
+    }
+}
@@ -0,0 +1,147 @@
+#include <Async/DiskIo.hpp>
+#include <Async/Executor.hpp>
+#include <Async/IoAwaitables.hpp>
+
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace Torrent;
+using namespace Torrent::Async;
+
+static Task<int> answer()
+{
+    co_return 42;
+}
+
+static Task<int> addOne()
+{
+    int v = co_await answer();
+    co_return v + 1;
+}
+
+static Task<void> fail()
+{
+    throw std::runtime_error("boom");
+    co_return;
+}
+
+TEST(AsyncTest, TaskChainsValues)
+{
+    EXPECT_EQ(syncWait(addOne()), 43);
+}
+
+TEST(AsyncTest, TaskPropagatesExceptions)
+{
+    EXPECT_THROW(syncWait(fail()), std::runtime_error);
+}
+
+TEST(AsyncTest, ExecutorRunsSpawnedTasks)
+{
+    constexpr int Count = 10'000;
+    std::atomic<int> done{0};
+    {
+        Executor executor(4);
+        auto body = [](Executor& ex, std::atomic<int>& counter) -> Task<void>
+        {
+            co_await ex.schedule();
+            counter.fetch_add(1);
+        };
+        for (int i = 0; i < Count; ++i)
+        {
+            executor.spawn(body(executor, done));
+        }
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (done.load() < Count && std::chrono::steady_clock::now() < deadline)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    EXPECT_EQ(done.load(), Count);
+}
+
+TEST(AsyncTest, SleepResumesOnLoopThread)
+{
+    Net::EventLoop loop;
+    std::jthread thread([&] { loop.run(); });
+
+    auto task = [](Net::EventLoop& l) -> Task<std::thread::id>
+    {
+        co_await sleepFor(l, std::chrono::milliseconds(10));
+        co_return std::this_thread::get_id();
+    };
+    EXPECT_EQ(syncWait(task(loop)), thread.get_id());
+    loop.stop();
+}
+
+TEST(AsyncTest, StopBeforeRunIsNotLost)
+{
+    // the owner may stop and join before the thread ever reached run()
+    for (int i = 0; i < 100; ++i)
+    {
+        Net::EventLoop loop;
+        std::jthread thread([&] { loop.run(); });
+        loop.stop();
+    }
+
+    Net::EventLoop loop;
+    loop.stop();
+    loop.run();  // returns at once and takes the stop with it
+    int ticks = 0;
+    EXPECT_TRUE(loop.runUntil([&] { return ++ticks > 3; }, std::chrono::milliseconds(1'000)));
+}
+
+TEST(AsyncTest, SocketReadWrite)
+{
+    int fds[2];
+    ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds), 0);
+
+    Net::EventLoop loop;
+    std::jthread thread([&] { loop.run(); });
+
+    std::vector<uint8_t> payload(256 * 1'024);
+    for (size_t i = 0; i < payload.size(); ++i)
+    {
+        payload[i] = static_cast<uint8_t>(i * 7);
+    }
+
+    std::vector<uint8_t> received(payload.size());
+    auto reader = [](Net::EventLoop& l, int fd, std::vector<uint8_t>& out) -> Task<void>
+    { co_await asyncReadExactly(l, fd, out); };
+    auto writer = [](Net::EventLoop& l, int fd, const std::vector<uint8_t>& in) -> Task<void>
+    { co_await asyncWriteAll(l, fd, in); };
+
+    std::jthread writerThread([&] { syncWait(writer(loop, fds[0], payload)); });
+    syncWait(reader(loop, fds[1], received));
+    writerThread = {};
+    EXPECT_EQ(received, payload);
+
+    ::close(fds[0]);
+    std::vector<uint8_t> more(1);
+    EXPECT_THROW(syncWait(reader(loop, fds[1], more)), std::runtime_error);
+    ::close(fds[1]);
+    loop.stop();
+}
+
+TEST(AsyncTest, DiskReadFile)
+{
+    auto path = std::filesystem::temp_directory_path() / ("sk_async_test_" + std::to_string(std::rand()));
+    std::string content(100'000, 'x');
+    std::ofstream(path, std::ios::binary) << content;
+
+    DiskIo disk(2);
+    EXPECT_EQ(syncWait(disk.readFile(path.string())), content);
+    EXPECT_THROW(syncWait(disk.readFile(path.string() + ".missing")), std::runtime_error);
+    std::filesystem::remove(path);
+}
+
+TEST(AsyncTest, FramePoolReusesFrames)
+{
+    void* a = FramePool::allocate(200);
+    FramePool::deallocate(a, 200);
+    void* b = FramePool::allocate(250);
+    EXPECT_EQ(a, b);
+    FramePool::deallocate(b, 250);
+}
@@ -0,0 +1,111 @@
+#include <Core/PeerStore.hpp>
+#include <Core/TrackerResponse.hpp>
+#include <Utils/CompactPeers.hpp>
+
+#include <gtest/gtest.h>
+
+using Torrent::Net::Endpoint;
+
+static std::string encStr(const std::string& s)
+{
+    return std::to_string(s.size()) + ":" + s;
+}
+
+TEST(CompactPeersTest, DecodeV4)
+{
+    std::string blob = {'\x0a', '\x00', '\x00', '\x01', '\x1a', '\xe1', '\xc0', '\xa8', '\x01', '\x02', '\x00', '\x50'};
+    std::vector<Endpoint> peers;
+
+    EXPECT_EQ(Torrent::Utils::decodeCompactPeers4(blob, peers), 2u);
+    ASSERT_EQ(peers.size(), 2u);
+    EXPECT_TRUE(peers[0].isV4());
+    EXPECT_EQ(peers[0].port, 6'881);
+    EXPECT_EQ(peers[0].toString(), "10.0.0.1:6881");
+    EXPECT_EQ(peers[1].toString(), "192.168.1.2:80");
+}
+
+TEST(CompactPeersTest, DecodeV6)
+{
+    std::string blob(18, '\0');
+    blob[0]  = '\x20';
+    blob[1]  = '\x01';
+    blob[15] = '\x01';
+    blob[16] = '\x1a';
+    blob[17] = '\xe1';
+    std::vector<Endpoint> peers;
+
+    EXPECT_EQ(Torrent::Utils::decodeCompactPeers6(blob, peers), 1u);
+    EXPECT_FALSE(peers[0].isV4());
+    EXPECT_EQ(peers[0].toString(), "[2001::1]:6881");
+}
+
+TEST(CompactPeersTest, InvalidLengthThrows)
+{
+    std::vector<Endpoint> peers;
+    EXPECT_THROW(Torrent::Utils::decodeCompactPeers4(std::string(7, 'x'), peers), std::runtime_error);
+    EXPECT_THROW(Torrent::Utils::decodeCompactPeers6(std::string(17, 'x'), peers), std::runtime_error);
+}
+
+TEST(PeerStoreTest, DeduplicatesAndGrows)
+{
+    Torrent::Core::PeerStore store;
+    std::vector<Endpoint> peers;
+    for (uint32_t i = 0; i < 10'000; ++i)
+    {
+        uint8_t addr[4] = {10, static_cast<uint8_t>(i >> 16), static_cast<uint8_t>(i >> 8), static_cast<uint8_t>(i)};
+        peers.push_back(Endpoint::fromV4(addr, 6'881));
+    }
+
+    EXPECT_EQ(store.merge(peers), 10'000u);
+    EXPECT_EQ(store.merge(peers), 0u);
+    EXPECT_EQ(store.size(), 10'000u);
+    EXPECT_TRUE(store.contains(peers[1'234]));
+
+    uint8_t other[4] = {10, 0, 0, 1};
+    EXPECT_FALSE(store.contains(Endpoint::fromV4(other, 6'882)));
+    EXPECT_TRUE(store.insert(Endpoint::fromV4(other, 6'882)));
+    EXPECT_FALSE(store.insert(Endpoint::fromV4(other, 6'882)));
+}
+
+TEST(TrackerResponseTest, CompactResponse)
+{
+    std::string peers  = {'\x7f', '\x00', '\x00', '\x01', '\x1a', '\xe1'};
+    std::string peers6 = std::string(15, '\0') + '\x01' + '\x1a' + '\xe2';
+    std::string body   = "d8:completei5e10:incompletei3e8:intervali1800e5:peers" + encStr(peers) + "6:peers6" + encStr(peers6) + "e";
+
+    Torrent::Core::AnnounceResponse resp;
+    Torrent::Core::parseAnnounceResponse(body, resp);
+
+    EXPECT_TRUE(resp.failureReason.empty());
+    EXPECT_EQ(resp.interval, 1'800u);
+    EXPECT_EQ(resp.complete, 5u);
+    EXPECT_EQ(resp.incomplete, 3u);
+    ASSERT_EQ(resp.peers.size(), 2u);
+    EXPECT_EQ(resp.peers[0].toString(), "127.0.0.1:6881");
+    EXPECT_EQ(resp.peers[1].toString(), "[::1]:6882");
+}
+
+TEST(TrackerResponseTest, DictionaryModelPeers)
+{
+    std::string body = "d8:intervali60e5:peersld2:ip9:127.0.0.17:peer id20:AAAAAAAAAAAAAAAAAAAA4:porti51413eeee";
+
+    Torrent::Core::AnnounceResponse resp;
+    Torrent::Core::parseAnnounceResponse(body, resp);
+
+    ASSERT_EQ(resp.peers.size(), 1u);
+    EXPECT_EQ(resp.peers[0].toString(), "127.0.0.1:51413");
+}
+
+TEST(TrackerResponseTest, FailureReason)
+{
+    Torrent::Core::AnnounceResponse resp;
+    Torrent::Core::parseAnnounceResponse("d14:failure reason12:unregisterede", resp);
+    EXPECT_EQ(resp.failureReason, "unregistered");
+    EXPECT_TRUE(resp.peers.empty());
+}
+
+TEST(TrackerResponseTest, TruncatedThrows)
+{
+    Torrent::Core::AnnounceResponse resp;
+    EXPECT_THROW(Torrent::Core::parseAnnounceResponse("d5:peers12:abc", resp), std::runtime_error);
+}
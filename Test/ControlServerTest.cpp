@@ -0,0 +1,180 @@
+#include <Core/ControlServer.hpp>
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+using namespace Torrent::Core;
+using Torrent::Utils::Bencode::Dict;
+using Torrent::Utils::Bencode::Value;
+
+namespace {
+std::string writeTorrent()
+{
+    std::string torrent = "d8:announce27:http://127.0.0.1:1/announce4:infod6:lengthi4096e4:name4:ctrl12:piece lengthi16384e"
+                          "6:pieces20:" +
+                          std::string(20, 'A') + "ee";
+    auto path = std::filesystem::temp_directory_path() / "sk_control_test.torrent";
+    std::ofstream(path, std::ios::binary) << torrent;
+    return path.string();
+}
+
+std::string socketPath()
+{
+    return (std::filesystem::temp_directory_path() / ("sk_control_" + std::to_string(::getpid()) + ".sock")).string();
+}
+
+SessionManager::Options fastOptions()
+{
+    SessionManager::Options options;
+    options.workers          = 2;
+    options.tickInterval     = std::chrono::milliseconds(20);
+    options.snapshotInterval = std::chrono::milliseconds(10);
+    return options;
+}
+
+Dict op(const std::string& name, std::optional<uint64_t> id = {})
+{
+    Dict request{{"op", Value(name)}};
+    if (id)
+    {
+        request.emplace("id", Value(*id));
+    }
+    return request;
+}
+
+uint64_t integer(const Dict& d, const std::string& key)
+{
+    return d.at(key).asInt();
+}
+
+// Polls status until pred accepts the session's entry.
+bool waitForSession(ControlClient& client, uint64_t id, const std::function<bool(const Dict&)>& pred)
+{
+    for (int i = 0; i < 500; ++i)
+    {
+        auto sessions = client.request(op("status", id)).at("sessions").asList();
+        if (!sessions.empty() && pred(sessions.front().asDict()))
+        {
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return false;
+}
+}  // namespace
+
+TEST(ControlServerTest, ManagesSessionsThroughTheSocket)
+{
+    SessionManager manager(fastOptions());
+    ControlServer server(manager, socketPath());
+    ControlClient client(socketPath());
+
+    auto added = client.request({{"op", Value(std::string("add"))}, {"source", Value(writeTorrent())}});
+    ASSERT_EQ(integer(added, "ok"), 1u);
+    auto id = integer(added, "id");
+
+    ASSERT_TRUE(waitForSession(client, id,
+        [](const Dict& s) { return s.at("state").asStr() == "running" && s.at("failed announces").asInt() > 0; }));
+    auto status = client.request(op("status", id)).at("sessions").asList().front().asDict();
+    EXPECT_EQ(status.at("name").asStr(), "ctrl");
+    EXPECT_EQ(integer(status, "size"), 4'096u);
+
+    ASSERT_EQ(integer(client.request(op("pause", id)), "ok"), 1u);
+    ASSERT_TRUE(waitForSession(client, id, [](const Dict& s) { return s.at("paused").asInt() == 1; }));
+    auto stats = client.request(op("stats"));
+    EXPECT_EQ(integer(stats, "sessions"), 1u);
+    EXPECT_EQ(integer(stats, "paused"), 1u);
+    EXPECT_EQ(integer(stats, "running"), 0u);
+
+    ASSERT_EQ(integer(client.request(op("resume", id)), "ok"), 1u);
+    ASSERT_TRUE(waitForSession(client, id, [](const Dict& s) { return s.at("paused").asInt() == 0; }));
+
+    ASSERT_EQ(integer(client.request(op("remove", id)), "ok"), 1u);
+    EXPECT_EQ(integer(client.request(op("remove", id)), "ok"), 0u);
+    for (int i = 0; i < 500 && !client.request(op("status")).at("sessions").asList().empty(); ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_TRUE(client.request(op("status")).at("sessions").asList().empty());
+}
+
+TEST(ControlServerTest, AnswersBadRequestsWithErrors)
+{
+    SessionManager manager(fastOptions());
+    ControlServer server(manager, socketPath());
+    ControlClient client(socketPath());
+
+    auto unknown = client.request(op("frobnicate"));
+    EXPECT_EQ(integer(unknown, "ok"), 0u);
+    EXPECT_EQ(unknown.at("error").asStr(), "Unknown op frobnicate");
+
+    auto missing = client.request(op("pause"));
+    EXPECT_EQ(integer(missing, "ok"), 0u);
+    EXPECT_EQ(missing.at("error").asStr(), "Missing id");
+
+    EXPECT_EQ(integer(client.request(op("pause", 42)), "ok"), 0u);
+    // the connection survives errors
+    EXPECT_EQ(integer(client.request(op("stats")), "ok"), 1u);
+}
+
+TEST(ControlServerTest, ReloadsTheBlocklist)
+{
+    auto list = std::filesystem::temp_directory_path() / "sk_control_test.p2p";
+    std::ofstream(list) << "one:1.1.1.0-1.1.1.255\n";
+    SessionManager manager(fastOptions());
+    Torrent::Metrics::Registry metrics;
+    IpBlocklist blocklist(&metrics);
+    {
+        ControlServer unconfigured(manager, socketPath(), {}, &blocklist);
+        EXPECT_EQ(ControlClient(socketPath()).request(op("blocklist")).at("error").asStr(), "No blocklist configured");
+    }
+
+    ControlServer server(manager, socketPath(), {list.string()}, &blocklist);
+    ControlClient client(socketPath());
+    auto loaded = client.request(op("blocklist"));
+    ASSERT_EQ(integer(loaded, "ok"), 1u);
+    EXPECT_EQ(integer(loaded, "ranges"), 1u);
+    EXPECT_TRUE(blocklist.blocked(Torrent::Net::Endpoint::parse("1.1.1.1", 6'881)));
+
+    std::ofstream(list) << "two:2.2.2.0-2.2.2.255\nthree:3.3.3.0-3.3.3.255\nnot a range\n";
+    auto reloaded = client.request(op("blocklist"));
+    EXPECT_EQ(integer(reloaded, "ranges"), 2u);
+    EXPECT_EQ(integer(reloaded, "rejected"), 1u);
+    EXPECT_FALSE(blocklist.blocked(Torrent::Net::Endpoint::parse("1.1.1.1", 6'881)));
+    EXPECT_TRUE(blocklist.blocked(Torrent::Net::Endpoint::parse("3.3.3.3", 6'881)));
+
+    // a list that went away keeps the filter loaded last
+    std::filesystem::remove(list);
+    EXPECT_EQ(integer(client.request(op("blocklist")), "ok"), 0u);
+    EXPECT_TRUE(blocklist.blocked(Torrent::Net::Endpoint::parse("3.3.3.3", 6'881)));
+}
+
+TEST(ControlServerTest, ServesManyClientsAndShutsDownWithClientsConnected)
+{
+    SessionManager manager(fastOptions());
+    auto server = std::make_unique<ControlServer>(manager, socketPath());
+    std::vector<std::jthread> pollers;
+    std::atomic<int> answered{0};
+    for (int t = 0; t < 4; ++t)
+    {
+        pollers.emplace_back(
+            [&]
+            {
+                ControlClient client(socketPath());
+                for (int i = 0; i < 200; ++i)
+                {
+                    answered += integer(client.request(op("stats")), "ok") == 1;
+                }
+            });
+    }
+    pollers.clear();
+    EXPECT_EQ(answered, 800);
+
+    ControlClient idle(socketPath());
+    server.reset();
+    EXPECT_THROW(idle.request(op("stats")), std::runtime_error);
+    EXPECT_FALSE(std::filesystem::exists(socketPath()));
+}
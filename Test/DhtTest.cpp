@@ -0,0 +1,228 @@
+#include <Core/IpFilter.hpp>
+#include <Dht/DhtNode.hpp>
+#include <Utils/BencodeEncoder.hpp>
+
+#include <gtest/gtest.h>
+#include <memory>
+
+using namespace Torrent::Dht;
+using Torrent::Net::Endpoint;
+using Torrent::Net::EventLoop;
+
+namespace {
+Endpoint loopback(uint16_t port = 0)
+{
+    return Endpoint::parse("127.0.0.1", port);
+}
+
+NodeId idWithPrefix(uint8_t first)
+{
+    NodeId id{};
+    id[0] = first;
+    return id;
+}
+}  // namespace
+
+TEST(RoutingTableTest, ClosestIsSortedByXorDistance)
+{
+    RoutingTable table(NodeId{});
+    auto now = RoutingTable::Clock::now();
+    for (uint8_t i = 1; i < 40; ++i)
+    {
+        table.add(idWithPrefix(i), loopback(i), now);
+    }
+
+    std::vector<NodeEntry> out;
+    auto target = idWithPrefix(0x20);
+    table.closest(target, 5, out);
+    ASSERT_EQ(out.size(), 5u);
+    EXPECT_EQ(out[0].id, target);
+    for (size_t i = 1; i < out.size(); ++i)
+    {
+        EXPECT_TRUE(closer(target, out[i - 1].id, out[i].id));
+    }
+}
+
+TEST(RoutingTableTest, FullBucketOnlyEvictsFailingNodes)
+{
+    RoutingTable table(NodeId{});
+    auto now = RoutingTable::Clock::now();
+
+    // every id with the top bit set lands in bucket 0
+    for (uint8_t i = 0; i < RoutingTable::K; ++i)
+    {
+        ASSERT_TRUE(table.add(idWithPrefix(0x80 | i), loopback(i + 1), now));
+    }
+    EXPECT_FALSE(table.add(idWithPrefix(0xff), loopback(100), now));
+
+    table.markFailed(idWithPrefix(0x83));
+    table.markFailed(idWithPrefix(0x83));
+    EXPECT_TRUE(table.add(idWithPrefix(0xff), loopback(100), now));
+    EXPECT_FALSE(table.contains(idWithPrefix(0x83)));
+    EXPECT_EQ(table.size(), RoutingTable::K);
+}
+
+TEST(DhtNodeTest, TokensSurviveOneRotation)
+{
+    EventLoop loop;
+    DhtNode node(loop, loopback());
+    auto peer  = loopback(6'881);
+    auto token = node.makeToken(peer);
+
+    EXPECT_TRUE(node.checkToken(peer, token));
+    EXPECT_FALSE(node.checkToken(Endpoint::parse("127.0.0.2", 6'881), token));
+    node.rotateTokens();
+    EXPECT_TRUE(node.checkToken(peer, token));
+    node.rotateTokens();
+    EXPECT_FALSE(node.checkToken(peer, token));
+}
+
+TEST(DhtNodeTest, RateLimitsFloodingNode)
+{
+    EventLoop loop;
+    DhtNode::Options opts;
+    opts.queryRate  = 1.0;
+    opts.queryBurst = 10.0;
+    DhtNode node(loop, loopback(), opts);
+    Torrent::Net::UdpSocket flooder(loopback());
+
+    namespace Bencode = Torrent::Utils::Bencode;
+    Bencode::Dict args;
+    args["id"] = std::string(20, 'x');
+    Bencode::Dict query;
+    query["a"] = args;
+    query["q"] = std::string("ping");
+    query["t"] = std::string("aa");
+    query["y"] = std::string("q");
+    auto packet = Bencode::encode(query);
+
+    for (int i = 0; i < 100; ++i)
+    {
+        flooder.sendTo(node.endpoint(), std::span(reinterpret_cast<const uint8_t*>(packet.data()), packet.size()));
+    }
+    loop.runUntil([&] { return node.stats().queriesReceived == 100; }, std::chrono::milliseconds(2'000));
+
+    EXPECT_EQ(node.stats().queriesReceived, 100u);
+    EXPECT_GE(node.stats().queriesDropped, 89u);
+}
+
+TEST(DhtNodeTest, DropsPacketsFromBlockedAddresses)
+{
+    EventLoop loop;
+    Torrent::Metrics::Registry metrics;
+    Torrent::Core::IpBlocklist blocklist(&metrics);
+    blocklist.replace(std::make_unique<const Torrent::Core::IpFilter>(
+        Torrent::Core::IpFilter::parse("127.0.0.1 - 127.0.0.1 , 000 , loopback\n")));
+    DhtNode::Options opts;
+    opts.blocklist = &blocklist;
+    DhtNode node(loop, loopback(), opts);
+    Torrent::Net::UdpSocket sender(loopback());
+
+    namespace Bencode = Torrent::Utils::Bencode;
+    Bencode::Dict args;
+    args["id"] = std::string(20, 'x');
+    Bencode::Dict query;
+    query["a"] = args;
+    query["q"] = std::string("ping");
+    query["t"] = std::string("aa");
+    query["y"] = std::string("q");
+    auto packet = Bencode::encode(query);
+
+    for (int i = 0; i < 5; ++i)
+    {
+        sender.sendTo(node.endpoint(), std::span(reinterpret_cast<const uint8_t*>(packet.data()), packet.size()));
+    }
+    loop.runUntil([&] { return node.stats().blocked == 5; }, std::chrono::milliseconds(2'000));
+
+    EXPECT_EQ(node.stats().blocked, 5u);
+    EXPECT_EQ(node.stats().queriesReceived, 0u);
+    EXPECT_EQ(node.table().size(), 0u);
+}
+
+TEST(DhtNodeTest, AnnouncedPeersExpire)
+{
+    DhtNode::Options opts;
+    opts.peerLifetime  = std::chrono::seconds(1);
+    opts.tokenRotation = std::chrono::seconds(1);
+    EventLoop loop;
+    DhtNode storing(loop, loopback(), opts);
+    DhtNode announcing(loop, loopback());
+    DhtNode looking(loop, loopback());
+
+    size_t bootstrapped = 0;
+    announcing.bootstrap({storing.endpoint()}, [&] { ++bootstrapped; });
+    looking.bootstrap({storing.endpoint()}, [&] { ++bootstrapped; });
+    ASSERT_TRUE(loop.runUntil([&] { return bootstrapped == 2; }, std::chrono::seconds(10)));
+
+    NodeId infoHash = idWithPrefix(0x3c);
+    bool announced  = false;
+    announcing.announce(infoHash, 7'001, [&](const std::vector<Endpoint>&) { announced = true; });
+    ASSERT_TRUE(loop.runUntil([&] { return announced; }, std::chrono::seconds(10)));
+
+    auto lookup = [&]
+    {
+        std::vector<Endpoint> found;
+        bool done = false;
+        looking.getPeers(infoHash,
+            [&](const std::vector<Endpoint>& peers)
+            {
+                found = peers;
+                done  = true;
+            });
+        EXPECT_TRUE(loop.runUntil([&] { return done; }, std::chrono::seconds(10)));
+        return found;
+    };
+    auto found = lookup();
+    EXPECT_NE(std::find(found.begin(), found.end(), loopback(7'001)), found.end());
+
+    // past its lifetime the peer is pruned by the rotation timer and no longer returned
+    loop.runUntil([] { return false; }, std::chrono::milliseconds(2'500));
+    found = lookup();
+    EXPECT_EQ(std::find(found.begin(), found.end(), loopback(7'001)), found.end());
+}
+
+TEST(DhtNodeTest, SwarmBootstrapAnnounceAndLookup)
+{
+    constexpr size_t kNodes = 48;
+    EventLoop loop;
+    std::vector<std::unique_ptr<DhtNode>> nodes;
+    for (size_t i = 0; i < kNodes; ++i)
+    {
+        nodes.push_back(std::make_unique<DhtNode>(loop, loopback()));
+    }
+
+    size_t bootstrapped = 0;
+    for (size_t i = 1; i < kNodes; ++i)
+    {
+        nodes[i]->bootstrap({nodes[0]->endpoint()}, [&] { ++bootstrapped; });
+    }
+    ASSERT_TRUE(loop.runUntil([&] { return bootstrapped == kNodes - 1; }, std::chrono::seconds(10)));
+    for (const auto& node : nodes)
+    {
+        EXPECT_GE(node->table().size(), RoutingTable::K);
+    }
+
+    NodeId infoHash = idWithPrefix(0x5a);
+    infoHash[19]    = 0x11;
+
+    bool announced = false;
+    nodes[7]->announce(infoHash, 7'000, [&](const std::vector<Endpoint>&) { announced = true; });
+    ASSERT_TRUE(loop.runUntil([&] { return announced; }, std::chrono::seconds(10)));
+
+    std::vector<Endpoint> found;
+    bool done = false;
+    nodes[31]->getPeers(infoHash,
+        [&](const std::vector<Endpoint>& peers)
+        {
+            found = peers;
+            done  = true;
+        });
+    ASSERT_TRUE(loop.runUntil([&] { return done; }, std::chrono::seconds(10)));
+
+    ASSERT_FALSE(found.empty());
+    EXPECT_NE(std::find(found.begin(), found.end(), loopback(7'000)), found.end());
+    for (const auto& node : nodes)
+    {
+        EXPECT_EQ(node->stats().queriesDropped, 0u);
+    }
+}
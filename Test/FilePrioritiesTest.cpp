@@ -0,0 +1,355 @@
+#include <Async/DiskIo.hpp>
+#include <Async/Executor.hpp>
+#include <Async/IoAwaitables.hpp>
+#include <Core/FilePriorities.hpp>
+#include <Core/Storage.hpp>
+#include <Core/Swarm.hpp>
+#include <Net/TcpStream.hpp>
+#include <Utils/BencodeEncoder.hpp>
+
+#include <gtest/gtest.h>
+#include <openssl/sha.h>
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <thread>
+
+using namespace Torrent;
+using namespace Torrent::Core;
+
+namespace {
+constexpr uint64_t kPiece = 2 * PeerWire::BlockSize;
+
+// Metadata with the given file sizes; enough for priorities and storage, no hashes.
+Metadata layout(const std::vector<uint64_t>& sizes, uint64_t pieceLength)
+{
+    Metadata meta;
+    meta.name        = "prio";
+    meta.pieceLength = pieceLength;
+    for (size_t i = 0; i < sizes.size(); ++i)
+    {
+        meta.files.push_back({"f" + std::to_string(i), sizes[i], {}, false});
+        meta.totalSize += sizes[i];
+    }
+    return meta;
+}
+
+std::vector<uint8_t> makeData(size_t size, uint32_t seed)
+{
+    std::vector<uint8_t> data(size);
+    std::mt19937 rng(seed);
+    for (auto& b : data)
+    {
+        b = static_cast<uint8_t>(rng());
+    }
+    return data;
+}
+
+// Multi-file v1 torrent over `data`.
+Metadata makeTorrent(const std::vector<uint8_t>& data, const std::vector<uint64_t>& sizes)
+{
+    using namespace Utils::Bencode;
+    std::string pieces;
+    for (size_t offset = 0; offset < data.size(); offset += kPiece)
+    {
+        unsigned char hash[SHA_DIGEST_LENGTH];
+        SHA1(data.data() + offset, std::min<size_t>(kPiece, data.size() - offset), hash);
+        pieces.append(reinterpret_cast<const char*>(hash), SHA_DIGEST_LENGTH);
+    }
+    List files;
+    for (size_t i = 0; i < sizes.size(); ++i)
+    {
+        files.push_back(Value(Dict{{"length", Value(sizes[i])}, {"path", Value(List{Value("f" + std::to_string(i))})}}));
+    }
+    Dict info{{"files", Value(files)}, {"name", Value(std::string("prio"))}, {"piece length", Value(kPiece)},
+        {"pieces", Value(pieces)}};
+    std::string raw;
+    encode(Value(info), raw);
+    return Utils::parseInfoDict(raw);
+}
+
+std::filesystem::path tempDir(const std::string& tag)
+{
+    auto dir = std::filesystem::temp_directory_path() / ("sk_prio_test_" + tag + "_" + std::to_string(std::rand()));
+    std::filesystem::create_directories(dir);
+    return dir;
+}
+
+std::vector<uint8_t> slurp(const std::filesystem::path& path)
+{
+    std::ifstream in(path, std::ios::binary);
+    return {std::istreambuf_iterator<char>(in), {}};
+}
+
+template <typename F>
+void onLoop(Net::EventLoop& loop, F fn)
+{
+    Async::syncWait(
+        [](Net::EventLoop& loop, F fn) -> Async::Task<void>
+        {
+            co_await Async::resumeOn(loop);
+            fn();
+        }(loop, std::move(fn)));
+}
+
+bool waitFor(Net::EventLoop& loop, const std::function<bool()>& pred)
+{
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(20);
+    while (std::chrono::steady_clock::now() < deadline)
+    {
+        bool done = false;
+        onLoop(loop, [&] { done = pred(); });
+        if (done)
+        {
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return false;
+}
+}  // namespace
+
+TEST(FilePrioritiesTest, BoundaryPiecesTakeTheHighestFile)
+{
+    // pieces of 100: [0,100) f0 | [100,200) f0 f1 | [200,300) f1 pad f3 | [300,350) f3
+    auto meta = layout({150, 70, 10, 120}, 100);
+    meta.files[2].padding = true;
+    FilePriorities priorities(meta);
+    ASSERT_EQ(priorities.pieceCount(), 4u);
+    EXPECT_EQ(priorities.piecesOf(1), std::pair(1u, 2u));
+
+    EXPECT_EQ(priorities.set(0, Priority::Skip), (std::vector<uint32_t>{0}));  // piece 1 still wanted for f1
+    EXPECT_EQ(priorities.piece(1), Priority::Normal);
+    EXPECT_EQ(priorities.set(1, Priority::Skip), (std::vector<uint32_t>{1}));
+    EXPECT_EQ(priorities.piece(2), Priority::Normal);  // f3; the pad file does not count
+    EXPECT_EQ(priorities.set(3, Priority::High), (std::vector<uint32_t>{2, 3}));
+    EXPECT_TRUE(priorities.set(3, Priority::High).empty());
+    EXPECT_EQ(priorities.set(1, Priority::Low), (std::vector<uint32_t>{1}));
+
+    std::vector<Priority> all{Priority::Normal, Priority::Normal, Priority::Skip, Priority::Normal};
+    EXPECT_EQ(priorities.set(all), (std::vector<uint32_t>{0, 1, 2, 3}));
+    EXPECT_THROW(priorities.set(std::vector<Priority>(3)), std::runtime_error);
+}
+
+TEST(FilePrioritiesTest, HundredThousandFilesUpdateIncrementally)
+{
+    constexpr size_t kFiles = 100'000;
+    std::mt19937 rng(3);
+    std::vector<uint64_t> sizes(kFiles);
+    for (auto& size : sizes)
+    {
+        size = rng() % 64 == 0 ? 1'000'000 + rng() % 3'000'000 : rng() % 20'000;  // mostly small, some spanning pieces
+    }
+    auto meta = layout(sizes, 256 * 1'024);
+    FilePriorities priorities(meta);
+    PiecePicker picker(priorities.pieceCount(), meta.pieceLength, meta.totalSize);
+
+    // select a few files out of the whole torrent
+    std::vector<Priority> only(kFiles, Priority::Skip);
+    for (size_t i = 0; i < kFiles; i += 997)
+    {
+        only[i] = Priority::High;
+    }
+    for (auto piece : priorities.set(only))
+    {
+        picker.setPriority(piece, priorities.piece(piece));
+    }
+
+    // brute force: a piece is wanted iff some wanted file overlaps it
+    auto expected = [&](uint32_t piece)
+    {
+        uint64_t begin = piece * meta.pieceLength;
+        uint64_t end   = std::min(begin + meta.pieceLength, meta.totalSize);
+        auto best      = Priority::Skip;
+        uint64_t at    = 0;
+        for (size_t i = 0; i < kFiles && at < end; at += sizes[i], ++i)
+        {
+            if (sizes[i] > 0 && at + sizes[i] > begin)
+            {
+                best = std::max(best, priorities.file(i));
+            }
+        }
+        return best;
+    };
+    for (uint32_t piece = 0; piece < priorities.pieceCount(); piece += 37)
+    {
+        ASSERT_EQ(priorities.piece(piece), expected(piece)) << piece;
+    }
+
+    // one file at runtime touches the pieces under it and nothing else
+    size_t big = 0;
+    while (sizes[big] < 1'000'000 || only[big] != Priority::Skip)
+    {
+        ++big;
+    }
+    auto [first, last] = *priorities.piecesOf(big);
+    auto changed       = priorities.set(big, Priority::Normal);
+    ASSERT_FALSE(changed.empty());
+    EXPECT_GE(changed.front(), first);
+    EXPECT_LE(changed.back(), last);
+    EXPECT_GE(changed.size(), last - first - 1);  // at least its interior
+    for (auto piece : changed)
+    {
+        EXPECT_EQ(priorities.piece(piece), expected(piece));
+        picker.setPriority(piece, priorities.piece(piece));
+    }
+    for (uint32_t piece = first; piece <= last; ++piece)
+    {
+        EXPECT_NE(picker.priority(piece), Priority::Skip);
+    }
+
+    // and back
+    auto undone = priorities.set(big, Priority::Skip);
+    for (auto piece : undone)
+    {
+        EXPECT_EQ(priorities.piece(piece), expected(piece));
+    }
+}
+
+TEST(FilePrioritiesTest, PickerHonoursPiecePriorities)
+{
+    PiecePicker picker(4, kPiece, 4 * kPiece);
+    std::vector<bool> all(4, true);
+    picker.addPeer(all);
+    picker.addPeer({false, false, true, false});  // piece 2 is the least rare
+    picker.setPriority(0, Priority::Skip);
+    picker.setPriority(1, Priority::Skip);
+    picker.setPriority(2, Priority::High);
+    EXPECT_FALSE(picker.finished());
+    EXPECT_FALSE(picker.interesting({true, true, false, false}));
+
+    auto now   = PiecePicker::Clock::now();
+    auto block = picker.pick(all, false, now);
+    ASSERT_TRUE(block);
+    EXPECT_EQ(block->piece, 2u);  // priority beats rarity
+    picker.pick(all, false, now);
+    block = picker.pick(all, false, now);
+    ASSERT_TRUE(block);
+    EXPECT_EQ(block->piece, 3u);
+    picker.pick(all, false, now);
+    EXPECT_FALSE(picker.pick(all, false, now));  // nothing but skipped pieces left
+
+    picker.onPieceVerified(2);
+    picker.onPieceVerified(3);
+    EXPECT_TRUE(picker.finished());
+    EXPECT_FALSE(picker.complete());
+    picker.setPriority(1, Priority::Low);
+    EXPECT_FALSE(picker.finished());
+    picker.setPriority(1, Priority::Skip);
+    EXPECT_TRUE(picker.finished());
+}
+
+TEST(FilePrioritiesTest, StorageKeepsSkippedFilesInThePartfile)
+{
+    auto dir  = tempDir("storage");
+    auto meta = layout({kPiece + 100, 3 * kPiece, kPiece - 100}, kPiece);
+    auto data = makeData(meta.totalSize, 5);
+    std::vector<Priority> priorities{Priority::Normal, Priority::Skip, Priority::Normal};
+
+    Async::Executor executor(1);
+    Async::DiskIo disk(1, &executor);
+    {
+        Storage storage(meta, dir.string(), priorities);
+        EXPECT_FALSE(storage.allocated(1));
+        EXPECT_FALSE(std::filesystem::exists(dir / "prio" / "f1"));
+        EXPECT_FALSE(std::filesystem::exists(storage.partPath()));
+
+        // the boundary pieces only
+        Async::syncWait(storage.write(disk, kPiece, std::span(data).subspan(kPiece, kPiece)));
+        Async::syncWait(storage.write(disk, 4 * kPiece, std::span(data).subspan(4 * kPiece)));
+        EXPECT_FALSE(std::filesystem::exists(dir / "prio" / "f1"));
+        EXPECT_TRUE(std::filesystem::exists(storage.partPath()));
+
+        std::vector<uint8_t> piece(kPiece);
+        Async::syncWait(storage.read(disk, kPiece, piece));
+        EXPECT_TRUE(std::equal(piece.begin(), piece.end(), data.begin() + kPiece));
+        Async::syncWait(storage.read(disk, 2 * kPiece, piece));  // never written
+        EXPECT_EQ(piece, std::vector<uint8_t>(kPiece, 0));
+    }
+
+    // a later run sees the same partfile; wanting the file moves the bytes over
+    Storage storage(meta, dir.string(), priorities);
+    EXPECT_FALSE(storage.allocated(1));
+    storage.allocate(1);
+    EXPECT_TRUE(storage.allocated(1));
+    auto f1 = slurp(dir / "prio" / "f1");
+    ASSERT_EQ(f1.size(), 3 * kPiece);
+    EXPECT_TRUE(std::equal(f1.begin(), f1.begin() + kPiece - 100, data.begin() + kPiece + 100));
+    EXPECT_EQ(std::vector<uint8_t>(f1.begin() + kPiece, f1.begin() + 2 * kPiece), std::vector<uint8_t>(kPiece, 0));
+    EXPECT_TRUE(std::equal(f1.end() - 100, f1.end(), data.begin() + 4 * kPiece));
+
+    std::filesystem::remove_all(dir);
+}
+
+TEST(FilePrioritiesTest, SwarmDownloadsSelectedFilesThenTheRest)
+{
+    std::vector<uint64_t> sizes{kPiece + 500, 4 * kPiece, 2 * kPiece - 500, 1'000};
+    uint64_t total = 0;
+    for (auto size : sizes)
+    {
+        total += size;
+    }
+    auto data     = makeData(total, 9);
+    auto meta     = makeTorrent(data, sizes);
+    auto seedDir  = tempDir("seed");
+    auto leechDir = tempDir("leech");
+    std::vector<Priority> priorities{Priority::Normal, Priority::Skip, Priority::High, Priority::Skip};
+
+    Net::EventLoop loop;
+    std::jthread thread([&] { loop.run(); });
+    Async::Executor executor(2);
+    Async::DiskIo disk(1, &executor);
+    {
+        Storage seedStorage(meta, seedDir.string());
+        Async::syncWait(seedStorage.write(disk, 0, data));
+        Swarm seeder(loop, executor, disk, meta, seedStorage, std::string(20, 'S'));
+        ASSERT_EQ(Async::syncWait(seeder.checkFiles()), meta.pieceHashes.size());
+
+        Storage leechStorage(meta, leechDir.string(), priorities);
+        Swarm::Options options;
+        options.filePriorities = priorities;
+        Swarm leecher(loop, executor, disk, meta, leechStorage, std::string(20, 'L'), options);
+
+        std::unique_ptr<Net::TcpListener> listener;
+        onLoop(loop,
+            [&]
+            {
+                listener = std::make_unique<Net::TcpListener>(loop, Net::Endpoint::parse("127.0.0.1", 0),
+                    [&](std::unique_ptr<Net::TcpStream> stream) { seeder.acceptPeer(std::move(stream)); });
+                leecher.addPeer(listener->localEndpoint());
+            });
+
+        ASSERT_TRUE(waitFor(loop, [&] { return leecher.picker().finished(); }));
+        bool complete = true;
+        onLoop(loop, [&] { complete = leecher.picker().complete(); });
+        EXPECT_FALSE(complete);  // the interior of f1 was never fetched
+        EXPECT_FALSE(std::filesystem::exists(leechDir / "prio" / "f1"));
+        EXPECT_FALSE(std::filesystem::exists(leechDir / "prio" / "f3"));
+        EXPECT_TRUE(std::filesystem::exists(leechStorage.partPath()));
+        auto f0 = slurp(leechDir / "prio" / "f0");
+        auto f2 = slurp(leechDir / "prio" / "f2");
+        EXPECT_TRUE(std::equal(f0.begin(), f0.end(), data.begin()));
+        EXPECT_TRUE(std::equal(f2.begin(), f2.end(), data.begin() + static_cast<ptrdiff_t>(sizes[0] + sizes[1])));
+
+        Async::syncWait(leecher.setFilePriority(1, Priority::Low));
+        Async::syncWait(leecher.setFilePriority(3, Priority::Normal));
+        ASSERT_TRUE(waitFor(loop, [&] { return leecher.picker().complete(); }));
+
+        Async::syncWait(leecher.shutdown());
+        Async::syncWait(seeder.shutdown());
+        onLoop(loop, [&] { listener.reset(); });
+    }
+    loop.stop();
+
+    std::vector<uint8_t> onDisk;
+    for (size_t i = 0; i < sizes.size(); ++i)
+    {
+        auto file = slurp(leechDir / "prio" / ("f" + std::to_string(i)));
+        onDisk.insert(onDisk.end(), file.begin(), file.end());
+    }
+    EXPECT_EQ(onDisk, data);
+    std::filesystem::remove_all(seedDir);
+    std::filesystem::remove_all(leechDir);
+}
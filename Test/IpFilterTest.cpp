@@ -0,0 +1,246 @@
+#include <Async/Executor.hpp>
+#include <Core/IpFilter.hpp>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Torrent;
+using namespace Torrent::Core;
+
+namespace {
+Net::Endpoint ip(const std::string& address)
+{
+    return Net::Endpoint::parse(address, 6'881);
+}
+
+Net::Endpoint v4(uint32_t address)
+{
+    uint8_t bytes[4] = {static_cast<uint8_t>(address >> 24), static_cast<uint8_t>(address >> 16),
+        static_cast<uint8_t>(address >> 8), static_cast<uint8_t>(address)};
+    return Net::Endpoint::fromV4(bytes, 6'881);
+}
+
+std::string dotted(uint32_t address)
+{
+    return std::to_string(address >> 24) + '.' + std::to_string(address >> 16 & 0xff) + '.'
+        + std::to_string(address >> 8 & 0xff) + '.' + std::to_string(address & 0xff);
+}
+
+std::filesystem::path tempDir(const std::string& tag)
+{
+    auto dir = std::filesystem::temp_directory_path() / ("sk_ipfilter_test_" + tag + "_" + std::to_string(std::rand()));
+    std::filesystem::create_directories(dir);
+    return dir;
+}
+}  // namespace
+
+TEST(IpFilterTest, ParsesP2pAndDatLines)
+{
+    auto filter = IpFilter::parse("# a comment\n"
+                                  "// another one\n"
+                                  "\n"
+                                  "Some ISP:1.2.3.0-1.2.3.255\n"
+                                  "Colons: in: description:10.0.0.1-10.0.0.9\r\n"
+                                  "IPv6 range:2001:db8::-2001:db8::ffff\n"
+                                  "020.000.000.000 - 020.000.000.255 , 000 , Leading zeros\n"
+                                  "030.000.000.000 - 030.000.000.255 , 200 , Level above 127\n"
+                                  "  040.0.0.0 - 040.0.0.9 , 127 , Commas, in, description\n"
+                                  "garbage line\n"
+                                  "Backwards:5.5.5.9-5.5.5.1\n"
+                                  "Bad octet:300.1.1.1-300.1.1.2\n");
+    EXPECT_EQ(filter.stats().lines, 6u);
+    EXPECT_EQ(filter.stats().rejected, 3u);
+    EXPECT_EQ(filter.stats().v4Ranges, 4u);
+    EXPECT_EQ(filter.stats().v6Ranges, 1u);
+
+    EXPECT_TRUE(filter.blocked(ip("1.2.3.0")));
+    EXPECT_TRUE(filter.blocked(ip("1.2.3.255")));
+    EXPECT_FALSE(filter.blocked(ip("1.2.4.0")));
+    EXPECT_FALSE(filter.blocked(ip("1.2.2.255")));
+    EXPECT_TRUE(filter.blocked(ip("10.0.0.5")));
+    EXPECT_FALSE(filter.blocked(ip("10.0.0.10")));
+    EXPECT_TRUE(filter.blocked(ip("20.0.0.128")));
+    EXPECT_FALSE(filter.blocked(ip("30.0.0.1")));
+    EXPECT_TRUE(filter.blocked(ip("40.0.0.9")));
+    EXPECT_FALSE(filter.blocked(ip("5.5.5.5")));
+    EXPECT_TRUE(filter.blocked(ip("2001:db8::abcd")));
+    EXPECT_FALSE(filter.blocked(ip("2001:db8::1:0")));
+    EXPECT_FALSE(filter.blocked(ip("::1")));
+
+    IpFilter empty;
+    EXPECT_EQ(empty.size(), 0u);
+    EXPECT_FALSE(empty.blocked(ip("1.2.3.4")));
+}
+
+TEST(IpFilterTest, MergesOverlappingAndAdjacentRanges)
+{
+    auto filter = IpFilter::parse("a:1.0.0.0-1.0.0.100\n"
+                                  "b:1.0.0.50-1.0.0.200\n"
+                                  "c:1.0.0.201-1.0.1.0\n"    // adjacent
+                                  "d:1.0.0.10-1.0.0.20\n"    // inside
+                                  "e:1.0.1.2-1.0.1.3\n"      // one address apart
+                                  "f:255.255.255.0-255.255.255.255\n"
+                                  "g:::fffe:ffff:ffff-::ffff:0.0.0.1\n"  // crosses into the IPv4-mapped block
+                                  "h:::ffff:255.255.255.255-::1:0:0:1\n");  // and out of it
+    EXPECT_EQ(filter.stats().lines, 8u);
+    EXPECT_EQ(filter.stats().v4Ranges, 4u);  // 0.0.0.0-0.0.0.1, 1.0.0.0-1.0.1.0, 1.0.1.2-1.0.1.3, 255.255.255.0-...
+    EXPECT_EQ(filter.stats().v6Ranges, 2u);
+    EXPECT_TRUE(filter.blocked(ip("1.0.0.201")));
+    EXPECT_TRUE(filter.blocked(ip("1.0.1.0")));
+    EXPECT_FALSE(filter.blocked(ip("1.0.1.1")));
+    EXPECT_TRUE(filter.blocked(ip("1.0.1.3")));
+    EXPECT_TRUE(filter.blocked(ip("0.0.0.1")));
+    EXPECT_FALSE(filter.blocked(ip("0.0.0.2")));
+    EXPECT_TRUE(filter.blocked(ip("255.255.255.255")));
+    EXPECT_TRUE(filter.blocked(ip("::fffe:ffff:ffff")));
+    EXPECT_TRUE(filter.blocked(ip("::1:0:0:0")));
+    EXPECT_FALSE(filter.blocked(ip("::1:0:0:2")));
+
+    auto everything = IpFilter::parse("all:::-ffff:ffff:ffff:ffff:ffff:ffff:ffff:ffff\nagain:1.2.3.4-1.2.3.5\n");
+    EXPECT_EQ(everything.stats().v4Ranges, 1u);
+    EXPECT_EQ(everything.stats().v6Ranges, 2u);
+    EXPECT_TRUE(everything.blocked(ip("0.0.0.0")));
+    EXPECT_TRUE(everything.blocked(ip("::")));
+    EXPECT_TRUE(everything.blocked(ip("ffff:ffff:ffff:ffff:ffff:ffff:ffff:ffff")));
+}
+
+TEST(IpFilterTest, ParallelParseMatchesBruteForce)
+{
+    std::mt19937 rng(48);
+    std::vector<std::pair<uint32_t, uint32_t>> ranges;
+    std::string text;
+    for (int i = 0; i < 60'000; ++i)
+    {
+        uint32_t first = rng();
+        uint32_t last  = first + rng() % 4'096;
+        if (last < first)
+        {
+            last = UINT32_MAX;
+        }
+        ranges.emplace_back(first, last);
+        text += (i % 2 ? "range " + std::to_string(i) + ':' + dotted(first) + '-' + dotted(last)
+                       : dotted(first) + " - " + dotted(last) + " , 100 , range " + std::to_string(i))
+            + '\n';
+    }
+    ASSERT_GT(text.size(), 1u << 20);  // several chunks
+
+    Async::Executor executor(3);
+    auto serial   = IpFilter::parse(text);
+    auto parallel = IpFilter::parse(text, &executor);
+    EXPECT_EQ(parallel.stats().lines, ranges.size());
+    EXPECT_EQ(parallel.stats().rejected, 0u);
+    EXPECT_EQ(parallel.size(), serial.size());
+    EXPECT_LT(parallel.size(), ranges.size());  // some overlap
+
+    auto bruteForce = [&](uint32_t address)
+    {
+        return std::any_of(ranges.begin(), ranges.end(), [&](const auto& r) { return r.first <= address && address <= r.second; });
+    };
+    for (int i = 0; i < 4'000; ++i)
+    {
+        // half near a range edge, where off-by-ones hide
+        const auto& range = ranges[rng() % ranges.size()];
+        uint32_t address  = i % 2 ? static_cast<uint32_t>(rng())
+                                  : (rng() % 2 ? range.first : range.second) + static_cast<uint32_t>(rng() % 3) - 1;
+        bool expected     = bruteForce(address);
+        ASSERT_EQ(parallel.blocked(v4(address)), expected) << dotted(address);
+        ASSERT_EQ(serial.blocked(v4(address)), expected) << dotted(address);
+    }
+}
+
+TEST(IpFilterTest, LoadsSeveralFiles)
+{
+    auto dir = tempDir("load");
+    std::ofstream(dir / "a.p2p") << "first:1.1.1.0-1.1.1.255\n";
+    std::ofstream(dir / "b.dat") << "002.002.002.000 - 002.002.002.255 , 050 , second\n";
+    std::ofstream(dir / "empty.p2p");
+
+    Async::Executor executor(2);
+    auto filter = IpFilter::load({(dir / "a.p2p").string(), (dir / "b.dat").string(), (dir / "empty.p2p").string()},
+        &executor);
+    EXPECT_EQ(filter.size(), 2u);
+    EXPECT_TRUE(filter.blocked(ip("1.1.1.1")));
+    EXPECT_TRUE(filter.blocked(ip("2.2.2.2")));
+    EXPECT_THROW(IpFilter::load({(dir / "missing.p2p").string()}), std::runtime_error);
+
+    Metrics::Registry metrics;
+    IpBlocklist blocklist(&metrics);
+    EXPECT_THROW(blocklist.load({(dir / "missing.p2p").string()}), std::runtime_error);
+    EXPECT_EQ(blocklist.stats().v4Ranges, 0u);
+    blocklist.load({(dir / "a.p2p").string()});
+    EXPECT_EQ(blocklist.stats().v4Ranges, 1u);
+    EXPECT_EQ(metrics.snapshot().find("sktorrent_ip_filter_ranges")->value, 1);
+    std::filesystem::remove_all(dir);
+}
+
+TEST(IpBlocklistTest, FiltersAndCountsBlockedEndpoints)
+{
+    Metrics::Registry metrics;
+    IpBlocklist blocklist(&metrics);
+    std::vector<Net::Endpoint> peers{ip("1.1.1.1"), ip("9.9.9.9"), ip("1.1.1.2"), ip("2001:db8::1")};
+    EXPECT_EQ(blocklist.filter(peers), 0u);
+    EXPECT_EQ(peers.size(), 4u);
+
+    blocklist.replace(std::make_unique<const IpFilter>(IpFilter::parse("one:1.1.1.0-1.1.1.255\nsix:2001:db8::-2001:db8::1\n")));
+    EXPECT_EQ(blocklist.filter(peers), 3u);
+    ASSERT_EQ(peers.size(), 1u);
+    EXPECT_EQ(peers[0], ip("9.9.9.9"));
+    EXPECT_TRUE(blocklist.blocked(ip("1.1.1.7")));
+    EXPECT_EQ(metrics.snapshot().find("sktorrent_blocked_peers_total")->value, 4);
+}
+
+TEST(IpBlocklistTest, ReplacesTheFilterUnderConcurrentReaders)
+{
+    Metrics::Registry metrics;
+    IpBlocklist blocklist(&metrics);
+    auto odd  = IpFilter::parse("odd:1.0.0.0-1.255.255.255\n");
+    auto even = IpFilter::parse("even:2.0.0.0-2.255.255.255\n");
+
+    // every lookup sees one whole filter: exactly one of the two addresses is blocked once the first swap is in
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> lookups{0};
+    std::atomic<uint64_t> torn{0};
+    std::vector<std::jthread> readers;
+    for (int i = 0; i < 4; ++i)
+    {
+        readers.emplace_back(
+            [&]
+            {
+                while (!stop)
+                {
+                    std::vector<Net::Endpoint> both{ip("1.2.3.4"), ip("2.3.4.5")};
+                    size_t removed = blocklist.filter(both);
+                    if (removed == 2)
+                    {
+                        ++torn;
+                    }
+                    ++lookups;
+                }
+            });
+    }
+    for (int swap = 0; swap < 500; ++swap)
+    {
+        blocklist.replace(std::make_unique<const IpFilter>(swap % 2 ? odd : even));
+        if (swap % 50 == 0)
+        {
+            std::this_thread::yield();
+        }
+    }
+    while (lookups < 1'000)
+    {
+        std::this_thread::yield();
+    }
+    stop = true;
+    readers.clear();
+    EXPECT_EQ(torn, 0u);
+    EXPECT_TRUE(blocklist.blocked(ip("1.9.9.9")));  // the last swap was odd
+    EXPECT_FALSE(blocklist.blocked(ip("2.9.9.9")));
+}
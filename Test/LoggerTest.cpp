@@ -0,0 +1,212 @@
+#include <Logger.hpp>
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <thread>
+
+TEST(LoggerTest, RingWrapsRecordsAroundTheEnd)
+{
+    LogRing ring(64);
+    std::vector<std::string> seen;
+    for (int i = 0; i < 20; ++i)
+    {
+        std::string record(7 + i % 5, static_cast<char>('a' + i));
+        ASSERT_TRUE(ring.tryPush(record));
+        ring.consume([&](std::string_view r) { seen.emplace_back(r); });
+        ASSERT_EQ(seen.back(), record);
+    }
+    EXPECT_EQ(seen.size(), 20u);
+    EXPECT_TRUE(ring.empty());
+}
+
+TEST(LoggerTest, FullRingRefusesUntilConsumed)
+{
+    LogRing ring(32);
+    EXPECT_TRUE(ring.tryPush(std::string(12, 'x')));
+    EXPECT_TRUE(ring.tryPush(std::string(12, 'y')));
+    EXPECT_FALSE(ring.tryPush("z"));
+    EXPECT_EQ(ring.consume([](std::string_view) {}), 2u);
+    EXPECT_TRUE(ring.tryPush("z"));
+}
+
+namespace {
+// The log file is shared by every run, so each test tags its lines.
+std::string runTag()
+{
+    return std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+}
+
+std::string readFile(const std::filesystem::path& path)
+{
+    std::ifstream in(path, std::ios::binary);
+    return std::string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+}
+}  // namespace
+
+TEST(LoggerTest, LinesFromManyThreadsAllReachTheFile)
+{
+    auto& logger = Logger::instance();
+    logger.setConsoleEnabled(false);
+    constexpr int Threads = 4;
+    constexpr int Lines   = 5'000;
+    auto run              = runTag();
+    {
+        std::vector<std::jthread> threads;
+        for (int t = 0; t < Threads; ++t)
+        {
+            threads.emplace_back(
+                [t, &run]
+                {
+                    for (int i = 0; i < Lines; ++i)
+                    {
+                        LOG_INFO(LoggerTest, "many threads", LOG_MD(Run, run), LOG_MD(Thread, t), LOG_MD(Line, i));
+                    }
+                });
+        }
+    }
+    logger.flush();
+    logger.setConsoleEnabled(true);
+
+    // the file may have rotated meanwhile
+    int count = 0;
+    for (const auto& entry : std::filesystem::directory_iterator(std::filesystem::path(logger.path()).parent_path()))
+    {
+        if (entry.path().extension() != ".log")
+        {
+            continue;
+        }
+        std::ifstream file(entry.path());
+        std::string line;
+        while (std::getline(file, line))
+        {
+            if (line.find("[I] [LoggerTest] many threads Run[" + run + "]") != std::string::npos)
+            {
+                ++count;
+            }
+        }
+    }
+    EXPECT_EQ(count, Threads * Lines);
+    EXPECT_EQ(logger.droppedLines(), 0u);
+}
+
+namespace {
+enum class Color : uint8_t
+{
+    Red = 3
+};
+
+int evaluations = 0;
+
+int counted(int v)
+{
+    ++evaluations;
+    return v;
+}
+}  // namespace
+
+TEST(LoggerTest, FormatsValuesWithoutStreams)
+{
+    std::string out;
+    appendLogValue(out, -42);
+    out += ' ';
+    appendLogValue(out, uint8_t{200});
+    out += ' ';
+    appendLogValue(out, true);
+    out += ' ';
+    appendLogValue(out, Color::Red);
+    out += ' ';
+    appendLogValue(out, 0.25);
+    out += ' ';
+    appendLogValue(out, "text");
+    out += ' ';
+    appendLogValue(out, std::string("str"));
+    out += ' ';
+    appendLogValue(out, 'c');
+    EXPECT_EQ(out, "-42 200 1 3 0.25 text str c");
+}
+
+TEST(LoggerTest, FilteredLinesDoNotEvaluateArguments)
+{
+    auto& logger = Logger::instance();
+    logger.setModuleLevel("Filtered", LogLevel::Warning);
+    evaluations = 0;
+    LOG_DEBUG(Filtered, "dropped", LOG_MD(Value, counted(1)));
+    LOG_INFO(Filtered, "dropped", LOG_MD(Value, counted(2)));
+    EXPECT_EQ(evaluations, 0);
+
+    logger.setConsoleEnabled(false);
+    LOG_WARNING(Filtered, "kept", LOG_MD(Value, counted(3)));
+    EXPECT_EQ(evaluations, 1);
+    logger.setModuleLevel("Filtered", LogLevel::Trace);
+    LOG_TRACE(Filtered, "kept", LOG_MD(Value, counted(4)));
+    EXPECT_EQ(evaluations, 2);
+    logger.flush();
+    logger.setConsoleEnabled(true);
+}
+
+TEST(LoggerTest, BinaryFileDecodesToTheTextFormat)
+{
+    auto& logger = Logger::instance();
+    logger.setConsoleEnabled(false);
+    logger.setFileFormat(LogFileFormat::Binary);
+    auto run = runTag();
+    std::string hash(20, '\x07');
+    for (int i = 0; i < 3; ++i)
+    {
+        LOG_WARNING(BinaryTest, "peer event", LOG_MD(Run, run), LOG_MD(Peer, -i), LOG_MD(Rate, 0.5f), LOG_MD(Ratio, 0.1),
+            LOG_MD(Choked, i == 1), LOG_MD(Kind, Color::Red), LOG_MD(Hash, hash), "tail");
+    }
+    logger.flush();
+    auto path = logger.path();
+    logger.setFileFormat(LogFileFormat::Text);
+    logger.setConsoleEnabled(true);
+
+    EXPECT_EQ(std::filesystem::path(path).extension(), ".sklog");
+    auto text = LogBinary::Decoder().decode(readFile(path));
+    std::vector<std::string> lines;
+    size_t begin = 0;
+    for (size_t end; (end = text.find('\n', begin)) != std::string::npos; begin = end + 1)
+    {
+        auto line = text.substr(begin, end - begin);
+        if (line.find("Run[" + run + "]") != std::string::npos)
+        {
+            lines.push_back(line);
+        }
+    }
+    ASSERT_EQ(lines.size(), 3u);
+    for (int i = 0; i < 3; ++i)
+    {
+        std::string expected = "[W] [BinaryTest] peer event Run[" + run + "] Peer[" + std::to_string(-i) +
+                               "] Rate[0.5] Ratio[0.1] Choked[" + std::to_string(i == 1) + "] Kind[3] Hash[" + hash + "] tail";
+        ASSERT_GT(lines[i].size(), 20u);
+        EXPECT_EQ(lines[i][4], '-');
+        EXPECT_EQ(lines[i].substr(20), expected);
+    }
+}
+
+TEST(LoggerTest, RotatesBySize)
+{
+    auto& logger = Logger::instance();
+    logger.setConsoleEnabled(false);
+    constexpr uint64_t MaxBytes = 4 * 1'024;
+    std::filesystem::path dir   = std::filesystem::path(logger.path()).parent_path();
+    std::filesystem::remove(dir / "skTorrent.3.log");
+    logger.setRotation(MaxBytes, 2);
+    for (int i = 0; i < 200; ++i)
+    {
+        LOG_INFO(RotationTest, "filler", LOG_MD(Line, i), LOG_MD(Padding, std::string(40, 'p')));
+        logger.flush();
+    }
+    logger.setRotation(LOG_ROTATE_BYTES, 5);
+    logger.setConsoleEnabled(true);
+
+    EXPECT_LE(std::filesystem::file_size(logger.path()), MaxBytes);
+    EXPECT_LE(std::filesystem::file_size(dir / "skTorrent.1.log"), MaxBytes);
+    EXPECT_TRUE(std::filesystem::exists(dir / "skTorrent.2.log"));
+    EXPECT_FALSE(std::filesystem::exists(dir / "skTorrent.3.log"));
+    EXPECT_NE(readFile(logger.path()).find("filler Line[199]"), std::string::npos);
+}
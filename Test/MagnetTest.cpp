@@ -0,0 +1,452 @@
+#include <Core/MetadataExchange.hpp>
+#include <Core/SessionManager.hpp>
+#include <Core/PeerWire.hpp>
+#include <Utils/MagnetUri.hpp>
+#include <Utils/MetaUtils.hpp>
+
+#include <Async/IoAwaitables.hpp>
+
+#include <gtest/gtest.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <mutex>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace Torrent;
+using namespace Torrent::Core;
+
+namespace {
+const std::string kPeerId(20, 'P');
+
+std::string makeInfoDict(size_t pieces)
+{
+    std::string hashes(pieces * 20, 'h');
+    for (size_t i = 0; i < hashes.size(); ++i)
+    {
+        hashes[i] = static_cast<char>(i * 31);
+    }
+    return "d6:lengthi" + std::to_string(pieces * 16'384) + "e4:name6:magnet12:piece lengthi16384e6:pieces" +
+           std::to_string(hashes.size()) + ":" + hashes + "e";
+}
+
+bool readAll(int fd, void* buf, size_t len)
+{
+    auto* p = static_cast<char*>(buf);
+    while (len > 0)
+    {
+        ssize_t n = ::recv(fd, p, len, 0);
+        if (n <= 0)
+        {
+            return false;
+        }
+        p   += n;
+        len -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+void writeAll(int fd, const std::string& data)
+{
+    ::send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+}
+
+// Blocking single-connection seeder; a corrupt seeder flips a byte in every piece it serves.
+class FakeSeeder
+{
+public:
+    FakeSeeder(std::string info, std::string infoHash, bool corrupt = false)
+        : m_info(std::move(info))
+        , m_infoHash(std::move(infoHash))
+        , m_corrupt(corrupt)
+    {
+        m_listen = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr{};
+        addr.sin_family      = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        ::bind(m_listen, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+        ::listen(m_listen, 4);
+        socklen_t len = sizeof(addr);
+        ::getsockname(m_listen, reinterpret_cast<sockaddr*>(&addr), &len);
+        m_port   = ntohs(addr.sin_port);
+        m_thread = std::jthread([this] { serve(); });
+    }
+
+    ~FakeSeeder()
+    {
+        ::shutdown(m_listen, SHUT_RDWR);
+        ::close(m_listen);
+    }
+
+    Net::Endpoint endpoint() const
+    {
+        return Net::Endpoint::parse("127.0.0.1", m_port);
+    }
+
+    std::atomic<int> served{0};
+
+private:
+    void serve()
+    {
+        int fd = ::accept(m_listen, nullptr, nullptr);
+        if (fd < 0)
+        {
+            return;
+        }
+        char hs[PeerWire::HandshakeSize];
+        if (readAll(fd, hs, sizeof(hs)))
+        {
+            writeAll(fd, PeerWire::encodeHandshake(m_infoHash, std::string(20, 'S')));
+            writeAll(fd, PeerWire::encodeExtended(0, PeerWire::encodeExtendedHandshake(3, static_cast<int64_t>(m_info.size()))));
+
+            uint8_t remoteId = 0;
+            while (true)
+            {
+                uint8_t header[4];
+                if (!readAll(fd, header, 4))
+                {
+                    break;
+                }
+                uint32_t len = (uint32_t(header[0]) << 24) | (uint32_t(header[1]) << 16) | (uint32_t(header[2]) << 8) | header[3];
+                std::string msg(len, '\0');
+                if (!readAll(fd, msg.data(), len))
+                {
+                    break;
+                }
+                if (len < 2 || msg[0] != static_cast<char>(PeerWire::MessageId::Extended))
+                {
+                    continue;
+                }
+                auto payload = std::string_view(msg).substr(2);
+                if (msg[1] == 0)
+                {
+                    remoteId = PeerWire::decodeExtendedHandshake(payload).utMetadata;
+                }
+                else if (msg[1] == 3)
+                {
+                    auto req    = PeerWire::decodeMetadataMessage(payload);
+                    auto offset = req.piece * PeerWire::MetadataPieceSize;
+                    auto piece  = m_info.substr(offset, PeerWire::MetadataPieceSize);
+                    if (m_corrupt)
+                    {
+                        piece[0] ^= 1;
+                    }
+                    auto reply = PeerWire::encodeMetadataData(req.piece, static_cast<int64_t>(m_info.size()), piece);
+                    writeAll(fd, PeerWire::encodeExtended(remoteId, reply));
+                    ++served;
+                }
+            }
+        }
+        ::close(fd);
+    }
+
+    std::string m_info;
+    std::string m_infoHash;
+    bool m_corrupt;
+    int m_listen   = -1;
+    uint16_t m_port = 0;
+    std::jthread m_thread;
+};
+
+// Blocking HTTP tracker that hands out one peer and keeps every request line.
+class FakeTracker
+{
+public:
+    explicit FakeTracker(const Net::Endpoint& peer)
+    {
+        m_peer.assign(reinterpret_cast<const char*>(peer.address.data() + 12), 4);  // IPv4-mapped
+        m_peer += static_cast<char>(peer.port >> 8);
+        m_peer += static_cast<char>(peer.port & 0xff);
+
+        m_listen = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr{};
+        addr.sin_family      = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        ::bind(m_listen, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+        ::listen(m_listen, 4);
+        socklen_t len = sizeof(addr);
+        ::getsockname(m_listen, reinterpret_cast<sockaddr*>(&addr), &len);
+        m_port   = ntohs(addr.sin_port);
+        m_thread = std::jthread([this] { serve(); });
+    }
+
+    ~FakeTracker()
+    {
+        ::shutdown(m_listen, SHUT_RDWR);
+        ::close(m_listen);
+    }
+
+    std::string url() const
+    {
+        return "http://127.0.0.1:" + std::to_string(m_port) + "/announce";
+    }
+
+    std::vector<std::string> requests()
+    {
+        std::scoped_lock lk(m_mutex);
+        return m_requests;
+    }
+
+private:
+    void serve()
+    {
+        while (true)
+        {
+            int fd = ::accept(m_listen, nullptr, nullptr);
+            if (fd < 0)
+            {
+                return;
+            }
+            std::string request;
+            char c;
+            while (!request.ends_with("\r\n\r\n") && ::recv(fd, &c, 1, 0) == 1)
+            {
+                request += c;
+            }
+            {
+                std::scoped_lock lk(m_mutex);
+                m_requests.push_back(request.substr(0, request.find("\r\n")));
+            }
+            auto body = "d8:intervali1800e5:peers6:" + m_peer + "e";
+            writeAll(fd, "HTTP/1.0 200 OK\r\nContent-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body);
+            ::close(fd);
+        }
+    }
+
+    std::string m_peer;  // compact form
+    int m_listen    = -1;
+    uint16_t m_port = 0;
+    std::mutex m_mutex;
+    std::vector<std::string> m_requests;
+    std::jthread m_thread;
+};
+
+std::string toHex(const std::string& bytes)
+{
+    std::string hex;
+    for (unsigned char c : bytes)
+    {
+        static const char digits[] = "0123456789abcdef";
+        hex.push_back(digits[c >> 4]);
+        hex.push_back(digits[c & 15]);
+    }
+    return hex;
+}
+}  // namespace
+
+TEST(MagnetTest, ParsesHexMagnet)
+{
+    auto link = Utils::parseMagnetUri("magnet:?xt=urn:btih:0123456789abcdef0123456789ABCDEF01234567&dn=My%20File%21"
+                                      "&tr=http%3A%2F%2Ft1%2Fannounce&tr=udp%3A%2F%2Ft2%3A80&x.pe=10.0.0.1:6881"
+                                      "&x.pe=[::1]:7000&x.pe=bogus");
+    EXPECT_EQ(link.infoHash, std::string("\x01\x23\x45\x67\x89\xab\xcd\xef\x01\x23\x45\x67\x89\xab\xcd\xef\x01\x23\x45\x67", 20));
+    EXPECT_EQ(link.displayName, "My File!");
+    ASSERT_EQ(link.trackers.size(), 2u);
+    EXPECT_EQ(link.trackers[0][0], "http://t1/announce");
+    EXPECT_EQ(link.trackers[1][0], "udp://t2:80");
+    ASSERT_EQ(link.peers.size(), 2u);
+    EXPECT_EQ(link.peers[0], Net::Endpoint::parse("10.0.0.1", 6'881));
+    EXPECT_EQ(link.peers[1], Net::Endpoint::parse("::1", 7'000));
+}
+
+TEST(MagnetTest, KeepsPlusSigns)
+{
+    auto link = Utils::parseMagnetUri("magnet:?xt=urn:btih:0123456789abcdef0123456789abcdef01234567&dn=C++%20Primer"
+                                      "&tr=http://t1/announce?key=a+b%2Bc");
+    EXPECT_EQ(link.displayName, "C++ Primer");
+    ASSERT_EQ(link.trackers.size(), 1u);
+    EXPECT_EQ(link.trackers[0][0], "http://t1/announce?key=a+b+c");
+    EXPECT_EQ(Utils::urlDecode("a+b%20c%2"), "a+b c%2");
+}
+
+TEST(MagnetTest, ParsesBase32Magnet)
+{
+    auto hex = Utils::parseMagnetUri("magnet:?xt=urn:btih:c12fe1c06bba254a9dc9f519b335aa7c1367a88a");
+    auto b32 = Utils::parseMagnetUri("magnet:?xt=urn:btih:YEX6DQDLXISUVHOJ6UM3GNNKPQJWPKEK");
+    EXPECT_EQ(hex.infoHash, b32.infoHash);
+}
+
+TEST(MagnetTest, RejectsInvalidMagnets)
+{
+    EXPECT_THROW(Utils::parseMagnetUri("http://example.com"), std::runtime_error);
+    EXPECT_THROW(Utils::parseMagnetUri("magnet:?dn=nohash"), std::runtime_error);
+    EXPECT_THROW(Utils::parseMagnetUri("magnet:?xt=urn:btih:1234"), std::runtime_error);
+    EXPECT_THROW(Utils::parseMagnetUri("magnet:?xt=urn:btih:zz23456789abcdef0123456789abcdef01234567"), std::runtime_error);
+}
+
+TEST(MagnetTest, WireMessagesRoundTrip)
+{
+    std::string hash(20, 'H');
+    auto hs = PeerWire::decodeHandshake(PeerWire::encodeHandshake(hash, kPeerId));
+    ASSERT_TRUE(hs);
+    EXPECT_TRUE(hs->extensions);
+    EXPECT_EQ(hs->infoHash, hash);
+    EXPECT_EQ(hs->peerId, kPeerId);
+
+    auto ext = PeerWire::decodeExtendedHandshake(PeerWire::encodeExtendedHandshake(7, 40'000));
+    EXPECT_EQ(ext.utMetadata, 7);
+    EXPECT_EQ(ext.metadataSize, 40'000);
+
+    auto data = PeerWire::decodeMetadataMessage(PeerWire::encodeMetadataData(2, 40'000, "payload"));
+    EXPECT_EQ(data.type, PeerWire::MetadataMessage::Data);
+    EXPECT_EQ(data.piece, 2u);
+    EXPECT_EQ(data.totalSize, 40'000);
+    EXPECT_EQ(data.data, "payload");
+
+    auto framed = PeerWire::encodeExtended(7, "xy");
+    EXPECT_EQ(framed, std::string("\x00\x00\x00\x04\x14\x07xy", 8));
+}
+
+TEST(MagnetTest, FetcherAssemblesAndVerifies)
+{
+    auto info = makeInfoDict(2'000);  // ~40 KB -> 3 pieces
+    MetadataFetcher fetcher(Utils::computeInfoHash(info));
+    EXPECT_FALSE(fetcher.setSize(0));
+    ASSERT_TRUE(fetcher.setSize(static_cast<int64_t>(info.size())));
+    EXPECT_FALSE(fetcher.setSize(static_cast<int64_t>(info.size()) + 1));
+    ASSERT_EQ(fetcher.pieceCount(), 3u);
+
+    std::vector<uint32_t> mine;
+    for (int i = 0; i < 3; ++i)
+    {
+        mine.push_back(*fetcher.nextPiece(mine));
+    }
+    EXPECT_EQ(mine, (std::vector<uint32_t>{0, 1, 2}));
+    EXPECT_FALSE(fetcher.nextPiece(mine));
+    // another peer gets a duplicate of a straggler
+    EXPECT_TRUE(fetcher.nextPiece({}));
+
+    auto piece = [&](uint32_t i) { return std::string_view(info).substr(i * 16'384, 16'384); };
+    EXPECT_THROW(fetcher.onData(0, "short"), std::runtime_error);
+    EXPECT_FALSE(fetcher.onData(0, piece(0)));
+    EXPECT_FALSE(fetcher.onData(2, piece(2)));
+    EXPECT_TRUE(fetcher.onData(1, piece(1)));
+    EXPECT_TRUE(fetcher.complete());
+    EXPECT_EQ(fetcher.info(), info);
+}
+
+TEST(MagnetTest, FetcherResetsOnHashMismatch)
+{
+    auto info = makeInfoDict(10);
+    MetadataFetcher fetcher(std::string(20, 'x'));
+    ASSERT_TRUE(fetcher.setSize(static_cast<int64_t>(info.size())));
+    ASSERT_EQ(*fetcher.nextPiece({}), 0u);
+    EXPECT_FALSE(fetcher.onData(0, info));
+    EXPECT_FALSE(fetcher.complete());
+    EXPECT_EQ(fetcher.hashFailures(), 1u);
+    EXPECT_EQ(fetcher.size(), 0);
+}
+
+TEST(MagnetTest, ExchangeFetchesFromSeveralPeers)
+{
+    auto info     = makeInfoDict(5'000);  // ~100 KB -> 7 pieces
+    auto infoHash = Utils::computeInfoHash(info);
+
+    FakeSeeder a(info, infoHash);
+    FakeSeeder b(info, infoHash);
+    FakeSeeder c(info, infoHash);
+
+    Net::EventLoop loop;
+    std::jthread thread([&] { loop.run(); });
+    Async::Executor executor(2);
+
+    // the first candidate refuses connections
+    int closed = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    ::bind(closed, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    socklen_t len = sizeof(addr);
+    ::getsockname(closed, reinterpret_cast<sockaddr*>(&addr), &len);
+    auto refused = Net::Endpoint::parse("127.0.0.1", ntohs(addr.sin_port));
+
+    MetadataExchange::Options opts;
+    opts.maxPeers      = 3;
+    opts.pipelineDepth = 2;
+    opts.peerTimeout   = std::chrono::seconds(5);
+    MetadataExchange exchange(loop, executor, infoHash, kPeerId, opts);
+    auto raw = Async::syncWait(exchange.run({refused, a.endpoint(), b.endpoint(), c.endpoint()}));
+    ::close(closed);
+
+    EXPECT_EQ(raw, info);
+    EXPECT_EQ(a.served + b.served + c.served >= 7, true);
+    EXPECT_GE((a.served > 0) + (b.served > 0) + (c.served > 0), 2);
+
+    auto meta = Utils::parseInfoDict(raw);
+    EXPECT_EQ(meta.infoHash, infoHash);
+    EXPECT_EQ(meta.name, "magnet");
+    EXPECT_EQ(meta.pieceHashes.size(), 5'000u);
+    loop.stop();
+}
+
+TEST(MagnetTest, ExchangeFailsWhenOnlyCorruptPeers)
+{
+    auto info     = makeInfoDict(100);
+    auto infoHash = Utils::computeInfoHash(info);
+    FakeSeeder bad(info, infoHash, true);
+
+    Net::EventLoop loop;
+    std::jthread thread([&] { loop.run(); });
+    Async::Executor executor(1);
+
+    MetadataExchange exchange(loop, executor, infoHash, kPeerId);
+    EXPECT_THROW(Async::syncWait(exchange.run({bad.endpoint()})), std::runtime_error);
+    EXPECT_FALSE(exchange.fetcher().complete());
+    loop.stop();
+}
+
+TEST(MagnetTest, SessionStartsFromMagnet)
+{
+    auto info     = makeInfoDict(1'000);
+    auto infoHash = Utils::computeInfoHash(info);
+    FakeSeeder seeder(info, infoHash);
+
+    SessionManager::Options opts;
+    opts.workers      = 2;
+    opts.tickInterval = std::chrono::milliseconds(20);
+    SessionManager manager(opts);
+    auto id = manager.add(kPeerId, "magnet:?xt=urn:btih:" + toHex(infoHash) + "&dn=pending&x.pe=" + seeder.endpoint().toString());
+    auto session = manager.find(id);
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (session->status().state != SessionState::Running && session->status().state != SessionState::Failed &&
+           std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    ASSERT_EQ(session->status().state, SessionState::Running);
+    EXPECT_EQ(session->metadata().name, "magnet");
+    EXPECT_EQ(session->metadata().infoHash, infoHash);
+    EXPECT_EQ(session->status().totalSize, 1'000u * 16'384);
+}
+
+TEST(MagnetTest, StartsOnceTheSizeIsKnown)
+{
+    auto info     = makeInfoDict(1'000);
+    auto infoHash = Utils::computeInfoHash(info);
+    FakeSeeder seeder(info, infoHash);
+    FakeTracker tracker(seeder.endpoint());
+
+    SessionManager::Options opts;
+    opts.workers      = 2;
+    opts.tickInterval = std::chrono::milliseconds(20);
+    SessionManager manager(opts);
+    auto id      = manager.add(kPeerId, "magnet:?xt=urn:btih:" + toHex(infoHash) + "&tr=" + tracker.url());
+    auto session = manager.find(id);
+
+    // the peer lookup before the metadata sends no size; the first announce after it starts with the real one
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (tracker.requests().size() < 2 && std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    auto requests = tracker.requests();
+    ASSERT_GE(requests.size(), 2u);
+    EXPECT_EQ(session->status().state, SessionState::Running);
+    EXPECT_EQ(requests[0].find("left="), std::string::npos) << requests[0];
+    EXPECT_NE(requests[0].find("&event=started"), std::string::npos) << requests[0];
+    EXPECT_NE(requests[1].find("&left=16384000&"), std::string::npos) << requests[1];
+    EXPECT_NE(requests[1].find("&event=started"), std::string::npos) << requests[1];
+}
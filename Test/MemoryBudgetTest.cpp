@@ -0,0 +1,239 @@
+#include <Async/DiskIo.hpp>
+#include <Async/Executor.hpp>
+#include <Async/IoAwaitables.hpp>
+#include <Core/MemoryBudget.hpp>
+#include <Core/ReadCache.hpp>
+#include <Core/Swarm.hpp>
+#include <Net/TcpStream.hpp>
+#include <Utils/BencodeEncoder.hpp>
+
+#include <gtest/gtest.h>
+#include <openssl/sha.h>
+
+#include <filesystem>
+#include <random>
+#include <thread>
+
+using namespace Torrent;
+using namespace Torrent::Core;
+
+namespace {
+constexpr uint64_t kPiece = 4 * PeerWire::BlockSize;
+
+template <typename F>
+void onLoop(Net::EventLoop& loop, F fn)
+{
+    Async::syncWait(
+        [](Net::EventLoop& loop, F fn) -> Async::Task<void>
+        {
+            co_await Async::resumeOn(loop);
+            fn();
+        }(loop, std::move(fn)));
+}
+
+Metadata makeTorrent(const std::vector<uint8_t>& data)
+{
+    using namespace Utils::Bencode;
+    std::string pieces;
+    for (size_t offset = 0; offset < data.size(); offset += kPiece)
+    {
+        unsigned char hash[SHA_DIGEST_LENGTH];
+        SHA1(data.data() + offset, std::min<size_t>(kPiece, data.size() - offset), hash);
+        pieces.append(reinterpret_cast<const char*>(hash), SHA_DIGEST_LENGTH);
+    }
+    Dict info{{"length", Value(uint64_t{data.size()})}, {"name", Value(std::string("budget.bin"))},
+        {"piece length", Value(kPiece)}, {"pieces", Value(pieces)}};
+    std::string raw;
+    encode(Value(info), raw);
+    return Utils::parseInfoDict(raw);
+}
+
+std::filesystem::path tempDir(const std::string& tag)
+{
+    auto dir = std::filesystem::temp_directory_path() / ("sk_budget_test_" + tag + "_" + std::to_string(std::rand()));
+    std::filesystem::create_directories(dir);
+    return dir;
+}
+}  // namespace
+
+TEST(MemoryBudgetTest, TracksUsageAndPressurePerCategory)
+{
+    Metrics::Registry metrics;
+    MemoryBudget budget(&metrics);
+    budget.setLimits(MemoryCategory::Network, {.soft = 100, .hard = 200});
+
+    budget.charge(MemoryCategory::Network, 60);
+    budget.charge(MemoryCategory::Metadata, 1'000);  // unlimited
+    EXPECT_EQ(budget.pressure(MemoryCategory::Network), MemoryPressure::None);
+    budget.charge(MemoryCategory::Network, 40);
+    EXPECT_EQ(budget.pressure(MemoryCategory::Network), MemoryPressure::Soft);
+    budget.charge(MemoryCategory::Network, 150);  // charge() never refuses
+    EXPECT_EQ(budget.pressure(MemoryCategory::Network), MemoryPressure::Hard);
+    EXPECT_EQ(budget.pressure(MemoryCategory::Metadata), MemoryPressure::None);
+
+    budget.release(MemoryCategory::Network, 200);
+    auto usage = budget.usage(MemoryCategory::Network);
+    EXPECT_EQ(usage.used, 50u);
+    EXPECT_EQ(usage.peak, 250u);
+    EXPECT_EQ(usage.limits.soft, 100u);
+    EXPECT_EQ(usage.pressure, MemoryPressure::None);
+
+    auto snapshot = metrics.snapshot();
+    auto* network = snapshot.find("sktorrent_memory_bytes", "category=\"network\"");
+    auto* meta    = snapshot.find("sktorrent_memory_bytes", "category=\"metadata\"");
+    ASSERT_TRUE(network && meta);
+    EXPECT_EQ(network->value, 50);
+    EXPECT_EQ(meta->value, 1'000);
+
+    // lowering the limits applies to what is already held
+    budget.setLimits(MemoryCategory::Metadata, {.soft = 500, .hard = 800});
+    EXPECT_EQ(budget.pressure(MemoryCategory::Metadata), MemoryPressure::Hard);
+}
+
+TEST(MemoryBudgetTest, TryChargeStopsAtTheHardLimit)
+{
+    Metrics::Registry metrics;
+    MemoryBudget budget(&metrics);
+    budget.setLimits(MemoryCategory::Pieces, {.soft = 50, .hard = 100});
+
+    EXPECT_TRUE(budget.tryCharge(MemoryCategory::Pieces, 80));
+    EXPECT_FALSE(budget.tryCharge(MemoryCategory::Pieces, 21));
+    EXPECT_TRUE(budget.tryCharge(MemoryCategory::Pieces, 20));
+    EXPECT_FALSE(budget.tryCharge(MemoryCategory::Pieces, 1));
+    EXPECT_EQ(budget.usage(MemoryCategory::Pieces).refused, 2u);
+    budget.release(MemoryCategory::Pieces, 100);
+
+    {
+        MemoryCharge charge(budget, MemoryCategory::Pieces, 30);
+        EXPECT_TRUE(charge.tryResize(90));
+        EXPECT_FALSE(charge.tryResize(101));
+        EXPECT_EQ(charge.bytes(), 90u);
+        MemoryCharge moved = std::move(charge);
+        EXPECT_EQ(budget.used(MemoryCategory::Pieces), 90u);
+        moved.resize(10);
+        EXPECT_EQ(budget.used(MemoryCategory::Pieces), 10u);
+    }
+    EXPECT_EQ(budget.used(MemoryCategory::Pieces), 0u);
+}
+
+TEST(MemoryBudgetTest, ReadCacheEvictsOldestAndTrimsUnderPressure)
+{
+    Metrics::Registry metrics;
+    MemoryBudget budget(&metrics);
+    budget.setLimits(MemoryCategory::ReadCache, {.soft = 250, .hard = 300});
+    ReadCache cache(budget, 3);
+
+    for (uint32_t piece = 0; piece < 4; ++piece)
+    {
+        cache.insert(piece, std::vector<uint8_t>(50, static_cast<uint8_t>(piece)));
+    }
+    EXPECT_EQ(cache.size(), 3u);  // capacity
+    EXPECT_FALSE(cache.find(0));
+    ASSERT_TRUE(cache.find(1));  // now the most recent
+    EXPECT_EQ(cache.find(1)->front(), 1);
+    EXPECT_EQ(budget.used(MemoryCategory::ReadCache), 150u);
+
+    // the budget refuses: the cache makes room out of its own pieces, oldest first
+    cache.insert(9, std::vector<uint8_t>(220));
+    EXPECT_EQ(cache.size(), 2u);
+    EXPECT_TRUE(cache.find(9));
+    EXPECT_TRUE(cache.find(1));
+    EXPECT_FALSE(cache.find(2));
+    EXPECT_EQ(budget.used(MemoryCategory::ReadCache), 270u);
+    EXPECT_EQ(budget.pressure(MemoryCategory::ReadCache), MemoryPressure::Soft);
+
+    // larger than the whole budget: served, not kept
+    auto big = cache.insert(10, std::vector<uint8_t>(400));
+    EXPECT_EQ(big->size(), 400u);
+    EXPECT_FALSE(cache.find(10));
+    EXPECT_EQ(cache.size(), 0u);
+
+    cache.insert(1, std::vector<uint8_t>(100));
+    cache.insert(2, std::vector<uint8_t>(100));
+    cache.insert(3, std::vector<uint8_t>(100));
+    EXPECT_EQ(budget.pressure(MemoryCategory::ReadCache), MemoryPressure::Hard);
+    EXPECT_FALSE(cache.admits());
+    cache.trim();
+    EXPECT_EQ(cache.size(), 0u);
+    EXPECT_EQ(budget.used(MemoryCategory::ReadCache), 0u);
+    EXPECT_TRUE(cache.admits());
+}
+
+TEST(MemoryBudgetTest, PickerFinishesStartedPiecesOnly)
+{
+    PiecePicker picker(3, kPiece, 3 * kPiece);
+    std::vector<bool> all(3, true);
+    picker.addPeer(all);
+    auto now   = PiecePicker::Clock::now();
+    auto first = picker.pick(all, false, now);
+    ASSERT_TRUE(first);
+    for (int i = 1; i < 4; ++i)
+    {
+        auto block = picker.pick(all, false, now, false);
+        ASSERT_TRUE(block);
+        EXPECT_EQ(block->piece, first->piece);
+    }
+    EXPECT_FALSE(picker.pick(all, false, now, false));
+    EXPECT_TRUE(picker.pick(all, false, now));
+}
+
+TEST(MemoryBudgetTest, SwarmDownloadsWithinATightBudget)
+{
+    std::vector<uint8_t> data(24 * kPiece + 777);
+    std::mt19937 rng(7);
+    for (auto& b : data)
+    {
+        b = static_cast<uint8_t>(rng());
+    }
+    auto meta     = makeTorrent(data);
+    auto seedDir  = tempDir("seed");
+    auto leechDir = tempDir("leech");
+
+    Metrics::Registry metrics;
+    MemoryBudget budget(&metrics);
+    budget.setLimits(MemoryCategory::Network, {.soft = 64 * 1'024, .hard = 128 * 1'024});
+    budget.setLimits(MemoryCategory::Pieces, {.soft = kPiece, .hard = 2 * kPiece});
+    budget.setLimits(MemoryCategory::ReadCache, {.soft = 2 * kPiece, .hard = 3 * kPiece});
+    Swarm::Options options;
+    options.memory  = &budget;
+    options.metrics = &metrics;
+
+    Net::EventLoop loop;
+    std::jthread thread([&] { loop.run(); });
+    Async::Executor executor(2);
+    Async::DiskIo disk(1, &executor);
+    {
+        Storage seedStorage(meta, seedDir.string());
+        Async::syncWait(seedStorage.write(disk, 0, data));
+        Swarm seeder(loop, executor, disk, meta, seedStorage, std::string(20, 'S'), options);
+        ASSERT_EQ(Async::syncWait(seeder.checkFiles()), meta.pieceHashes.size());
+        Storage leechStorage(meta, leechDir.string());
+        Swarm leecher(loop, executor, disk, meta, leechStorage, std::string(20, 'L'), options);
+
+        std::unique_ptr<Net::TcpListener> listener;
+        onLoop(loop,
+            [&]
+            {
+                listener = std::make_unique<Net::TcpListener>(loop, Net::Endpoint::parse("127.0.0.1", 0),
+                    [&](std::unique_ptr<Net::TcpStream> stream) { seeder.acceptPeer(std::move(stream)); });
+                leecher.addPeer(listener->localEndpoint());
+            });
+
+        std::vector<uint8_t> whole(data.size());
+        EXPECT_EQ(leecher.readBlocking(0, 0, whole), data.size());
+        EXPECT_EQ(whole, data);
+        EXPECT_GT(budget.usage(MemoryCategory::ReadCache).peak, 0u);
+        EXPECT_LE(budget.usage(MemoryCategory::ReadCache).peak, 3 * kPiece);
+
+        Async::syncWait(leecher.shutdown());
+        Async::syncWait(seeder.shutdown());
+        onLoop(loop, [&] { listener.reset(); });
+        EXPECT_EQ(budget.used(MemoryCategory::Network), 0u);
+        EXPECT_EQ(budget.used(MemoryCategory::Pieces), 0u);
+        EXPECT_EQ(budget.used(MemoryCategory::DiskWrite), 0u);
+    }
+    EXPECT_EQ(budget.used(MemoryCategory::ReadCache), 0u);
+    loop.stop();
+    std::filesystem::remove_all(seedDir);
+    std::filesystem::remove_all(leechDir);
+}
@@ -0,0 +1,308 @@
+#include <Async/Executor.hpp>
+#include <Core/MerkleTree.hpp>
+#include <Utils/BencodeEncoder.hpp>
+#include <Utils/MetaUtils.hpp>
+
+#include <gtest/gtest.h>
+#include <random>
+
+using namespace Torrent;
+using namespace Torrent::Core;
+using Merkle::Hash;
+
+namespace {
+constexpr uint64_t kPiece = 4 * Merkle::BlockSize;
+
+std::vector<uint8_t> makeData(size_t size, uint32_t seed = 1)
+{
+    std::vector<uint8_t> data(size);
+    std::mt19937 rng(seed);
+    for (auto& b : data)
+    {
+        b = static_cast<uint8_t>(rng());
+    }
+    return data;
+}
+
+Hash blockHash(const std::vector<uint8_t>& data, uint32_t block)
+{
+    size_t offset = size_t{block} * Merkle::BlockSize;
+    return Merkle::sha256(std::span(data).subspan(offset, std::min<size_t>(Merkle::BlockSize, data.size() - offset)));
+}
+
+// Whole tree in heap order, the way a seeder would answer hash requests.
+struct FullTree
+{
+    explicit FullTree(const std::vector<uint8_t>& data)
+    {
+        auto leaves = Merkle::hashBlocks(data);
+        width       = std::bit_ceil(leaves.size());
+        nodes.resize(2 * width - 1);
+        std::copy(leaves.begin(), leaves.end(), nodes.begin() + static_cast<ptrdiff_t>(width - 1));
+        for (size_t n = width - 1; n-- > 0;)
+        {
+            nodes[n] = Merkle::combine(nodes[2 * n + 1], nodes[2 * n + 2]);
+        }
+    }
+
+    // Uncles of a block from the leaf up, `levels` of them.
+    std::vector<Hash> proof(uint32_t block, unsigned levels) const
+    {
+        std::vector<Hash> out;
+        for (size_t i = width - 1 + block; i != 0 && out.size() < levels; i = (i - 1) / 2)
+        {
+            out.push_back(nodes[(i & 1) ? i + 1 : i - 1]);
+        }
+        return out;
+    }
+
+    size_t width;
+    std::vector<Hash> nodes;
+};
+
+std::string toString(const Hash& h)
+{
+    return {reinterpret_cast<const char*>(h.data()), h.size()};
+}
+
+std::string bencode(const Utils::Bencode::Value& value)
+{
+    std::string out;
+    Utils::Bencode::encode(value, out);
+    return out;
+}
+}  // namespace
+
+TEST(MerkleTest, RootOfSmallFileIsPaddedWithZeroLeaves)
+{
+    auto data   = makeData(2 * Merkle::BlockSize + 100);
+    auto hashes = Merkle::hashFile(data, kPiece);
+    EXPECT_TRUE(hashes.pieceLayer.empty());
+
+    Hash zero{};
+    auto left     = Merkle::combine(blockHash(data, 0), blockHash(data, 1));
+    auto expected = Merkle::combine(left, Merkle::combine(blockHash(data, 2), zero));
+    EXPECT_EQ(hashes.root, expected);
+    EXPECT_EQ(Merkle::padHash(1), Merkle::combine(zero, zero));
+    EXPECT_THROW(Merkle::hashFile(data, 3 * Merkle::BlockSize), std::runtime_error);
+}
+
+TEST(MerkleTest, ParallelHashingMatchesSerial)
+{
+    auto data = makeData(9 * 1'024 * 1'024 + 12'345);
+    Async::Executor executor(4);
+
+    auto serial   = Merkle::hashFile(data, kPiece);
+    auto parallel = Merkle::hashFile(data, kPiece, &executor);
+    EXPECT_EQ(serial.root, parallel.root);
+    EXPECT_EQ(serial.pieceLayer, parallel.pieceLayer);
+    EXPECT_EQ(serial.root, FullTree(data).nodes[0]);
+    EXPECT_EQ(serial.pieceLayer.size(), (data.size() + kPiece - 1) / kPiece);
+}
+
+TEST(MerkleTest, PieceLayerMustHashToRoot)
+{
+    auto data   = makeData(10 * Merkle::BlockSize);
+    auto hashes = Merkle::hashFile(data, kPiece);
+    ASSERT_EQ(hashes.pieceLayer.size(), 3u);
+
+    MerkleTree tree(data.size(), kPiece, hashes.root);
+    EXPECT_FALSE(tree.hasPieceLayer());
+    auto tampered = hashes.pieceLayer;
+    tampered[2][0] ^= 1;
+    EXPECT_FALSE(tree.setPieceLayer(tampered));
+    EXPECT_FALSE(tree.setPieceLayer(std::span(hashes.pieceLayer).first(2)));
+    EXPECT_TRUE(tree.setPieceLayer(hashes.pieceLayer));
+    EXPECT_TRUE(tree.hasPieceLayer());
+}
+
+TEST(MerkleTest, BlocksWithoutProofVerifyPerPiece)
+{
+    auto data   = makeData(10 * Merkle::BlockSize);
+    auto hashes = Merkle::hashFile(data, kPiece);
+    MerkleTree tree(data.size(), kPiece, hashes.root);
+
+    // blocks may arrive before the piece layer
+    EXPECT_EQ(tree.addBlock(0, blockHash(data, 0)), MerkleTree::Status::Pending);
+    ASSERT_TRUE(tree.setPieceLayer(hashes.pieceLayer));
+    EXPECT_EQ(tree.addBlock(1, blockHash(data, 1)), MerkleTree::Status::Pending);
+    EXPECT_EQ(tree.addBlock(2, blockHash(data, 2)), MerkleTree::Status::Pending);
+    EXPECT_EQ(tree.addBlock(3, blockHash(data, 3)), MerkleTree::Status::Verified);
+    EXPECT_TRUE(tree.pieceVerified(0));
+
+    // a corrupt block fails the piece and every unproven block has to come again
+    auto bad = blockHash(data, 5);
+    bad[0] ^= 1;
+    EXPECT_EQ(tree.addBlock(4, blockHash(data, 4)), MerkleTree::Status::Pending);
+    EXPECT_EQ(tree.addBlock(5, bad), MerkleTree::Status::Pending);
+    EXPECT_EQ(tree.addBlock(6, blockHash(data, 6)), MerkleTree::Status::Pending);
+    EXPECT_EQ(tree.addBlock(7, blockHash(data, 7)), MerkleTree::Status::Failed);
+    EXPECT_FALSE(tree.pieceVerified(1));
+    EXPECT_FALSE(tree.blockVerified(4));
+    for (uint32_t b = 4; b < 8; ++b)
+    {
+        tree.addBlock(b, blockHash(data, b));
+    }
+    EXPECT_TRUE(tree.pieceVerified(1));
+
+    // the last piece has two real blocks and two zero leaves
+    EXPECT_EQ(tree.addBlock(8, blockHash(data, 8)), MerkleTree::Status::Pending);
+    EXPECT_EQ(tree.addBlock(9, blockHash(data, 9)), MerkleTree::Status::Verified);
+    EXPECT_EQ(tree.cachedPieces(), 0u);
+}
+
+TEST(MerkleTest, ProofsVerifySingleBlocks)
+{
+    auto data = makeData(64 * Merkle::BlockSize);
+    FullTree full(data);
+    MerkleTree tree(data.size(), kPiece, full.nodes[0]);
+    EXPECT_EQ(tree.pieceCount(), 16u);
+
+    // without the piece layer the proof has to reach the root
+    EXPECT_EQ(tree.addBlock(21, blockHash(data, 21), full.proof(21, 3)), MerkleTree::Status::Pending);
+    EXPECT_EQ(tree.addBlock(21, blockHash(data, 21), full.proof(21, 6)), MerkleTree::Status::Verified);
+    EXPECT_TRUE(tree.blockVerified(21));
+
+    // its sibling leaf and piece node are cached now: neighbours need short proofs or none
+    EXPECT_EQ(tree.addBlock(20, blockHash(data, 20)), MerkleTree::Status::Verified);
+    EXPECT_EQ(tree.addBlock(22, blockHash(data, 22), full.proof(22, 1)), MerkleTree::Status::Verified);
+    // the piece layer above was cached as well, so a block of the sibling piece stops there
+    EXPECT_EQ(tree.addBlock(17, blockHash(data, 17), full.proof(17, 2)), MerkleTree::Status::Verified);
+
+    // a bad block is caught on its own, costing one block instead of a piece
+    auto bad = blockHash(data, 23);
+    bad[5] ^= 1;
+    EXPECT_EQ(tree.addBlock(23, bad), MerkleTree::Status::Failed);
+    EXPECT_FALSE(tree.pieceVerified(5));
+    EXPECT_EQ(tree.addBlock(23, blockHash(data, 23)), MerkleTree::Status::Verified);
+    EXPECT_TRUE(tree.pieceVerified(5));
+
+    // a forged proof is rejected
+    auto forged = full.proof(40, 6);
+    forged[4][0] ^= 1;
+    EXPECT_EQ(tree.addBlock(40, blockHash(data, 40), forged), MerkleTree::Status::Failed);
+    EXPECT_FALSE(tree.blockVerified(40));
+}
+
+TEST(MerkleTest, ProofSettlesEarlierUnprovenBlocks)
+{
+    auto data   = makeData(8 * Merkle::BlockSize);
+    auto hashes = Merkle::hashFile(data, kPiece);
+    FullTree full(data);
+    MerkleTree tree(data.size(), kPiece, hashes.root);
+    ASSERT_TRUE(tree.setPieceLayer(hashes.pieceLayer));
+
+    auto bad = blockHash(data, 0);
+    bad[0] ^= 1;
+    EXPECT_EQ(tree.addBlock(0, bad), MerkleTree::Status::Pending);
+    EXPECT_EQ(tree.addBlock(2, blockHash(data, 2)), MerkleTree::Status::Pending);
+    // block 1's proof names block 0's true hash, exposing the bad one
+    EXPECT_EQ(tree.addBlock(1, blockHash(data, 1), full.proof(1, 2)), MerkleTree::Status::Verified);
+    EXPECT_FALSE(tree.blockVerified(0));
+    EXPECT_EQ(tree.addBlock(3, blockHash(data, 3)), MerkleTree::Status::Verified);
+    EXPECT_TRUE(tree.blockVerified(2));
+    EXPECT_FALSE(tree.pieceVerified(0));
+    EXPECT_EQ(tree.addBlock(0, blockHash(data, 0)), MerkleTree::Status::Verified);
+    EXPECT_TRUE(tree.pieceVerified(0));
+}
+
+TEST(MerkleTest, ParsesV2Torrent)
+{
+    using namespace Utils::Bencode;
+    auto big    = makeData(5 * Merkle::BlockSize, 2);
+    auto small  = makeData(100, 3);
+    auto bigH   = Merkle::hashFile(big, kPiece);
+    auto smallH = Merkle::hashFile(small, kPiece);
+
+    auto file = [](uint64_t length, const Hash* root)
+    {
+        Dict attrs{{"length", Value(length)}};
+        if (root)
+        {
+            attrs["pieces root"] = Value(toString(*root));
+        }
+        return Value(Dict{{"", Value(attrs)}});
+    };
+    Dict dir{{"small.txt", file(small.size(), &smallH.root)}, {"empty", file(0, nullptr)}};
+    Dict tree{{"big.bin", file(big.size(), &bigH.root)}, {"dir", Value(dir)}};
+    Dict info{{"file tree", Value(tree)}, {"meta version", Value(uint64_t{2})}, {"name", Value(std::string("v2"))},
+        {"piece length", Value(kPiece)}};
+
+    std::string layer;
+    for (const auto& h : bigH.pieceLayer)
+    {
+        layer += toString(h);
+    }
+    auto rawInfo    = bencode(Value(info));
+    auto withLayers  = [&](Dict layers)
+    {
+        return bencode(Value(Dict{{"announce", Value(std::string("http://t/a"))}, {"info", Value(info)},
+            {"piece layers", Value(std::move(layers))}}));
+    };
+
+    auto meta = Utils::parseMetadata(withLayers(Dict{{toString(bigH.root), Value(layer)}}));
+    EXPECT_TRUE(meta.isV2());
+    EXPECT_FALSE(meta.isHybrid());
+    EXPECT_EQ(meta.infoHashV2, Utils::computeInfoHashV2(rawInfo));
+    EXPECT_EQ(meta.infoHash, meta.infoHashV2.substr(0, 20));
+    ASSERT_EQ(meta.files.size(), 3u);
+    EXPECT_EQ(meta.files[0].path, "big.bin");
+    EXPECT_EQ(meta.files[1].path, "dir/empty");
+    EXPECT_TRUE(meta.files[1].piecesRoot.empty());
+    EXPECT_EQ(meta.files[2].path, "dir/small.txt");
+    EXPECT_EQ(meta.totalSize, big.size() + small.size());
+
+    // the parsed layer feeds straight into verification
+    const auto& file0 = meta.files[0];
+    auto raw          = meta.pieceLayers.at(file0.piecesRoot);
+    std::vector<Hash> hashes;
+    for (size_t i = 0; i < raw.size(); i += 32)
+    {
+        hashes.push_back(Merkle::fromString(std::string_view(raw).substr(i, 32)));
+    }
+    MerkleTree merkle(file0.size, meta.pieceLength, Merkle::fromString(file0.piecesRoot));
+    EXPECT_TRUE(merkle.setPieceLayer(hashes));
+
+    // layers that do not hash up to a root of the torrent are rejected when parsing
+    auto tampered = layer;
+    tampered[40] ^= 1;
+    EXPECT_THROW(Utils::parseMetadata(withLayers(Dict{{toString(bigH.root), Value(tampered)}})), std::runtime_error);
+    EXPECT_THROW(Utils::parseMetadata(withLayers(Dict{{toString(bigH.root), Value(layer.substr(32))}})),
+        std::runtime_error);
+    EXPECT_THROW(Utils::parseMetadata(withLayers(Dict{{toString(smallH.root), Value(layer)}})), std::runtime_error);
+
+    info["piece length"] = Value(uint64_t{20'000});
+    EXPECT_THROW(Utils::parseInfoDict(bencode(Value(info))), std::runtime_error);
+}
+
+TEST(MerkleTest, ParsesHybridTorrent)
+{
+    using namespace Utils::Bencode;
+    auto a  = makeData(Merkle::BlockSize + 7, 4);
+    auto aH = Merkle::hashFile(a, kPiece);
+
+    auto fileV1 = [](const std::string& name, uint64_t length, const char* attr)
+    {
+        Dict d{{"length", Value(length)}, {"path", Value(List{Value(name)})}};
+        if (attr)
+        {
+            d["attr"] = Value(std::string(attr));
+        }
+        return Value(d);
+    };
+    Dict attrs{{"length", Value(uint64_t{a.size()})}, {"pieces root", Value(toString(aH.root))}};
+    Dict tree{{"a.bin", Value(Dict{{"", Value(attrs)}})}};
+    Dict info{{"file tree", Value(tree)}, {"meta version", Value(uint64_t{2})}, {"name", Value(std::string("hybrid"))},
+        {"piece length", Value(kPiece)}, {"pieces", Value(std::string(20, 'x'))},
+        {"files", Value(List{fileV1("a.bin", a.size(), nullptr), fileV1(".pad", kPiece - a.size(), "p")})}};
+    auto rawInfo = bencode(Value(info));
+
+    auto meta = Utils::parseInfoDict(rawInfo);
+    EXPECT_TRUE(meta.isHybrid());
+    EXPECT_EQ(meta.infoHash, Utils::computeInfoHash(rawInfo));
+    EXPECT_EQ(meta.infoHashV2, Utils::computeInfoHashV2(rawInfo));
+    ASSERT_EQ(meta.files.size(), 2u);
+    EXPECT_EQ(meta.files[0].piecesRoot, toString(aH.root));
+    EXPECT_TRUE(meta.files[1].padding);
+    EXPECT_EQ(meta.totalSize, kPiece);
+}
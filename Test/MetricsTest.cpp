@@ -0,0 +1,194 @@
+#include <Async/Executor.hpp>
+#include <Async/IoAwaitables.hpp>
+#include <Core/TorrentSession.hpp>
+#include <Metrics/Metrics.hpp>
+#include <Metrics/Prometheus.hpp>
+#include <Net/TcpStream.hpp>
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <thread>
+
+using namespace Torrent;
+using namespace Torrent::Metrics;
+
+TEST(MetricsTest, CounterSumsEveryThread)
+{
+    Registry registry;
+    auto& counter = registry.counter("test_events_total", "Events");
+    {
+        std::vector<std::jthread> threads;
+        for (int t = 0; t < 8; ++t)
+        {
+            threads.emplace_back(
+                [&counter]
+                {
+                    for (int i = 0; i < 10'000; ++i)
+                    {
+                        counter.add();
+                    }
+                });
+        }
+    }
+    EXPECT_EQ(counter.value(), 80'000u);
+    EXPECT_EQ(&registry.counter("test_events_total", "Events"), &counter);
+    EXPECT_THROW(registry.gauge("test_events_total", "Events"), std::runtime_error);
+}
+
+TEST(MetricsTest, HistogramBucketsStayWithinTheirPrecision)
+{
+    for (uint64_t v : {uint64_t{0}, uint64_t{7}, uint64_t{8}, uint64_t{9}, uint64_t{1'000}, uint64_t{123'456'789},
+             ~uint64_t{0}})
+    {
+        size_t bucket = Histogram::bucketOf(v);
+        ASSERT_LT(bucket, Histogram::BucketCount);
+        uint64_t upper = Histogram::upperBound(bucket);
+        EXPECT_GE(upper, v);
+        EXPECT_LE(upper - v, v / 8);
+        if (bucket > 0)
+        {
+            EXPECT_LT(Histogram::upperBound(bucket - 1), v);
+        }
+    }
+
+    Histogram histogram;
+    for (uint64_t v = 1; v <= 1'000; ++v)
+    {
+        histogram.record(v);
+    }
+    auto s = histogram.snapshot();
+    EXPECT_EQ(s.count, 1'000u);
+    EXPECT_EQ(s.sum, 500'500u);
+    EXPECT_NEAR(static_cast<double>(s.percentile(0.5)), 500, 500 / 8.0);
+    EXPECT_NEAR(static_cast<double>(s.percentile(0.99)), 990, 990 / 8.0);
+    EXPECT_EQ(s.percentile(1.0), Histogram::upperBound(Histogram::bucketOf(1'000)));
+}
+
+TEST(MetricsTest, ChildScopesShowUpWithTheirLabels)
+{
+    Registry root;
+    root.gauge("test_depth", "Depth").set(3);
+    {
+        Registry session("session=\"7\"", root);
+        session.counter("test_bytes_total", "Bytes").add(42);
+        auto s = root.snapshot();
+        ASSERT_NE(s.find("test_bytes_total", "session=\"7\""), nullptr);
+        EXPECT_EQ(s.find("test_bytes_total", "session=\"7\"")->value, 42);
+        EXPECT_EQ(s.find("test_depth")->value, 3);
+    }
+    EXPECT_EQ(root.snapshot().find("test_bytes_total", "session=\"7\""), nullptr);
+}
+
+TEST(MetricsTest, SessionsReportAnnouncesThroughTheirScope)
+{
+    Core::TorrentSession session("-SK0001-000000000000", "magnet:?xt=urn:btih:0123456789abcdef0123456789abcdef01234567");
+    EXPECT_FALSE(session.announce());  // no trackers yet
+    auto labels = session.metrics().labels();
+    auto s      = Registry::global().snapshot();
+    ASSERT_NE(s.find("sktorrent_announces_total", labels), nullptr);
+    EXPECT_EQ(s.find("sktorrent_announces_total", labels)->value, 0);
+    EXPECT_EQ(session.status().announces, 0u);
+}
+
+TEST(MetricsTest, SessionsAnnounceTheTransfersOfTheirScope)
+{
+    Metadata meta;
+    meta.name        = "scoped";
+    meta.announce    = "http://tracker.test/announce";
+    meta.infoHash    = std::string(20, 'i');
+    meta.pieceLength = 16'384;
+    meta.totalSize   = 1'000;
+    meta.files.push_back({"scoped", 1'000, {}, false});
+    Core::TorrentSession session("-SK0001-000000000000", "scoped.torrent", meta);
+
+    // what a swarm scoped to the session's metrics counts
+    session.metrics().counter("sktorrent_uploaded_bytes_total", "Payload bytes sent to peers").add(300);
+    session.metrics().counter("sktorrent_downloaded_bytes_total", "Payload bytes of accepted blocks").add(700);
+    auto fallback = session.getAnnounceRequest("http://other.test/announce");
+    EXPECT_NE(fallback.find("&uploaded=300&downloaded=700&left=1000"), std::string::npos) << fallback;
+
+    Net::EventLoop loop;
+    Async::Executor executor(1);
+    Async::DiskIo disk(1);
+    Async::syncWait(session.prepareSession({disk, executor, loop}));
+    auto request = session.getAnnounceRequest();
+    EXPECT_EQ(request.rfind("http://tracker.test/announce?", 0), 0u) << request;
+    EXPECT_NE(request.find("&uploaded=300&downloaded=700&left=1000"), std::string::npos) << request;
+}
+
+TEST(MetricsTest, RendersPrometheusText)
+{
+    Registry root;
+    root.counter("test_up_bytes_total", "Uploaded").add(5);
+    Registry session("session=\"1\"", root);
+    auto& latency = session.histogram("test_latency_microseconds", "Latency");
+    latency.record(3);
+    latency.record(3);
+    latency.record(100);
+
+    // the same ladder of buckets whatever was recorded, empty ones included
+    std::string buckets;
+    for (unsigned bits = 0; bits <= 36; ++bits)
+    {
+        uint64_t bound = (uint64_t{1} << bits) - 1;
+        buckets += "test_latency_microseconds_bucket{session=\"1\",le=\"" + std::to_string(bound) + "\"} "
+                   + (bound < 3 ? "0" : bound < 100 ? "2" : "3") + '\n';
+    }
+    EXPECT_EQ(renderPrometheus(root.snapshot()), "# HELP test_latency_microseconds Latency\n"
+                                                 "# TYPE test_latency_microseconds histogram\n"
+                                                     + buckets
+                                                     + "test_latency_microseconds_bucket{session=\"1\",le=\"+Inf\"} 3\n"
+                                                       "test_latency_microseconds_sum{session=\"1\"} 106\n"
+                                                       "test_latency_microseconds_count{session=\"1\"} 3\n"
+                                                       "# HELP test_up_bytes_total Uploaded\n"
+                                                       "# TYPE test_up_bytes_total counter\n"
+                                                       "test_up_bytes_total 5\n");
+
+    Registry idle;
+    idle.histogram("test_idle_microseconds", "Idle");
+    auto empty = renderPrometheus(idle.snapshot());
+    EXPECT_NE(empty.find("test_idle_microseconds_bucket{le=\"0\"} 0\n"), std::string::npos);
+    EXPECT_NE(empty.find("test_idle_microseconds_bucket{le=\"68719476735\"} 0\n"), std::string::npos);
+
+    auto path = (std::filesystem::temp_directory_path() / "sk_metrics_test.prom").string();
+    writePrometheusFile(root, path);
+    std::ifstream in(path);
+    std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    EXPECT_EQ(text, renderPrometheus(root.snapshot()));
+    std::filesystem::remove(path);
+}
+
+TEST(MetricsTest, ServesScrapesOnLoopback)
+{
+    Registry registry;
+    registry.counter("test_scrapes_total", "Scrapes").add(9);
+    Net::EventLoop loop;
+    std::jthread thread([&] { loop.run(); });
+    std::unique_ptr<PrometheusServer> server;
+    auto response = Async::syncWait(
+        [](Net::EventLoop& loop, Registry& registry, std::unique_ptr<PrometheusServer>& server) -> Async::Task<std::string>
+        {
+            co_await Async::resumeOn(loop);
+            server = std::make_unique<PrometheusServer>(loop, registry);
+            Net::TcpStream client(loop);
+            co_await client.connect(server->localEndpoint());
+            std::string request = "GET /metrics HTTP/1.1\r\nHost: localhost\r\n\r\n";
+            co_await client.write({reinterpret_cast<const uint8_t*>(request.data()), request.size()});
+            std::string response;
+            std::array<uint8_t, 1'024> buffer;
+            while (size_t n = co_await client.read(buffer))
+            {
+                response.append(reinterpret_cast<const char*>(buffer.data()), n);
+            }
+            server.reset();
+            co_return response;
+        }(loop, registry, server));
+    loop.stop();
+
+    EXPECT_TRUE(response.starts_with("HTTP/1.0 200 OK\r\n"));
+    EXPECT_NE(response.find("\r\n\r\n# HELP test_scrapes_total Scrapes\n"), std::string::npos);
+    EXPECT_NE(response.find("\ntest_scrapes_total 9\n"), std::string::npos);
+}
@@ -0,0 +1,224 @@
+#include <Core/PeerRouter.hpp>
+#include <Core/PeerWire.hpp>
+
+#include <gtest/gtest.h>
+
+#include <cerrno>
+#include <mutex>
+#include <thread>
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace Torrent;
+using namespace Torrent::Core;
+
+namespace {
+Net::LoopGroup::Options shards(size_t n)
+{
+    Net::LoopGroup::Options options;
+    options.shards     = n;
+    options.pinThreads = false;
+    return options;
+}
+
+int connectTo(uint16_t port)
+{
+    int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    sockaddr_in addr{};
+    addr.sin_family      = AF_INET;
+    addr.sin_port        = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    EXPECT_EQ(::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)), 0);
+    return fd;
+}
+
+void sendAll(int fd, std::string_view data)
+{
+    EXPECT_EQ(::send(fd, data.data(), data.size(), MSG_NOSIGNAL), static_cast<ssize_t>(data.size()));
+}
+
+// True once the router closed the connection; a reset if it left our handshake unread.
+bool closedByPeer(int fd)
+{
+    timeval timeout{5, 0};
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    char c;
+    auto n = ::recv(fd, &c, 1, 0);
+    return n == 0 || (n < 0 && errno == ECONNRESET);
+}
+
+struct Delivered
+{
+    size_t shard;
+    std::string handshake;  // as the acceptor reads it
+};
+
+// Records on which shard every connection arrives and what it reads first.
+struct Sink
+{
+    PeerRouter::Acceptor acceptor(Net::LoopGroup& loops)
+    {
+        return [this, &loops](std::unique_ptr<Net::TcpStream> stream)
+        {
+            std::string head(PeerWire::HandshakeSize, '\0');
+            auto n = ::recv(stream->fd(), head.data(), head.size(), 0);
+            head.resize(static_cast<size_t>(std::max<ssize_t>(n, 0)));
+            std::scoped_lock lk(mutex);
+            delivered.push_back({loops.currentShard(), head});
+        };
+    }
+
+    size_t size()
+    {
+        std::scoped_lock lk(mutex);
+        return delivered.size();
+    }
+
+    std::mutex mutex;
+    std::vector<Delivered> delivered;
+};
+
+bool waitFor(const std::function<bool()>& pred)
+{
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (!pred())
+    {
+        if (std::chrono::steady_clock::now() > deadline)
+        {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    return true;
+}
+}  // namespace
+
+TEST(PeerRouterTest, LoopGroupDestroyedRightAfterConstruction)
+{
+    // no PeerRouter and no runOnEach(): nothing waits for the shards before the destructor stops them
+    auto options       = shards(4);
+    options.pinThreads = true;
+    for (int i = 0; i < 30; ++i)
+    {
+        Net::LoopGroup loops(options);
+        EXPECT_EQ(loops.currentShard(), loops.size());
+    }
+}
+
+TEST(PeerRouterTest, HandsConnectionsToTheOwningShard)
+{
+    Net::LoopGroup loops(shards(4));
+    Metrics::Registry metrics;
+    PeerRouter router(loops, Net::Endpoint::parse("127.0.0.1", 0), {.metrics = &metrics});
+    EXPECT_TRUE(router.reusePort());
+
+    std::string first(20, 'a');
+    std::string second(20, 'b');
+    Sink sink;
+    router.add(first, 1, sink.acceptor(loops));
+    router.add(second, 3, sink.acceptor(loops));
+
+    std::vector<int> clients;
+    for (int i = 0; i < 40; ++i)
+    {
+        clients.push_back(connectTo(router.localEndpoint().port));
+        sendAll(clients.back(), PeerWire::encodeHandshake(i % 2 ? second : first, std::string(20, 'p')));
+    }
+    ASSERT_TRUE(waitFor([&] { return sink.size() == clients.size(); }));
+    for (const auto& d : sink.delivered)
+    {
+        auto handshake = PeerWire::decodeHandshake(d.handshake);
+        ASSERT_TRUE(handshake);  // nothing consumed on the way
+        EXPECT_EQ(d.shard, handshake->infoHash == first ? 1u : 3u);
+    }
+    auto stats = router.stats();
+    EXPECT_EQ(stats.routed, clients.size());
+    EXPECT_GT(stats.crossShard, 0u);  // the kernel spreads accepts over all four shards
+    EXPECT_EQ(stats.rejected, 0u);
+    for (int fd : clients)
+    {
+        ::close(fd);
+    }
+}
+
+TEST(PeerRouterTest, WaitsForSplitHandshakes)
+{
+    Net::LoopGroup loops(shards(2));
+    PeerRouter router(loops, Net::Endpoint::parse("127.0.0.1", 0));
+    std::string hash(20, 'h');
+    Sink sink;
+    router.add(hash, 0, sink.acceptor(loops));
+
+    int fd         = connectTo(router.localEndpoint().port);
+    auto handshake = PeerWire::encodeHandshake(hash, std::string(20, 'p'));
+    sendAll(fd, std::string_view(handshake).substr(0, 30));
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    EXPECT_EQ(sink.size(), 0u);
+    sendAll(fd, std::string_view(handshake).substr(30));
+    ASSERT_TRUE(waitFor([&] { return sink.size() == 1; }));
+    EXPECT_EQ(sink.delivered[0].handshake, handshake);
+    EXPECT_EQ(sink.delivered[0].shard, 0u);
+    ::close(fd);
+}
+
+TEST(PeerRouterTest, ClosesUnknownGarbageAndSilentConnections)
+{
+    Net::LoopGroup loops(shards(2));
+    Metrics::Registry metrics;
+    PeerRouter::Options options;
+    options.handshakeTimeout = std::chrono::milliseconds(100);
+    options.metrics          = &metrics;
+    PeerRouter router(loops, Net::Endpoint::parse("127.0.0.1", 0), options);
+    std::string hash(20, 'k');
+    Sink sink;
+    router.add(hash, 1, sink.acceptor(loops));
+
+    int unknown = connectTo(router.localEndpoint().port);
+    sendAll(unknown, PeerWire::encodeHandshake(std::string(20, 'u'), std::string(20, 'p')));
+    int garbage = connectTo(router.localEndpoint().port);
+    sendAll(garbage, std::string(PeerWire::HandshakeSize, 'x'));
+    int silent = connectTo(router.localEndpoint().port);
+    EXPECT_TRUE(closedByPeer(unknown));
+    EXPECT_TRUE(closedByPeer(garbage));
+    EXPECT_TRUE(closedByPeer(silent));
+    EXPECT_TRUE(waitFor([&] { return router.stats().rejected == 3; }));
+
+    // removed torrents are closed as well
+    router.remove(hash);
+    int removed = connectTo(router.localEndpoint().port);
+    sendAll(removed, PeerWire::encodeHandshake(hash, std::string(20, 'p')));
+    EXPECT_TRUE(closedByPeer(removed));
+    EXPECT_EQ(sink.size(), 0u);
+    for (int fd : {unknown, garbage, silent, removed})
+    {
+        ::close(fd);
+    }
+}
+
+TEST(PeerRouterTest, ClosesBlockedAddresses)
+{
+    Net::LoopGroup loops(shards(2));
+    Metrics::Registry metrics;
+    IpBlocklist blocklist(&metrics);
+    PeerRouter router(loops, Net::Endpoint::parse("127.0.0.1", 0), {.metrics = &metrics, .blocklist = &blocklist});
+    std::string hash(20, 'b');
+    Sink sink;
+    router.add(hash, 0, sink.acceptor(loops));
+
+    blocklist.replace(std::make_unique<const IpFilter>(IpFilter::parse("loopback:127.0.0.0-127.255.255.255\n")));
+    int blocked = connectTo(router.localEndpoint().port);
+    sendAll(blocked, PeerWire::encodeHandshake(hash, std::string(20, 'p')));
+    EXPECT_TRUE(closedByPeer(blocked));
+    EXPECT_TRUE(waitFor([&] { return router.stats().rejected == 1; }));
+    EXPECT_EQ(sink.size(), 0u);
+
+    blocklist.replace(std::make_unique<const IpFilter>());
+    int allowed = connectTo(router.localEndpoint().port);
+    sendAll(allowed, PeerWire::encodeHandshake(hash, std::string(20, 'p')));
+    EXPECT_TRUE(waitFor([&] { return sink.size() == 1; }));
+    EXPECT_EQ(router.stats().routed, 1u);
+    ::close(blocked);
+    ::close(allowed);
+}
@@ -0,0 +1,146 @@
+#include <Core/SessionManager.hpp>
+
+#include <gtest/gtest.h>
+#include <arpa/inet.h>
+#include <filesystem>
+#include <fstream>
+#include <unistd.h>
+
+using namespace Torrent::Core;
+
+static std::string writeTempTorrent()
+{
+    std::string pieces  = std::string(20, 'A');
+    std::string torrent = "d4:infod6:lengthi4096e4:name4:test12:piece lengthi16384e6:pieces20:" + pieces + "ee";
+
+    auto path = std::filesystem::temp_directory_path() / ("sk_session_test_" + std::to_string(std::rand()) + ".torrent");
+    std::ofstream ofs(path, std::ios::binary);
+    ofs.write(torrent.data(), static_cast<std::streamsize>(torrent.size()));
+    return path.string();
+}
+
+static bool waitFor(const std::function<bool()>& pred, std::chrono::milliseconds timeout = std::chrono::seconds(10))
+{
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (!pred())
+    {
+        if (std::chrono::steady_clock::now() > deadline)
+        {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return true;
+}
+
+TEST(SessionManagerTest, RunsManySessionsOnFixedThreads)
+{
+    SessionManager::Options opts;
+    opts.workers      = 2;
+    opts.ioThreads    = 2;
+    opts.tickInterval = std::chrono::milliseconds(20);
+    SessionManager manager(opts);
+
+    auto path = writeTempTorrent();
+    std::vector<SessionManager::SessionId> ids;
+    for (int i = 0; i < 300; ++i)
+    {
+        ids.push_back(manager.add("-SK0001-000000000000", path));
+    }
+    EXPECT_EQ(manager.size(), 300u);
+
+    ASSERT_TRUE(waitFor(
+        [&]
+        {
+            for (auto id : ids)
+            {
+                auto s = manager.find(id)->status();
+                if (s.state != SessionState::Running || s.failedAnnounces == 0)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }));
+
+    auto status = manager.find(ids[0])->status();
+    EXPECT_EQ(status.totalSize, 4'096u);
+    EXPECT_EQ(status.announces, 0u);  // no trackers in the test torrent
+}
+
+TEST(SessionManagerTest, StopIsNonBlockingAndTakesEffectOnTick)
+{
+    SessionManager::Options opts;
+    opts.workers      = 1;
+    opts.tickInterval = std::chrono::milliseconds(10);
+    SessionManager manager(opts);
+
+    auto id      = manager.add("-SK0001-000000000000", writeTempTorrent());
+    auto session = manager.find(id);
+    ASSERT_TRUE(waitFor([&] { return session->status().state == SessionState::Running; }));
+
+    EXPECT_TRUE(manager.remove(id));
+    EXPECT_FALSE(manager.remove(id));
+    EXPECT_EQ(manager.find(id), nullptr);
+    EXPECT_TRUE(session->status().stopRequested);
+    EXPECT_TRUE(waitFor([&] { return session->status().state == SessionState::Stopped; }));
+}
+
+TEST(SessionManagerTest, FailedPrepareIsReported)
+{
+    SessionManager manager;
+    auto id = manager.add("-SK0001-000000000000", "/this/path/does/not/exist.torrent");
+    EXPECT_TRUE(waitFor([&] { return manager.find(id)->status().state == SessionState::Failed; }));
+}
+
+TEST(SessionManagerTest, DestroyedRightAfterConstruction)
+{
+    // the io threads may not have entered their loops yet when the destructor stops and joins them
+    SessionManager::Options opts;
+    opts.workers   = 1;
+    opts.ioThreads = 4;
+    for (int i = 0; i < 50; ++i)
+    {
+        SessionManager manager(opts);
+    }
+}
+
+TEST(SessionManagerTest, DestroyedWhilePreparing)
+{
+    // a peer that never answers would hold a magnet's metadata fetch for the whole peer timeout
+    int silent = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len        = sizeof(addr);
+    ASSERT_EQ(::bind(silent, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)), 0);
+    ASSERT_EQ(::listen(silent, 64), 0);
+    ::getsockname(silent, reinterpret_cast<sockaddr*>(&addr), &len);
+    auto magnet = "magnet:?xt=urn:btih:0123456789abcdef0123456789abcdef01234567&x.pe=127.0.0.1:" +
+                  std::to_string(ntohs(addr.sin_port));
+    auto path = writeTempTorrent();
+
+    SessionManager::Options opts;
+    opts.workers   = 2;
+    opts.ioThreads = 2;
+    std::vector<std::shared_ptr<TorrentSession>> sessions;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 10; ++i)
+    {
+        SessionManager manager(opts);
+        auto fetching = manager.find(manager.add("-SK0001-000000000000", magnet));
+        manager.add("-SK0001-000000000000", path);
+        if (i % 2)
+        {
+            waitFor([&] { return fetching->status().state == SessionState::Preparing; });
+        }
+        sessions.push_back(fetching);
+    }
+    // every prepare has ended before its manager went away, the fetches by cancellation
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(10));
+    for (const auto& session : sessions)
+    {
+        EXPECT_EQ(session->status().state, SessionState::Failed);
+    }
+    ::close(silent);
+}
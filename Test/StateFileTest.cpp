@@ -0,0 +1,311 @@
+#include <Core/SessionManager.hpp>
+#include <Core/StateFile.hpp>
+#include <Core/TorrentCreator.hpp>
+
+#include <gtest/gtest.h>
+
+#include <arpa/inet.h>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <unistd.h>
+
+using namespace Torrent;
+using namespace Torrent::Core;
+
+namespace {
+const auto kDir = std::filesystem::temp_directory_path() / "sk_state_test";
+
+// A hybrid torrent carries everything the state file stores: v1 hashes, pad files, piece layers and tiers.
+std::string writeTorrent(const std::string& name, size_t size)
+{
+    std::filesystem::create_directories(kDir / name);
+    std::ofstream(kDir / name / "a.bin", std::ios::binary) << std::string(size, 'a');
+    std::ofstream(kDir / name / "b.bin", std::ios::binary) << std::string(size / 3, 'b');
+
+    CreateOptions options;
+    options.format      = TorrentFormat::Hybrid;
+    options.pieceLength = 16'384;
+    options.trackers    = {{"http://127.0.0.1:1/announce", "http://127.0.0.1:2/announce"}, {"udp://127.0.0.1:3"}};
+    auto path           = kDir / (name + ".torrent");
+    std::ofstream(path, std::ios::binary) << createTorrent((kDir / name).string(), options);
+    return path.string();
+}
+
+Metadata readMetadata(const std::string& path)
+{
+    std::ifstream in(path, std::ios::binary);
+    return Utils::parseMetadata(std::string(std::istreambuf_iterator<char>(in), {}));
+}
+
+void expectSame(const Metadata& a, const Metadata& b)
+{
+    EXPECT_EQ(a.announce, b.announce);
+    EXPECT_EQ(a.name, b.name);
+    EXPECT_EQ(a.pieceLength, b.pieceLength);
+    EXPECT_EQ(a.totalSize, b.totalSize);
+    EXPECT_EQ(a.pieceHashes, b.pieceHashes);
+    EXPECT_EQ(a.announceList, b.announceList);
+    ASSERT_EQ(a.files.size(), b.files.size());
+    for (size_t i = 0; i < a.files.size(); ++i)
+    {
+        EXPECT_EQ(a.files[i].path, b.files[i].path);
+        EXPECT_EQ(a.files[i].size, b.files[i].size);
+        EXPECT_EQ(a.files[i].piecesRoot, b.files[i].piecesRoot);
+        EXPECT_EQ(a.files[i].padding, b.files[i].padding);
+    }
+    EXPECT_EQ(a.infoHash, b.infoHash);
+    EXPECT_EQ(a.metaVersion, b.metaVersion);
+    EXPECT_EQ(a.infoHashV2, b.infoHashV2);
+    EXPECT_EQ(a.pieceLayers, b.pieceLayers);
+}
+
+std::string readAll(const std::filesystem::path& path)
+{
+    std::ifstream in(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), {});
+}
+
+void writeAll(const std::filesystem::path& path, const std::string& data)
+{
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << data;
+}
+
+StateFormat::Session record(const std::string& image, size_t index)
+{
+    StateFormat::Header header;
+    std::memcpy(&header, image.data(), sizeof(header));
+    StateFormat::Session session;
+    std::memcpy(&session, image.data() + header.table.offset + index * sizeof(session), sizeof(session));
+    return session;
+}
+
+bool waitFor(const std::function<bool()>& pred)
+{
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (!pred())
+    {
+        if (std::chrono::steady_clock::now() > deadline)
+        {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return true;
+}
+}  // namespace
+
+TEST(StateFileTest, Crc32cMatchesTheCheckValue)
+{
+    std::string_view check = "123456789";
+    EXPECT_EQ(crc32c({reinterpret_cast<const uint8_t*>(check.data()), check.size()}), 0xE306'9283u);
+    std::string longer(1'000, 'x');
+    auto whole = crc32c({reinterpret_cast<const uint8_t*>(longer.data()), longer.size()});
+    auto split = crc32c({reinterpret_cast<const uint8_t*>(longer.data()) + 13, longer.size() - 13},
+        crc32c({reinterpret_cast<const uint8_t*>(longer.data()), 13}));
+    EXPECT_EQ(whole, split);
+}
+
+TEST(StateFileTest, MapsSessionsBackWithoutParsing)
+{
+    auto first  = readMetadata(writeTorrent("one", 100'000));
+    auto second = readMetadata(writeTorrent("two", 40'000));
+    ASSERT_TRUE(first.isHybrid());
+    auto state = (kDir / "state").string();
+    std::vector<StateFile::Entry> entries{{"/x/one.torrent", &first, false}, {"magnet:?xt=two", &second, true}};
+    StateFile::write(state, entries);
+
+    auto file = StateFile::open(state);
+    ASSERT_EQ(file->size(), 2u);
+    auto view = file->session(0);
+    ASSERT_TRUE(view);
+    EXPECT_EQ(view->source(), "/x/one.torrent");
+    EXPECT_EQ(view->name(), first.name);
+    EXPECT_EQ(view->infoHash(), first.infoHash);
+    EXPECT_EQ(view->totalSize(), first.totalSize);
+    EXPECT_FALSE(view->paused());
+    ASSERT_EQ(view->pieceCount(), first.pieceHashes.size());
+    EXPECT_EQ(view->pieceHash(3), first.pieceHashes[3]);
+    ASSERT_EQ(view->fileCount(), first.files.size());
+    EXPECT_EQ(view->file(0).path, first.files[0].path);
+    expectSame(view->toMetadata(), first);
+
+    auto other = file->session(1);
+    ASSERT_TRUE(other);
+    EXPECT_TRUE(other->paused());
+    EXPECT_EQ(*file->source(1), "magnet:?xt=two");
+    expectSame(other->toMetadata(), second);
+}
+
+TEST(StateFileTest, DamagedSessionIsDetectedAndKeepsItsSource)
+{
+    auto first  = readMetadata(writeTorrent("one", 100'000));
+    auto second = readMetadata(writeTorrent("two", 40'000));
+    auto state  = kDir / "state";
+    std::vector<StateFile::Entry> entries{{"one.torrent", &first, false}, {"two.torrent", &second, true}};
+    StateFile::write(state.string(), entries);
+
+    auto image   = readAll(state);
+    auto damaged = record(image, 0);
+    image[damaged.pieces.offset + 7] ^= 0x40;
+    writeAll(state, image);
+
+    auto file = StateFile::open(state.string());
+    EXPECT_FALSE(file->session(0));
+    ASSERT_TRUE(file->source(0));
+    EXPECT_EQ(*file->source(0), "one.torrent");
+    ASSERT_TRUE(file->session(1));
+    expectSame(file->session(1)->toMetadata(), second);
+
+    // with the source gone as well there is nothing to fall back to
+    image[damaged.source.offset] ^= 0x01;
+    writeAll(state, image);
+    EXPECT_FALSE(StateFile::open(state.string())->source(0));
+}
+
+TEST(StateFileTest, RejectsForeignTruncatedAndDamagedFiles)
+{
+    auto meta  = readMetadata(writeTorrent("one", 100'000));
+    auto state = kDir / "state";
+    std::vector<StateFile::Entry> entries{{"one.torrent", &meta, false}};
+    StateFile::write(state.string(), entries);
+    auto image = readAll(state);
+
+    EXPECT_THROW(StateFile::open((kDir / "missing").string()), std::runtime_error);
+    writeAll(state, image.substr(0, image.size() - 1));
+    EXPECT_THROW(StateFile::open(state.string()), std::runtime_error);
+    writeAll(state, "d4:infod6:lengthi1eee" + std::string(100, ' '));
+    EXPECT_THROW(StateFile::open(state.string()), std::runtime_error);
+
+    auto tableDamaged = image;
+    tableDamaged[sizeof(StateFormat::Header) + offsetof(StateFormat::Session, totalSize)] ^= 0x01;
+    writeAll(state, tableDamaged);
+    EXPECT_THROW(StateFile::open(state.string()), std::runtime_error);
+
+    auto headerDamaged = image;
+    headerDamaged[offsetof(StateFormat::Header, sessions)] = 9;
+    writeAll(state, headerDamaged);
+    EXPECT_THROW(StateFile::open(state.string()), std::runtime_error);
+
+    // a failed write reports it and leaves the previous file alone
+    writeAll(state, image);
+    EXPECT_THROW(StateFile::write((kDir / "missing" / "state").string(), entries), std::runtime_error);
+    std::filesystem::create_directories(kDir / "occupied.tmp");
+    EXPECT_THROW(StateFile::write((kDir / "occupied").string(), entries), std::runtime_error);
+    EXPECT_EQ(readAll(state), image);
+}
+
+TEST(StateFileTest, ManagerRestoresSessionsAndReparsesDamagedOnes)
+{
+    auto one   = writeTorrent("one", 100'000);
+    auto two   = writeTorrent("two", 40'000);
+    auto state = kDir / "state";
+
+    SessionManager::Options options;
+    options.workers      = 2;
+    options.tickInterval = std::chrono::milliseconds(20);
+    {
+        SessionManager manager(options);
+        auto first  = manager.add(manager.newPeerId(), one);
+        auto second = manager.add(manager.newPeerId(), two);
+        ASSERT_TRUE(waitFor(
+            [&]
+            {
+                return manager.find(first)->status().state == SessionState::Running &&
+                       manager.find(second)->status().state == SessionState::Running;
+            }));
+        manager.setPaused(second, true);
+        EXPECT_EQ(manager.saveState(state.string()), 2u);
+    }
+
+    // the first session restores without its .torrent, the second is damaged and falls back to its .torrent
+    auto expected = readMetadata(one);
+    std::filesystem::remove(one);
+    auto image   = readAll(state);
+    auto damaged = record(image, 1);
+    image[damaged.data.offset + damaged.data.size - 1] ^= 0x01;
+    writeAll(state, image);
+
+    SessionManager manager(options);
+    auto result = manager.restoreState(state.string());
+    EXPECT_EQ(result.restored, 1u);
+    EXPECT_EQ(result.reparsed, 1u);
+    ASSERT_EQ(manager.size(), 2u);
+    auto restored = manager.find(1);
+    auto reparsed = manager.find(2);
+    ASSERT_TRUE(waitFor(
+        [&]
+        {
+            return restored->status().state == SessionState::Running && reparsed->status().state == SessionState::Running;
+        }));
+    expectSame(restored->metadata(), expected);
+    EXPECT_FALSE(restored->status().paused);
+    EXPECT_TRUE(reparsed->status().paused);
+    expectSame(reparsed->metadata(), readMetadata(two));
+    std::filesystem::remove_all(kDir);
+}
+
+TEST(StateFileTest, ManagerKeepsSessionsWithoutMetadata)
+{
+    auto one   = writeTorrent("one", 100'000);
+    auto state = kDir / "state";
+
+    // a peer that never answers holds the magnet's metadata fetch until it goes away
+    int silent = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len        = sizeof(addr);
+    ASSERT_EQ(::bind(silent, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)), 0);
+    ASSERT_EQ(::listen(silent, 4), 0);
+    ::getsockname(silent, reinterpret_cast<sockaddr*>(&addr), &len);
+    auto magnet = "magnet:?xt=urn:btih:0123456789abcdef0123456789abcdef01234567&x.pe=127.0.0.1:" +
+                  std::to_string(ntohs(addr.sin_port));
+    auto missing = (kDir / "missing.torrent").string();
+
+    SessionManager::Options options;
+    options.workers          = 2;
+    options.tickInterval     = std::chrono::milliseconds(20);
+    options.snapshotInterval = std::chrono::milliseconds(20);
+    {
+        SessionManager manager(options);
+        auto running   = manager.add(manager.newPeerId(), one);
+        auto preparing = manager.add(manager.newPeerId(), magnet);
+        auto failed    = manager.add(manager.newPeerId(), missing);
+        manager.setPaused(preparing, true);
+        ASSERT_TRUE(waitFor(
+            [&]
+            {
+                return manager.find(running)->status().state == SessionState::Running &&
+                       manager.find(failed)->status().state == SessionState::Failed;
+            }));
+        EXPECT_EQ(manager.find(preparing)->status().state, SessionState::Preparing);
+        EXPECT_EQ(manager.saveState(state.string()), 3u);
+
+        ::close(silent);
+        ASSERT_TRUE(waitFor([&] { return manager.find(preparing)->status().state != SessionState::Preparing; }));
+    }
+
+    auto file = StateFile::open(state.string());
+    ASSERT_EQ(file->size(), 3u);
+    EXPECT_FALSE(file->sourceOnly(0));
+    EXPECT_TRUE(file->sourceOnly(1));
+    EXPECT_FALSE(file->session(1));
+    EXPECT_EQ(file->source(1), magnet);
+    EXPECT_TRUE(file->paused(1));
+    EXPECT_TRUE(file->sourceOnly(2));
+    EXPECT_EQ(file->source(2), missing);
+
+    SessionManager manager(options);
+    auto result = manager.restoreState(state.string());
+    EXPECT_EQ(result.restored, 1u);
+    EXPECT_EQ(result.reparsed, 2u);
+    ASSERT_TRUE(waitFor([&] { return manager.snapshot()->sessions.size() == 3; }));
+    auto sessions = manager.snapshot()->sessions;
+    EXPECT_EQ(sessions[0].source, one);
+    EXPECT_EQ(sessions[1].source, magnet);
+    EXPECT_TRUE(sessions[1].status.paused);
+    EXPECT_EQ(sessions[2].source, missing);
+    std::filesystem::remove_all(kDir);
+}
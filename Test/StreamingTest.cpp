@@ -0,0 +1,345 @@
+#include <Async/DiskIo.hpp>
+#include <Async/Executor.hpp>
+#include <Async/IoAwaitables.hpp>
+#include <Core/PeerWire.hpp>
+#include <Core/PiecePicker.hpp>
+#include <Core/Storage.hpp>
+#include <Core/Swarm.hpp>
+#include <Net/TcpStream.hpp>
+#include <Utils/BencodeEncoder.hpp>
+#include <Utils/MetaUtils.hpp>
+
+#include <gtest/gtest.h>
+#include <openssl/sha.h>
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <thread>
+
+using namespace Torrent;
+using namespace Torrent::Core;
+using namespace std::chrono_literals;
+
+namespace {
+constexpr uint64_t kPiece = 2 * PeerWire::BlockSize;
+
+std::vector<uint8_t> makeData(size_t size, uint32_t seed = 1)
+{
+    std::vector<uint8_t> data(size);
+    std::mt19937 rng(seed);
+    for (auto& b : data)
+    {
+        b = static_cast<uint8_t>(rng());
+    }
+    return data;
+}
+
+// Two-file v1 torrent over `data`, split after `firstSize` bytes.
+Metadata makeTorrent(const std::vector<uint8_t>& data, size_t firstSize)
+{
+    using namespace Utils::Bencode;
+    std::string pieces;
+    for (size_t offset = 0; offset < data.size(); offset += kPiece)
+    {
+        unsigned char hash[SHA_DIGEST_LENGTH];
+        SHA1(data.data() + offset, std::min<size_t>(kPiece, data.size() - offset), hash);
+        pieces.append(reinterpret_cast<const char*>(hash), SHA_DIGEST_LENGTH);
+    }
+    auto file = [](const std::string& name, uint64_t length)
+    { return Value(Dict{{"length", Value(length)}, {"path", Value(List{Value(name)})}}); };
+    Dict info{{"files", Value(List{file("a.bin", firstSize), file("b.bin", data.size() - firstSize)})},
+        {"name", Value(std::string("stream"))}, {"piece length", Value(kPiece)}, {"pieces", Value(pieces)}};
+    std::string raw;
+    encode(Value(info), raw);
+    return Utils::parseInfoDict(raw);
+}
+
+std::filesystem::path tempDir(const std::string& tag)
+{
+    auto dir = std::filesystem::temp_directory_path() / ("sk_stream_test_" + tag + "_" + std::to_string(std::rand()));
+    std::filesystem::create_directories(dir);
+    return dir;
+}
+
+template <typename F>
+void onLoop(Net::EventLoop& loop, F fn)
+{
+    Async::syncWait(
+        [](Net::EventLoop& loop, F fn) -> Async::Task<void>
+        {
+            co_await Async::resumeOn(loop);
+            fn();
+        }(loop, std::move(fn)));
+}
+
+std::vector<bool> all(uint32_t n)
+{
+    return std::vector<bool>(n, true);
+}
+}  // namespace
+
+TEST(StreamingTest, PeerWireMessagesRoundTrip)
+{
+    using PeerWire::MessageId;
+    auto have = PeerWire::encodeHave(0x01020304);
+    ASSERT_EQ(have.size(), 9u);
+    EXPECT_EQ(static_cast<MessageId>(have[4]), MessageId::Have);
+    EXPECT_EQ(PeerWire::decodeHave(std::string_view(have).substr(5)), 0x01020304u);
+
+    std::vector<bool> pieces{true, false, true, true, false, false, false, false, true, false};
+    auto bitfield = PeerWire::encodeBitfield(pieces);
+    EXPECT_EQ(bitfield.size(), 5u + 2);
+    EXPECT_EQ(PeerWire::decodeBitfield(std::string_view(bitfield).substr(5), 10), pieces);
+    EXPECT_THROW(PeerWire::decodeBitfield(std::string_view(bitfield).substr(5), 17), std::runtime_error);
+
+    auto cancel  = PeerWire::encodeRequest(MessageId::Cancel, 7, 16'384, 100);
+    auto request = PeerWire::decodeRequest(std::string_view(cancel).substr(5));
+    EXPECT_EQ(static_cast<MessageId>(cancel[4]), MessageId::Cancel);
+    EXPECT_EQ(request.piece, 7u);
+    EXPECT_EQ(request.begin, 16'384u);
+    EXPECT_EQ(request.length, 100u);
+
+    auto piece = PeerWire::encodePieceHeader(3, 32, 5) + "hello";
+    EXPECT_EQ(piece.substr(0, 4), std::string("\0\0\0\x0e", 4));
+    auto block = PeerWire::decodePiece(std::string_view(piece).substr(5));
+    EXPECT_EQ(block.piece, 3u);
+    EXPECT_EQ(block.begin, 32u);
+    EXPECT_EQ(block.length, 5u);
+    EXPECT_EQ(block.data, "hello");
+}
+
+TEST(StreamingTest, PicksRarestPieceFirst)
+{
+    PiecePicker picker(4, kPiece, 4 * kPiece);
+    picker.addPeer(all(4));
+    picker.addPeer({true, true, false, true});
+    picker.addPeer({true, false, false, true});
+
+    auto block = picker.pick(all(4), false, PiecePicker::Clock::now());
+    ASSERT_TRUE(block);
+    EXPECT_EQ(block->piece, 2u);
+    EXPECT_EQ(block->offset, 0u);
+    EXPECT_EQ(block->length, PeerWire::BlockSize);
+
+    // the started piece is finished before the next rarest one
+    block = picker.pick(all(4), false, PiecePicker::Clock::now());
+    ASSERT_TRUE(block);
+    EXPECT_EQ(block->piece, 2u);
+    EXPECT_EQ(block->offset, PeerWire::BlockSize);
+    block = picker.pick(all(4), false, PiecePicker::Clock::now());
+    ASSERT_TRUE(block);
+    EXPECT_EQ(block->piece, 1u);
+}
+
+TEST(StreamingTest, RarestPieceFollowsAvailabilityAndPriorityChanges)
+{
+    auto now = PiecePicker::Clock::now();
+    PiecePicker empty(0, kPiece, 0);
+    EXPECT_FALSE(empty.pick({}, false, now));
+
+    PiecePicker picker(4, kPiece, 4 * kPiece);
+    for (uint32_t i = 0; i < 4; ++i)
+    {
+        picker.setPriority(i, Priority::Skip);
+    }
+    picker.addPeer(all(4));
+    EXPECT_FALSE(picker.pick(all(4), false, now));
+
+    // piece 3 is rarest once a second peer brings the others, until the peer leaves and piece 0 is raised
+    for (uint32_t i = 0; i < 4; ++i)
+    {
+        picker.setPriority(i, Priority::Normal);
+    }
+    std::vector<bool> second{true, true, true, false};
+    picker.addPeer(second);
+    auto block = picker.pick({false, true, true, true}, false, now);
+    ASSERT_TRUE(block);
+    EXPECT_EQ(block->piece, 3u);
+    picker.onPieceFailed(3);
+    picker.removePeer(second);
+    picker.onHave(3);
+    picker.setPriority(0, Priority::High);
+    block = picker.pick(all(4), false, now);
+    ASSERT_TRUE(block);
+    EXPECT_EQ(block->piece, 0u);
+
+    // verified pieces are never picked again
+    picker.onPieceVerified(1);
+    picker.onPieceVerified(2);
+    EXPECT_FALSE(picker.pick({false, true, true, false}, false, now));
+    block = picker.pick({false, true, true, true}, false, now);
+    ASSERT_TRUE(block);
+    EXPECT_EQ(block->piece, 3u);
+}
+
+TEST(StreamingTest, DeadlinesOrderPiecesAndGateUrgentOnes)
+{
+    auto now = PiecePicker::Clock::now();
+    PiecePicker picker(6, kPiece, 6 * kPiece - 10);
+    picker.addPeer(all(6));
+    picker.setDeadline(4, now + 10s);
+    picker.setDeadline(5, now + 20s);
+    picker.setDeadline(3, now);
+
+    // piece 3 is urgent: a slow peer gets the next deadline outside the window instead
+    auto slow = picker.pick(all(6), false, now);
+    ASSERT_TRUE(slow);
+    EXPECT_EQ(slow->piece, 4u);
+
+    auto fast = picker.pick(all(6), true, now);
+    ASSERT_TRUE(fast);
+    EXPECT_EQ(fast->piece, 3u);
+    fast = picker.pick(all(6), true, now);
+    EXPECT_EQ(fast->piece, 3u);
+    EXPECT_EQ(fast->offset, PeerWire::BlockSize);
+
+    // the short last piece has a short last block
+    picker.setDeadline(5, now);
+    fast = picker.pick(all(6), true, now);
+    fast = picker.pick(all(6), true, now);
+    ASSERT_TRUE(fast);
+    EXPECT_EQ(fast->piece, 5u);
+    EXPECT_EQ(fast->length, PeerWire::BlockSize - 10);
+}
+
+TEST(StreamingTest, StalledUrgentBlockGoesToASecondPeer)
+{
+    auto now = PiecePicker::Clock::now();
+    PiecePicker picker(2, PeerWire::BlockSize, 2 * PeerWire::BlockSize, {.urgentWindow = 2s, .rerequestAfter = 500ms});
+    picker.addPeer(all(2));
+    picker.setDeadline(0, now);
+
+    auto first = picker.pick(all(2), true, now);
+    ASSERT_TRUE(first);
+    EXPECT_EQ(first->piece, 0u);
+    // not stalled yet: the other fast peer moves on to rarest-first work
+    auto other = picker.pick(all(2), true, now + 100ms);
+    ASSERT_TRUE(other);
+    EXPECT_EQ(other->piece, 1u);
+
+    auto second = picker.pick(all(2), true, now + 600ms);
+    ASSERT_TRUE(second);
+    EXPECT_EQ(*second, *first);
+    EXPECT_FALSE(picker.pick(all(2), true, now + 2s));
+
+    EXPECT_TRUE(picker.onBlock(*first));
+    EXPECT_FALSE(picker.onBlock(*second));
+    EXPECT_TRUE(picker.piecePending(0));
+    picker.onPieceVerified(0);
+    EXPECT_TRUE(picker.have(0));
+    EXPECT_EQ(picker.haveCount(), 1u);
+}
+
+TEST(StreamingTest, FailedPieceIsPickedAgain)
+{
+    auto now = PiecePicker::Clock::now();
+    PiecePicker picker(1, PeerWire::BlockSize, PeerWire::BlockSize);
+    picker.addPeer(all(1));
+    auto block = picker.pick(all(1), false, now);
+    ASSERT_TRUE(block);
+    EXPECT_FALSE(picker.pick(all(1), false, now));
+    ASSERT_TRUE(picker.onBlock(*block));
+    picker.onPieceFailed(0);
+    EXPECT_EQ(picker.pick(all(1), false, now), block);
+
+    picker.abort(*block);
+    EXPECT_EQ(picker.pick(all(1), false, now), block);
+}
+
+TEST(StreamingTest, CheckFilesKeepsOnlyGoodPieces)
+{
+    auto data = makeData(5 * kPiece + 123);
+    auto meta = makeTorrent(data, 2 * kPiece + 7);
+    auto dir  = tempDir("check");
+
+    Net::EventLoop loop;
+    std::jthread thread([&] { loop.run(); });
+    Async::Executor executor(1);
+    Async::DiskIo disk(1, &executor);
+    {
+        Storage storage(meta, dir.string());
+        data[3 * kPiece + 5] ^= 1;
+        Async::syncWait(storage.write(disk, 0, data));
+        Swarm swarm(loop, executor, disk, meta, storage, std::string(20, 'S'));
+        EXPECT_EQ(Async::syncWait(swarm.checkFiles()), 5u);
+        onLoop(loop, [&] { EXPECT_FALSE(swarm.picker().have(3)); });
+    }
+    loop.stop();
+    std::filesystem::remove_all(dir);
+}
+
+TEST(StreamingTest, StreamsRangesFromLoopbackSeeder)
+{
+    auto data     = makeData(7 * kPiece + 1'000, 2);
+    size_t aSize  = 3 * kPiece + 500;
+    auto meta     = makeTorrent(data, aSize);
+    auto seedDir  = tempDir("seed");
+    auto leechDir = tempDir("leech");
+
+    Net::EventLoop loop;
+    std::jthread thread([&] { loop.run(); });
+    Async::Executor executor(2);
+    Async::DiskIo disk(1, &executor);
+    {
+        Storage seedStorage(meta, seedDir.string());
+        Async::syncWait(seedStorage.write(disk, 0, data));
+        Swarm seeder(loop, executor, disk, meta, seedStorage, std::string(20, 'S'));
+        ASSERT_EQ(Async::syncWait(seeder.checkFiles()), meta.pieceHashes.size());
+
+        Storage leechStorage(meta, leechDir.string());
+        Swarm leecher(loop, executor, disk, meta, leechStorage, std::string(20, 'L'));
+
+        std::unique_ptr<Net::TcpListener> listener;
+        onLoop(loop,
+            [&]
+            {
+                listener = std::make_unique<Net::TcpListener>(loop, Net::Endpoint::parse("127.0.0.1", 0),
+                    [&](std::unique_ptr<Net::TcpStream> stream) { seeder.acceptPeer(std::move(stream)); });
+                leecher.addPeer(listener->localEndpoint());
+            });
+
+        // straddles a piece boundary in the second file
+        std::vector<uint8_t> range(kPiece);
+        EXPECT_EQ(leecher.readBlocking(1, kPiece / 2, range), range.size());
+        EXPECT_TRUE(std::equal(range.begin(), range.end(), data.begin() + static_cast<ptrdiff_t>(aSize + kPiece / 2)));
+
+        // short read at the end of the first file
+        std::vector<uint8_t> tail(1'000);
+        EXPECT_EQ(leecher.readBlocking(0, aSize - 100, tail), 100u);
+        EXPECT_TRUE(std::equal(tail.begin(), tail.begin() + 100, data.begin() + static_cast<ptrdiff_t>(aSize - 100)));
+
+        // the rest of the torrent, through the same API
+        std::vector<uint8_t> whole(data.size());
+        EXPECT_EQ(leecher.readBlocking(0, 0, std::span(whole).first(aSize)), aSize);
+        EXPECT_EQ(leecher.readBlocking(1, 0, std::span(whole).subspan(aSize)), data.size() - aSize);
+        EXPECT_EQ(whole, data);
+
+        Swarm::Stats stats;
+        bool complete = false;
+        onLoop(loop,
+            [&]
+            {
+                stats    = leecher.stats();
+                complete = leecher.picker().complete();
+            });
+        EXPECT_TRUE(complete);
+        EXPECT_EQ(stats.piecesVerified, meta.pieceHashes.size());
+        EXPECT_EQ(stats.hashFailures, 0u);
+        EXPECT_EQ(stats.downloaded, data.size());
+
+        Async::syncWait(leecher.shutdown());
+        Async::syncWait(seeder.shutdown());
+        onLoop(loop, [&] { listener.reset(); });
+    }
+    loop.stop();
+
+    std::ifstream a(leechDir / "stream" / "a.bin", std::ios::binary);
+    std::ifstream b(leechDir / "stream" / "b.bin", std::ios::binary);
+    std::vector<uint8_t> onDisk(std::istreambuf_iterator<char>(a), {});
+    onDisk.insert(onDisk.end(), std::istreambuf_iterator<char>(b), {});
+    EXPECT_EQ(onDisk, data);
+    std::filesystem::remove_all(seedDir);
+    std::filesystem::remove_all(leechDir);
+}
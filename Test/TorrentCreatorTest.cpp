@@ -0,0 +1,184 @@
+#include <Core/MerkleTree.hpp>
+#include <Core/TorrentCreator.hpp>
+#include <Async/Executor.hpp>
+
+#include <gtest/gtest.h>
+#include <openssl/sha.h>
+
+#include <filesystem>
+#include <fstream>
+#include <random>
+
+using namespace Torrent;
+using namespace Torrent::Core;
+
+namespace {
+constexpr uint64_t kPiece = 32 * 1'024;
+
+// Sizes straddle piece and block boundaries; the empty file must survive as well.
+struct Tree
+{
+    Tree()
+    {
+        std::filesystem::remove_all(root);
+        std::mt19937 rng(11);
+        for (auto [path, size] : std::initializer_list<std::pair<const char*, size_t>>{
+                 {"b/big.bin", 5 * kPiece + 1'234}, {"a.txt", 100}, {"b/a/exact.bin", 2 * kPiece}, {"c/empty", 0},
+                 {"b/small.bin", 20'000}})
+        {
+            std::string data(size, '\0');
+            for (auto& c : data)
+            {
+                c = static_cast<char>(rng());
+            }
+            std::filesystem::create_directories((root / path).parent_path());
+            std::ofstream(root / path, std::ios::binary) << data;
+            contents[path] = data;
+        }
+    }
+
+    ~Tree()
+    {
+        std::filesystem::remove_all(root);
+    }
+
+    std::filesystem::path root = std::filesystem::temp_directory_path() / "sk_creator_test";
+    std::map<std::string, std::string> contents;
+};
+
+std::string sha1(std::string_view data)
+{
+    unsigned char out[SHA_DIGEST_LENGTH];
+    SHA1(reinterpret_cast<const unsigned char*>(data.data()), data.size(), out);
+    return {reinterpret_cast<char*>(out), SHA_DIGEST_LENGTH};
+}
+
+Metadata create(const Tree& tree, TorrentFormat format, Async::Executor* executor)
+{
+    CreateOptions options;
+    options.format      = format;
+    options.pieceLength = kPiece;
+    options.trackers    = {{"http://a/announce"}, {"http://b/announce"}};
+    return Utils::parseMetadata(createTorrent(tree.root.string(), options, executor));
+}
+
+// The v1 stream as the file list lays it out, pad files read as zeros.
+std::string stream(const Tree& tree, const Metadata& meta)
+{
+    std::string out;
+    for (const auto& file : meta.files)
+    {
+        out += file.padding ? std::string(file.size, '\0') : tree.contents.at(file.path);
+    }
+    return out;
+}
+}  // namespace
+
+TEST(TorrentCreatorTest, ScansFilesInFileTreeOrder)
+{
+    Tree tree;
+    auto files = scanFiles(tree.root.string());
+    std::vector<std::string> paths;
+    for (const auto& file : files)
+    {
+        paths.push_back(file.path);
+    }
+    EXPECT_EQ(paths, (std::vector<std::string>{"a.txt", "b/a/exact.bin", "b/big.bin", "b/small.bin", "c/empty"}));
+}
+
+TEST(TorrentCreatorTest, PicksPowerOfTwoPieceLengths)
+{
+    EXPECT_EQ(autoPieceLength(1), 16u * 1'024);
+    EXPECT_EQ(autoPieceLength(1'500ull * 1'024 * 1'024), 1'024u * 1'024);
+    EXPECT_EQ(autoPieceLength(1ull << 50), 16u * 1'024 * 1'024);
+}
+
+TEST(TorrentCreatorTest, V1PiecesSpanFileBoundaries)
+{
+    Tree tree;
+    Async::Executor executor{3};
+    auto meta = create(tree, TorrentFormat::V1, &executor);
+    EXPECT_FALSE(meta.isV2());
+    EXPECT_EQ(meta.name, "sk_creator_test");
+    EXPECT_EQ(meta.announce, "http://a/announce");
+    ASSERT_EQ(meta.announceList.size(), 2u);
+    ASSERT_EQ(meta.files.size(), 5u);
+
+    auto data = stream(tree, meta);
+    EXPECT_EQ(data.size(), meta.totalSize);
+    ASSERT_EQ(meta.pieceHashes.size(), (data.size() + kPiece - 1) / kPiece);
+    for (size_t i = 0; i < meta.pieceHashes.size(); ++i)
+    {
+        EXPECT_EQ(meta.pieceHashes[i], sha1(std::string_view(data).substr(i * kPiece, kPiece))) << i;
+    }
+}
+
+TEST(TorrentCreatorTest, HybridMatchesBothHashTrees)
+{
+    Tree tree;
+    auto meta = create(tree, TorrentFormat::Hybrid, nullptr);
+    ASSERT_TRUE(meta.isHybrid());
+
+    auto data = stream(tree, meta);
+    ASSERT_EQ(meta.pieceHashes.size(), (data.size() + kPiece - 1) / kPiece);
+    for (size_t i = 0; i < meta.pieceHashes.size(); ++i)
+    {
+        EXPECT_EQ(meta.pieceHashes[i], sha1(std::string_view(data).substr(i * kPiece, kPiece))) << i;
+    }
+
+    size_t pads = 0;
+    for (const auto& file : meta.files)
+    {
+        if (file.padding)
+        {
+            ++pads;
+            continue;
+        }
+        const auto& content = tree.contents.at(file.path);
+        if (content.empty())
+        {
+            EXPECT_TRUE(file.piecesRoot.empty());
+            continue;
+        }
+        auto expected = Merkle::hashFile({reinterpret_cast<const uint8_t*>(content.data()), content.size()}, kPiece);
+        EXPECT_EQ(file.piecesRoot, std::string(reinterpret_cast<const char*>(expected.root.data()), 32)) << file.path;
+        if (!expected.pieceLayer.empty())
+        {
+            ASSERT_TRUE(meta.pieceLayers.contains(file.piecesRoot));
+            EXPECT_EQ(meta.pieceLayers.at(file.piecesRoot).size(), expected.pieceLayer.size() * 32);
+        }
+    }
+    // every file with data except the last one ends on a piece boundary, exact.bin already does
+    EXPECT_EQ(pads, 2u);
+}
+
+TEST(TorrentCreatorTest, V2SingleFile)
+{
+    Tree tree;
+    auto path = tree.root / "b" / "big.bin";
+    CreateOptions options;
+    options.format = TorrentFormat::V2;
+    auto meta      = Utils::parseMetadata(createTorrent(path.string(), options));
+    ASSERT_TRUE(meta.isV2());
+    EXPECT_FALSE(meta.isHybrid());
+    ASSERT_EQ(meta.files.size(), 1u);
+    EXPECT_EQ(meta.files[0].path, "big.bin");
+    EXPECT_EQ(meta.pieceLength, autoPieceLength(meta.totalSize));
+
+    const auto& content = tree.contents.at("b/big.bin");
+    auto expected = Merkle::hashFile({reinterpret_cast<const uint8_t*>(content.data()), content.size()}, meta.pieceLength);
+    EXPECT_EQ(meta.files[0].piecesRoot, std::string(reinterpret_cast<const char*>(expected.root.data()), 32));
+}
+
+TEST(TorrentCreatorTest, RejectsEmptyInputAndOddPieceLengths)
+{
+    auto dir = std::filesystem::temp_directory_path() / "sk_creator_empty";
+    std::filesystem::create_directories(dir);
+    EXPECT_THROW(createTorrent(dir.string(), {}), std::runtime_error);
+    std::filesystem::remove_all(dir);
+
+    Tree tree;
+    CreateOptions options;
+    options.pieceLength = 40'000;
+    EXPECT_THROW(createTorrent(tree.root.string(), options), std::runtime_error);
+}
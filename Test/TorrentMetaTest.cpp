@@ -210,6 +210,21 @@ TEST(TorrentMetaFillTest, MultiFileTorrent)
     EXPECT_EQ(md.infoHash, expectedHash);
 }
 
+TEST(TorrentMetaFillTest, AnnounceListTiers)
+{
+    std::string info = "d6:lengthi1e4:name" + encStr("t") + "12:piece lengthi16384e6:pieces20:" + std::string(20, 'P') + "e";
+
+    std::string torrent = "d8:announce" + encStr("http://a") + "13:announce-list" + "l" + "l" + encStr("http://a") +
+        encStr("http://b") + "e" + "l" + encStr("udp://c") + "e" + "e" + "4:info" + info + "e";
+
+    auto path = writeTempTorrent(torrent);
+    auto md   = Torrent::Utils::fillMetadata(path);
+
+    ASSERT_EQ(md.announceList.size(), 2u);
+    EXPECT_EQ(md.announceList[0], (std::vector<std::string>{"http://a", "http://b"}));
+    EXPECT_EQ(md.announceList[1], (std::vector<std::string>{"udp://c"}));
+}
+
 TEST(TorrentMetaFillTest, MissingFileThrows)
 {
     EXPECT_THROW(Torrent::Utils::fillMetadata("/this/path/does/not/exist.torrent"), std::runtime_error);
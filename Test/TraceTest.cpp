@@ -0,0 +1,99 @@
+#include <Metrics/Trace.hpp>
+#include <Utils/BencodeParser.hpp>
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <thread>
+
+using namespace Torrent::Metrics;
+
+namespace {
+size_t countOf(const std::string& text, const std::string& needle)
+{
+    size_t n = 0;
+    for (size_t at = text.find(needle); at != std::string::npos; at = text.find(needle, at + 1))
+    {
+        ++n;
+    }
+    return n;
+}
+
+// Tracing is process-wide: start from an empty trace and leave it stopped.
+struct TracingOn
+{
+    TracingOn()
+    {
+        Tracer::instance().clear();
+        Tracer::instance().start();
+    }
+
+    ~TracingOn()
+    {
+        Tracer::instance().stop();
+        Tracer::instance().clear();
+    }
+};
+}  // namespace
+
+TEST(TraceTest, RecordsNothingWhileStopped)
+{
+    Tracer::instance().stop();
+    Tracer::instance().clear();
+    {
+        TRACE_SCOPE("stopped");
+    }
+    EXPECT_EQ(Tracer::instance().chromeTraceJson().find("stopped"), std::string::npos);
+}
+
+TEST(TraceTest, NestedScopesBecomeCompleteEvents)
+{
+    TracingOn tracing;
+    {
+        TRACE_SCOPE("outer");
+        {
+            TRACE_SCOPE("inner");
+            Torrent::Utils::Bencode::Parser("d3:keyi42ee").parse();
+        }
+    }
+    auto json = Tracer::instance().chromeTraceJson();
+    EXPECT_TRUE(json.starts_with("{\"displayTimeUnit\":\"ms\",\"traceEvents\":["));
+    EXPECT_EQ(countOf(json, "{\"name\":\"outer\",\"ph\":\"X\""), 1u);
+    EXPECT_EQ(countOf(json, "{\"name\":\"inner\",\"ph\":\"X\""), 1u);
+    EXPECT_EQ(countOf(json, "{\"name\":\"Bencode::Parser::parse\",\"ph\":\"X\""), 1u);
+    // inner ends first, so it is recorded before outer
+    EXPECT_LT(json.find("\"inner\""), json.find("\"outer\""));
+}
+
+TEST(TraceTest, KeepsTheNewestEventsOfEachThread)
+{
+    TracingOn tracing;
+    std::jthread([]
+        {
+            Tracer::instance().setThreadName("ring \"filler\"");
+            for (size_t i = 0; i < Tracer::RingEvents + 10; ++i)
+            {
+                TRACE_SCOPE("fill");
+            }
+        }).join();
+    auto json = Tracer::instance().chromeTraceJson();
+    EXPECT_EQ(countOf(json, "\"name\":\"fill\""), Tracer::RingEvents - 1);
+    EXPECT_NE(json.find("\"args\":{\"name\":\"ring \\\"filler\\\"\"}"), std::string::npos);
+}
+
+TEST(TraceTest, WritesTheTraceFile)
+{
+    TracingOn tracing;
+    {
+        TRACE_SCOPE("to file");
+    }
+    auto path = (std::filesystem::temp_directory_path() / "sk_trace_test.json").string();
+    Tracer::instance().writeChromeTrace(path);
+    std::ifstream in(path);
+    std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    EXPECT_NE(text.find("\"name\":\"to file\""), std::string::npos);
+    EXPECT_TRUE(text.ends_with("]}\n"));
+    std::filesystem::remove(path);
+}
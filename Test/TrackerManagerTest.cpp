@@ -0,0 +1,160 @@
+#include <Core/TrackerManager.hpp>
+#include <Net/CurlTransport.hpp>
+
+#include <gtest/gtest.h>
+#include <map>
+#include <set>
+
+using namespace Torrent::Core;
+
+namespace {
+struct FakeTransport: ITrackerTransport
+{
+    std::optional<Result> race(std::span<const std::string> urls, std::chrono::milliseconds, const Accept& accept,
+        std::vector<bool>& failed) override
+    {
+        races.emplace_back(urls.begin(), urls.end());
+        std::optional<Result> winner;
+        for (size_t i = 0; i < urls.size(); ++i)
+        {
+            auto it = responses.find(urls[i]);
+            if (it == responses.end())
+            {
+                failed[i] = true;
+                continue;
+            }
+            if (!accept(it->second))
+            {
+                failed[i] = true;
+                continue;
+            }
+            if (!winner || it->first == fastest)
+            {
+                winner = Result{i, it->second};
+            }
+        }
+        return winner;
+    }
+
+    std::map<std::string, std::string> responses;
+    std::string fastest;
+    std::vector<std::vector<std::string>> races;
+};
+
+const std::string kOk = "d8:intervali900e5:peers6:" + std::string({'\x7f', '\x00', '\x00', '\x01', '\x1a', '\xe1'}) + "e";
+
+Torrent::Metadata tieredMeta()
+{
+    Torrent::Metadata meta;
+    meta.announce     = "http://ignored";
+    meta.announceList = {
+        {"http://a1", "http://a2", "http://a3"},
+        {"http://b1", "http://b2"},
+    };
+    return meta;
+}
+
+std::string_view identity(const std::string& url)
+{
+    return url;
+}
+}  // namespace
+
+TEST(TrackerManagerTest, ShufflesWithinTiersOnly)
+{
+    auto transport = std::make_unique<FakeTransport>();
+    TrackerManager manager(tieredMeta(), std::move(transport), {}, 7);
+
+    ASSERT_EQ(manager.tiers().size(), 2u);
+    std::set<std::string> first;
+    for (const auto& e : manager.tiers()[0])
+    {
+        first.insert(e.url);
+    }
+    EXPECT_EQ(first, (std::set<std::string>{"http://a1", "http://a2", "http://a3"}));
+    EXPECT_EQ(manager.tiers()[1].size(), 2u);
+}
+
+TEST(TrackerManagerTest, FallsBackToAnnounceWithoutList)
+{
+    Torrent::Metadata meta;
+    meta.announce = "http://single";
+    TrackerManager manager(meta, std::make_unique<FakeTransport>());
+    ASSERT_EQ(manager.tiers().size(), 1u);
+    EXPECT_EQ(manager.tiers()[0][0].url, "http://single");
+}
+
+TEST(TrackerManagerTest, RacesWholeTierAndPromotesWinner)
+{
+    auto transport               = std::make_unique<FakeTransport>();
+    auto* fake                   = transport.get();
+    fake->responses["http://a2"] = kOk;
+    fake->responses["http://a3"] = kOk;
+    fake->fastest                = "http://a3";
+
+    TrackerManager manager(tieredMeta(), std::move(transport), {}, 1);
+    AnnounceResponse resp;
+    ASSERT_TRUE(manager.announce(identity, resp));
+
+    ASSERT_EQ(fake->races.size(), 1u);
+    EXPECT_EQ(fake->races[0].size(), 3u);
+    EXPECT_EQ(resp.interval, 900u);
+    ASSERT_EQ(resp.peers.size(), 1u);
+    EXPECT_EQ(manager.tiers()[0].front().url, "http://a3");
+}
+
+TEST(TrackerManagerTest, FailsOverToNextTierAndBacksOff)
+{
+    auto transport               = std::make_unique<FakeTransport>();
+    auto* fake                   = transport.get();
+    fake->responses["http://b2"] = kOk;
+
+    TrackerManager manager(tieredMeta(), std::move(transport), {}, 3);
+    AnnounceResponse resp;
+    ASSERT_TRUE(manager.announce(identity, resp));
+    ASSERT_EQ(fake->races.size(), 2u);
+    EXPECT_EQ(manager.tiers()[1].front().url, "http://b2");
+    for (const auto& e : manager.tiers()[0])
+    {
+        EXPECT_EQ(e.failures, 1u);
+    }
+
+    // the whole first tier is backing off, so the next announce goes straight to tier 2
+    fake->races.clear();
+    ASSERT_TRUE(manager.announce(identity, resp));
+    ASSERT_EQ(fake->races.size(), 1u);
+    EXPECT_EQ(fake->races[0][0], "http://b2");
+}
+
+TEST(TrackerManagerTest, FailureReasonIsNotAWinner)
+{
+    auto transport               = std::make_unique<FakeTransport>();
+    auto* fake                   = transport.get();
+    fake->responses["http://a1"] = "d14:failure reason7:go awaye";
+    fake->responses["http://b1"] = kOk;
+
+    TrackerManager manager(tieredMeta(), std::move(transport), {}, 5);
+    AnnounceResponse resp;
+    ASSERT_TRUE(manager.announce(identity, resp));
+    EXPECT_TRUE(resp.failureReason.empty());
+    EXPECT_EQ(manager.tiers()[1].front().url, "http://b1");
+}
+
+TEST(TrackerManagerTest, AllFail)
+{
+    TrackerManager manager(tieredMeta(), std::make_unique<FakeTransport>(), {}, 9);
+    AnnounceResponse resp;
+    EXPECT_FALSE(manager.announce(identity, resp));
+}
+
+TEST(CurlTrackerTransportTest, UnreachableTrackersAreFlagged)
+{
+    Torrent::Net::CurlTrackerTransport transport;
+    std::vector<std::string> urls = {"http://127.0.0.1:1/announce", "http://127.0.0.1:2/announce"};
+    std::vector<bool> failed(urls.size(), false);
+
+    auto result = transport.race(urls, std::chrono::milliseconds(2'000), [](std::string_view) { return true; }, failed);
+    EXPECT_FALSE(result.has_value());
+    EXPECT_TRUE(failed[0]);
+    EXPECT_TRUE(failed[1]);
+}
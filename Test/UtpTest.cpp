@@ -0,0 +1,357 @@
+#include <Net/Ledbat.hpp>
+#include <Net/Utp.hpp>
+
+#include <Async/IoAwaitables.hpp>
+
+#include <gtest/gtest.h>
+#include <random>
+#include <sys/epoll.h>
+#include <thread>
+
+using namespace Torrent;
+using namespace Torrent::Net;
+using namespace std::chrono_literals;
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+const Endpoint kLocalhost = Endpoint::parse("127.0.0.1", 0);
+
+std::string makePayload(size_t size)
+{
+    std::string data(size, '\0');
+    std::mt19937 rng(42);
+    for (auto& c : data)
+    {
+        c = static_cast<char>(rng());
+    }
+    return data;
+}
+
+// Loopback relay standing in for a bottleneck link. The client sends to front() and the server sees the relay's
+// back socket. Client-to-server datagrams are serialised at `rate` behind a tail-drop buffer and may be lost at
+// random; both directions add the propagation delay. Runs on the loop thread.
+class LinkSimulator
+{
+public:
+    struct Options
+    {
+        double rate = 2e6;  // bytes per second
+        std::chrono::milliseconds delay{10};
+        std::chrono::milliseconds buffer{250};
+        double loss = 0;
+    };
+
+    LinkSimulator(EventLoop& loop, const Endpoint& server, Options options)
+        : m_loop(loop)
+        , m_server(server)
+        , m_options(options)
+        , m_front(kLocalhost)
+        , m_back(kLocalhost)
+    {
+        loop.add(m_front.fd(), EPOLLIN, [this](uint32_t) { pump(true); });
+        loop.add(m_back.fd(), EPOLLIN, [this](uint32_t) { pump(false); });
+    }
+
+    ~LinkSimulator()
+    {
+        m_loop.remove(m_front.fd());
+        m_loop.remove(m_back.fd());
+    }
+
+    Endpoint front() const
+    {
+        return m_front.localEndpoint();
+    }
+
+    std::chrono::microseconds averageQueueDelay() const
+    {
+        return m_forwarded ? std::chrono::duration_cast<std::chrono::microseconds>(m_queueTotal / m_forwarded) : 0us;
+    }
+
+    std::chrono::microseconds maxQueueDelay() const
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(m_queueMax);
+    }
+
+    uint64_t overflows() const
+    {
+        return m_overflows;
+    }
+
+    uint64_t lost() const
+    {
+        return m_lost;
+    }
+
+private:
+    void pump(bool upstream)
+    {
+        auto& in  = upstream ? m_front : m_back;
+        auto& out = upstream ? m_back : m_front;
+        std::array<uint8_t, 2'048> buffer;
+        Endpoint from;
+        ssize_t n = 0;
+        while ((n = in.receiveFrom(from, buffer)) >= 0)
+        {
+            auto now       = Clock::now();
+            auto deliverAt = now + m_options.delay;
+            if (upstream)
+            {
+                m_client   = from;
+                auto start = std::max(m_busyUntil, now);
+                auto queue = start - now;
+                if (queue > m_options.buffer)
+                {
+                    ++m_overflows;
+                    continue;
+                }
+                if (m_chance(m_rng) < m_options.loss)
+                {
+                    ++m_lost;
+                    continue;
+                }
+                auto serialise = std::chrono::duration<double>(static_cast<double>(n) / m_options.rate);
+                m_busyUntil    = start + std::chrono::duration_cast<Clock::duration>(serialise);
+                m_queueTotal  += queue;
+                m_queueMax     = std::max(m_queueMax, queue);
+                ++m_forwarded;
+                deliverAt = m_busyUntil + m_options.delay;
+            }
+            auto to = upstream ? m_server : m_client;
+            m_loop.runAfter(std::chrono::ceil<std::chrono::milliseconds>(deliverAt - now),
+                [&out, to, packet = std::vector<uint8_t>(buffer.begin(), buffer.begin() + n)] { out.sendTo(to, packet); });
+        }
+    }
+
+    EventLoop& m_loop;
+    Endpoint m_server;
+    Endpoint m_client;
+    Options m_options;
+    UdpSocket m_front;
+    UdpSocket m_back;
+    std::mt19937 m_rng{7};
+    std::uniform_real_distribution<double> m_chance{0.0, 1.0};
+    Clock::time_point m_busyUntil{};
+    Clock::duration m_queueTotal{};
+    Clock::duration m_queueMax{};
+    uint64_t m_forwarded = 0;
+    uint64_t m_overflows = 0;
+    uint64_t m_lost      = 0;
+};
+
+Async::Detached drain(std::unique_ptr<UtpStream> stream, std::string& out, std::atomic<bool>& done)
+{
+    std::array<uint8_t, 16'384> buffer;
+    try
+    {
+        while (size_t n = co_await stream->read(buffer))
+        {
+            out.append(reinterpret_cast<const char*>(buffer.data()), n);
+        }
+    }
+    catch (const std::exception&)
+    {
+    }
+    done = true;
+}
+
+Async::Task<void> upload(EventLoop& loop, UtpContext& context, Endpoint to, const std::string& data)
+{
+    co_await Async::resumeOn(loop);
+    auto stream = context.createStream();
+    co_await stream->connect(to);
+    co_await stream->write({reinterpret_cast<const uint8_t*>(data.data()), data.size()});
+    // dropping the stream closes gracefully; the context keeps delivering until the FIN is acknowledged
+}
+
+struct TransferResult
+{
+    std::string received;
+    std::chrono::duration<double> elapsed{};
+    UtpContext::Stats sender;
+};
+
+// Pushes data from a client context to a server context through a simulated link.
+TransferResult transfer(const std::string& data, LinkSimulator::Options link, UtpContext::Options options,
+    std::function<void(const LinkSimulator&)> inspect)
+{
+    EventLoop loop;
+    UtpContext server(loop, kLocalhost, options);
+    UtpContext client(loop, kLocalhost, options);
+    LinkSimulator sim(loop, server.localEndpoint(), link);
+
+    TransferResult result;
+    std::atomic<bool> done{false};
+    server.listen([&](std::unique_ptr<UtpStream> stream) { drain(std::move(stream), result.received, done); });
+
+    std::thread thread([&] { loop.run(); });
+    auto start = Clock::now();
+    Async::syncWait(upload(loop, client, sim.front(), data));
+    for (auto deadline = start + 30s; !done && Clock::now() < deadline;)
+    {
+        std::this_thread::sleep_for(1ms);
+    }
+    result.elapsed = Clock::now() - start;
+    loop.stop();
+    thread.join();
+
+    result.sender = client.stats();
+    inspect(sim);
+    return result;
+}
+}  // namespace
+
+TEST(UtpTest, PacketHeaderRoundTrip)
+{
+    Utp::Header h;
+    h.type          = Utp::PacketType::State;
+    h.extension     = Utp::SelectiveAckExtension;
+    h.connectionId  = 0xbeef;
+    h.timestamp     = 0x01020304;
+    h.timestampDiff = 0xfffffff0;
+    h.window        = 1 << 20;
+    h.seq           = 65'535;
+    h.ack           = 7;
+
+    std::array<uint8_t, Utp::HeaderSize + 6 + 3> packet{};
+    Utp::writeHeader(h, packet.data());
+    packet[20] = 0;  // no further extension
+    packet[21] = 4;
+    packet[22] = 0b101;
+    std::memcpy(packet.data() + 26, "abc", 3);
+
+    Utp::Header parsed;
+    std::span<const uint8_t> sack;
+    size_t offset = 0;
+    ASSERT_TRUE(Utp::readPacket(packet, parsed, sack, offset));
+    EXPECT_EQ(parsed.type, Utp::PacketType::State);
+    EXPECT_EQ(parsed.connectionId, 0xbeef);
+    EXPECT_EQ(parsed.timestamp, 0x01020304u);
+    EXPECT_EQ(parsed.timestampDiff, 0xfffffff0u);
+    EXPECT_EQ(parsed.window, 1u << 20);
+    EXPECT_EQ(parsed.seq, 65'535);
+    EXPECT_EQ(parsed.ack, 7);
+    ASSERT_EQ(sack.size(), 4u);
+    EXPECT_EQ(sack[0], 0b101);
+    EXPECT_EQ(offset, 26u);
+
+    // truncated extension, bad version
+    EXPECT_FALSE(Utp::readPacket(std::span(packet).first(23), parsed, sack, offset));
+    packet[0] = 0x42;
+    EXPECT_FALSE(Utp::readPacket(packet, parsed, sack, offset));
+}
+
+TEST(UtpTest, SequenceNumbersWrap)
+{
+    EXPECT_TRUE(Utp::seqLess(1, 2));
+    EXPECT_TRUE(Utp::seqLess(65'535, 0));
+    EXPECT_FALSE(Utp::seqLess(0, 65'535));
+    EXPECT_FALSE(Utp::seqLess(5, 5));
+}
+
+TEST(UtpTest, PacketPoolReusesBuffers)
+{
+    Utp::PacketPool pool;
+    auto* a = pool.acquire();
+    pool.release(a);
+    EXPECT_EQ(pool.acquire(), a);
+    EXPECT_EQ(pool.allocated(), 1u);
+    pool.release(a);
+    EXPECT_EQ(pool.cached(), 1u);
+}
+
+TEST(UtpTest, LedbatTracksQueuingDelayTarget)
+{
+    Ledbat::Options opts;
+    opts.target = 100ms;
+    Ledbat ledbat(opts);
+    auto now            = Clock::now();
+    const uint32_t mss  = opts.mss;
+    const uint32_t base = 5'000;
+
+    // slow start while the queue stays empty
+    auto initial = ledbat.window();
+    for (int i = 0; i < 20; ++i)
+    {
+        ledbat.onAck(mss, base, ledbat.window(), now);
+    }
+    EXPECT_TRUE(ledbat.inSlowStart());
+    EXPECT_GT(ledbat.window(), initial);
+
+    // queuing delay beyond the target ends slow start and shrinks the window
+    auto peak = ledbat.window();
+    for (int i = 0; i < 200; ++i)
+    {
+        ledbat.onAck(mss, base + 200'000, ledbat.window(), now);
+    }
+    EXPECT_FALSE(ledbat.inSlowStart());
+    EXPECT_EQ(ledbat.queuingDelay(), 200ms);
+    EXPECT_LT(ledbat.window(), peak);
+
+    // and below the target it grows again
+    auto low = ledbat.window();
+    for (int i = 0; i < 200; ++i)
+    {
+        ledbat.onAck(mss, base + 20'000, ledbat.window(), now);
+    }
+    EXPECT_EQ(ledbat.queuingDelay(), 20ms);
+    EXPECT_GT(ledbat.window(), low);
+
+    ledbat.onLoss();
+    EXPECT_LE(ledbat.window(), (low + 200 * mss) / 2);
+    ledbat.onTimeout();
+    EXPECT_EQ(ledbat.window(), mss);
+}
+
+TEST(UtpTest, TransfersOverLossyLink)
+{
+    auto data = makePayload(1 << 20);
+
+    LinkSimulator::Options link;
+    link.rate  = 8e6;
+    link.delay = 5ms;
+    link.loss  = 0.02;
+
+    uint64_t lost = 0;
+    auto result   = transfer(data, link, {}, [&](const LinkSimulator& sim) { lost = sim.lost(); });
+    ASSERT_EQ(result.received.size(), data.size());
+    EXPECT_TRUE(result.received == data);
+    EXPECT_GT(lost, 0u);
+    EXPECT_GE(result.sender.retransmits, lost);
+}
+
+TEST(UtpTest, KeepsQueuingDelayNearTarget)
+{
+    auto data = makePayload(3 << 20);
+
+    // the bottleneck buffer holds 250ms; a loss-based sender would fill it
+    LinkSimulator::Options link;
+    link.rate   = 2e6;
+    link.delay  = 10ms;
+    link.buffer = 250ms;
+
+    UtpContext::Options options;
+    options.congestion.target = 25ms;
+
+    std::chrono::microseconds average{0};
+    std::chrono::microseconds peak{0};
+    uint64_t overflows = 0;
+    auto result = transfer(data, link, options,
+        [&](const LinkSimulator& sim)
+        {
+            average   = sim.averageQueueDelay();
+            peak      = sim.maxQueueDelay();
+            overflows = sim.overflows();
+        });
+    ASSERT_TRUE(result.received == data);
+
+    double throughput = static_cast<double>(data.size()) / result.elapsed.count();
+    RecordProperty("throughput_bytes_per_sec", std::to_string(static_cast<uint64_t>(throughput)));
+    RecordProperty("average_queue_delay_us", std::to_string(average.count()));
+    RecordProperty("max_queue_delay_us", std::to_string(peak.count()));
+
+    EXPECT_EQ(overflows, 0u);
+    EXPECT_LT(average, 60ms);
+    EXPECT_GT(throughput, 0.6 * link.rate);
+}
@@ -0,0 +1,87 @@
+#include "DiskIo.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace Torrent::Async {
+
+DiskIo::DiskIo(size_t threads, Executor* resumeOn)
+    : m_pool(threads)
+    , m_resumeOn(resumeOn)
+    , m_depthGauge(Metrics::Registry::global().gauge("sktorrent_disk_queue_depth", "Disk operations queued or running"))
+{}
+
+void DiskIo::Op::await_suspend(std::coroutine_handle<> h)
+{
+    disk.m_inFlight.fetch_add(1, std::memory_order_relaxed);
+    disk.m_depthGauge.add(1);
+    disk.m_pool.post(
+        [this, h]
+        {
+            result = isWrite ? ::pwrite(fd, data, size, static_cast<off_t>(offset)) :
+                               ::pread(fd, data, size, static_cast<off_t>(offset));
+            error  = result < 0 ? errno : 0;
+            disk.m_inFlight.fetch_sub(1, std::memory_order_relaxed);
+            disk.m_depthGauge.add(-1);
+            if (disk.m_resumeOn)
+            {
+                disk.m_resumeOn->post(h);
+            }
+            else
+            {
+                h.resume();
+            }
+        });
+}
+
+size_t DiskIo::Op::await_resume()
+{
+    if (result < 0)
+    {
+        throw std::runtime_error(std::string(isWrite ? "pwrite" : "pread") + " failed: " + std::strerror(error));
+    }
+    return static_cast<size_t>(result);
+}
+
+Task<std::string> DiskIo::readFile(const std::string& path)
+{
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        throw std::runtime_error("Failed to open torrent file");
+    }
+
+    std::string data;
+    try
+    {
+        struct stat st{};
+        ::fstat(fd, &st);
+        data.resize(static_cast<size_t>(st.st_size));
+
+        size_t done = 0;
+        while (done < data.size())
+        {
+            auto* dst = reinterpret_cast<uint8_t*>(data.data()) + done;
+            size_t n  = co_await read(fd, done, std::span(dst, data.size() - done));
+            if (n == 0)
+            {
+                data.resize(done);
+                break;
+            }
+            done += n;
+        }
+    }
+    catch (...)
+    {
+        ::close(fd);
+        throw;
+    }
+    ::close(fd);
+    co_return data;
+}
+
+}  // namespace Torrent::Async
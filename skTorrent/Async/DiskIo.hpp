@@ -0,0 +1,66 @@
+#ifndef DISKIO_HPP
+#define DISKIO_HPP
+
+#include "Executor.hpp"
+
+#include <Metrics/Metrics.hpp>
+
+#include <span>
+#include <string>
+
+namespace Torrent::Async {
+
+// Blocking file I/O runs on a small dedicated pool so it never stalls network or session workers. Completions
+// resume the awaiting coroutine on resumeOn when given, otherwise directly on the disk thread.
+class DiskIo
+{
+public:
+    explicit DiskIo(size_t threads, Executor* resumeOn = nullptr);
+
+    auto read(int fd, uint64_t offset, std::span<uint8_t> buffer)
+    {
+        return Op{*this, fd, offset, buffer.data(), buffer.size(), false};
+    }
+
+    auto write(int fd, uint64_t offset, std::span<const uint8_t> data)
+    {
+        return Op{*this, fd, offset, const_cast<uint8_t*>(data.data()), data.size(), true};
+    }
+
+    // Whole-file read; throws std::runtime_error if the file cannot be opened.
+    Task<std::string> readFile(const std::string& path);
+
+    size_t queueDepth() const
+    {
+        return m_inFlight.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct Op
+    {
+        bool await_ready() noexcept
+        {
+            return false;
+        }
+
+        void await_suspend(std::coroutine_handle<> h);
+        size_t await_resume();
+
+        DiskIo& disk;
+        int fd;
+        uint64_t offset;
+        uint8_t* data;
+        size_t size;
+        bool isWrite;
+        ssize_t result = 0;
+        int error      = 0;
+    };
+
+    Executor m_pool;
+    Executor* m_resumeOn;
+    std::atomic<size_t> m_inFlight{0};
+    Metrics::Gauge& m_depthGauge;  // summed over every pool in the process
+};
+
+}  // namespace Torrent::Async
+#endif  // DISKIO_HPP
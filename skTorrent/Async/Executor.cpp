@@ -0,0 +1,180 @@
+#include "Executor.hpp"
+
+#include <Logger.hpp>
+#include <Metrics/Trace.hpp>
+
+namespace Torrent::Async {
+
+namespace {
+thread_local Executor* t_executor = nullptr;
+thread_local size_t t_workerIndex = 0;
+
+Detached runDetached(Executor& executor, Task<void> task)
+{
+    co_await executor.schedule();
+    try
+    {
+        co_await std::move(task);
+    }
+    catch (const std::exception& e)
+    {
+        LOG_ERROR(Executor, "Spawned task threw", LOG_MD(Error, e.what()));
+    }
+}
+}  // namespace
+
+Executor::Executor(size_t threads)
+{
+    threads = std::max<size_t>(threads, 1);
+    for (size_t i = 0; i < threads; ++i)
+    {
+        m_workers.push_back(std::make_unique<Worker>());
+    }
+    for (size_t i = 0; i < threads; ++i)
+    {
+        m_workers[i]->thread = std::jthread([this, i](std::stop_token stop) { workerLoop(i, stop); });
+    }
+}
+
+Executor::~Executor()
+{
+    for (auto& w : m_workers)
+    {
+        w->thread.request_stop();
+    }
+    {
+        std::scoped_lock lk(m_sleepMutex);
+    }
+    m_sleepCv.notify_all();
+    for (auto& w : m_workers)
+    {
+        w->thread = {};
+    }
+}
+
+Executor* Executor::current()
+{
+    return t_executor;
+}
+
+void Executor::push(size_t worker, Job job, bool back)
+{
+    m_queued.fetch_add(1);
+    {
+        auto& w = *m_workers[worker];
+        std::scoped_lock lk(w.mutex);
+        if (back)
+        {
+            w.jobs.push_back(std::move(job));
+        }
+        else
+        {
+            w.jobs.push_front(std::move(job));
+        }
+    }
+    if (m_sleeping.load() > 0)
+    {
+        {
+            std::scoped_lock lk(m_sleepMutex);
+        }
+        m_sleepCv.notify_one();
+    }
+}
+
+void Executor::post(Job job)
+{
+    if (t_executor == this)
+    {
+        push(t_workerIndex, std::move(job), true);
+    }
+    else
+    {
+        // external jobs go to the front so they are stolen before the owner's own LIFO work
+        push(m_nextInject.fetch_add(1, std::memory_order_relaxed) % m_workers.size(), std::move(job), false);
+    }
+}
+
+void Executor::post(std::coroutine_handle<> handle)
+{
+    post([handle] { handle.resume(); });
+}
+
+void Executor::spawn(Task<void> task)
+{
+    runDetached(*this, std::move(task));
+}
+
+bool Executor::popLocal(size_t self, Job& job)
+{
+    auto& w = *m_workers[self];
+    std::scoped_lock lk(w.mutex);
+    if (w.jobs.empty())
+    {
+        return false;
+    }
+    job = std::move(w.jobs.back());
+    w.jobs.pop_back();
+    return true;
+}
+
+bool Executor::steal(size_t self, Job& job)
+{
+    for (size_t i = 1; i < m_workers.size(); ++i)
+    {
+        auto& victim = *m_workers[(self + i) % m_workers.size()];
+        std::unique_lock lk(victim.mutex, std::try_to_lock);
+        if (!lk.owns_lock() || victim.jobs.empty())
+        {
+            continue;
+        }
+        job = std::move(victim.jobs.front());
+        victim.jobs.pop_front();
+        m_steals.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+void Executor::workerLoop(size_t index, std::stop_token stop)
+{
+    t_executor    = this;
+    t_workerIndex = index;
+    Metrics::Tracer::instance().setThreadName("worker " + std::to_string(index));
+
+    Job job;
+    while (true)
+    {
+        if (popLocal(index, job) || steal(index, job))
+        {
+            m_queued.fetch_sub(1);
+            try
+            {
+                job();
+            }
+            catch (const std::exception& e)
+            {
+                LOG_ERROR(Executor, "Job threw", LOG_MD(Error, e.what()));
+            }
+            job = nullptr;
+            continue;
+        }
+        if (stop.stop_requested())
+        {
+            // a job still queued was posted by a job of a worker that is still around to run it
+            if (m_queued.load() == 0)
+            {
+                return;
+            }
+            std::this_thread::yield();
+            continue;
+        }
+
+        std::unique_lock lk(m_sleepMutex);
+        m_sleeping.fetch_add(1);
+        // a steal can miss a job behind a contended try_lock: the queued counter catches that case
+        m_sleepCv.wait(lk, stop, [this] { return m_queued.load() > 0; });
+        m_sleeping.fetch_sub(1);
+    }
+}
+
+}  // namespace Torrent::Async
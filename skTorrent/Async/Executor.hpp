@@ -0,0 +1,96 @@
+#ifndef EXECUTOR_HPP
+#define EXECUTOR_HPP
+
+#include "Task.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Torrent::Async {
+
+// Fixed-size work-stealing pool. Each worker owns a deque: it pushes and pops at the back (LIFO keeps a
+// coroutine's continuation hot in cache) while idle workers steal from the front of the others. Jobs posted
+// from outside the pool are spread round-robin.
+class Executor
+{
+public:
+    using Job = std::function<void()>;
+
+    explicit Executor(size_t threads);
+    // Runs the jobs still queued, and those they post, before joining the workers, so no coroutine is dropped
+    // halfway.
+    ~Executor();
+    Executor(const Executor&) = delete;
+
+    void post(Job job);
+    void post(std::coroutine_handle<> handle);
+
+    // co_await executor.schedule() continues the coroutine on one of the workers.
+    auto schedule()
+    {
+        struct Awaiter
+        {
+            bool await_ready() noexcept
+            {
+                return false;
+            }
+
+            void await_suspend(std::coroutine_handle<> h)
+            {
+                executor.post(h);
+            }
+
+            void await_resume() noexcept
+            {}
+
+            Executor& executor;
+        };
+        return Awaiter{*this};
+    }
+
+    // Runs the task on the pool; nobody awaits it, exceptions are logged.
+    void spawn(Task<void> task);
+
+    size_t size() const
+    {
+        return m_workers.size();
+    }
+
+    uint64_t steals() const
+    {
+        return m_steals.load(std::memory_order_relaxed);
+    }
+
+    // Executor whose worker is running the calling thread, or nullptr.
+    static Executor* current();
+
+private:
+    struct Worker
+    {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+        std::jthread thread;
+    };
+
+    void push(size_t worker, Job job, bool back);
+    bool popLocal(size_t self, Job& job);
+    bool steal(size_t self, Job& job);
+    void workerLoop(size_t index, std::stop_token stop);
+
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::atomic<size_t> m_queued{0};
+    std::atomic<size_t> m_sleeping{0};
+    std::atomic<size_t> m_nextInject{0};
+    std::atomic<uint64_t> m_steals{0};
+    std::mutex m_sleepMutex;
+    std::condition_variable_any m_sleepCv;
+};
+
+}  // namespace Torrent::Async
+#endif  // EXECUTOR_HPP
@@ -0,0 +1,75 @@
+#include "FramePool.hpp"
+
+#include <new>
+
+namespace Torrent::Async {
+
+namespace {
+struct FreeNode
+{
+    FreeNode* next;
+};
+
+thread_local bool t_cacheDestroyed = false;
+
+struct ThreadCache
+{
+    ~ThreadCache()
+    {
+        t_cacheDestroyed = true;
+        for (size_t i = 0; i < FramePool::Classes; ++i)
+        {
+            while (heads[i])
+            {
+                FreeNode* node = heads[i];
+                heads[i]       = node->next;
+                ::operator delete(node);
+            }
+        }
+    }
+
+    FreeNode* heads[FramePool::Classes]{};
+    size_t counts[FramePool::Classes]{};
+};
+
+thread_local ThreadCache t_cache;
+
+size_t sizeClass(size_t size)
+{
+    return (size + FramePool::Granularity - 1) / FramePool::Granularity - 1;
+}
+}  // namespace
+
+void* FramePool::allocate(size_t size)
+{
+    size_t cls = sizeClass(size);
+    if (cls >= Classes || t_cacheDestroyed)
+    {
+        return ::operator new(size);
+    }
+
+    if (FreeNode* node = t_cache.heads[cls])
+    {
+        t_cache.heads[cls] = node->next;
+        --t_cache.counts[cls];
+        return node;
+    }
+    return ::operator new((cls + 1) * Granularity);
+}
+
+void FramePool::deallocate(void* ptr, size_t size) noexcept
+{
+    size_t cls = sizeClass(size);
+    if (cls >= Classes || t_cacheDestroyed || t_cache.counts[cls] >= MaxCached)
+    {
+        ::operator delete(ptr);
+        return;
+    }
+
+    auto* node         = static_cast<FreeNode*>(ptr);
+    node->next         = t_cache.heads[cls];
+    t_cache.heads[cls] = node;
+    ++t_cache.counts[cls];
+}
+
+}  // namespace Torrent::Async
@@ -0,0 +1,22 @@
+#ifndef FRAMEPOOL_HPP
+#define FRAMEPOOL_HPP
+
+#include <cstddef>
+
+namespace Torrent::Async {
+
+// Thread-local size-class free lists for coroutine frames. A frame freed on another thread simply joins that
+// thread's cache; each list is capped so a burst of coroutines does not pin memory forever.
+class FramePool
+{
+public:
+    static constexpr size_t Granularity = 64;
+    static constexpr size_t Classes     = 32;  // frames up to 2 KiB are pooled
+    static constexpr size_t MaxCached   = 512;
+
+    static void* allocate(size_t size);
+    static void deallocate(void* ptr, size_t size) noexcept;
+};
+
+}  // namespace Torrent::Async
+#endif  // FRAMEPOOL_HPP
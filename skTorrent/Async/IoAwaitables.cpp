@@ -0,0 +1,92 @@
+#include "IoAwaitables.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace Torrent::Async {
+
+Task<void> asyncConnect(Net::EventLoop& loop, int fd, const Net::Endpoint& endpoint)
+{
+    sockaddr_storage addr{};
+    socklen_t len = endpoint.toSockaddr(addr);
+    if (::connect(fd, reinterpret_cast<const sockaddr*>(&addr), len) == 0)
+    {
+        co_return;
+    }
+    if (errno != EINPROGRESS)
+    {
+        throw std::runtime_error(std::string("connect failed: ") + std::strerror(errno));
+    }
+
+    co_await writable(loop, fd);
+    int error        = 0;
+    socklen_t optLen = sizeof(error);
+    ::getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &optLen);
+    if (error != 0)
+    {
+        throw std::runtime_error(std::string("connect failed: ") + std::strerror(error));
+    }
+}
+
+Task<size_t> asyncRead(Net::EventLoop& loop, int fd, std::span<uint8_t> buffer)
+{
+    while (true)
+    {
+        ssize_t n = ::read(fd, buffer.data(), buffer.size());
+        if (n >= 0)
+        {
+            co_return static_cast<size_t>(n);
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+        {
+            co_await readable(loop, fd);
+            continue;
+        }
+        if (errno != EINTR)
+        {
+            throw std::runtime_error(std::string("read failed: ") + std::strerror(errno));
+        }
+    }
+}
+
+Task<void> asyncReadExactly(Net::EventLoop& loop, int fd, std::span<uint8_t> buffer)
+{
+    size_t done = 0;
+    while (done < buffer.size())
+    {
+        size_t n = co_await asyncRead(loop, fd, buffer.subspan(done));
+        if (n == 0)
+        {
+            throw std::runtime_error("Connection closed");
+        }
+        done += n;
+    }
+}
+
+Task<void> asyncWriteAll(Net::EventLoop& loop, int fd, std::span<const uint8_t> data)
+{
+    size_t done = 0;
+    while (done < data.size())
+    {
+        ssize_t n = ::send(fd, data.data() + done, data.size() - done, MSG_NOSIGNAL);
+        if (n >= 0)
+        {
+            done += static_cast<size_t>(n);
+            continue;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+        {
+            co_await writable(loop, fd);
+            continue;
+        }
+        if (errno != EINTR)
+        {
+            throw std::runtime_error(std::string("write failed: ") + std::strerror(errno));
+        }
+    }
+}
+
+}  // namespace Torrent::Async
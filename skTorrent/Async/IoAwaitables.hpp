@@ -0,0 +1,106 @@
+#ifndef IOAWAITABLES_HPP
+#define IOAWAITABLES_HPP
+
+#include "Task.hpp"
+
+#include <Net/Endpoint.hpp>
+#include <Net/EventLoop.hpp>
+
+#include <chrono>
+#include <span>
+#include <sys/epoll.h>
+
+namespace Torrent::Async {
+
+// All awaitables below register through EventLoop::post, so they may be awaited from any thread; the
+// coroutine resumes on the loop thread.
+
+// Continues the coroutine on the loop thread.
+inline auto resumeOn(Net::EventLoop& loop)
+{
+    struct Awaiter
+    {
+        bool await_ready() noexcept
+        {
+            return false;
+        }
+
+        void await_suspend(std::coroutine_handle<> h)
+        {
+            loop.post([h] { h.resume(); });
+        }
+
+        void await_resume() noexcept
+        {}
+
+        Net::EventLoop& loop;
+    };
+    return Awaiter{loop};
+}
+
+inline auto sleepFor(Net::EventLoop& loop, std::chrono::milliseconds delay)
+{
+    struct Awaiter
+    {
+        bool await_ready() noexcept
+        {
+            return delay.count() <= 0;
+        }
+
+        void await_suspend(std::coroutine_handle<> h)
+        {
+            loop.post([loop = &loop, delay = delay, h] { loop->runAfter(delay, [h] { h.resume(); }); });
+        }
+
+        void await_resume() noexcept
+        {}
+
+        Net::EventLoop& loop;
+        std::chrono::milliseconds delay;
+    };
+    return Awaiter{loop, delay};
+}
+
+inline auto waitReady(Net::EventLoop& loop, int fd, uint32_t events)
+{
+    struct Awaiter
+    {
+        bool await_ready() noexcept
+        {
+            return false;
+        }
+
+        void await_suspend(std::coroutine_handle<> h)
+        {
+            loop.post([loop = &loop, fd = fd, events = events, h] { loop->waitFor(fd, events, [h] { h.resume(); }); });
+        }
+
+        void await_resume() noexcept
+        {}
+
+        Net::EventLoop& loop;
+        int fd;
+        uint32_t events;
+    };
+    return Awaiter{loop, fd, events};
+}
+
+inline auto readable(Net::EventLoop& loop, int fd)
+{
+    return waitReady(loop, fd, EPOLLIN);
+}
+
+inline auto writable(Net::EventLoop& loop, int fd)
+{
+    return waitReady(loop, fd, EPOLLOUT);
+}
+
+// fd must be a non-blocking stream socket of the endpoint's family.
+Task<void> asyncConnect(Net::EventLoop& loop, int fd, const Net::Endpoint& endpoint);
+// Reads whatever is available (at least one byte); returns 0 on orderly shutdown, throws on socket errors.
+Task<size_t> asyncRead(Net::EventLoop& loop, int fd, std::span<uint8_t> buffer);
+Task<void> asyncReadExactly(Net::EventLoop& loop, int fd, std::span<uint8_t> buffer);
+Task<void> asyncWriteAll(Net::EventLoop& loop, int fd, std::span<const uint8_t> data);
+
+}  // namespace Torrent::Async
+#endif  // IOAWAITABLES_HPP
@@ -0,0 +1,321 @@
+#ifndef TASK_HPP
+#define TASK_HPP
+
+#include "FramePool.hpp"
+
+#include <coroutine>
+#include <exception>
+#include <latch>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace Torrent::Async {
+
+namespace Detail {
+struct PooledFrame
+{
+    static void* operator new(size_t size)
+    {
+        return FramePool::allocate(size);
+    }
+
+    static void operator delete(void* ptr, size_t size) noexcept
+    {
+        FramePool::deallocate(ptr, size);
+    }
+};
+
+struct PromiseBase: PooledFrame
+{
+    struct FinalAwaiter
+    {
+        bool await_ready() noexcept
+        {
+            return false;
+        }
+
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> h) noexcept
+        {
+            return h.promise().continuation;
+        }
+
+        void await_resume() noexcept
+        {}
+    };
+
+    std::suspend_always initial_suspend() noexcept
+    {
+        return {};
+    }
+
+    FinalAwaiter final_suspend() noexcept
+    {
+        return {};
+    }
+
+    void unhandled_exception() noexcept
+    {
+        exception = std::current_exception();
+    }
+
+    std::coroutine_handle<> continuation = std::noop_coroutine();
+    std::exception_ptr exception;
+};
+}  // namespace Detail
+
+// Lazily started coroutine: nothing runs until the task is awaited, and completion resumes the awaiter through
+// symmetric transfer, so deep co_await chains do not grow the stack. Frames come from FramePool.
+template <typename T = void>
+class [[nodiscard]] Task
+{
+public:
+    struct promise_type: Detail::PromiseBase
+    {
+        Task get_return_object()
+        {
+            return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        template <typename U>
+        void return_value(U&& v)
+        {
+            value.emplace(std::forward<U>(v));
+        }
+
+        std::optional<T> value;
+    };
+
+    Task() = default;
+
+    Task(Task&& other) noexcept
+        : m_handle(std::exchange(other.m_handle, {}))
+    {}
+
+    Task& operator=(Task&& other) noexcept
+    {
+        if (this != &other)
+        {
+            destroy();
+            m_handle = std::exchange(other.m_handle, {});
+        }
+        return *this;
+    }
+
+    ~Task()
+    {
+        destroy();
+    }
+
+    auto operator co_await() && noexcept
+    {
+        struct Awaiter
+        {
+            bool await_ready() noexcept
+            {
+                return !handle;
+            }
+
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+            {
+                handle.promise().continuation = awaiting;
+                return handle;
+            }
+
+            T await_resume()
+            {
+                auto& promise = handle.promise();
+                if (promise.exception)
+                {
+                    std::rethrow_exception(promise.exception);
+                }
+                return std::move(*promise.value);
+            }
+
+            std::coroutine_handle<promise_type> handle;
+        };
+        return Awaiter{m_handle};
+    }
+
+private:
+    explicit Task(std::coroutine_handle<promise_type> handle)
+        : m_handle(handle)
+    {}
+
+    void destroy()
+    {
+        if (m_handle)
+        {
+            m_handle.destroy();
+            m_handle = {};
+        }
+    }
+
+    std::coroutine_handle<promise_type> m_handle;
+};
+
+template <>
+class [[nodiscard]] Task<void>
+{
+public:
+    struct promise_type: Detail::PromiseBase
+    {
+        Task get_return_object()
+        {
+            return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        void return_void() noexcept
+        {}
+    };
+
+    Task() = default;
+
+    Task(Task&& other) noexcept
+        : m_handle(std::exchange(other.m_handle, {}))
+    {}
+
+    Task& operator=(Task&& other) noexcept
+    {
+        if (this != &other)
+        {
+            destroy();
+            m_handle = std::exchange(other.m_handle, {});
+        }
+        return *this;
+    }
+
+    ~Task()
+    {
+        destroy();
+    }
+
+    auto operator co_await() && noexcept
+    {
+        struct Awaiter
+        {
+            bool await_ready() noexcept
+            {
+                return !handle;
+            }
+
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+            {
+                handle.promise().continuation = awaiting;
+                return handle;
+            }
+
+            void await_resume()
+            {
+                if (handle.promise().exception)
+                {
+                    std::rethrow_exception(handle.promise().exception);
+                }
+            }
+
+            std::coroutine_handle<promise_type> handle;
+        };
+        return Awaiter{m_handle};
+    }
+
+private:
+    explicit Task(std::coroutine_handle<promise_type> handle)
+        : m_handle(handle)
+    {}
+
+    void destroy()
+    {
+        if (m_handle)
+        {
+            m_handle.destroy();
+            m_handle = {};
+        }
+    }
+
+    std::coroutine_handle<promise_type> m_handle;
+};
+
+// Eagerly started, self-destroying coroutine used to root a Task that nobody awaits.
+struct Detached
+{
+    struct promise_type: Detail::PooledFrame
+    {
+        Detached get_return_object() noexcept
+        {
+            return {};
+        }
+
+        std::suspend_never initial_suspend() noexcept
+        {
+            return {};
+        }
+
+        std::suspend_never final_suspend() noexcept
+        {
+            return {};
+        }
+
+        void return_void() noexcept
+        {}
+
+        void unhandled_exception() noexcept
+        {
+            std::terminate();
+        }
+    };
+};
+
+// Blocks the calling thread until the task completes; for tests and synchronous entry points only.
+template <typename T>
+T syncWait(Task<T> task)
+{
+    std::latch done(1);
+    std::exception_ptr error;
+
+    if constexpr (std::is_void_v<T>)
+    {
+        [](Task<T> t, std::latch& latch, std::exception_ptr& err) -> Detached
+        {
+            try
+            {
+                co_await std::move(t);
+            }
+            catch (...)
+            {
+                err = std::current_exception();
+            }
+            latch.count_down();
+        }(std::move(task), done, error);
+        done.wait();
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+    }
+    else
+    {
+        std::optional<T> result;
+        [](Task<T> t, std::latch& latch, std::optional<T>& out, std::exception_ptr& err) -> Detached
+        {
+            try
+            {
+                out.emplace(co_await std::move(t));
+            }
+            catch (...)
+            {
+                err = std::current_exception();
+            }
+            latch.count_down();
+        }(std::move(task), done, result, error);
+        done.wait();
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+        return std::move(*result);
+    }
+}
+
+}  // namespace Torrent::Async
+#endif  // TASK_HPP
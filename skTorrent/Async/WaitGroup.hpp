@@ -0,0 +1,73 @@
+#ifndef WAITGROUP_HPP
+#define WAITGROUP_HPP
+
+#include <coroutine>
+#include <cstddef>
+#include <mutex>
+#include <utility>
+
+namespace Torrent::Async {
+
+// Lets one coroutine wait for a set of spawned tasks. The waiter is resumed inline by the last done(), so
+// done() must be the final thing a task does with anything the waiter owns.
+class WaitGroup
+{
+public:
+    void add(size_t n = 1)
+    {
+        std::scoped_lock lk(m_mutex);
+        m_count += n;
+    }
+
+    void done()
+    {
+        std::coroutine_handle<> waiter;
+        {
+            std::scoped_lock lk(m_mutex);
+            if (--m_count == 0)
+            {
+                waiter = std::exchange(m_waiter, nullptr);
+            }
+        }
+        if (waiter)
+        {
+            waiter.resume();
+        }
+    }
+
+    auto wait()
+    {
+        struct Awaiter
+        {
+            bool await_ready() noexcept
+            {
+                return false;
+            }
+
+            bool await_suspend(std::coroutine_handle<> h)
+            {
+                std::scoped_lock lk(group.m_mutex);
+                if (group.m_count == 0)
+                {
+                    return false;
+                }
+                group.m_waiter = h;
+                return true;
+            }
+
+            void await_resume() noexcept
+            {}
+
+            WaitGroup& group;
+        };
+        return Awaiter{*this};
+    }
+
+private:
+    std::mutex m_mutex;
+    size_t m_count = 0;
+    std::coroutine_handle<> m_waiter;
+};
+
+}  // namespace Torrent::Async
+#endif  // WAITGROUP_HPP
@@ -0,0 +1,82 @@
+#include "AnnounceUrl.hpp"
+
+#include <Utils/MetaUtils.hpp>
+
+#include <algorithm>
+#include <charconv>
+#include <limits>
+
+namespace Torrent::Core {
+
+namespace {
+constexpr std::string_view kUploaded   = "&uploaded=";
+constexpr std::string_view kDownloaded = "&downloaded=";
+constexpr std::string_view kLeft       = "&left=";
+constexpr std::string_view kCompact    = "&compact=1";
+constexpr std::string_view kEvent      = "&event=";
+constexpr size_t kMaxDigits            = std::numeric_limits<uint64_t>::digits10 + 1;
+constexpr size_t kMaxEvent             = std::string_view("completed").size();
+constexpr size_t kMaxTail =
+    kUploaded.size() + kDownloaded.size() + kLeft.size() + 3 * kMaxDigits + kCompact.size() + kEvent.size() + kMaxEvent;
+
+std::string_view eventName(AnnounceEvent event)
+{
+    switch (event)
+    {
+    case AnnounceEvent::Started: return "started";
+    case AnnounceEvent::Completed: return "completed";
+    case AnnounceEvent::Stopped: return "stopped";
+    default: return {};
+    }
+}
+
+char* put(char* out, std::string_view s)
+{
+    return std::copy(s.begin(), s.end(), out);
+}
+
+char* put(char* out, uint64_t v)
+{
+    return std::to_chars(out, out + kMaxDigits, v).ptr;
+}
+}  // namespace
+
+AnnounceUrl::AnnounceUrl(std::string_view trackerUrl, std::string_view infoHash, std::string_view peerId, uint16_t port)
+    : m_trackerUrl(trackerUrl)
+{
+    m_buffer.reserve(trackerUrl.size() + 3 * (infoHash.size() + peerId.size()) + 64 + kMaxTail);
+    m_buffer  = trackerUrl;
+    // private trackers often carry a passkey in the query already
+    m_buffer += trackerUrl.find('?') == std::string_view::npos ? '?' : '&';
+    m_buffer += "info_hash=";
+    Utils::urlEncode(infoHash, m_buffer);
+    m_buffer += "&peer_id=";
+    Utils::urlEncode(peerId, m_buffer);
+    m_buffer     += "&port=";
+    m_buffer     += std::to_string(port);
+    m_prefixSize  = m_buffer.size();
+    m_buffer.resize(m_prefixSize + kMaxTail);
+}
+
+std::string_view AnnounceUrl::build(uint64_t uploaded, uint64_t downloaded, std::optional<uint64_t> left, AnnounceEvent event)
+{
+    char* out = m_buffer.data() + m_prefixSize;
+    out       = put(out, kUploaded);
+    out       = put(out, uploaded);
+    out       = put(out, kDownloaded);
+    out       = put(out, downloaded);
+    if (left)
+    {
+        out = put(out, kLeft);
+        out = put(out, *left);
+    }
+    out = put(out, kCompact);
+    if (auto name = eventName(event); !name.empty())
+    {
+        out = put(out, kEvent);
+        out = put(out, name);
+    }
+    return {m_buffer.data(), static_cast<size_t>(out - m_buffer.data())};
+}
+
+}  // namespace Torrent::Core
@@ -0,0 +1,43 @@
+#ifndef ANNOUNCEURL_HPP
+#define ANNOUNCEURL_HPP
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace Torrent::Core {
+
+enum class AnnounceEvent : uint8_t
+{
+    None,  // regular re-announce
+    Started,
+    Completed,
+    Stopped
+};
+
+// HTTP announce URL compiled once per tracker. The tracker URL, info_hash, peer_id and port are encoded up front;
+// build() only writes the transfer counters and the event behind them, in place, so re-announcing never allocates.
+class AnnounceUrl
+{
+public:
+    AnnounceUrl(std::string_view trackerUrl, std::string_view infoHash, std::string_view peerId, uint16_t port);
+
+    // Parameters in a fixed order: info_hash, peer_id, port, uploaded, downloaded, left, compact, event; left is
+    // left out while the size is unknown, e.g. for a magnet link without its metadata. The view stays valid until
+    // the next build() on this object.
+    std::string_view build(uint64_t uploaded, uint64_t downloaded, std::optional<uint64_t> left, AnnounceEvent event);
+
+    const std::string& trackerUrl() const
+    {
+        return m_trackerUrl;
+    }
+
+private:
+    std::string m_trackerUrl;
+    std::string m_buffer;  // constant prefix followed by room for the longest tail
+    size_t m_prefixSize = 0;
+};
+
+}  // namespace Torrent::Core
+#endif  // ANNOUNCEURL_HPP
@@ -0,0 +1,327 @@
+#include "ControlServer.hpp"
+#include "MemoryBudget.hpp"
+
+#include <Logger.hpp>
+#include <Net/Stream.hpp>
+#include <Utils/BencodeEncoder.hpp>
+
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace Torrent::Core {
+
+using Utils::Bencode::Dict;
+using Utils::Bencode::List;
+using Utils::Bencode::Value;
+
+namespace {
+std::string_view stateName(SessionState state)
+{
+    switch (state)
+    {
+    case SessionState::Created: return "created";
+    case SessionState::Preparing: return "preparing";
+    case SessionState::Running: return "running";
+    case SessionState::Stopped: return "stopped";
+    case SessionState::Failed: return "failed";
+    }
+    return "unknown";
+}
+
+const Value& field(const Dict& request, const std::string& key)
+{
+    auto it = request.find(key);
+    if (it == request.end())
+    {
+        throw std::runtime_error("Missing " + key);
+    }
+    return it->second;
+}
+
+Dict success()
+{
+    return {{"ok", Value(uint64_t{1})}};
+}
+
+Dict failure(const std::string& error)
+{
+    return {{"ok", Value(uint64_t{0})}, {"error", Value(error)}};
+}
+
+Value describe(const SessionManager::SessionSnapshot& session)
+{
+    const auto& s = session.status;
+    return Value(Dict{
+        {"id", Value(session.id)},
+        {"source", Value(session.source)},
+        {"name", Value(session.name)},
+        {"state", Value(std::string(stateName(s.state)))},
+        {"paused", Value(uint64_t{s.paused})},
+        {"size", Value(s.totalSize)},
+        {"peers", Value(s.knownPeers)},
+        {"announces", Value(uint64_t{s.announces})},
+        {"failed announces", Value(uint64_t{s.failedAnnounces})},
+    });
+}
+
+uint32_t readBigEndian(const std::array<uint8_t, 4>& bytes)
+{
+    return uint32_t{bytes[0]} << 24 | uint32_t{bytes[1]} << 16 | uint32_t{bytes[2]} << 8 | bytes[3];
+}
+
+Dict parseMessage(std::string_view payload)
+{
+    auto value = Utils::Bencode::Parser(payload).parse();
+    if (!value.isDict())
+    {
+        throw std::runtime_error("Control message is not a dictionary");
+    }
+    return value.asDict();
+}
+}  // namespace
+
+namespace Control {
+std::string frame(const Dict& message)
+{
+    std::string out(4, '\0');
+    Utils::Bencode::encode(Value(message), out);
+    auto size = static_cast<uint32_t>(out.size() - 4);
+    for (int i = 0; i < 4; ++i)
+    {
+        out[static_cast<size_t>(i)] = static_cast<char>(size >> (24 - 8 * i));
+    }
+    return out;
+}
+}  // namespace Control
+
+ControlServer::ControlServer(
+    SessionManager& sessions, const std::string& socketPath, std::vector<std::string> blocklists, IpBlocklist* blocklist)
+    : m_sessions(sessions)
+    , m_blocklists(std::move(blocklists))
+    , m_blocklist(blocklist ? *blocklist : IpBlocklist::global())
+{
+    m_listener = std::make_unique<Net::UnixListener>(m_loop, socketPath,
+        [this](std::unique_ptr<Net::TcpStream> stream) { serve(std::move(stream)); });
+    m_thread   = std::jthread(
+        [this]
+        {
+            Metrics::Tracer::instance().setThreadName("control");
+            m_loop.run();
+        });
+    LOG_INFO(ControlServer, "Control socket ready", LOG_MD(Path, socketPath));
+}
+
+ControlServer::~ControlServer()
+{
+    // clients see end of stream; the last one to finish stops the loop
+    m_loop.post(
+        [this]
+        {
+            m_listener.reset();
+            m_stopping = true;
+            for (auto* client : m_clients)
+            {
+                client->close();
+            }
+            if (m_clients.empty())
+            {
+                m_loop.stop();
+            }
+        });
+    m_thread = {};
+}
+
+Dict ControlServer::handle(const Dict& request)
+{
+    const auto& op = field(request, "op").asStr();
+    if (op == "add")
+    {
+        auto id  = m_sessions.add(m_sessions.newPeerId(), field(request, "source").asStr());
+        auto out = success();
+        out.emplace("id", Value(id));
+        LOG_INFO(ControlServer, "Session added", LOG_MD(Id, id));
+        return out;
+    }
+    if (op == "remove" || op == "pause" || op == "resume")
+    {
+        auto id    = field(request, "id").asInt();
+        bool found = op == "remove" ? m_sessions.remove(id) : m_sessions.setPaused(id, op == "pause");
+        return found ? success() : failure("Unknown session " + std::to_string(id));
+    }
+    if (op == "status")
+    {
+        auto snapshot = m_sessions.snapshot();
+        auto only     = request.find("id");
+        List sessions;
+        for (const auto& session : snapshot->sessions)
+        {
+            if (only == request.end() || (only->second.isInt() && only->second.asInt() == session.id))
+            {
+                sessions.push_back(describe(session));
+            }
+        }
+        auto out = success();
+        out.emplace("snapshot", Value(snapshot->snapshotNo));
+        out.emplace("sessions", Value(std::move(sessions)));
+        return out;
+    }
+    if (op == "stats")
+    {
+        auto snapshot = m_sessions.snapshot();
+        uint64_t running = 0, paused = 0, failed = 0, peers = 0, announces = 0, failures = 0;
+        for (const auto& session : snapshot->sessions)
+        {
+            const auto& s  = session.status;
+            running       += s.state == SessionState::Running && !s.paused;
+            paused        += s.paused;
+            failed        += s.state == SessionState::Failed;
+            peers         += s.knownPeers;
+            announces     += s.announces;
+            failures      += s.failedAnnounces;
+        }
+        auto out = success();
+        out.emplace("snapshot", Value(snapshot->snapshotNo));
+        out.emplace("sessions", Value(uint64_t{snapshot->sessions.size()}));
+        out.emplace("running", Value(running));
+        out.emplace("paused", Value(paused));
+        out.emplace("failed", Value(failed));
+        out.emplace("peers", Value(peers));
+        out.emplace("announces", Value(announces));
+        out.emplace("failed announces", Value(failures));
+        out.emplace("steals", Value(snapshot->steals));
+        out.emplace("disk queue", Value(uint64_t{snapshot->diskQueue}));
+        Dict memory;
+        for (size_t i = 0; i < MemoryCategoryCount; ++i)
+        {
+            auto category = static_cast<MemoryCategory>(i);
+            memory.emplace(std::string(toString(category)), Value(MemoryBudget::global().used(category)));
+        }
+        out.emplace("memory", Value(std::move(memory)));
+        return out;
+    }
+    if (op == "blocklist")
+    {
+        if (m_blocklists.empty())
+        {
+            return failure("No blocklist configured");
+        }
+        try
+        {
+            m_blocklist.load(m_blocklists, &m_sessions.workers());
+        }
+        catch (const std::exception& e)
+        {
+            // the current filter stays in place
+            return failure(e.what());
+        }
+        auto stats = m_blocklist.stats();
+        auto out   = success();
+        out.emplace("ranges", Value(uint64_t{stats.v4Ranges + stats.v6Ranges}));
+        out.emplace("rejected", Value(uint64_t{stats.rejected}));
+        LOG_INFO(ControlServer, "Blocklist reloaded", LOG_MD(Ranges, stats.v4Ranges + stats.v6Ranges),
+            LOG_MD(Rejected, stats.rejected));
+        return out;
+    }
+    return failure("Unknown op " + op);
+}
+
+Async::Detached ControlServer::serve(std::unique_ptr<Net::TcpStream> stream)
+{
+    m_clients.insert(stream.get());
+    try
+    {
+        std::array<uint8_t, 4> header;
+        std::string payload;
+        while (true)
+        {
+            co_await Net::readExactly(*stream, header);
+            uint32_t size = readBigEndian(header);
+            if (size > Control::MaxFrame)
+            {
+                throw std::runtime_error("Control frame too large");
+            }
+            payload.resize(size);
+            co_await Net::readExactly(*stream, {reinterpret_cast<uint8_t*>(payload.data()), payload.size()});
+
+            Dict response;
+            try
+            {
+                response = handle(parseMessage(payload));
+            }
+            catch (const std::exception& e)
+            {
+                response = failure(e.what());
+            }
+            auto out = Control::frame(response);
+            co_await stream->write({reinterpret_cast<const uint8_t*>(out.data()), out.size()});
+        }
+    }
+    catch (const std::exception& e)
+    {
+        LOG_DEBUG(ControlServer, "Control client gone", LOG_MD(Reason, e.what()));
+    }
+    m_clients.erase(stream.get());
+    if (m_stopping && m_clients.empty())
+    {
+        m_loop.stop();
+    }
+}
+
+ControlClient::ControlClient(const std::string& socketPath)
+    : m_fd(Net::connectUnix(socketPath))
+{}
+
+ControlClient::~ControlClient()
+{
+    ::close(m_fd);
+}
+
+Dict ControlClient::request(const Dict& message)
+{
+    auto out = Control::frame(message);
+    for (size_t sent = 0; sent < out.size();)
+    {
+        ssize_t n = ::send(m_fd, out.data() + sent, out.size() - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            throw std::runtime_error(std::string("Control write failed: ") + std::strerror(errno));
+        }
+        sent += static_cast<size_t>(n);
+    }
+
+    auto readAll = [this](char* data, size_t size)
+    {
+        for (size_t got = 0; got < size;)
+        {
+            ssize_t n = ::read(m_fd, data + got, size - got);
+            if (n < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (n <= 0)
+            {
+                throw std::runtime_error("Control connection closed");
+            }
+            got += static_cast<size_t>(n);
+        }
+    };
+    std::array<uint8_t, 4> header;
+    readAll(reinterpret_cast<char*>(header.data()), header.size());
+    uint32_t size = readBigEndian(header);
+    if (size > Control::MaxFrame)
+    {
+        throw std::runtime_error("Control frame too large");
+    }
+    std::string payload(size, '\0');
+    readAll(payload.data(), payload.size());
+    return parseMessage(payload);
+}
+
+}  // namespace Torrent::Core
@@ -0,0 +1,75 @@
+#ifndef CONTROLSERVER_HPP
+#define CONTROLSERVER_HPP
+
+#include "IpFilter.hpp"
+#include "SessionManager.hpp"
+
+#include <Net/UnixSocket.hpp>
+#include <Utils/BencodeParser.hpp>
+
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace Torrent::Core {
+
+// Local control protocol. Every message in either direction is a 4-byte big-endian length followed by a bencoded
+// dictionary. Requests name an "op":
+//   add     source=<.torrent path or magnet URI>  -> id
+//   remove  id                                    (also: pause, resume)
+//   status  [id]                                  -> sessions=[{id source name state paused size peers ...}]
+//   stats                                         -> aggregate counts
+//   blocklist                                     reloads the blocklist files -> ranges rejected
+// Every answer carries ok=1 or ok=0 with an "error" string.
+namespace Control {
+constexpr uint32_t MaxFrame = 1 << 20;
+
+std::string frame(const Utils::Bencode::Dict& message);
+}  // namespace Control
+
+// Serves the control protocol on a Unix domain socket from a thread of its own. status and stats only read the
+// manager's published snapshot, so polling never contends with the session or io threads. Must not outlive the
+// manager.
+class ControlServer
+{
+public:
+    // blocklists are the files the blocklist op loads into blocklist, the global one when null, on the manager's
+    // workers.
+    ControlServer(SessionManager& sessions, const std::string& socketPath, std::vector<std::string> blocklists = {},
+        IpBlocklist* blocklist = nullptr);
+    ~ControlServer();
+    ControlServer(const ControlServer&) = delete;
+
+    // Answers one request; throws std::runtime_error for malformed ones.
+    Utils::Bencode::Dict handle(const Utils::Bencode::Dict& request);
+
+private:
+    Async::Detached serve(std::unique_ptr<Net::TcpStream> stream);
+
+    SessionManager& m_sessions;
+    std::vector<std::string> m_blocklists;
+    IpBlocklist& m_blocklist;
+    Net::EventLoop m_loop;
+    std::unique_ptr<Net::UnixListener> m_listener;
+    std::unordered_set<Net::TcpStream*> m_clients;  // loop thread only
+    bool m_stopping = false;
+    std::jthread m_thread;
+};
+
+// Blocking client, one request at a time.
+class ControlClient
+{
+public:
+    explicit ControlClient(const std::string& socketPath);
+    ~ControlClient();
+    ControlClient(const ControlClient&) = delete;
+
+    // Throws std::runtime_error when the daemon cannot be reached or hangs up.
+    Utils::Bencode::Dict request(const Utils::Bencode::Dict& message);
+
+private:
+    int m_fd = -1;
+};
+
+}  // namespace Torrent::Core
+#endif  // CONTROLSERVER_HPP
@@ -0,0 +1,108 @@
+#include "FilePriorities.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+namespace Torrent::Core {
+
+FilePriorities::FilePriorities(const Metadata& meta)
+    : m_pieceLength(meta.pieceLength)
+    , m_totalSize(meta.totalSize)
+{
+    if (m_pieceLength == 0)
+    {
+        throw std::runtime_error("Piece length is zero");
+    }
+    uint64_t offset = 0;
+    m_files.reserve(meta.files.size());
+    for (const auto& entry : meta.files)
+    {
+        m_files.push_back({offset, entry.size, entry.padding});
+        offset += entry.size;
+    }
+    m_pieces.resize(static_cast<size_t>((m_totalSize + m_pieceLength - 1) / m_pieceLength));
+    for (uint32_t piece = 0; piece < m_pieces.size(); ++piece)
+    {
+        m_pieces[piece] = compute(piece);
+    }
+}
+
+std::optional<std::pair<uint32_t, uint32_t>> FilePriorities::piecesOf(size_t index) const
+{
+    const auto& file = m_files.at(index);
+    if (file.size == 0)
+    {
+        return std::nullopt;
+    }
+    return std::pair{static_cast<uint32_t>(file.offset / m_pieceLength),
+        static_cast<uint32_t>((file.offset + file.size - 1) / m_pieceLength)};
+}
+
+Priority FilePriorities::compute(uint32_t piece) const
+{
+    uint64_t begin = piece * m_pieceLength;
+    uint64_t end   = std::min(begin + m_pieceLength, m_totalSize);
+    // file ends never decrease, so the files overlapping the piece start at the first one ending past its start
+    auto it = std::partition_point(m_files.begin(), m_files.end(), [&](const File& f) { return f.offset + f.size <= begin; });
+    auto best = Priority::Skip;
+    for (; it != m_files.end() && it->offset < end; ++it)
+    {
+        if (!it->padding && it->size > 0)
+        {
+            best = std::max(best, it->priority);
+        }
+    }
+    return best;
+}
+
+std::vector<uint32_t> FilePriorities::set(size_t index, Priority priority)
+{
+    auto& file = m_files.at(index);
+    auto range = piecesOf(index);
+    if (file.priority == priority || file.padding || !range)
+    {
+        file.priority = priority;
+        return {};
+    }
+    file.priority = priority;
+
+    std::vector<uint32_t> changed;
+    auto [first, last] = *range;
+    for (uint32_t piece = first; piece <= last; ++piece)
+    {
+        // pieces strictly inside the file overlap no other
+        auto updated = piece == first || piece == last ? compute(piece) : priority;
+        if (updated != m_pieces[piece])
+        {
+            m_pieces[piece] = updated;
+            changed.push_back(piece);
+        }
+    }
+    return changed;
+}
+
+std::vector<uint32_t> FilePriorities::set(std::span<const Priority> priorities)
+{
+    if (priorities.size() != m_files.size())
+    {
+        throw std::runtime_error("Expected " + std::to_string(m_files.size()) + " file priorities");
+    }
+    for (size_t i = 0; i < m_files.size(); ++i)
+    {
+        m_files[i].priority = priorities[i];
+    }
+    std::vector<uint32_t> changed;
+    for (uint32_t piece = 0; piece < m_pieces.size(); ++piece)
+    {
+        auto updated = compute(piece);
+        if (updated != m_pieces[piece])
+        {
+            m_pieces[piece] = updated;
+            changed.push_back(piece);
+        }
+    }
+    return changed;
+}
+
+}  // namespace Torrent::Core
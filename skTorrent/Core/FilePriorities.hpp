@@ -0,0 +1,71 @@
+#ifndef FILEPRIORITIES_HPP
+#define FILEPRIORITIES_HPP
+
+#include "PiecePicker.hpp"
+
+#include <Utils/MetaUtils.hpp>
+
+#include <optional>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace Torrent::Core {
+
+// Priorities of the entries of Metadata::files, translated into piece priorities. A piece takes the highest
+// priority among the files it overlaps, so a piece shared by a skipped file and a wanted one is still downloaded;
+// pad and empty files never count. Changing one file recomputes only the pieces under it: the two on its edges by
+// looking at their other files, the ones in between directly.
+class FilePriorities
+{
+public:
+    // Every file Normal.
+    explicit FilePriorities(const Metadata& meta);
+
+    size_t fileCount() const
+    {
+        return m_files.size();
+    }
+
+    uint32_t pieceCount() const
+    {
+        return static_cast<uint32_t>(m_pieces.size());
+    }
+
+    Priority file(size_t index) const
+    {
+        return m_files.at(index).priority;
+    }
+
+    Priority piece(uint32_t piece) const
+    {
+        return m_pieces[piece];
+    }
+
+    // First and last piece under a file; none for empty files.
+    std::optional<std::pair<uint32_t, uint32_t>> piecesOf(size_t index) const;
+
+    // Both return the pieces whose priority changed, ascending. The whole-torrent form throws std::runtime_error
+    // unless there is one priority per file.
+    std::vector<uint32_t> set(size_t index, Priority priority);
+    std::vector<uint32_t> set(std::span<const Priority> priorities);
+
+private:
+    struct File
+    {
+        uint64_t offset   = 0;
+        uint64_t size     = 0;
+        bool padding      = false;
+        Priority priority = Priority::Normal;
+    };
+
+    Priority compute(uint32_t piece) const;
+
+    uint64_t m_pieceLength;
+    uint64_t m_totalSize;
+    std::vector<File> m_files;
+    std::vector<Priority> m_pieces;
+};
+
+}  // namespace Torrent::Core
+#endif  // FILEPRIORITIES_HPP
@@ -0,0 +1,510 @@
+#include "IpFilter.hpp"
+
+#include <Async/Executor.hpp>
+
+#include <Logger.hpp>
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <bit>
+#include <fstream>
+#include <iterator>
+#include <latch>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+
+namespace Torrent::Core {
+
+namespace {
+using Address6 = IpFilter::Address6;
+using Range6   = IpFilter::Range<Address6>;
+
+constexpr size_t kChunkBytes      = 1 << 20;
+constexpr Address6 kMappedFirst   = Address6{0xffff} << 32;
+constexpr Address6 kMappedLast    = kMappedFirst | 0xffff'ffff;
+constexpr Address6 kLastAddress   = ~Address6{0};
+constexpr unsigned kHighestLevel  = 127;  // DAT levels up to this one block
+constexpr size_t kMaxAddressChars = 45;   // INET6_ADDRSTRLEN without the terminator
+
+std::string_view trim(std::string_view s)
+{
+    auto first = s.find_first_not_of(" \t\r");
+    if (first == std::string_view::npos)
+    {
+        return {};
+    }
+    return s.substr(first, s.find_last_not_of(" \t\r") - first + 1);
+}
+
+// dotted quad, octets of up to three digits including leading zeros ("001.002.003.004" is common in DAT lists)
+std::optional<uint32_t> parseV4(std::string_view s)
+{
+    uint32_t address = 0;
+    size_t at        = 0;
+    for (int octet = 0; octet < 4; ++octet)
+    {
+        if (octet > 0)
+        {
+            if (at == s.size() || s[at] != '.')
+            {
+                return std::nullopt;
+            }
+            ++at;
+        }
+        uint32_t value = 0;
+        size_t digits  = 0;
+        for (; at < s.size() && s[at] >= '0' && s[at] <= '9' && digits < 3; ++at, ++digits)
+        {
+            value = value * 10 + static_cast<uint32_t>(s[at] - '0');
+        }
+        if (digits == 0 || value > 255)
+        {
+            return std::nullopt;
+        }
+        address = address << 8 | value;
+    }
+    if (at != s.size())
+    {
+        return std::nullopt;
+    }
+    return address;
+}
+
+std::optional<Address6> parseAddress(std::string_view s)
+{
+    s = trim(s);
+    if (auto v4 = parseV4(s))
+    {
+        return kMappedFirst | *v4;
+    }
+    if (s.size() > kMaxAddressChars || s.find(':') == std::string_view::npos)
+    {
+        return std::nullopt;
+    }
+    char text[kMaxAddressChars + 1];
+    s.copy(text, s.size());
+    text[s.size()] = '\0';
+    uint8_t bytes[16];
+    if (::inet_pton(AF_INET6, text, bytes) != 1)
+    {
+        return std::nullopt;
+    }
+    Address6 address = 0;
+    for (uint8_t b : bytes)
+    {
+        address = address << 8 | b;
+    }
+    return address;
+}
+
+// "first-last", addresses contain no '-'
+std::optional<Range6> parseRange(std::string_view s)
+{
+    auto dash = s.find('-');
+    if (dash == std::string_view::npos)
+    {
+        return std::nullopt;
+    }
+    auto first = parseAddress(s.substr(0, dash));
+    auto last  = first ? parseAddress(s.substr(dash + 1)) : std::nullopt;
+    if (!last)
+    {
+        return std::nullopt;
+    }
+    return Range6{*first, *last};
+}
+
+std::optional<unsigned> parseLevel(std::string_view s)
+{
+    s = trim(s);
+    if (s.empty() || s.size() > 9 || s.find_first_not_of("0123456789") != std::string_view::npos)
+    {
+        return std::nullopt;
+    }
+    unsigned level = 0;
+    for (char c : s)
+    {
+        level = level * 10 + static_cast<unsigned>(c - '0');
+    }
+    return level;
+}
+
+void parseLine(std::string_view line, std::vector<Range6>& out, IpFilter::Stats& stats)
+{
+    line = trim(line);
+    if (line.empty() || line.front() == '#' || line.starts_with("//"))
+    {
+        return;
+    }
+    std::optional<Range6> range;
+    bool wanted = true;
+    // DAT: the text before the first comma is the range; a P2P description may hold commas but is no range
+    if (auto comma = line.find(','); comma != std::string_view::npos && (range = parseRange(line.substr(0, comma))))
+    {
+        auto rest  = line.substr(comma + 1);
+        auto level = parseLevel(rest.substr(0, rest.find(',')));
+        if (!level)
+        {
+            range.reset();
+        }
+        wanted = level && *level <= kHighestLevel;
+    }
+    else
+    {
+        // P2P: the description may hold colons and so may an IPv6 range; the first split that parses wins
+        for (auto colon = line.find(':'); colon != std::string_view::npos && !range; colon = line.find(':', colon + 1))
+        {
+            range = parseRange(line.substr(colon + 1));
+        }
+    }
+    if (!range || range->first > range->last)
+    {
+        ++stats.rejected;
+        return;
+    }
+    ++stats.lines;
+    if (wanted)
+    {
+        out.push_back(*range);
+    }
+}
+
+bool byFirst(const Range6& a, const Range6& b)
+{
+    return a.first < b.first;
+}
+
+struct ParseJob
+{
+    explicit ParseJob(std::vector<std::string_view> text)
+        : chunks(std::move(text))
+        , ranges(chunks.size())
+        , stats(chunks.size())
+        , done(static_cast<std::ptrdiff_t>(chunks.size()))
+    {}
+
+    std::vector<std::string_view> chunks;
+    std::vector<std::vector<Range6>> ranges;
+    std::vector<IpFilter::Stats> stats;
+    std::atomic<size_t> next{0};
+    std::latch done;
+};
+
+void parseChunks(ParseJob& job)
+{
+    for (size_t i; (i = job.next.fetch_add(1, std::memory_order_relaxed)) < job.chunks.size();)
+    {
+        std::string_view text = job.chunks[i];
+        auto& out             = job.ranges[i];
+        while (!text.empty())
+        {
+            auto end = text.find('\n');
+            parseLine(text.substr(0, end), out, job.stats[i]);
+            text.remove_prefix(end == std::string_view::npos ? text.size() : end + 1);
+        }
+        std::sort(out.begin(), out.end(), byFirst);
+        job.done.count_down();
+    }
+}
+
+// pieces of about kChunkBytes cut after a line end
+std::vector<std::string_view> split(std::string_view text)
+{
+    std::vector<std::string_view> chunks;
+    while (!text.empty())
+    {
+        size_t end = text.size();
+        if (end > kChunkBytes)
+        {
+            auto newline = text.find('\n', kChunkBytes);
+            end          = newline == std::string_view::npos ? text.size() : newline + 1;
+        }
+        chunks.push_back(text.substr(0, end));
+        text.remove_prefix(end);
+    }
+    return chunks;
+}
+
+// all ranges sorted by first address
+std::vector<Range6> parseTexts(const std::vector<std::string_view>& texts, Async::Executor* executor, IpFilter::Stats& stats)
+{
+    std::vector<std::string_view> chunks;
+    for (auto text : texts)
+    {
+        auto pieces = split(text);
+        chunks.insert(chunks.end(), pieces.begin(), pieces.end());
+    }
+    auto job = std::make_shared<ParseJob>(std::move(chunks));
+    if (executor)
+    {
+        // workers that start after the caller took the last chunk find nothing left and leave
+        for (size_t i = 1; i < std::min(job->chunks.size(), executor->size() + 1); ++i)
+        {
+            executor->post([job] { parseChunks(*job); });
+        }
+    }
+    parseChunks(*job);
+    job->done.wait();
+
+    // merge the sorted chunks pairwise, doubling the run length each round
+    std::vector<Range6> ranges;
+    std::vector<size_t> bounds{0};
+    for (size_t i = 0; i < job->ranges.size(); ++i)
+    {
+        ranges.insert(ranges.end(), job->ranges[i].begin(), job->ranges[i].end());
+        bounds.push_back(ranges.size());
+        stats.lines    += job->stats[i].lines;
+        stats.rejected += job->stats[i].rejected;
+    }
+    for (size_t width = 1; width + 1 < bounds.size(); width *= 2)
+    {
+        for (size_t i = 0; i + width + 1 < bounds.size(); i += 2 * width)
+        {
+            size_t end = std::min(i + 2 * width, bounds.size() - 1);
+            std::inplace_merge(ranges.begin() + static_cast<std::ptrdiff_t>(bounds[i]),
+                ranges.begin() + static_cast<std::ptrdiff_t>(bounds[i + width]),
+                ranges.begin() + static_cast<std::ptrdiff_t>(bounds[end]), byFirst);
+        }
+    }
+    return ranges;
+}
+
+// In-order walk of the implicit tree rooted at k fills it from the sorted ranges.
+template <typename T>
+void layOut(const std::vector<IpFilter::Range<T>>& sorted, std::vector<IpFilter::Range<T>>& tree, size_t& next, size_t k)
+{
+    if (k < tree.size())
+    {
+        layOut(sorted, tree, next, 2 * k);
+        tree[k] = sorted[next++];
+        layOut(sorted, tree, next, 2 * k + 1);
+    }
+}
+
+template <typename T>
+std::vector<IpFilter::Range<T>> eytzinger(const std::vector<IpFilter::Range<T>>& sorted)
+{
+    if (sorted.empty())
+    {
+        return {};
+    }
+    std::vector<IpFilter::Range<T>> tree(sorted.size() + 1);
+    size_t next = 0;
+    layOut(sorted, tree, next, 1);
+    return tree;
+}
+
+// The ranges are disjoint and sorted, so the first one ending at or after x is the only one that may hold it.
+// The descent goes left while the node ends at or after x; shifting out the trailing right turns and the last
+// left one leaves the node where it went left last, 0 when it never did.
+template <typename T>
+bool contains(const std::vector<IpFilter::Range<T>>& tree, T x)
+{
+    // descendants this many levels down sit side by side, k * Ahead being the first of them
+    constexpr size_t Ahead = 64 / sizeof(IpFilter::Range<T>);
+    size_t n               = tree.empty() ? 0 : tree.size() - 1;
+    size_t k               = 1;
+    // near the leaves k * Ahead is past the end: the address is computed as an integer, since a pointer that far
+    // out is undefined, and a prefetch of it is harmless
+    auto base = reinterpret_cast<uintptr_t>(tree.data());
+    while (k <= n)
+    {
+        __builtin_prefetch(reinterpret_cast<const void*>(base + k * Ahead * sizeof(IpFilter::Range<T>)));
+        k = 2 * k + (tree[k].last < x);
+    }
+    k >>= std::countr_one(k) + 1;
+    return k != 0 && tree[k].first <= x;
+}
+
+size_t readerSlot()
+{
+    static std::atomic<size_t> next{0};
+    thread_local size_t index = next.fetch_add(1, std::memory_order_relaxed) % IpBlocklist::Slots;
+    return index;
+}
+}  // namespace
+
+IpFilter IpFilter::parse(std::string_view text, Async::Executor* executor)
+{
+    Stats stats;
+    auto ranges = parseTexts({text}, executor, stats);
+    return build(ranges, stats);
+}
+
+IpFilter IpFilter::load(const std::vector<std::string>& paths, Async::Executor* executor)
+{
+    std::vector<std::string> contents;
+    for (const auto& path : paths)
+    {
+        std::ifstream in(path, std::ios::binary);
+        if (in)
+        {
+            contents.emplace_back(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        }
+        if (!in && !in.eof())
+        {
+            throw std::runtime_error("Cannot read IP filter " + path);
+        }
+    }
+    Stats stats;
+    auto ranges = parseTexts({contents.begin(), contents.end()}, executor, stats);
+    auto filter = build(ranges, stats);
+    LOG_INFO(IpFilter, "Loaded IP filter", LOG_MD(Files, paths.size()), LOG_MD(Lines, filter.m_stats.lines),
+        LOG_MD(Rejected, filter.m_stats.rejected), LOG_MD(Ranges, filter.size()));
+    return filter;
+}
+
+IpFilter IpFilter::build(const std::vector<Range<Address6>>& ranges, Stats stats)
+{
+    std::vector<Range6> merged;
+    for (const auto& range : ranges)
+    {
+        if (!merged.empty() && (merged.back().last == kLastAddress || range.first <= merged.back().last + 1))
+        {
+            merged.back().last = std::max(merged.back().last, range.last);
+        }
+        else
+        {
+            merged.push_back(range);
+        }
+    }
+
+    // the IPv4-mapped block goes to the IPv4 table, what lies on either side of it to the IPv6 one
+    std::vector<Range<uint32_t>> v4;
+    std::vector<Range6> v6;
+    for (const auto& range : merged)
+    {
+        if (range.first < kMappedFirst)
+        {
+            v6.push_back({range.first, std::min(range.last, kMappedFirst - 1)});
+        }
+        if (range.first <= kMappedLast && range.last >= kMappedFirst)
+        {
+            v4.push_back({static_cast<uint32_t>(std::max(range.first, kMappedFirst)),
+                static_cast<uint32_t>(std::min(range.last, kMappedLast))});
+        }
+        if (range.last > kMappedLast)
+        {
+            v6.push_back({std::max(range.first, kMappedLast + 1), range.last});
+        }
+    }
+
+    IpFilter filter;
+    stats.v4Ranges = v4.size();
+    stats.v6Ranges = v6.size();
+    filter.m_v4    = eytzinger(v4);
+    filter.m_v6    = eytzinger(v6);
+    filter.m_stats = stats;
+    return filter;
+}
+
+bool IpFilter::blocked(const Net::Endpoint& endpoint) const
+{
+    const auto& a = endpoint.address;
+    if (endpoint.isV4())
+    {
+        return contains(m_v4, static_cast<uint32_t>(a[12]) << 24 | static_cast<uint32_t>(a[13]) << 16
+                | static_cast<uint32_t>(a[14]) << 8 | a[15]);
+    }
+    Address6 address = 0;
+    for (uint8_t b : a)
+    {
+        address = address << 8 | b;
+    }
+    return contains(m_v6, address);
+}
+
+IpBlocklist& IpBlocklist::global()
+{
+    static IpBlocklist blocklist;
+    return blocklist;
+}
+
+IpBlocklist::IpBlocklist(Metrics::Registry* metrics)
+    : m_current(new IpFilter())
+    , m_blocked((metrics ? *metrics : Metrics::Registry::global())
+              .counter("sktorrent_blocked_peers_total", "Connections, tracker peers and DHT nodes refused by the IP filter"))
+    , m_ranges((metrics ? *metrics : Metrics::Registry::global())
+              .gauge("sktorrent_ip_filter_ranges", "Address ranges in the IP filter after merging"))
+{}
+
+IpBlocklist::~IpBlocklist()
+{
+    delete m_current.load(std::memory_order_acquire);
+}
+
+// A reader that saw the epoch unchanged after announcing itself is seen by any replace() bumping it later, which
+// then waits for it; one that raced with the bump backs off and announces itself again in the new epoch.
+template <typename F>
+auto IpBlocklist::read(F fn)
+{
+    auto& slot = m_readers[readerSlot()];
+    for (;;)
+    {
+        uint64_t epoch = m_epoch.load();
+        auto& active   = slot.active[epoch & 1];
+        active.fetch_add(1);
+        if (m_epoch.load() != epoch)
+        {
+            active.fetch_sub(1, std::memory_order_release);
+            continue;
+        }
+        auto result = fn(*m_current.load(std::memory_order_acquire));
+        active.fetch_sub(1, std::memory_order_release);
+        return result;
+    }
+}
+
+bool IpBlocklist::blocked(const Net::Endpoint& endpoint)
+{
+    bool blocked = read([&](const IpFilter& filter) { return filter.blocked(endpoint); });
+    if (blocked)
+    {
+        m_blocked.add();
+    }
+    return blocked;
+}
+
+size_t IpBlocklist::filter(std::vector<Net::Endpoint>& endpoints)
+{
+    size_t removed = read(
+        [&](const IpFilter& filter)
+        {
+            return std::erase_if(endpoints, [&](const Net::Endpoint& endpoint) { return filter.blocked(endpoint); });
+        });
+    if (removed > 0)
+    {
+        m_blocked.add(removed);
+    }
+    return removed;
+}
+
+void IpBlocklist::replace(std::unique_ptr<const IpFilter> filter)
+{
+    std::scoped_lock lk(m_writer);
+    m_ranges.set(static_cast<int64_t>(filter->size()));
+    const IpFilter* old = m_current.exchange(filter.release());
+    uint64_t epoch      = m_epoch.load(std::memory_order_relaxed);
+    m_epoch.store(epoch + 1);
+    for (auto& slot : m_readers)
+    {
+        while (slot.active[epoch & 1].load(std::memory_order_acquire) != 0)
+        {
+            std::this_thread::yield();
+        }
+    }
+    delete old;
+}
+
+void IpBlocklist::load(const std::vector<std::string>& paths, Async::Executor* executor)
+{
+    replace(std::make_unique<const IpFilter>(IpFilter::load(paths, executor)));
+}
+
+IpFilter::Stats IpBlocklist::stats()
+{
+    return read([](const IpFilter& filter) { return filter.stats(); });
+}
+
+}  // namespace Torrent::Core
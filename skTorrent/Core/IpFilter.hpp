@@ -0,0 +1,131 @@
+#ifndef IPFILTER_HPP
+#define IPFILTER_HPP
+
+#include <Metrics/Metrics.hpp>
+#include <Net/Endpoint.hpp>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Torrent::Async {
+class Executor;
+}
+
+namespace Torrent::Core {
+
+// Immutable set of blocked address ranges, parsed from blocklists in either common format, one range per line:
+//  - P2P (PeerGuardian): "description:first-last";
+//  - DAT (eMule ipfilter.dat): "first - last , level , description", blocking when level is 127 or less.
+// Addresses are IPv4, with or without leading zeros, or IPv6. Blank lines and lines starting with '#' or "//"
+// are skipped; lines matching neither format are counted and ignored.
+//
+// Overlapping and adjacent ranges are merged, then IPv4 and IPv6 ranges are laid out in two arrays in Eytzinger
+// (breadth-first) order: a lookup walks down an implicit binary tree whose top levels stay in cache, and every
+// step prefetches the descendants a few levels down, which share a cache line. A lookup is a branch-free
+// loop of about log2(ranges) steps with no pointer chasing.
+class IpFilter
+{
+public:
+    struct Stats
+    {
+        size_t lines    = 0;  // valid lines, DAT ones above the blocking level included
+        size_t rejected = 0;  // lines in neither format, or with first > last
+        size_t v4Ranges = 0;  // after merging
+        size_t v6Ranges = 0;
+    };
+
+    // IPv6 addresses, and IPv4 ones mapped (::ffff:a.b.c.d), as big-endian 128-bit numbers
+    using Address6 = unsigned __int128;
+
+    template <typename T>
+    struct Range
+    {
+        T first;
+        T last;
+    };
+
+    // Blocks nothing.
+    IpFilter() = default;
+
+    // Text is cut into chunks at line ends; the workers of the executor and the caller parse and sort one chunk
+    // at a time, then the sorted chunks are merged. Without an executor everything runs on the caller.
+    static IpFilter parse(std::string_view text, Async::Executor* executor = nullptr);
+    // All files make one filter. Throws std::runtime_error when a file cannot be read.
+    static IpFilter load(const std::vector<std::string>& paths, Async::Executor* executor = nullptr);
+
+    // IPv4-mapped endpoints are looked up as IPv4.
+    bool blocked(const Net::Endpoint& endpoint) const;
+
+    size_t size() const
+    {
+        return m_stats.v4Ranges + m_stats.v6Ranges;
+    }
+
+    const Stats& stats() const
+    {
+        return m_stats;
+    }
+
+private:
+    // ranges sorted by first address
+    static IpFilter build(const std::vector<Range<Address6>>& ranges, Stats stats);
+
+    // 1-based Eytzinger order; empty when there is no range
+    std::vector<Range<uint32_t>> m_v4;
+    std::vector<Range<Address6>> m_v6;
+    Stats m_stats;
+};
+
+// The filter every connection is checked against, replaced while in use. Readers never lock nor wait: each one
+// announces itself in a per-thread-slot counter of the current epoch, looks the address up and leaves. replace()
+// publishes the new filter, moves to the next epoch and frees the old filter once the counters of the previous
+// epoch are back to zero, so only the writer waits. Blocked lookups are counted in sktorrent_blocked_peers_total.
+class IpBlocklist
+{
+public:
+    static constexpr size_t Slots = 16;
+
+    // Empty until replaced; reports to the global metrics registry.
+    static IpBlocklist& global();
+
+    // Reports to metrics, the global registry when null.
+    explicit IpBlocklist(Metrics::Registry* metrics = nullptr);
+    ~IpBlocklist();
+    IpBlocklist(const IpBlocklist&) = delete;
+
+    bool blocked(const Net::Endpoint& endpoint);
+    // Erases the blocked endpoints; returns how many.
+    size_t filter(std::vector<Net::Endpoint>& endpoints);
+
+    // Returns once no lookup uses the previous filter any more. Must not be called from a lookup.
+    void replace(std::unique_ptr<const IpFilter> filter);
+    // Parses paths with IpFilter::load() and swaps the result in; throws like it, keeping the current filter.
+    void load(const std::vector<std::string>& paths, Async::Executor* executor = nullptr);
+
+    IpFilter::Stats stats();
+
+private:
+    struct alignas(64) Slot
+    {
+        std::array<std::atomic<uint64_t>, 2> active{};  // lookups in progress, by epoch parity
+    };
+
+    template <typename F>
+    auto read(F fn);
+
+    std::atomic<const IpFilter*> m_current;
+    std::atomic<uint64_t> m_epoch{0};
+    std::array<Slot, Slots> m_readers;
+    std::mutex m_writer;
+    Metrics::Counter& m_blocked;
+    Metrics::Gauge& m_ranges;
+};
+
+}  // namespace Torrent::Core
+#endif  // IPFILTER_HPP
@@ -0,0 +1,206 @@
+#include "MemoryBudget.hpp"
+
+#include <Logger.hpp>
+
+#include <algorithm>
+#include <string>
+#include <utility>
+
+namespace Torrent::Core {
+
+namespace {
+constexpr std::array<std::string_view, MemoryCategoryCount> kNames{"network", "pieces", "disk write", "read cache", "metadata"};
+
+// std::string keeps short strings inline
+uint64_t heapBytes(const std::string& s)
+{
+    return s.capacity() > 15 ? s.capacity() + 1 : 0;
+}
+}  // namespace
+
+std::string_view toString(MemoryCategory category)
+{
+    return kNames[static_cast<size_t>(category)];
+}
+
+MemoryBudget& MemoryBudget::global()
+{
+    static MemoryBudget budget;
+    return budget;
+}
+
+MemoryBudget::MemoryBudget(Metrics::Registry* metrics)
+{
+    auto& parent = metrics ? *metrics : Metrics::Registry::global();
+    for (size_t i = 0; i < MemoryCategoryCount; ++i)
+    {
+        auto& s   = m_slots[i];
+        s.metrics = std::make_unique<Metrics::Registry>("category=\"" + std::string(kNames[i]) + '"', parent);
+        s.bytes   = &s.metrics->gauge("sktorrent_memory_bytes", "Memory held for torrents and peers");
+        s.refused = &s.metrics->counter("sktorrent_memory_refused_total", "Allocations refused at the hard limit");
+    }
+}
+
+void MemoryBudget::setLimits(MemoryCategory category, Limits limits)
+{
+    auto& s = slot(category);
+    s.hard.store(limits.hard, std::memory_order_relaxed);
+    s.soft.store(std::min(limits.soft, limits.hard), std::memory_order_relaxed);
+    update(category, s.used.load(std::memory_order_relaxed));
+}
+
+void MemoryBudget::charge(MemoryCategory category, uint64_t bytes)
+{
+    auto& s = slot(category);
+    s.bytes->add(static_cast<int64_t>(bytes));
+    update(category, s.used.fetch_add(bytes, std::memory_order_relaxed) + bytes);
+}
+
+bool MemoryBudget::tryCharge(MemoryCategory category, uint64_t bytes)
+{
+    auto& s   = slot(category);
+    auto hard = s.hard.load(std::memory_order_relaxed);
+    auto used = s.used.load(std::memory_order_relaxed);
+    do
+    {
+        if (used > hard || bytes > hard - used)
+        {
+            s.refused->add();
+            return false;
+        }
+    } while (!s.used.compare_exchange_weak(used, used + bytes, std::memory_order_relaxed));
+    s.bytes->add(static_cast<int64_t>(bytes));
+    update(category, used + bytes);
+    return true;
+}
+
+void MemoryBudget::release(MemoryCategory category, uint64_t bytes)
+{
+    auto& s = slot(category);
+    s.bytes->add(-static_cast<int64_t>(bytes));
+    update(category, s.used.fetch_sub(bytes, std::memory_order_relaxed) - bytes);
+}
+
+MemoryBudget::Usage MemoryBudget::usage(MemoryCategory category) const
+{
+    const auto& s = slot(category);
+    Usage u;
+    u.used        = s.used.load(std::memory_order_relaxed);
+    u.peak        = s.peak.load(std::memory_order_relaxed);
+    u.refused     = s.refused->value();
+    u.limits.soft = s.soft.load(std::memory_order_relaxed);
+    u.limits.hard = s.hard.load(std::memory_order_relaxed);
+    u.pressure    = s.pressure.load(std::memory_order_relaxed);
+    return u;
+}
+
+void MemoryBudget::update(MemoryCategory category, uint64_t used)
+{
+    auto& s   = slot(category);
+    auto peak = s.peak.load(std::memory_order_relaxed);
+    while (used > peak && !s.peak.compare_exchange_weak(peak, used, std::memory_order_relaxed))
+    {}
+
+    // racing updates may leave a stale level for a moment; the next charge or release corrects it
+    auto level = used >= s.hard.load(std::memory_order_relaxed)   ? MemoryPressure::Hard
+                 : used >= s.soft.load(std::memory_order_relaxed) ? MemoryPressure::Soft
+                                                                   : MemoryPressure::None;
+    if (s.pressure.exchange(level, std::memory_order_relaxed) != level)
+    {
+        LOG_DEBUG(MemoryBudget, "Memory pressure changed", LOG_MD(Category, toString(category)),
+            LOG_MD(Level, static_cast<int>(level)), LOG_MD(Used, used));
+    }
+}
+
+MemoryCharge::MemoryCharge(MemoryBudget& budget, MemoryCategory category, uint64_t bytes)
+    : m_budget(&budget)
+    , m_category(category)
+{
+    resize(bytes);
+}
+
+MemoryCharge::~MemoryCharge()
+{
+    resize(0);
+}
+
+MemoryCharge::MemoryCharge(MemoryCharge&& other) noexcept
+    : m_budget(other.m_budget)
+    , m_category(other.m_category)
+    , m_bytes(std::exchange(other.m_bytes, 0))
+{}
+
+MemoryCharge& MemoryCharge::operator=(MemoryCharge&& other) noexcept
+{
+    if (this != &other)
+    {
+        resize(0);
+        m_budget   = other.m_budget;
+        m_category = other.m_category;
+        m_bytes    = std::exchange(other.m_bytes, 0);
+    }
+    return *this;
+}
+
+void MemoryCharge::resize(uint64_t bytes)
+{
+    if (!m_budget || bytes == m_bytes)
+    {
+        return;
+    }
+    if (bytes > m_bytes)
+    {
+        m_budget->charge(m_category, bytes - m_bytes);
+    }
+    else
+    {
+        m_budget->release(m_category, m_bytes - bytes);
+    }
+    m_bytes = bytes;
+}
+
+bool MemoryCharge::tryResize(uint64_t bytes)
+{
+    if (m_budget && bytes > m_bytes)
+    {
+        if (!m_budget->tryCharge(m_category, bytes - m_bytes))
+        {
+            return false;
+        }
+        m_bytes = bytes;
+        return true;
+    }
+    resize(bytes);
+    return true;
+}
+
+uint64_t footprint(const Metadata& meta)
+{
+    uint64_t bytes = sizeof(Metadata) + heapBytes(meta.announce) + heapBytes(meta.name) + heapBytes(meta.infoHash) +
+                     heapBytes(meta.infoHashV2);
+    bytes += meta.pieceHashes.capacity() * sizeof(std::string);
+    for (const auto& hash : meta.pieceHashes)
+    {
+        bytes += heapBytes(hash);
+    }
+    for (const auto& tier : meta.announceList)
+    {
+        bytes += sizeof(tier) + tier.capacity() * sizeof(std::string);
+        for (const auto& url : tier)
+        {
+            bytes += heapBytes(url);
+        }
+    }
+    bytes += meta.files.capacity() * sizeof(Metadata::FileEntry);
+    for (const auto& file : meta.files)
+    {
+        bytes += heapBytes(file.path) + heapBytes(file.piecesRoot);
+    }
+    for (const auto& [root, hashes] : meta.pieceLayers)
+    {
+        bytes += 4 * sizeof(void*) + 2 * sizeof(std::string) + heapBytes(root) + heapBytes(hashes);  // tree node
+    }
+    return bytes;
+}
+
+}  // namespace Torrent::Core
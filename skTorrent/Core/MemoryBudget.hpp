@@ -0,0 +1,150 @@
+#ifndef MEMORYBUDGET_HPP
+#define MEMORYBUDGET_HPP
+
+#include <Metrics/Metrics.hpp>
+#include <Utils/MetaUtils.hpp>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string_view>
+
+namespace Torrent::Core {
+
+enum class MemoryCategory : uint8_t
+{
+    Network,    // peer messages waiting to be written and receive buffers
+    Pieces,     // pieces being assembled from blocks
+    DiskWrite,  // verified pieces queued for the disk pool
+    ReadCache,  // pieces kept for serving uploads
+    Metadata,   // parsed torrents of every session
+    Count
+};
+
+constexpr size_t MemoryCategoryCount = static_cast<size_t>(MemoryCategory::Count);
+
+std::string_view toString(MemoryCategory category);
+
+enum class MemoryPressure : uint8_t
+{
+    None,
+    Soft,  // at or above the soft limit: stop growing
+    Hard   // at or above the hard limit: shed what can be shed
+};
+
+// Memory held for torrents and peers across every session, accounted by category against a soft and a hard limit.
+// The budget allocates nothing; the owners of the memory report it and look at pressure() where they decide to
+// take more:
+//  - a Swarm stops reading its sockets while Network is under hard pressure, shrinks its request pipelines under
+//    soft Pieces or DiskWrite pressure and starts no new piece under hard pressure;
+//  - its read cache shrinks under soft and empties under hard ReadCache pressure;
+//  - a session that would cross the hard Metadata limit fails to prepare.
+// charge() always succeeds, for memory that is already there, such as a block that arrived; tryCharge() refuses
+// what would cross the hard limit. Usage is exported as sktorrent_memory_bytes{category="..."}. Thread-safe and
+// lock-free.
+class MemoryBudget
+{
+public:
+    static constexpr uint64_t Unlimited = std::numeric_limits<uint64_t>::max();
+
+    struct Limits
+    {
+        uint64_t soft = Unlimited;
+        uint64_t hard = Unlimited;
+    };
+
+    struct Usage
+    {
+        uint64_t used    = 0;
+        uint64_t peak    = 0;
+        uint64_t refused = 0;  // tryCharge() calls turned down
+        Limits limits;
+        MemoryPressure pressure = MemoryPressure::None;
+    };
+
+    // Unlimited until configured; reports to the global metrics registry.
+    static MemoryBudget& global();
+
+    // Reports to metrics, the global registry when null.
+    explicit MemoryBudget(Metrics::Registry* metrics = nullptr);
+    MemoryBudget(const MemoryBudget&) = delete;
+
+    // soft is clamped to hard.
+    void setLimits(MemoryCategory category, Limits limits);
+
+    void charge(MemoryCategory category, uint64_t bytes);
+    bool tryCharge(MemoryCategory category, uint64_t bytes);
+    void release(MemoryCategory category, uint64_t bytes);
+
+    uint64_t used(MemoryCategory category) const
+    {
+        return slot(category).used.load(std::memory_order_relaxed);
+    }
+
+    MemoryPressure pressure(MemoryCategory category) const
+    {
+        return slot(category).pressure.load(std::memory_order_relaxed);
+    }
+
+    Usage usage(MemoryCategory category) const;
+
+private:
+    struct alignas(64) Slot
+    {
+        std::atomic<uint64_t> used{0};
+        std::atomic<uint64_t> peak{0};
+        std::atomic<uint64_t> soft{Unlimited};
+        std::atomic<uint64_t> hard{Unlimited};
+        std::atomic<MemoryPressure> pressure{MemoryPressure::None};
+        std::unique_ptr<Metrics::Registry> metrics;  // labelled with the category
+        Metrics::Gauge* bytes     = nullptr;
+        Metrics::Counter* refused = nullptr;
+    };
+
+    Slot& slot(MemoryCategory category)
+    {
+        return m_slots[static_cast<size_t>(category)];
+    }
+
+    const Slot& slot(MemoryCategory category) const
+    {
+        return m_slots[static_cast<size_t>(category)];
+    }
+
+    void update(MemoryCategory category, uint64_t used);
+
+    std::array<Slot, MemoryCategoryCount> m_slots;
+};
+
+// Bytes charged to one category for as long as it lives; move-only.
+class MemoryCharge
+{
+public:
+    MemoryCharge() = default;
+    MemoryCharge(MemoryBudget& budget, MemoryCategory category, uint64_t bytes = 0);
+    ~MemoryCharge();
+    MemoryCharge(MemoryCharge&& other) noexcept;
+    MemoryCharge& operator=(MemoryCharge&& other) noexcept;
+
+    uint64_t bytes() const
+    {
+        return m_bytes;
+    }
+
+    void resize(uint64_t bytes);
+    // Like resize(), but growing past the hard limit fails and leaves the charge as it was.
+    bool tryResize(uint64_t bytes);
+
+private:
+    MemoryBudget* m_budget    = nullptr;
+    MemoryCategory m_category = MemoryCategory::Network;
+    uint64_t m_bytes          = 0;
+};
+
+// Rough heap footprint of parsed metadata, for the Metadata category.
+uint64_t footprint(const Metadata& meta);
+
+}  // namespace Torrent::Core
+#endif  // MEMORYBUDGET_HPP
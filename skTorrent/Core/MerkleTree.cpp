@@ -0,0 +1,524 @@
+#include "MerkleTree.hpp"
+
+#include <Async/Executor.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <condition_variable>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <openssl/sha.h>
+#include <stdexcept>
+
+namespace Torrent::Core {
+
+namespace {
+constexpr size_t BlocksPerJob = 64;  // 1 MiB of data per executor job
+
+// Runs fn over [0, count) in chunks. The caller works through chunks too, so this cannot deadlock when called
+// from a worker of the same executor; jobs that start after everything is claimed return at once.
+void parallelFor(size_t count, Async::Executor* executor, const std::function<void(size_t)>& fn)
+{
+    size_t chunks = (count + BlocksPerJob - 1) / BlocksPerJob;
+    if (!executor || chunks <= 1)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            fn(i);
+        }
+        return;
+    }
+
+    struct Shared
+    {
+        std::atomic<size_t> next{0};
+        std::atomic<size_t> done{0};
+        std::mutex mutex;
+        std::condition_variable finished;
+    };
+    auto shared = std::make_shared<Shared>();
+
+    auto work = [shared, chunks, count, fn = &fn]
+    {
+        for (size_t chunk = shared->next++; chunk < chunks; chunk = shared->next++)
+        {
+            size_t end = std::min(count, (chunk + 1) * BlocksPerJob);
+            for (size_t i = chunk * BlocksPerJob; i < end; ++i)
+            {
+                (*fn)(i);
+            }
+            if (++shared->done == chunks)
+            {
+                std::scoped_lock lk(shared->mutex);
+                shared->finished.notify_all();
+            }
+        }
+    };
+
+    for (size_t i = 1; i < std::min(chunks, executor->size() + 1); ++i)
+    {
+        executor->post(work);
+    }
+    work();
+
+    std::unique_lock lk(shared->mutex);
+    shared->finished.wait(lk, [&] { return shared->done == chunks; });
+}
+
+void checkPieceLength(uint64_t pieceLength)
+{
+    if (pieceLength < Merkle::BlockSize || !std::has_single_bit(pieceLength))
+    {
+        throw std::runtime_error("Invalid v2 piece length");
+    }
+}
+
+unsigned heightFor(uint64_t leaves)
+{
+    return static_cast<unsigned>(std::bit_width(std::bit_ceil(leaves)) - 1);
+}
+}  // namespace
+
+namespace Merkle {
+
+Hash sha256(std::span<const uint8_t> data)
+{
+    Hash out;
+    SHA256(data.data(), data.size(), out.data());
+    return out;
+}
+
+Hash combine(const Hash& left, const Hash& right)
+{
+    std::array<uint8_t, 64> both;
+    std::memcpy(both.data(), left.data(), 32);
+    std::memcpy(both.data() + 32, right.data(), 32);
+    return sha256(both);
+}
+
+const Hash& padHash(unsigned height)
+{
+    static const auto pads = []
+    {
+        std::array<Hash, 64> p{};
+        for (size_t h = 1; h < p.size(); ++h)
+        {
+            p[h] = combine(p[h - 1], p[h - 1]);
+        }
+        return p;
+    }();
+    return pads.at(height);
+}
+
+Hash fromString(std::string_view raw)
+{
+    if (raw.size() != sizeof(Hash))
+    {
+        throw std::runtime_error("SHA-256 hash must be 32 bytes");
+    }
+    Hash out;
+    std::memcpy(out.data(), raw.data(), out.size());
+    return out;
+}
+
+Hash reduce(std::vector<Hash> layer, unsigned height, unsigned levels)
+{
+    if (layer.empty())
+    {
+        layer.push_back(padHash(height));
+    }
+    for (; levels > 0; --levels, ++height)
+    {
+        if (layer.size() % 2 != 0)
+        {
+            layer.push_back(padHash(height));
+        }
+        for (size_t i = 0; i < layer.size() / 2; ++i)
+        {
+            layer[i] = combine(layer[2 * i], layer[2 * i + 1]);
+        }
+        layer.resize(layer.size() / 2);
+    }
+    if (layer.size() != 1)
+    {
+        throw std::runtime_error("Merkle layer wider than the tree");
+    }
+    return layer.front();
+}
+
+std::vector<Hash> hashBlocks(std::span<const uint8_t> data, Async::Executor* executor)
+{
+    std::vector<Hash> leaves((data.size() + BlockSize - 1) / BlockSize);
+    parallelFor(leaves.size(), executor,
+        [&](size_t i)
+        {
+            size_t offset = i * BlockSize;
+            leaves[i]     = sha256(data.subspan(offset, std::min<size_t>(BlockSize, data.size() - offset)));
+        });
+    return leaves;
+}
+
+FileHashes hashFile(std::span<const uint8_t> data, uint64_t pieceLength, Async::Executor* executor)
+{
+    if (data.empty())
+    {
+        throw std::runtime_error("Empty files have no hash tree");
+    }
+    checkPieceLength(pieceLength);
+
+    auto leaves        = hashBlocks(data, executor);
+    unsigned height    = heightFor(leaves.size());
+    unsigned perPiece  = static_cast<unsigned>(std::countr_zero(pieceLength / BlockSize));
+    size_t pieceBlocks = size_t{1} << perPiece;
+    if (data.size() <= pieceLength)
+    {
+        return {reduce(std::move(leaves), 0, height), {}};
+    }
+
+    FileHashes out;
+    out.pieceLayer.resize((leaves.size() + pieceBlocks - 1) / pieceBlocks);
+    parallelFor(out.pieceLayer.size(), executor,
+        [&](size_t i)
+        {
+            auto first        = leaves.begin() + static_cast<ptrdiff_t>(i * pieceBlocks);
+            auto last         = leaves.begin() + static_cast<ptrdiff_t>(std::min(leaves.size(), (i + 1) * pieceBlocks));
+            out.pieceLayer[i] = reduce({first, last}, 0, perPiece);
+        });
+    out.root = reduce(out.pieceLayer, perPiece, height - perPiece);
+    return out;
+}
+}  // namespace Merkle
+
+MerkleTree::MerkleTree(uint64_t fileSize, uint64_t pieceLength, const Merkle::Hash& root)
+    : m_root(root)
+{
+    if (fileSize == 0)
+    {
+        throw std::runtime_error("Empty files have no hash tree");
+    }
+    checkPieceLength(pieceLength);
+
+    m_blocks      = static_cast<uint32_t>((fileSize + Merkle::BlockSize - 1) / Merkle::BlockSize);
+    m_treeHeight  = heightFor(m_blocks);
+    m_pieceHeight = std::min(static_cast<unsigned>(std::countr_zero(pieceLength / Merkle::BlockSize)), m_treeHeight);
+    m_pieces      = (m_blocks + blocksPerPiece() - 1) / blocksPerPiece();
+
+    size_t width = size_t{1} << (m_treeHeight - m_pieceHeight);
+    m_layer.assign(width, Merkle::padHash(m_pieceHeight));
+    m_layerKnown.assign(width, false);
+    std::fill(m_layerKnown.begin() + m_pieces, m_layerKnown.end(), true);
+    if (width == 1)
+    {
+        m_layer[0]      = root;
+        m_layerKnown[0] = true;
+        m_layerComplete = true;
+    }
+
+    m_blockVerified.assign(m_blocks, false);
+    m_pieceVerified.assign(m_pieces, false);
+}
+
+bool MerkleTree::setPieceLayer(std::span<const Merkle::Hash> layer)
+{
+    if (layer.size() != m_pieces)
+    {
+        return false;
+    }
+    if (m_layerComplete)
+    {
+        return std::equal(layer.begin(), layer.end(), m_layer.begin());
+    }
+    if (Merkle::reduce({layer.begin(), layer.end()}, m_pieceHeight, m_treeHeight - m_pieceHeight) != m_root)
+    {
+        return false;
+    }
+
+    std::copy(layer.begin(), layer.end(), m_layer.begin());
+    std::fill(m_layerKnown.begin(), m_layerKnown.end(), true);
+    m_layerComplete = true;
+
+    // pieces that were fully downloaded while waiting for the layer can be checked now
+    std::vector<uint32_t> waiting;
+    for (auto& [piece, sub] : m_subtrees)
+    {
+        sub.nodes[0] = m_layer[piece];
+        sub.state[0] = Trusted;
+        waiting.push_back(piece);
+    }
+    for (auto piece : waiting)
+    {
+        settle(piece, m_subtrees.at(piece), 0);
+        finishIfComplete(piece);
+    }
+    return true;
+}
+
+uint32_t MerkleTree::blocksIn(uint32_t piece) const
+{
+    return std::min(blocksPerPiece(), m_blocks - piece * blocksPerPiece());
+}
+
+MerkleTree::Subtree& MerkleTree::subtree(uint32_t piece)
+{
+    auto [it, inserted] = m_subtrees.try_emplace(piece);
+    auto& sub           = it->second;
+    if (inserted)
+    {
+        uint32_t width = blocksPerPiece();
+        sub.nodes.assign(2 * width - 1, Merkle::Hash{});
+        sub.state.assign(2 * width - 1, Empty);
+
+        // leaves past the end of the file are zero, and so is known every node above nothing but padding
+        for (uint32_t k = blocksIn(piece); k < width; ++k)
+        {
+            sub.state[width - 1 + k] = Trusted;
+        }
+        for (uint32_t n = width - 1; n-- > 0;)
+        {
+            if (sub.state[2 * n + 1] == Trusted && sub.state[2 * n + 2] == Trusted)
+            {
+                sub.nodes[n] = Merkle::combine(sub.nodes[2 * n + 1], sub.nodes[2 * n + 2]);
+                sub.state[n] = Trusted;
+            }
+        }
+    }
+    if (m_layerKnown[piece] && sub.state[0] != Trusted)
+    {
+        sub.nodes[0] = m_layer[piece];
+        sub.state[0] = Trusted;
+    }
+    return sub;
+}
+
+MerkleTree::Status MerkleTree::anchorPiece(uint32_t piece, const Merkle::Hash& node, std::span<const Merkle::Hash> proof)
+{
+    // only the piece layer is cached above the pieces, so the climb has to reach the root
+    Merkle::Hash hash = node;
+    Merkle::Hash firstUncle{};
+    bool uncleFromProof = false;
+    auto next           = proof.begin();
+    uint32_t j          = piece;
+    for (unsigned height = m_pieceHeight; height < m_treeHeight; ++height, j /= 2)
+    {
+        uint32_t sibling = j ^ 1;
+        Merkle::Hash uncle;
+        if ((static_cast<uint64_t>(sibling) << (height - m_pieceHeight)) >= m_pieces)
+        {
+            uncle = Merkle::padHash(height);
+        }
+        else if (height == m_pieceHeight && m_layerKnown[sibling])
+        {
+            uncle = m_layer[sibling];
+        }
+        else if (next != proof.end())
+        {
+            uncle          = *next++;
+            uncleFromProof = uncleFromProof || height == m_pieceHeight;
+        }
+        else
+        {
+            return Status::Pending;
+        }
+        if (height == m_pieceHeight)
+        {
+            firstUncle = uncle;
+        }
+        hash = (j & 1) ? Merkle::combine(uncle, hash) : Merkle::combine(hash, uncle);
+    }
+    if (hash != m_root)
+    {
+        return Status::Failed;
+    }
+
+    m_layer[piece]      = node;
+    m_layerKnown[piece] = true;
+    if (uncleFromProof)
+    {
+        m_layer[piece ^ 1]      = firstUncle;
+        m_layerKnown[piece ^ 1] = true;
+    }
+    m_layerComplete = std::all_of(m_layerKnown.begin(), m_layerKnown.end(), [](bool known) { return known; });
+    return Status::Verified;
+}
+
+MerkleTree::Status MerkleTree::addBlock(uint32_t block, const Merkle::Hash& leaf, std::span<const Merkle::Hash> proof)
+{
+    if (block >= m_blocks)
+    {
+        throw std::runtime_error("Block index out of range");
+    }
+    if (m_blockVerified[block])
+    {
+        return Status::Verified;
+    }
+
+    uint32_t piece     = block >> m_pieceHeight;
+    uint32_t firstLeaf = blocksPerPiece() - 1;
+    uint32_t leafIndex = firstLeaf + (block & firstLeaf);
+    auto& sub          = subtree(piece);
+
+    // climb to the nearest trusted node, taking uncles from the cache first and from the proof second
+    std::vector<std::pair<uint32_t, Merkle::Hash>> learned;
+    std::vector<uint32_t> proven;
+    Merkle::Hash hash = leaf;
+    uint32_t i        = leafIndex;
+    auto next         = proof.begin();
+    auto status       = Status::Pending;
+    while (true)
+    {
+        if (sub.state[i] == Trusted)
+        {
+            status = sub.nodes[i] == hash ? Status::Verified : Status::Failed;
+            break;
+        }
+        learned.emplace_back(i, hash);
+        if (i == 0)
+        {
+            status = anchorPiece(piece, hash, {next, proof.end()});
+            break;
+        }
+        uint32_t sibling = (i & 1) ? i + 1 : i - 1;
+        Merkle::Hash uncle;
+        if (sub.state[sibling] == Trusted)
+        {
+            uncle = sub.nodes[sibling];
+        }
+        else if (next != proof.end())
+        {
+            uncle = *next++;
+            learned.emplace_back(sibling, uncle);
+            proven.push_back(sibling);
+        }
+        else
+        {
+            break;
+        }
+        hash = (i & 1) ? Merkle::combine(hash, uncle) : Merkle::combine(uncle, hash);
+        i    = (i - 1) / 2;
+    }
+
+    if (status == Status::Failed)
+    {
+        return Status::Failed;
+    }
+
+    if (status == Status::Pending)
+    {
+        // the block waits for the rest of the subtree below its nearest trusted ancestor
+        sub.nodes[leafIndex] = leaf;
+        sub.state[leafIndex] = Received;
+        for (i = leafIndex; i != 0 && sub.state[i] != Trusted; i = (i - 1) / 2)
+        {
+        }
+        if (sub.state[i] == Trusted)
+        {
+            settle(piece, sub, i);
+        }
+        if (m_blockVerified[block])
+        {
+            status = Status::Verified;
+        }
+        else if (sub.state[leafIndex] == Empty)
+        {
+            status = Status::Failed;
+        }
+    }
+    else
+    {
+        m_blockVerified[block] = true;
+        for (auto& [node, value] : learned)
+        {
+            // a block downloaded earlier is good exactly when the proof vouches for its hash
+            if (node != leafIndex && node >= firstLeaf && sub.state[node] == Received && sub.nodes[node] == value)
+            {
+                m_blockVerified[piece * blocksPerPiece() + (node - firstLeaf)] = true;
+            }
+            sub.nodes[node] = value;
+            sub.state[node] = Trusted;
+        }
+        // unproven blocks below a newly trusted uncle may complete its subtree
+        for (auto node : proven)
+        {
+            if (node < firstLeaf)
+            {
+                settle(piece, sub, node);
+            }
+        }
+    }
+
+    finishIfComplete(piece);
+    return status;
+}
+
+void MerkleTree::settle(uint32_t piece, Subtree& sub, uint32_t top)
+{
+    uint32_t width     = blocksPerPiece();
+    uint32_t firstLeaf = width - 1;
+    unsigned levels    = m_pieceHeight - static_cast<unsigned>(std::bit_width(top + 1) - 1);
+    uint32_t leaves    = 1u << levels;
+    uint32_t leftmost  = ((top + 1) << levels) - 1;
+    uint32_t base      = piece * width - firstLeaf;  // block index of a leaf node
+
+    // a trusted leaf whose block never arrived, or was wrong, is still missing
+    uint32_t end = std::min(leftmost + leaves, firstLeaf + blocksIn(piece));
+    for (uint32_t n = leftmost; n < end; ++n)
+    {
+        if (!m_blockVerified[base + n] && sub.state[n] != Received)
+        {
+            return;
+        }
+    }
+
+    // recompute the subtree level by level; every trusted node that matches vouches for the leaves below it
+    m_scratch.resize(sub.nodes.size());
+    std::copy(sub.nodes.begin() + leftmost, sub.nodes.begin() + leftmost + leaves, m_scratch.begin() + leftmost);
+    for (unsigned level = levels; level-- > 0;)
+    {
+        uint32_t first = ((top + 1) << level) - 1;
+        for (uint32_t n = first; n < first + (1u << level); ++n)
+        {
+            m_scratch[n] = Merkle::combine(m_scratch[2 * n + 1], m_scratch[2 * n + 2]);
+        }
+    }
+    for (unsigned level = 0; level <= levels; ++level)
+    {
+        uint32_t first = ((top + 1) << level) - 1;
+        for (uint32_t n = first; n < first + (1u << level); ++n)
+        {
+            if (sub.state[n] != Trusted || m_scratch[n] != sub.nodes[n])
+            {
+                continue;
+            }
+            unsigned below = levels - level;
+            uint32_t from  = ((n + 1) << below) - 1;
+            for (uint32_t leaf = from; leaf < std::min(from + (1u << below), end); ++leaf)
+            {
+                m_blockVerified[base + leaf] = true;
+                sub.state[leaf]              = Trusted;
+            }
+        }
+    }
+
+    for (uint32_t n = leftmost; n < end; ++n)
+    {
+        if (!m_blockVerified[base + n])
+        {
+            sub.state[n] = Empty;
+        }
+    }
+}
+
+void MerkleTree::finishIfComplete(uint32_t piece)
+{
+    auto first = m_blockVerified.begin() + static_cast<ptrdiff_t>(piece) * blocksPerPiece();
+    if (std::all_of(first, first + blocksIn(piece), [](bool verified) { return verified; }))
+    {
+        m_pieceVerified[piece] = true;
+        m_subtrees.erase(piece);
+    }
+}
+
+}  // namespace Torrent::Core
@@ -0,0 +1,144 @@
+#ifndef MERKLETREE_HPP
+#define MERKLETREE_HPP
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace Torrent::Async {
+class Executor;
+}
+
+namespace Torrent::Core {
+
+// BEP 52 hash trees: every file has its own SHA-256 tree over 16 KiB blocks, padded to a power of two with
+// zero leaves.
+namespace Merkle {
+using Hash = std::array<uint8_t, 32>;
+
+constexpr uint32_t BlockSize = 16'384;
+
+Hash sha256(std::span<const uint8_t> data);
+Hash combine(const Hash& left, const Hash& right);
+// Root of a subtree of the given height that lies entirely past the end of the file.
+const Hash& padHash(unsigned height);
+// Throws unless raw is exactly 32 bytes.
+Hash fromString(std::string_view raw);
+// Hashes a layer at `height` up `levels` times; a missing right sibling is padding.
+Hash reduce(std::vector<Hash> layer, unsigned height, unsigned levels);
+
+// SHA-256 of every block; spread over the executor's workers when one is given.
+std::vector<Hash> hashBlocks(std::span<const uint8_t> data, Async::Executor* executor = nullptr);
+
+struct FileHashes
+{
+    Hash root{};
+    std::vector<Hash> pieceLayer;  // empty when the file fits in one piece, as in "piece layers"
+};
+
+FileHashes hashFile(std::span<const uint8_t> data, uint64_t pieceLength, Async::Executor* executor = nullptr);
+}  // namespace Merkle
+
+// Incremental verification of one file. Blocks arriving with an uncle-hash proof are verified on their own
+// against the nearest trusted node; blocks without one wait until their whole piece is in. Trusted nodes of
+// unfinished pieces are cached so later blocks of the same piece need shorter proofs or none at all, and the
+// cache is dropped once a piece verifies. Not thread-safe.
+class MerkleTree
+{
+public:
+    enum class Status
+    {
+        Pending,
+        Verified,
+        Failed
+    };
+
+    // pieceLength must be a power of two of at least one block.
+    MerkleTree(uint64_t fileSize, uint64_t pieceLength, const Merkle::Hash& root);
+
+    // Piece layer from "piece layers" or a hash reply; kept only if it hashes up to the root.
+    bool setPieceLayer(std::span<const Merkle::Hash> layer);
+
+    bool hasPieceLayer() const
+    {
+        return m_layerComplete;
+    }
+
+    // leaf is the block's SHA-256. proof holds uncle hashes from the leaf upwards and may stop early or be
+    // empty. A failed block, and any unverified block of its piece proven wrong with it, must be fetched again;
+    // blockVerified() tells which.
+    Status addBlock(uint32_t block, const Merkle::Hash& leaf, std::span<const Merkle::Hash> proof = {});
+
+    bool blockVerified(uint32_t block) const
+    {
+        return m_blockVerified[block];
+    }
+
+    bool pieceVerified(uint32_t piece) const
+    {
+        return m_pieceVerified[piece];
+    }
+
+    uint32_t blockCount() const
+    {
+        return m_blocks;
+    }
+
+    uint32_t pieceCount() const
+    {
+        return m_pieces;
+    }
+
+    uint32_t blocksPerPiece() const
+    {
+        return 1u << m_pieceHeight;
+    }
+
+    size_t cachedPieces() const
+    {
+        return m_subtrees.size();
+    }
+
+private:
+    enum NodeState : uint8_t
+    {
+        Empty,
+        Received,  // leaf we downloaded but could not check yet
+        Trusted
+    };
+
+    // Heap-ordered tree below one piece-layer node; node 0 is the piece node itself.
+    struct Subtree
+    {
+        std::vector<Merkle::Hash> nodes;
+        std::vector<NodeState> state;
+    };
+
+    Subtree& subtree(uint32_t piece);
+    Status anchorPiece(uint32_t piece, const Merkle::Hash& node, std::span<const Merkle::Hash> proof);
+    // Checks the received blocks below a trusted node once all of them are in; bad ones become Empty again.
+    void settle(uint32_t piece, Subtree& sub, uint32_t top);
+    void finishIfComplete(uint32_t piece);
+    uint32_t blocksIn(uint32_t piece) const;
+
+    Merkle::Hash m_root;
+    uint32_t m_blocks;
+    uint32_t m_pieces;
+    unsigned m_treeHeight;
+    unsigned m_pieceHeight;
+
+    std::vector<Merkle::Hash> m_layer;  // piece layer, padded to a power of two
+    std::vector<bool> m_layerKnown;
+    bool m_layerComplete = false;
+
+    std::unordered_map<uint32_t, Subtree> m_subtrees;
+    std::vector<bool> m_blockVerified;
+    std::vector<bool> m_pieceVerified;
+    std::vector<Merkle::Hash> m_scratch;
+};
+
+}  // namespace Torrent::Core
+#endif  // MERKLETREE_HPP
@@ -0,0 +1,232 @@
+#include "MetadataExchange.hpp"
+#include "PeerWire.hpp"
+
+#include <Async/IoAwaitables.hpp>
+#include <Net/TcpStream.hpp>
+
+#include <Logger.hpp>
+
+#include <array>
+#include <stdexcept>
+
+namespace Torrent::Core {
+
+namespace {
+std::span<const uint8_t> bytes(const std::string& s)
+{
+    return {reinterpret_cast<const uint8_t*>(s.data()), s.size()};
+}
+}  // namespace
+
+MetadataExchange::MetadataExchange(
+    Net::EventLoop& loop, Async::Executor& executor, std::string infoHash, std::string peerId)
+    : MetadataExchange(loop, executor, std::move(infoHash), std::move(peerId), Options{})
+{}
+
+MetadataExchange::MetadataExchange(
+    Net::EventLoop& loop, Async::Executor& executor, std::string infoHash, std::string peerId, Options options)
+    : m_loop(loop)
+    , m_executor(executor)
+    , m_infoHash(infoHash)
+    , m_peerId(std::move(peerId))
+    , m_options(options)
+    , m_fetcher(std::move(infoHash))
+{}
+
+Async::Task<std::string> MetadataExchange::run(std::vector<Net::Endpoint> peers)
+{
+    co_await Async::resumeOn(m_loop);
+    m_candidates    = std::move(peers);
+    m_nextCandidate = 0;
+
+    size_t workers = std::min(m_options.maxPeers, m_candidates.size());
+    Async::WaitGroup group;
+    group.add(workers);
+    for (size_t i = 0; i < workers; ++i)
+    {
+        m_executor.spawn(worker(group));
+    }
+    co_await group.wait();
+
+    if (m_cancelled && !m_fetcher.complete())
+    {
+        throw std::runtime_error("Metadata fetch cancelled");
+    }
+    if (!m_fetcher.complete())
+    {
+        throw std::runtime_error("Failed to fetch metadata from peers");
+    }
+    LOG_INFO(MetadataExchange, "Metadata fetched", LOG_MD(Size, m_fetcher.size()), LOG_MD(Pieces, m_fetcher.pieceCount()));
+    co_return m_fetcher.info();
+}
+
+Async::Task<void> MetadataExchange::worker(Async::WaitGroup& group)
+{
+    co_await Async::resumeOn(m_loop);
+    while (!m_cancelled && !m_fetcher.complete() && !m_fetcher.failed() && m_nextCandidate < m_candidates.size())
+    {
+        auto peer = m_candidates[m_nextCandidate++];
+        try
+        {
+            co_await fetchFrom(peer);
+        }
+        catch (const std::exception& e)
+        {
+            LOG_DEBUG(MetadataExchange, "Peer dropped", LOG_MD(Peer, peer.toString()), LOG_MD(Error, e.what()));
+        }
+    }
+    group.done();
+}
+
+Async::Task<void> MetadataExchange::fetchFrom(const Net::Endpoint& peer)
+{
+    auto stream = m_options.streamFactory ? m_options.streamFactory() : std::make_unique<Net::TcpStream>(m_loop);
+    // close() also aborts a connect still in progress, so one timer covers every phase
+    auto timer = m_loop.runAfter(m_options.peerTimeout, [raw = stream.get()] { raw->close(); });
+    m_active.insert(stream.get());
+
+    std::vector<uint32_t> outstanding;
+    std::exception_ptr error;
+    try
+    {
+        co_await talk(*stream, peer, outstanding);
+    }
+    catch (...)
+    {
+        error = std::current_exception();
+    }
+
+    for (uint32_t piece : outstanding)
+    {
+        m_fetcher.release(piece);
+    }
+    m_loop.cancel(timer);
+    m_active.erase(stream.get());
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+}
+
+Async::Task<void> MetadataExchange::talk(Net::Stream& stream, const Net::Endpoint& peer, std::vector<uint32_t>& outstanding)
+{
+    co_await stream.connect(peer);
+    co_await send(stream, PeerWire::encodeHandshake(m_infoHash, m_peerId));
+
+    std::array<uint8_t, PeerWire::HandshakeSize> reply;
+    co_await Net::readExactly(stream, reply);
+    auto handshake = PeerWire::decodeHandshake({reinterpret_cast<const char*>(reply.data()), reply.size()});
+    if (!handshake || handshake->infoHash != m_infoHash)
+    {
+        throw std::runtime_error("Handshake mismatch");
+    }
+    if (!handshake->extensions)
+    {
+        throw std::runtime_error("Peer does not support the extension protocol");
+    }
+    co_await send(stream, PeerWire::encodeExtended(0, PeerWire::encodeExtendedHandshake(LocalUtMetadataId)));
+
+    uint8_t remoteId     = 0;
+    int64_t metadataSize = 0;
+    std::string message;
+    while (!m_fetcher.complete() && !m_fetcher.failed())
+    {
+        co_await readMessage(stream, message);
+        if (message.size() < 2 || static_cast<PeerWire::MessageId>(message[0]) != PeerWire::MessageId::Extended)
+        {
+            continue;
+        }
+
+        auto payload = std::string_view(message).substr(2);
+        if (message[1] == 0)
+        {
+            auto ext = PeerWire::decodeExtendedHandshake(payload);
+            if (ext.utMetadata == 0)
+            {
+                throw std::runtime_error("Peer does not support ut_metadata");
+            }
+            remoteId     = ext.utMetadata;
+            metadataSize = ext.metadataSize;
+        }
+        else if (message[1] == LocalUtMetadataId)
+        {
+            auto msg = PeerWire::decodeMetadataMessage(payload);
+            switch (msg.type)
+            {
+                case PeerWire::MetadataMessage::Request:
+                    co_await send(stream, PeerWire::encodeExtended(remoteId, PeerWire::encodeMetadataReject(msg.piece)));
+                    break;
+                case PeerWire::MetadataMessage::Reject: throw std::runtime_error("Peer rejected metadata request");
+                case PeerWire::MetadataMessage::Data:
+                    std::erase(outstanding, msg.piece);
+                    if (m_fetcher.onData(msg.piece, msg.data))
+                    {
+                        interruptOthers(&stream);
+                        co_return;
+                    }
+                    break;
+            }
+        }
+
+        if (remoteId == 0)
+        {
+            continue;
+        }
+        // a failed hash check resets the fetcher, size included
+        if (m_fetcher.size() == 0 && !m_fetcher.setSize(metadataSize))
+        {
+            throw std::runtime_error("Peer advertised an unusable metadata size");
+        }
+        if (m_fetcher.size() != metadataSize)
+        {
+            throw std::runtime_error("Peer disagrees on metadata size");
+        }
+        while (outstanding.size() < m_options.pipelineDepth)
+        {
+            auto piece = m_fetcher.nextPiece(outstanding);
+            if (!piece)
+            {
+                break;
+            }
+            outstanding.push_back(*piece);
+            co_await send(stream, PeerWire::encodeExtended(remoteId, PeerWire::encodeMetadataRequest(*piece)));
+        }
+    }
+}
+
+Async::Task<void> MetadataExchange::send(Net::Stream& stream, const std::string& data)
+{
+    co_await stream.write(bytes(data));
+}
+
+Async::Task<void> MetadataExchange::readMessage(Net::Stream& stream, std::string& message)
+{
+    std::array<uint8_t, 4> header;
+    co_await Net::readExactly(stream, header);
+    uint32_t len = (uint32_t(header[0]) << 24) | (uint32_t(header[1]) << 16) | (uint32_t(header[2]) << 8) | header[3];
+    if (len > PeerWire::MaxMessageSize)
+    {
+        throw std::runtime_error("Peer message too large");
+    }
+    message.resize(len);
+    co_await Net::readExactly(stream, {reinterpret_cast<uint8_t*>(message.data()), message.size()});
+}
+
+void MetadataExchange::cancel()
+{
+    m_cancelled = true;
+    interruptOthers(nullptr);
+}
+
+void MetadataExchange::interruptOthers(Net::Stream* self)
+{
+    for (auto* stream : m_active)
+    {
+        if (stream != self)
+        {
+            stream->close();
+        }
+    }
+}
+
+}  // namespace Torrent::Core
@@ -0,0 +1,70 @@
+#ifndef METADATAEXCHANGE_HPP
+#define METADATAEXCHANGE_HPP
+
+#include "MetadataFetcher.hpp"
+
+#include <Async/Executor.hpp>
+#include <Async/WaitGroup.hpp>
+#include <Net/Endpoint.hpp>
+#include <Net/EventLoop.hpp>
+#include <Net/Stream.hpp>
+
+#include <chrono>
+#include <unordered_set>
+#include <vector>
+
+namespace Torrent::Core {
+
+// Downloads the info dictionary for a magnet link (BEP 9 over BEP 10). Up to maxPeers connections run at once,
+// each pulling the next candidate when its peer fails; every connection lives on the given loop thread.
+class MetadataExchange
+{
+public:
+    struct Options
+    {
+        size_t maxPeers      = 8;
+        size_t pipelineDepth = 4;
+        std::chrono::milliseconds peerTimeout{20'000};
+        Net::StreamFactory streamFactory;  // TCP when empty
+    };
+
+    MetadataExchange(Net::EventLoop& loop, Async::Executor& executor, std::string infoHash, std::string peerId);
+    MetadataExchange(Net::EventLoop& loop, Async::Executor& executor, std::string infoHash, std::string peerId,
+        Options options);
+
+    // Returns the verified raw info dictionary; throws std::runtime_error when no peer delivered it.
+    Async::Task<std::string> run(std::vector<Net::Endpoint> peers);
+    // Drops every connection and makes run() throw once they are gone. Loop thread only.
+    void cancel();
+
+    const MetadataFetcher& fetcher() const
+    {
+        return m_fetcher;
+    }
+
+private:
+    static constexpr uint8_t LocalUtMetadataId = 1;
+
+    Async::Task<void> worker(Async::WaitGroup& group);
+    Async::Task<void> fetchFrom(const Net::Endpoint& peer);
+    Async::Task<void> talk(Net::Stream& stream, const Net::Endpoint& peer, std::vector<uint32_t>& outstanding);
+    Async::Task<void> send(Net::Stream& stream, const std::string& data);
+    Async::Task<void> readMessage(Net::Stream& stream, std::string& message);
+    void interruptOthers(Net::Stream* self);
+
+    Net::EventLoop& m_loop;
+    Async::Executor& m_executor;
+    std::string m_infoHash;
+    std::string m_peerId;
+    Options m_options;
+
+    // loop thread only
+    MetadataFetcher m_fetcher;
+    std::vector<Net::Endpoint> m_candidates;
+    size_t m_nextCandidate = 0;
+    std::unordered_set<Net::Stream*> m_active;
+    bool m_cancelled = false;
+};
+
+}  // namespace Torrent::Core
+#endif  // METADATAEXCHANGE_HPP
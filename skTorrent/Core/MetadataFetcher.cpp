@@ -0,0 +1,120 @@
+#include "MetadataFetcher.hpp"
+#include "PeerWire.hpp"
+
+#include <Utils/MetaUtils.hpp>
+
+#include <Logger.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace Torrent::Core {
+
+MetadataFetcher::MetadataFetcher(std::string infoHash)
+    : m_infoHash(std::move(infoHash))
+{}
+
+bool MetadataFetcher::setSize(int64_t size)
+{
+    if (size <= 0 || size > static_cast<int64_t>(PeerWire::MaxMetadataSize))
+    {
+        return false;
+    }
+    if (!m_buffer.empty())
+    {
+        return size == this->size();
+    }
+
+    size_t pieces = (static_cast<size_t>(size) + PeerWire::MetadataPieceSize - 1) / PeerWire::MetadataPieceSize;
+    m_buffer.assign(static_cast<size_t>(size), '\0');
+    m_received.assign(pieces, false);
+    m_inFlight.assign(pieces, 0);
+    m_receivedCount = 0;
+    return true;
+}
+
+std::optional<uint32_t> MetadataFetcher::nextPiece(std::span<const uint32_t> outstanding)
+{
+    if (m_complete || m_buffer.empty())
+    {
+        return std::nullopt;
+    }
+
+    std::optional<uint32_t> best;
+    for (uint32_t i = 0; i < m_received.size(); ++i)
+    {
+        if (m_received[i] || std::find(outstanding.begin(), outstanding.end(), i) != outstanding.end())
+        {
+            continue;
+        }
+        if (!best || m_inFlight[i] < m_inFlight[*best])
+        {
+            best = i;
+            if (m_inFlight[i] == 0)
+            {
+                break;
+            }
+        }
+    }
+    if (best)
+    {
+        ++m_inFlight[*best];
+    }
+    return best;
+}
+
+void MetadataFetcher::release(uint32_t piece)
+{
+    if (piece < m_inFlight.size() && m_inFlight[piece] > 0)
+    {
+        --m_inFlight[piece];
+    }
+}
+
+bool MetadataFetcher::onData(uint32_t piece, std::string_view data)
+{
+    if (m_complete || piece >= m_received.size())
+    {
+        return false;
+    }
+    release(piece);
+
+    size_t offset   = piece * PeerWire::MetadataPieceSize;
+    size_t expected = std::min(PeerWire::MetadataPieceSize, m_buffer.size() - offset);
+    if (data.size() != expected)
+    {
+        throw std::runtime_error("Metadata piece has wrong size");
+    }
+    if (m_received[piece])
+    {
+        return false;
+    }
+
+    std::memcpy(m_buffer.data() + offset, data.data(), data.size());
+    m_received[piece] = true;
+    if (++m_receivedCount < m_received.size())
+    {
+        return false;
+    }
+
+    if (Utils::computeInfoHash(m_buffer) != m_infoHash)
+    {
+        ++m_hashFailures;
+        LOG_WARNING(MetadataFetcher, "Metadata does not match info hash", LOG_MD(Failures, m_hashFailures));
+        reset();
+        return false;
+    }
+    m_complete = true;
+    return true;
+}
+
+void MetadataFetcher::reset()
+{
+    m_buffer.clear();
+    m_received.clear();
+    m_inFlight.clear();
+    m_receivedCount = 0;
+}
+
+}  // namespace Torrent::Core
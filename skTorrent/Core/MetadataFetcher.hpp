@@ -0,0 +1,75 @@
+#ifndef METADATAFETCHER_HPP
+#define METADATAFETCHER_HPP
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Torrent::Core {
+
+// Assembles an info dictionary out of 16 KiB ut_metadata pieces coming from several peers. Pieces nobody is
+// fetching are handed out first; once all are in flight, stragglers are duplicated to another peer. The
+// assembled buffer must hash to the info hash, otherwise everything (size included) is thrown away and fetched
+// again. Not thread-safe: MetadataExchange drives it from one loop thread.
+class MetadataFetcher
+{
+public:
+    static constexpr uint32_t MaxHashFailures = 3;
+
+    explicit MetadataFetcher(std::string infoHash);
+
+    // The first plausible size wins; false if size is out of range or disagrees with the accepted one.
+    bool setSize(int64_t size);
+    // Next piece to request, skipping ones already outstanding for the asking peer.
+    std::optional<uint32_t> nextPiece(std::span<const uint32_t> outstanding);
+    // Returns true when this piece completed a dictionary that verified. Throws on a wrongly sized piece.
+    bool onData(uint32_t piece, std::string_view data);
+    void release(uint32_t piece);
+
+    int64_t size() const
+    {
+        return static_cast<int64_t>(m_buffer.size());
+    }
+
+    size_t pieceCount() const
+    {
+        return m_received.size();
+    }
+
+    bool complete() const
+    {
+        return m_complete;
+    }
+
+    bool failed() const
+    {
+        return m_hashFailures >= MaxHashFailures;
+    }
+
+    uint32_t hashFailures() const
+    {
+        return m_hashFailures;
+    }
+
+    const std::string& info() const
+    {
+        return m_buffer;
+    }
+
+private:
+    void reset();
+
+    std::string m_infoHash;
+    std::string m_buffer;
+    std::vector<bool> m_received;
+    std::vector<uint16_t> m_inFlight;
+    size_t m_receivedCount  = 0;
+    uint32_t m_hashFailures = 0;
+    bool m_complete         = false;
+};
+
+}  // namespace Torrent::Core
+#endif  // METADATAFETCHER_HPP
@@ -0,0 +1,233 @@
+#include "PeerRouter.hpp"
+#include "PeerWire.hpp"
+
+#include <Logger.hpp>
+
+#include <array>
+#include <cerrno>
+#include <stdexcept>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace Torrent::Core {
+
+namespace {
+constexpr auto kPartialRetry = std::chrono::milliseconds(5);
+
+Metrics::Registry& scope(const PeerRouter::Options& options)
+{
+    return options.metrics ? *options.metrics : Metrics::Registry::global();
+}
+}  // namespace
+
+PeerRouter::PeerRouter(Net::LoopGroup& loops, const Net::Endpoint& bindTo)
+    : PeerRouter(loops, bindTo, Options{})
+{}
+
+PeerRouter::PeerRouter(Net::LoopGroup& loops, const Net::Endpoint& bindTo, Options options)
+    : m_loops(loops)
+    , m_options(options)
+    , m_routed(scope(m_options).counter("sktorrent_routed_peers_total", "Incoming peer connections handed to a torrent"))
+    , m_crossShard(scope(m_options).counter("sktorrent_cross_shard_peers_total",
+          "Incoming peer connections accepted on another shard than their torrent's"))
+    , m_rejected(scope(m_options).counter("sktorrent_rejected_peers_total",
+          "Incoming peer connections closed before reaching a torrent"))
+    , m_blocklist(m_options.blocklist ? *m_options.blocklist : IpBlocklist::global())
+{
+    for (size_t i = 0; i < m_loops.size(); ++i)
+    {
+        m_shards.push_back(std::make_unique<Shard>());
+    }
+    auto listen = [this](size_t shard, const Net::Endpoint& endpoint, bool reusePort)
+    {
+        m_shards[shard]->listener = std::make_unique<Net::TcpListener>(m_loops.loop(shard), endpoint,
+            [this, shard](std::unique_ptr<Net::TcpStream> stream) { accepted(shard, std::move(stream)); }, reusePort);
+    };
+
+    // shard 0 first, to learn the port when bindTo asks for any
+    m_loops.runOnEach(
+        [&](size_t shard)
+        {
+            if (shard == 0)
+            {
+                listen(0, bindTo, m_loops.size() > 1);
+                m_local = m_shards[0]->listener->localEndpoint();
+            }
+        });
+    if (m_loops.size() > 1)
+    {
+        try
+        {
+            m_loops.runOnEach(
+                [&](size_t shard)
+                {
+                    if (shard != 0)
+                    {
+                        listen(shard, m_local, true);
+                    }
+                });
+        }
+        catch (const std::exception& e)
+        {
+            LOG_WARNING(PeerRouter, "Accepting on shard 0 only", LOG_MD(Error, e.what()));
+            m_reusePort = false;
+            m_loops.runOnEach([this](size_t shard) { m_shards[shard]->listener.reset(); });
+            m_loops.runOnEach(
+                [&](size_t shard)
+                {
+                    if (shard == 0)
+                    {
+                        listen(0, m_local, false);
+                    }
+                });
+        }
+    }
+    LOG_INFO(PeerRouter, "Accepting peers", LOG_MD(Port, m_local.port), LOG_MD(Shards, m_loops.size()),
+        LOG_MD(ReusePort, m_reusePort));
+}
+
+PeerRouter::~PeerRouter()
+{
+    m_loops.runOnEach(
+        [this](size_t shard)
+        {
+            auto& s = *m_shards[shard];
+            s.listener.reset();
+            s.routes.clear();
+            while (!s.pending.empty())
+            {
+                int fd = s.pending.begin()->first;
+                forget(shard, fd);
+                ::close(fd);
+            }
+        });
+    // sockets posted to another shard before the first pass reached it are closed by deliver(); this pass queues
+    // behind them
+    m_loops.runOnEach([](size_t) {});
+}
+
+void PeerRouter::add(const std::string& infoHash, size_t shard, Acceptor acceptor)
+{
+    if (shard >= m_loops.size())
+    {
+        throw std::runtime_error("No shard " + std::to_string(shard));
+    }
+    m_loops.runOnEach([&](size_t i) { m_shards[i]->routes[infoHash] = Route{shard, acceptor}; });
+}
+
+void PeerRouter::remove(const std::string& infoHash)
+{
+    m_loops.runOnEach([&](size_t i) { m_shards[i]->routes.erase(infoHash); });
+}
+
+PeerRouter::Stats PeerRouter::stats() const
+{
+    return {m_routed.value(), m_crossShard.value(), m_rejected.value()};
+}
+
+void PeerRouter::accepted(size_t shard, std::unique_ptr<Net::TcpStream> stream)
+{
+    // before a timer or a handshake is spent on it
+    if (auto remote = stream->remoteEndpoint(); remote && m_blocklist.blocked(*remote))
+    {
+        m_rejected.add();
+        return;
+    }
+    int fd = stream->release();
+    m_shards[shard]->pending[fd].timeout = m_loops.loop(shard).runAfter(m_options.handshakeTimeout,
+        [this, shard, fd]
+        {
+            m_shards[shard]->pending[fd].timeout = 0;  // firing, nothing to cancel
+            drop(shard, fd);
+        });
+    awaitHandshake(shard, fd);
+}
+
+void PeerRouter::awaitHandshake(size_t shard, int fd)
+{
+    m_loops.loop(shard).waitFor(fd, EPOLLIN, [this, shard, fd] { peek(shard, fd); });
+}
+
+void PeerRouter::peek(size_t shard, int fd)
+{
+    auto& s = *m_shards[shard];
+    if (!s.pending.contains(fd))
+    {
+        return;
+    }
+    std::array<char, PeerWire::HandshakeInfoHashEnd> head;
+    ssize_t n = ::recv(fd, head.data(), head.size(), MSG_PEEK);
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+    {
+        awaitHandshake(shard, fd);
+        return;
+    }
+    if (n > 0 && static_cast<size_t>(n) < head.size())
+    {
+        // the socket stays readable until the rest arrives; look again shortly instead of spinning
+        s.pending[fd].retry = m_loops.loop(shard).runAfter(kPartialRetry,
+            [this, shard, fd]
+            {
+                m_shards[shard]->pending[fd].retry = 0;
+                awaitHandshake(shard, fd);
+            });
+        return;
+    }
+    auto infoHash = n > 0 ? PeerWire::handshakeInfoHash({head.data(), head.size()}) : std::nullopt;
+    auto route    = infoHash ? s.routes.find(std::string(*infoHash)) : s.routes.end();
+    if (route == s.routes.end())
+    {
+        drop(shard, fd);
+        return;
+    }
+
+    forget(shard, fd);
+    size_t owner = route->second.shard;
+    if (owner == shard)
+    {
+        deliver(shard, route->first, fd);
+        return;
+    }
+    m_crossShard.add();
+    m_loops.loop(owner).post([this, owner, hash = route->first, fd] { deliver(owner, hash, fd); });
+}
+
+void PeerRouter::deliver(size_t shard, const std::string& infoHash, int fd)
+{
+    // the owner's own table decides: the torrent may have been removed while the socket was on its way
+    auto& routes = m_shards[shard]->routes;
+    auto route   = routes.find(infoHash);
+    if (route == routes.end())
+    {
+        ::close(fd);
+        m_rejected.add();
+        return;
+    }
+    m_routed.add();
+    route->second.acceptor(std::make_unique<Net::TcpStream>(m_loops.loop(shard), fd));
+}
+
+void PeerRouter::forget(size_t shard, int fd)
+{
+    auto& loop    = m_loops.loop(shard);
+    auto& pending = m_shards[shard]->pending;
+    for (auto timer : {pending[fd].timeout, pending[fd].retry})
+    {
+        if (timer)
+        {
+            loop.cancel(timer);
+        }
+    }
+    pending.erase(fd);
+    loop.remove(fd);
+}
+
+void PeerRouter::drop(size_t shard, int fd)
+{
+    forget(shard, fd);
+    ::close(fd);
+    m_rejected.add();
+}
+
+}  // namespace Torrent::Core
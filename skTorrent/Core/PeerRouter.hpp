@@ -0,0 +1,113 @@
+#ifndef PEERROUTER_HPP
+#define PEERROUTER_HPP
+
+#include "IpFilter.hpp"
+
+#include <Metrics/Metrics.hpp>
+#include <Net/LoopGroup.hpp>
+#include <Net/TcpStream.hpp>
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Torrent::Core {
+
+// Incoming peer connections of every torrent on one port, spread over the shards of a LoopGroup. A torrent lives
+// on one shard with all of its peers; the router hands it every connection whose handshake names its info hash.
+//
+// Every shard listens on the port itself with SO_REUSEPORT, so the kernel balances accepts over the shards; where
+// that is unavailable shard 0 listens alone. The accepting shard waits for the first 48 bytes of the handshake
+// and peeks them rather than reading them, so the owner sees the stream from its first byte. If the owner is
+// another shard the socket is posted to it. Each shard keeps its own copy of the routing table and add()/remove()
+// post every change to every shard, so accepting and routing take no lock. Connections from addresses the IP
+// blocklist blocks are closed as soon as they are accepted.
+class PeerRouter
+{
+public:
+    // Runs on the owning shard's loop thread.
+    using Acceptor = std::function<void(std::unique_ptr<Net::TcpStream>)>;
+
+    struct Options
+    {
+        std::chrono::milliseconds handshakeTimeout{10'000};
+        Metrics::Registry* metrics = nullptr;  // the global one when null
+        IpBlocklist* blocklist     = nullptr;  // the global one when null
+    };
+
+    struct Stats
+    {
+        uint64_t routed     = 0;  // handed to an acceptor
+        uint64_t crossShard = 0;  // of those, accepted on another shard than the owner's
+        uint64_t rejected   = 0;  // blocked, no handshake in time, not a handshake, or an unknown torrent
+    };
+
+    PeerRouter(Net::LoopGroup& loops, const Net::Endpoint& bindTo);
+    PeerRouter(Net::LoopGroup& loops, const Net::Endpoint& bindTo, Options options);
+    // Closes the listeners and connections still waiting for a handshake. Neither the constructor, the destructor
+    // nor add()/remove() may run on a shard thread.
+    ~PeerRouter();
+    PeerRouter(const PeerRouter&) = delete;
+
+    const Net::Endpoint& localEndpoint() const
+    {
+        return m_local;
+    }
+
+    // Whether every shard accepts, rather than shard 0 alone.
+    bool reusePort() const
+    {
+        return m_reusePort;
+    }
+
+    // Connections for infoHash go to acceptor on the loop of shard. In effect on every shard when add() returns.
+    void add(const std::string& infoHash, size_t shard, Acceptor acceptor);
+    void remove(const std::string& infoHash);
+
+    Stats stats() const;
+
+private:
+    struct Route
+    {
+        size_t shard = 0;
+        Acceptor acceptor;
+    };
+
+    // an accepted socket whose handshake is incomplete
+    struct Pending
+    {
+        Net::EventLoop::TimerId timeout = 0;
+        Net::EventLoop::TimerId retry   = 0;  // after a partial handshake
+    };
+
+    // touched on its own loop thread only
+    struct Shard
+    {
+        std::unique_ptr<Net::TcpListener> listener;
+        std::unordered_map<std::string, Route> routes;
+        std::unordered_map<int, Pending> pending;
+    };
+
+    void accepted(size_t shard, std::unique_ptr<Net::TcpStream> stream);
+    void awaitHandshake(size_t shard, int fd);
+    void peek(size_t shard, int fd);
+    void deliver(size_t shard, const std::string& infoHash, int fd);
+    void forget(size_t shard, int fd);
+    void drop(size_t shard, int fd);
+
+    Net::LoopGroup& m_loops;
+    Options m_options;
+    std::vector<std::unique_ptr<Shard>> m_shards;
+    Net::Endpoint m_local;
+    bool m_reusePort = true;
+    Metrics::Counter& m_routed;
+    Metrics::Counter& m_crossShard;
+    Metrics::Counter& m_rejected;
+    IpBlocklist& m_blocklist;
+};
+
+}  // namespace Torrent::Core
+#endif  // PEERROUTER_HPP
@@ -0,0 +1,107 @@
+#include "PeerStore.hpp"
+
+#include <algorithm>
+#include <bit>
+
+namespace Torrent::Core {
+
+size_t PeerStore::findSlot(const Net::Endpoint& ep, uint64_t hash, bool& found) const
+{
+    const uint64_t tag = hash >> 32;
+    size_t slot        = hash & m_mask;
+    while (true)
+    {
+        uint64_t entry = m_slots[slot];
+        if (entry == kEmpty)
+        {
+            found = false;
+            return slot;
+        }
+        if ((entry >> 32) == tag && m_peers[(entry & 0xffffffff) - 1] == ep)
+        {
+            found = true;
+            return slot;
+        }
+        slot = (slot + 1) & m_mask;
+    }
+}
+
+void PeerStore::rehash(size_t capacity)
+{
+    capacity = std::bit_ceil(std::max<size_t>(capacity, 16));
+    m_slots.assign(capacity, kEmpty);
+    m_mask = capacity - 1;
+    for (size_t i = 0; i < m_peers.size(); ++i)
+    {
+        uint64_t hash = Net::hashEndpoint(m_peers[i]);
+        size_t slot   = hash & m_mask;
+        while (m_slots[slot] != kEmpty)
+        {
+            slot = (slot + 1) & m_mask;
+        }
+        m_slots[slot] = ((hash >> 32) << 32) | (i + 1);
+    }
+}
+
+void PeerStore::reserve(size_t count)
+{
+    m_peers.reserve(count);
+    // keep load factor at or below 1/2
+    if (count * 2 > m_slots.size())
+    {
+        rehash(count * 2);
+    }
+}
+
+bool PeerStore::insert(const Net::Endpoint& ep)
+{
+    if ((m_peers.size() + 1) * 2 > m_slots.size())
+    {
+        rehash(m_slots.empty() ? 16 : m_slots.size() * 2);
+    }
+
+    uint64_t hash = Net::hashEndpoint(ep);
+    bool found    = false;
+    size_t slot   = findSlot(ep, hash, found);
+    if (found)
+    {
+        return false;
+    }
+    m_peers.push_back(ep);
+    m_slots[slot] = ((hash >> 32) << 32) | m_peers.size();
+    return true;
+}
+
+size_t PeerStore::merge(std::span<const Net::Endpoint> peers)
+{
+    if ((m_peers.size() + peers.size()) * 2 > m_slots.size())
+    {
+        reserve(m_peers.size() + peers.size());
+    }
+
+    size_t added = 0;
+    for (const auto& ep : peers)
+    {
+        added += insert(ep) ? 1 : 0;
+    }
+    return added;
+}
+
+bool PeerStore::contains(const Net::Endpoint& ep) const
+{
+    if (m_slots.empty())
+    {
+        return false;
+    }
+    bool found = false;
+    findSlot(ep, Net::hashEndpoint(ep), found);
+    return found;
+}
+
+void PeerStore::clear()
+{
+    m_peers.clear();
+    std::fill(m_slots.begin(), m_slots.end(), kEmpty);
+}
+
+}  // namespace Torrent::Core
@@ -0,0 +1,46 @@
+#ifndef PEERSTORE_HPP
+#define PEERSTORE_HPP
+
+#include <Net/Endpoint.hpp>
+
+#include <span>
+#include <vector>
+
+namespace Torrent::Core {
+
+// Per-torrent set of known peers. Endpoints live in a dense vector, de-duplication goes through an
+// open-addressing (linear probing) table of {hash tag, index} slots so lookups rarely touch the endpoint itself.
+class PeerStore
+{
+public:
+    PeerStore() = default;
+
+    bool insert(const Net::Endpoint& ep);
+    size_t merge(std::span<const Net::Endpoint> peers);
+    bool contains(const Net::Endpoint& ep) const;
+    void reserve(size_t count);
+    void clear();
+
+    size_t size() const
+    {
+        return m_peers.size();
+    }
+
+    std::span<const Net::Endpoint> peers() const
+    {
+        return m_peers;
+    }
+
+private:
+    static constexpr uint64_t kEmpty = 0;
+
+    void rehash(size_t capacity);
+    size_t findSlot(const Net::Endpoint& ep, uint64_t hash, bool& found) const;
+
+    std::vector<Net::Endpoint> m_peers;
+    std::vector<uint64_t> m_slots;  // high 32 bits: hash tag, low 32 bits: index + 1
+    size_t m_mask = 0;
+};
+
+}  // namespace Torrent::Core
+#endif  // PEERSTORE_HPP
@@ -0,0 +1,301 @@
+#include "PeerWire.hpp"
+
+#include <Utils/BencodeEncoder.hpp>
+
+#include <cctype>
+#include <stdexcept>
+
+namespace Torrent::Core::PeerWire {
+
+namespace {
+constexpr std::string_view Protocol = "\x13" "BitTorrent protocol";
+
+void appendLength(uint32_t len, std::string& out)
+{
+    out.push_back(static_cast<char>(len >> 24));
+    out.push_back(static_cast<char>(len >> 16));
+    out.push_back(static_cast<char>(len >> 8));
+    out.push_back(static_cast<char>(len));
+}
+
+uint32_t readU32(std::string_view data, size_t at)
+{
+    return (static_cast<uint32_t>(static_cast<uint8_t>(data[at])) << 24) |
+           (static_cast<uint32_t>(static_cast<uint8_t>(data[at + 1])) << 16) |
+           (static_cast<uint32_t>(static_cast<uint8_t>(data[at + 2])) << 8) | static_cast<uint8_t>(data[at + 3]);
+}
+
+std::string encodeMetadataHeader(MetadataMessage::Type type, uint32_t piece, int64_t totalSize)
+{
+    namespace B = Utils::Bencode;
+    std::string out = "d";
+    B::encodeString("msg_type", out);
+    B::encodeInt(type, out);
+    B::encodeString("piece", out);
+    B::encodeInt(piece, out);
+    if (type == MetadataMessage::Data)
+    {
+        B::encodeString("total_size", out);
+        B::encodeInt(totalSize, out);
+    }
+    out.push_back('e');
+    return out;
+}
+}  // namespace
+
+std::string encodeHandshake(std::string_view infoHash, std::string_view peerId, bool extensions)
+{
+    if (infoHash.size() != 20 || peerId.size() != 20)
+    {
+        throw std::runtime_error("Handshake needs a 20-byte info hash and peer id");
+    }
+    std::string out;
+    out.reserve(HandshakeSize);
+    out.append(Protocol);
+    out.append(8, '\0');
+    if (extensions)
+    {
+        out[Protocol.size() + 5] = 0x10;
+    }
+    out.append(infoHash);
+    out.append(peerId);
+    return out;
+}
+
+std::optional<Handshake> decodeHandshake(std::string_view data)
+{
+    if (data.size() < HandshakeSize || data.substr(0, Protocol.size()) != Protocol)
+    {
+        return std::nullopt;
+    }
+    Handshake hs;
+    hs.extensions = (static_cast<uint8_t>(data[Protocol.size() + 5]) & 0x10) != 0;
+    hs.infoHash   = data.substr(28, 20);
+    hs.peerId     = data.substr(48, 20);
+    return hs;
+}
+
+std::optional<std::string_view> handshakeInfoHash(std::string_view prefix)
+{
+    if (prefix.size() < HandshakeInfoHashEnd || prefix.substr(0, Protocol.size()) != Protocol)
+    {
+        return std::nullopt;
+    }
+    return prefix.substr(28, 20);
+}
+
+std::string encodeMessage(MessageId id, std::string_view payload)
+{
+    std::string out;
+    out.reserve(5 + payload.size());
+    appendLength(static_cast<uint32_t>(payload.size() + 1), out);
+    out.push_back(static_cast<char>(id));
+    out.append(payload);
+    return out;
+}
+
+std::string encodeExtended(uint8_t extendedId, std::string_view payload)
+{
+    std::string out;
+    out.reserve(6 + payload.size());
+    appendLength(static_cast<uint32_t>(payload.size() + 2), out);
+    out.push_back(static_cast<char>(MessageId::Extended));
+    out.push_back(static_cast<char>(extendedId));
+    out.append(payload);
+    return out;
+}
+
+std::string encodeHave(uint32_t piece)
+{
+    std::string payload;
+    appendLength(piece, payload);
+    return encodeMessage(MessageId::Have, payload);
+}
+
+std::string encodeBitfield(const std::vector<bool>& pieces)
+{
+    std::string payload((pieces.size() + 7) / 8, '\0');
+    for (size_t i = 0; i < pieces.size(); ++i)
+    {
+        if (pieces[i])
+        {
+            payload[i / 8] = static_cast<char>(payload[i / 8] | (0x80 >> (i % 8)));
+        }
+    }
+    return encodeMessage(MessageId::Bitfield, payload);
+}
+
+std::string encodeRequest(MessageId id, uint32_t piece, uint32_t begin, uint32_t length)
+{
+    std::string payload;
+    payload.reserve(12);
+    appendLength(piece, payload);
+    appendLength(begin, payload);
+    appendLength(length, payload);
+    return encodeMessage(id, payload);
+}
+
+std::string encodePieceHeader(uint32_t piece, uint32_t begin, uint32_t length)
+{
+    std::string out;
+    out.reserve(13);
+    appendLength(length + 9, out);
+    out.push_back(static_cast<char>(MessageId::Piece));
+    appendLength(piece, out);
+    appendLength(begin, out);
+    return out;
+}
+
+uint32_t decodeHave(std::string_view payload)
+{
+    if (payload.size() != 4)
+    {
+        throw std::runtime_error("Invalid have message");
+    }
+    return readU32(payload, 0);
+}
+
+std::vector<bool> decodeBitfield(std::string_view payload, uint32_t pieceCount)
+{
+    if (payload.size() != (pieceCount + 7) / 8)
+    {
+        throw std::runtime_error("Bitfield size does not match the piece count");
+    }
+    std::vector<bool> pieces(pieceCount);
+    for (uint32_t i = 0; i < pieceCount; ++i)
+    {
+        pieces[i] = (static_cast<uint8_t>(payload[i / 8]) & (0x80 >> (i % 8))) != 0;
+    }
+    return pieces;
+}
+
+BlockMessage decodeRequest(std::string_view payload)
+{
+    if (payload.size() != 12)
+    {
+        throw std::runtime_error("Invalid request message");
+    }
+    return {readU32(payload, 0), readU32(payload, 4), readU32(payload, 8), {}};
+}
+
+BlockMessage decodePiece(std::string_view payload)
+{
+    if (payload.size() < 8)
+    {
+        throw std::runtime_error("Invalid piece message");
+    }
+    auto data = payload.substr(8);
+    return {readU32(payload, 0), readU32(payload, 4), static_cast<uint32_t>(data.size()), data};
+}
+
+std::string encodeExtendedHandshake(uint8_t utMetadataId, int64_t metadataSize)
+{
+    namespace B = Utils::Bencode;
+    std::string out = "d";
+    B::encodeString("m", out);
+    out.push_back('d');
+    B::encodeString("ut_metadata", out);
+    B::encodeInt(utMetadataId, out);
+    out.push_back('e');
+    if (metadataSize > 0)
+    {
+        B::encodeString("metadata_size", out);
+        B::encodeInt(metadataSize, out);
+    }
+    B::encodeString("v", out);
+    B::encodeString("skTorrent 0.1", out);
+    out.push_back('e');
+    return out;
+}
+
+ExtendedHandshake decodeExtendedHandshake(std::string_view payload)
+{
+    namespace B = Utils::Bencode;
+    ExtendedHandshake hs;
+    B::DictScanner scanner(payload.substr(0, B::skipValue(payload, 0)));
+    std::string_view key;
+    std::string_view value;
+    while (scanner.next(key, value))
+    {
+        if (key == "m" && value.front() == 'd')
+        {
+            B::DictScanner extensions(value);
+            std::string_view name;
+            std::string_view id;
+            while (extensions.next(name, id))
+            {
+                if (name == "ut_metadata" && id.front() == 'i')
+                {
+                    auto v        = B::intValue(id);
+                    hs.utMetadata = v > 0 && v < 256 ? static_cast<uint8_t>(v) : 0;
+                }
+            }
+        }
+        else if (key == "metadata_size" && value.front() == 'i')
+        {
+            hs.metadataSize = B::intValue(value);
+        }
+        else if (key == "v" && std::isdigit(static_cast<unsigned char>(value.front())))
+        {
+            hs.client = B::stringView(value);
+        }
+    }
+    return hs;
+}
+
+std::string encodeMetadataRequest(uint32_t piece)
+{
+    return encodeMetadataHeader(MetadataMessage::Request, piece, 0);
+}
+
+std::string encodeMetadataData(uint32_t piece, int64_t totalSize, std::string_view data)
+{
+    std::string out = encodeMetadataHeader(MetadataMessage::Data, piece, totalSize);
+    out.append(data);
+    return out;
+}
+
+std::string encodeMetadataReject(uint32_t piece)
+{
+    return encodeMetadataHeader(MetadataMessage::Reject, piece, 0);
+}
+
+MetadataMessage decodeMetadataMessage(std::string_view payload)
+{
+    namespace B = Utils::Bencode;
+    size_t dictEnd = B::skipValue(payload, 0);
+    B::DictScanner scanner(payload.substr(0, dictEnd));
+
+    MetadataMessage msg;
+    int64_t type  = -1;
+    int64_t piece = -1;
+    std::string_view key;
+    std::string_view value;
+    while (scanner.next(key, value))
+    {
+        if (key == "msg_type")
+        {
+            type = B::intValue(value);
+        }
+        else if (key == "piece")
+        {
+            piece = B::intValue(value);
+        }
+        else if (key == "total_size")
+        {
+            msg.totalSize = B::intValue(value);
+        }
+    }
+
+    if (type < MetadataMessage::Request || type > MetadataMessage::Reject || piece < 0 ||
+        piece > static_cast<int64_t>(MaxMetadataSize / MetadataPieceSize))
+    {
+        throw std::runtime_error("Invalid ut_metadata message");
+    }
+    msg.type  = static_cast<MetadataMessage::Type>(type);
+    msg.piece = static_cast<uint32_t>(piece);
+    msg.data  = payload.substr(dictEnd);
+    return msg;
+}
+
+}  // namespace Torrent::Core::PeerWire
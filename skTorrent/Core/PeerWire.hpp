@@ -0,0 +1,104 @@
+#ifndef PEERWIRE_HPP
+#define PEERWIRE_HPP
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Torrent::Core::PeerWire {
+
+constexpr size_t HandshakeSize     = 68;
+constexpr size_t MaxMessageSize    = 1 << 20;
+constexpr size_t MetadataPieceSize = 16 * 1'024;
+constexpr size_t MaxMetadataSize   = 16 * 1'024 * 1'024;
+constexpr uint32_t BlockSize       = 16 * 1'024;
+
+enum class MessageId : uint8_t
+{
+    Choke         = 0,
+    Unchoke       = 1,
+    Interested    = 2,
+    NotInterested = 3,
+    Have          = 4,
+    Bitfield      = 5,
+    Request       = 6,
+    Piece         = 7,
+    Cancel        = 8,
+    Extended      = 20
+};
+
+struct Handshake
+{
+    std::string infoHash;
+    std::string peerId;
+    bool extensions = false;  // BEP 10 bit: reserved[5] & 0x10
+};
+
+std::string encodeHandshake(std::string_view infoHash, std::string_view peerId, bool extensions = true);
+std::optional<Handshake> decodeHandshake(std::string_view data);
+// The info hash of a handshake from its first HandshakeInfoHashEnd bytes, for routing a connection before the
+// peer id has arrived; nullopt if they are not a BitTorrent handshake.
+constexpr size_t HandshakeInfoHashEnd = 48;
+std::optional<std::string_view> handshakeInfoHash(std::string_view prefix);
+
+// <length:4><id:1><payload>
+std::string encodeMessage(MessageId id, std::string_view payload = {});
+std::string encodeExtended(uint8_t extendedId, std::string_view payload);
+
+// Request and Cancel share a layout; for Piece, length is the block size and data views the payload.
+struct BlockMessage
+{
+    uint32_t piece  = 0;
+    uint32_t begin  = 0;
+    uint32_t length = 0;
+    std::string_view data;
+};
+
+std::string encodeHave(uint32_t piece);
+std::string encodeBitfield(const std::vector<bool>& pieces);
+std::string encodeRequest(MessageId id, uint32_t piece, uint32_t begin, uint32_t length);
+// Header only, so the caller can append the block without building the message twice.
+std::string encodePieceHeader(uint32_t piece, uint32_t begin, uint32_t length);
+
+// Payload decoders throw std::runtime_error on malformed input.
+uint32_t decodeHave(std::string_view payload);
+std::vector<bool> decodeBitfield(std::string_view payload, uint32_t pieceCount);
+BlockMessage decodeRequest(std::string_view payload);
+BlockMessage decodePiece(std::string_view payload);
+
+// BEP 10 handshake, extended id 0. Only the fields the client uses are kept.
+struct ExtendedHandshake
+{
+    uint8_t utMetadata   = 0;  // peer's id for ut_metadata, 0 if unsupported
+    int64_t metadataSize = 0;
+    std::string client;
+};
+
+std::string encodeExtendedHandshake(uint8_t utMetadataId, int64_t metadataSize = 0);
+ExtendedHandshake decodeExtendedHandshake(std::string_view payload);
+
+// BEP 9 ut_metadata
+struct MetadataMessage
+{
+    enum Type : uint8_t
+    {
+        Request = 0,
+        Data    = 1,
+        Reject  = 2
+    };
+
+    Type type         = Request;
+    uint32_t piece    = 0;
+    int64_t totalSize = 0;
+    std::string_view data;  // trailing piece bytes of a Data message, view into the payload
+};
+
+std::string encodeMetadataRequest(uint32_t piece);
+std::string encodeMetadataData(uint32_t piece, int64_t totalSize, std::string_view data);
+std::string encodeMetadataReject(uint32_t piece);
+MetadataMessage decodeMetadataMessage(std::string_view payload);
+
+}  // namespace Torrent::Core::PeerWire
+#endif  // PEERWIRE_HPP
@@ -0,0 +1,312 @@
+#include "PiecePicker.hpp"
+
+#include "PeerWire.hpp"
+
+#include <algorithm>
+
+namespace Torrent::Core {
+
+PiecePicker::PiecePicker(uint32_t pieceCount, uint64_t pieceLength, uint64_t totalSize)
+    : PiecePicker(pieceCount, pieceLength, totalSize, Options{})
+{}
+
+PiecePicker::PiecePicker(uint32_t pieceCount, uint64_t pieceLength, uint64_t totalSize, Options options)
+    : m_pieceCount(pieceCount)
+    , m_pieceLength(pieceLength)
+    , m_totalSize(totalSize)
+    , m_options(options)
+    , m_have(pieceCount, false)
+    , m_priority(pieceCount, Priority::Normal)
+    , m_wantedMissing(pieceCount)
+    , m_availability(pieceCount, 0)
+    , m_deadlineOf(pieceCount)
+    , m_slots(pieceCount)
+{
+    for (uint32_t i = 0; i < m_pieceCount; ++i)
+    {
+        rebucket(i);
+    }
+}
+
+uint32_t PiecePicker::pieceSize(uint32_t piece) const
+{
+    return static_cast<uint32_t>(std::min(m_pieceLength, m_totalSize - piece * m_pieceLength));
+}
+
+bool PiecePicker::fresh(uint32_t piece) const
+{
+    return !m_have[piece] && m_priority[piece] != Priority::Skip && !m_deadlineOf[piece] && !m_partials.contains(piece);
+}
+
+void PiecePicker::rebucket(uint32_t piece)
+{
+    auto& slot = m_slots[piece];
+    if (slot.pos != NotBucketed)
+    {
+        auto it           = m_buckets.find(slot.key);
+        auto& pieces      = it->second;
+        uint32_t last     = pieces.back();
+        pieces[slot.pos]  = last;
+        m_slots[last].pos = slot.pos;
+        pieces.pop_back();
+        slot.pos = NotBucketed;
+        if (pieces.empty())
+        {
+            m_buckets.erase(it);
+        }
+    }
+    if (fresh(piece))
+    {
+        slot.key     = {static_cast<uint8_t>(Priority::High) - static_cast<uint8_t>(m_priority[piece]), m_availability[piece]};
+        auto& pieces = m_buckets[slot.key];
+        slot.pos     = static_cast<uint32_t>(pieces.size());
+        pieces.push_back(piece);
+    }
+}
+
+void PiecePicker::addPeer(const std::vector<bool>& has)
+{
+    for (uint32_t i = 0; i < m_pieceCount && i < has.size(); ++i)
+    {
+        if (has[i])
+        {
+            onHave(i);
+        }
+    }
+}
+
+void PiecePicker::removePeer(const std::vector<bool>& has)
+{
+    for (uint32_t i = 0; i < m_pieceCount && i < has.size(); ++i)
+    {
+        if (has[i] && m_availability[i] > 0)
+        {
+            --m_availability[i];
+            if (m_slots[i].pos != NotBucketed)
+            {
+                rebucket(i);
+            }
+        }
+    }
+}
+
+void PiecePicker::onHave(uint32_t piece)
+{
+    ++m_availability[piece];
+    if (m_slots[piece].pos != NotBucketed)
+    {
+        rebucket(piece);
+    }
+}
+
+void PiecePicker::setPriority(uint32_t piece, Priority priority)
+{
+    if (!m_have[piece])
+    {
+        m_wantedMissing += (priority != Priority::Skip) - (m_priority[piece] != Priority::Skip);
+    }
+    m_priority[piece] = priority;
+    rebucket(piece);
+}
+
+void PiecePicker::setDeadline(uint32_t piece, Clock::time_point deadline)
+{
+    if (m_have[piece] || (m_deadlineOf[piece] && *m_deadlineOf[piece] <= deadline))
+    {
+        return;
+    }
+    clearDeadline(piece);
+    m_deadlineOf[piece] = deadline;
+    m_deadlines.emplace(deadline, piece);
+    rebucket(piece);
+}
+
+void PiecePicker::clearDeadline(uint32_t piece)
+{
+    if (m_deadlineOf[piece])
+    {
+        m_deadlines.erase({*m_deadlineOf[piece], piece});
+        m_deadlineOf[piece].reset();
+        rebucket(piece);
+    }
+}
+
+bool PiecePicker::interesting(const std::vector<bool>& peerHas) const
+{
+    for (uint32_t i = 0; i < m_pieceCount && i < peerHas.size(); ++i)
+    {
+        if (peerHas[i] && !m_have[i] && (m_priority[i] != Priority::Skip || m_deadlineOf[i]))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+PiecePicker::Block PiecePicker::block(uint32_t piece, uint32_t index) const
+{
+    uint32_t offset = index * PeerWire::BlockSize;
+    return {piece, offset, std::min(PeerWire::BlockSize, pieceSize(piece) - offset)};
+}
+
+PiecePicker::Partial& PiecePicker::partial(uint32_t piece)
+{
+    auto [it, inserted] = m_partials.try_emplace(piece);
+    if (inserted)
+    {
+        it->second.blocks.resize((pieceSize(piece) + PeerWire::BlockSize - 1) / PeerWire::BlockSize);
+        rebucket(piece);
+    }
+    return it->second;
+}
+
+std::optional<PiecePicker::Block> PiecePicker::pickFrom(uint32_t piece, bool duplicates, Clock::time_point now)
+{
+    auto& p = partial(piece);
+    for (uint32_t i = 0; i < p.blocks.size(); ++i)
+    {
+        auto& b = p.blocks[i];
+        if (!b.received && b.requests == 0)
+        {
+            b.requests    = 1;
+            b.requestedAt = now;
+            return block(piece, i);
+        }
+    }
+    if (!duplicates)
+    {
+        return std::nullopt;
+    }
+    for (uint32_t i = 0; i < p.blocks.size(); ++i)
+    {
+        auto& b = p.blocks[i];
+        if (!b.received && b.requests == 1 && now - b.requestedAt >= m_options.rerequestAfter)
+        {
+            b.requests    = 2;
+            b.requestedAt = now;
+            return block(piece, i);
+        }
+    }
+    return std::nullopt;
+}
+
+std::optional<uint32_t> PiecePicker::rarestPiece(const std::vector<bool>& peerHas)
+{
+    // buckets run from the highest priority and lowest availability; none left means nothing is wanted
+    for (const auto& [key, pieces] : m_buckets)
+    {
+        // a random starting point spreads peers over equally rare pieces
+        size_t start = std::uniform_int_distribution<size_t>(0, pieces.size() - 1)(m_rng);
+        for (size_t n = 0; n < pieces.size(); ++n)
+        {
+            uint32_t piece = pieces[(start + n) % pieces.size()];
+            if (peerHas[piece])
+            {
+                return piece;
+            }
+        }
+    }
+    return std::nullopt;
+}
+
+std::optional<PiecePicker::Block> PiecePicker::pick(const std::vector<bool>& peerHas, bool fastPeer, Clock::time_point now,
+    bool newPieces)
+{
+    if (peerHas.size() != m_pieceCount)
+    {
+        return std::nullopt;
+    }
+
+    for (const auto& [deadline, piece] : m_deadlines)
+    {
+        bool urgent = deadline - now <= m_options.urgentWindow;
+        if (!peerHas[piece] || (urgent && !fastPeer) || (!newPieces && !m_partials.contains(piece)))
+        {
+            continue;
+        }
+        if (auto b = pickFrom(piece, urgent, now))
+        {
+            return b;
+        }
+    }
+
+    for (auto& [piece, p] : m_partials)
+    {
+        if (peerHas[piece] && !m_deadlineOf[piece])
+        {
+            if (auto b = pickFrom(piece, false, now))
+            {
+                return b;
+            }
+        }
+    }
+
+    if (!newPieces)
+    {
+        return std::nullopt;
+    }
+    if (auto piece = rarestPiece(peerHas))
+    {
+        return pickFrom(*piece, false, now);
+    }
+    return std::nullopt;
+}
+
+void PiecePicker::abort(const Block& block)
+{
+    auto it = m_partials.find(block.piece);
+    if (it == m_partials.end())
+    {
+        return;
+    }
+    auto& b = it->second.blocks[block.offset / PeerWire::BlockSize];
+    if (b.requests > 0)
+    {
+        --b.requests;
+    }
+}
+
+bool PiecePicker::onBlock(const Block& received)
+{
+    auto it = m_partials.find(received.piece);
+    if (it == m_partials.end() || received.offset % PeerWire::BlockSize != 0)
+    {
+        return false;
+    }
+    uint32_t index = received.offset / PeerWire::BlockSize;
+    auto& p        = it->second;
+    if (index >= p.blocks.size() || block(received.piece, index) != received || p.blocks[index].received)
+    {
+        return false;
+    }
+    p.blocks[index].received = true;
+    ++p.received;
+    return true;
+}
+
+bool PiecePicker::piecePending(uint32_t piece) const
+{
+    auto it = m_partials.find(piece);
+    return it != m_partials.end() && it->second.received == it->second.blocks.size();
+}
+
+void PiecePicker::onPieceVerified(uint32_t piece)
+{
+    if (!m_have[piece])
+    {
+        m_have[piece] = true;
+        ++m_haveCount;
+        m_wantedMissing -= m_priority[piece] != Priority::Skip;
+    }
+    m_partials.erase(piece);
+    clearDeadline(piece);
+    rebucket(piece);
+}
+
+void PiecePicker::onPieceFailed(uint32_t piece)
+{
+    m_partials.erase(piece);
+    rebucket(piece);
+}
+
+}  // namespace Torrent::Core
@@ -0,0 +1,174 @@
+#ifndef PIECEPICKER_HPP
+#define PIECEPICKER_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <random>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+namespace Torrent::Core {
+
+// Download priority of a piece, or of a file whose pieces take it on. Skipped pieces are never picked unless a
+// deadline asks for them.
+enum class Priority : uint8_t
+{
+    Skip   = 0,
+    Low    = 1,
+    Normal = 4,
+    High   = 7
+};
+
+// Decides which 16 KiB block to request next from a peer. Pieces with a deadline come first, earliest deadline
+// first; blocks of pieces due within the urgent window only go to peers the caller marks as fast, and a stalled
+// urgent block may be requested a second time. Already started pieces are finished before new ones, and new
+// pieces are chosen by priority, then rarest first, from buckets kept up to date as availability and priority
+// change, so a pick does not scan every piece. Not thread-safe; a Swarm drives it from its loop thread.
+class PiecePicker
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Options
+    {
+        std::chrono::milliseconds urgentWindow{2'000};
+        std::chrono::milliseconds rerequestAfter{500};  // before an urgent block goes to a second peer
+    };
+
+    struct Block
+    {
+        uint32_t piece  = 0;
+        uint32_t offset = 0;
+        uint32_t length = 0;
+
+        bool operator==(const Block&) const = default;
+    };
+
+    PiecePicker(uint32_t pieceCount, uint64_t pieceLength, uint64_t totalSize);
+    PiecePicker(uint32_t pieceCount, uint64_t pieceLength, uint64_t totalSize, Options options);
+
+    void addPeer(const std::vector<bool>& has);
+    void removePeer(const std::vector<bool>& has);
+    void onHave(uint32_t piece);
+
+    // Takes effect with the next pick; started pieces are still finished when skipped.
+    void setPriority(uint32_t piece, Priority priority);
+
+    Priority priority(uint32_t piece) const
+    {
+        return m_priority[piece];
+    }
+
+    // An earlier deadline replaces a later one.
+    void setDeadline(uint32_t piece, Clock::time_point deadline);
+    void clearDeadline(uint32_t piece);
+    // Deadline within the urgent window.
+    bool urgent(uint32_t piece, Clock::time_point now) const
+    {
+        return m_deadlineOf[piece] && *m_deadlineOf[piece] - now <= m_options.urgentWindow;
+    }
+
+    // With newPieces false only blocks of pieces already started are picked, e.g. while piece buffers are short.
+    std::optional<Block> pick(const std::vector<bool>& peerHas, bool fastPeer, Clock::time_point now, bool newPieces = true);
+    // The request will not be answered (choke, disconnect, timeout): the block is up for grabs again.
+    void abort(const Block& block);
+    // False for duplicates and blocks nobody asked for.
+    bool onBlock(const Block& block);
+    bool piecePending(uint32_t piece) const;  // every block is in, hash not checked yet
+    void onPieceVerified(uint32_t piece);
+    void onPieceFailed(uint32_t piece);
+
+    bool have(uint32_t piece) const
+    {
+        return m_have[piece];
+    }
+
+    const std::vector<bool>& havePieces() const
+    {
+        return m_have;
+    }
+
+    uint32_t haveCount() const
+    {
+        return m_haveCount;
+    }
+
+    bool complete() const
+    {
+        return m_haveCount == m_pieceCount;
+    }
+
+    // Every piece that is not skipped is verified.
+    bool finished() const
+    {
+        return m_wantedMissing == 0;
+    }
+
+    uint32_t pieceCount() const
+    {
+        return m_pieceCount;
+    }
+
+    uint32_t availability(uint32_t piece) const
+    {
+        return m_availability[piece];
+    }
+
+    uint32_t pieceSize(uint32_t piece) const;
+    bool interesting(const std::vector<bool>& peerHas) const;
+
+private:
+    struct BlockState
+    {
+        uint8_t requests = 0;
+        bool received    = false;
+        Clock::time_point requestedAt{};
+    };
+
+    struct Partial
+    {
+        std::vector<BlockState> blocks;
+        uint32_t received = 0;
+    };
+
+    // Pieces that may be started: missing, not skipped, without a deadline and not started yet.
+    using BucketKey = std::pair<uint8_t, uint32_t>;  // (inverted priority, availability)
+    static constexpr uint32_t NotBucketed = UINT32_MAX;
+
+    struct BucketSlot
+    {
+        BucketKey key{};
+        uint32_t pos = NotBucketed;
+    };
+
+    bool fresh(uint32_t piece) const;
+    // Moves the piece to the bucket its state calls for, or out of the buckets.
+    void rebucket(uint32_t piece);
+    Partial& partial(uint32_t piece);
+    std::optional<Block> pickFrom(uint32_t piece, bool duplicates, Clock::time_point now);
+    std::optional<uint32_t> rarestPiece(const std::vector<bool>& peerHas);
+    Block block(uint32_t piece, uint32_t index) const;
+
+    uint32_t m_pieceCount;
+    uint64_t m_pieceLength;
+    uint64_t m_totalSize;
+    Options m_options;
+
+    std::vector<bool> m_have;
+    uint32_t m_haveCount = 0;
+    std::vector<Priority> m_priority;
+    uint32_t m_wantedMissing = 0;  // pieces neither skipped nor had
+    std::vector<uint32_t> m_availability;
+    std::unordered_map<uint32_t, Partial> m_partials;
+    std::vector<std::optional<Clock::time_point>> m_deadlineOf;
+    std::set<std::pair<Clock::time_point, uint32_t>> m_deadlines;
+    std::map<BucketKey, std::vector<uint32_t>> m_buckets;
+    std::vector<BucketSlot> m_slots;
+    std::mt19937 m_rng{std::random_device{}()};
+};
+
+}  // namespace Torrent::Core
+#endif  // PIECEPICKER_HPP
@@ -0,0 +1,80 @@
+#include "ReadCache.hpp"
+
+namespace Torrent::Core {
+
+ReadCache::ReadCache(MemoryBudget& budget, size_t capacity)
+    : m_budget(budget)
+    , m_capacity(capacity)
+{}
+
+ReadCache::Piece ReadCache::find(uint32_t piece)
+{
+    auto it = m_index.find(piece);
+    if (it == m_index.end())
+    {
+        return nullptr;
+    }
+    m_lru.splice(m_lru.begin(), m_lru, it->second);
+    return it->second->data;
+}
+
+ReadCache::Piece ReadCache::insert(uint32_t piece, std::vector<uint8_t> data)
+{
+    if (auto cached = find(piece))
+    {
+        return cached;  // another peer's read got here first
+    }
+    auto shared = std::make_shared<const std::vector<uint8_t>>(std::move(data));
+    if (m_capacity == 0)
+    {
+        return shared;
+    }
+    if (m_lru.size() == m_capacity)
+    {
+        evictOldest();
+    }
+    MemoryCharge charge(m_budget, MemoryCategory::ReadCache);
+    while (!charge.tryResize(shared->size()))
+    {
+        if (m_lru.empty())
+        {
+            return shared;
+        }
+        evictOldest();
+    }
+    m_lru.push_front({piece, shared, std::move(charge)});
+    m_index[piece] = m_lru.begin();
+    return shared;
+}
+
+void ReadCache::trim()
+{
+    auto pressure = m_budget.pressure(MemoryCategory::ReadCache);
+    if (pressure == MemoryPressure::None)
+    {
+        return;
+    }
+    size_t keep = pressure == MemoryPressure::Hard ? 0 : m_lru.size() / 2;
+    while (m_lru.size() > keep)
+    {
+        evictOldest();
+    }
+}
+
+uint64_t ReadCache::bytes() const
+{
+    uint64_t total = 0;
+    for (const auto& entry : m_lru)
+    {
+        total += entry.charge.bytes();
+    }
+    return total;
+}
+
+void ReadCache::evictOldest()
+{
+    m_index.erase(m_lru.back().piece);
+    m_lru.pop_back();
+}
+
+}  // namespace Torrent::Core
@@ -0,0 +1,63 @@
+#ifndef READCACHE_HPP
+#define READCACHE_HPP
+
+#include "MemoryBudget.hpp"
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace Torrent::Core {
+
+// Whole pieces kept for serving uploads, so a peer fetching a piece block by block costs one disk read rather than
+// one per block. Least recently used pieces go first. Every piece is charged to MemoryCategory::ReadCache: an
+// insert the budget refuses evicts this cache's own pieces to make room, and trim() hands memory back while the
+// category is under pressure. Not thread-safe; a Swarm drives it from its loop thread.
+class ReadCache
+{
+public:
+    using Piece = std::shared_ptr<const std::vector<uint8_t>>;
+
+    // capacity in pieces, 0 disables the cache
+    ReadCache(MemoryBudget& budget, size_t capacity);
+    ReadCache(const ReadCache&) = delete;
+
+    // Whether reading a whole piece now is likely to pay off: enabled and no hard pressure.
+    bool admits() const
+    {
+        return m_capacity > 0 && m_budget.pressure(MemoryCategory::ReadCache) != MemoryPressure::Hard;
+    }
+
+    Piece find(uint32_t piece);
+    // Keeps the piece if the budget allows and returns it either way.
+    Piece insert(uint32_t piece, std::vector<uint8_t> data);
+    // Drops the older half under soft pressure and everything under hard pressure.
+    void trim();
+
+    size_t size() const
+    {
+        return m_lru.size();
+    }
+
+    uint64_t bytes() const;
+
+private:
+    struct Entry
+    {
+        uint32_t piece = 0;
+        Piece data;
+        MemoryCharge charge;
+    };
+
+    void evictOldest();
+
+    MemoryBudget& m_budget;
+    size_t m_capacity;
+    std::list<Entry> m_lru;  // most recently used first
+    std::unordered_map<uint32_t, std::list<Entry>::iterator> m_index;
+};
+
+}  // namespace Torrent::Core
+#endif  // READCACHE_HPP
@@ -0,0 +1,347 @@
+#include "SessionManager.hpp"
+
+#include <Logger.hpp>
+#include <Metrics/Trace.hpp>
+
+#include <algorithm>
+#include <random>
+
+namespace Torrent::Core {
+
+SessionManager::SessionManager()
+    : SessionManager(Options{})
+{}
+
+SessionManager::SessionManager(Options options)
+    : m_options(options)
+    , m_workers(options.workers)
+    , m_disk(options.diskThreads, &m_workers)
+    , m_peerIds(std::random_device{}())
+{
+    for (size_t i = 0; i < std::max<size_t>(m_options.ioThreads, 1); ++i)
+    {
+        auto shard = std::make_unique<Shard>();
+        auto* raw  = shard.get();
+        raw->loop.runEvery(m_options.tickInterval, [this, raw] { tickShard(*raw); });
+        raw->thread = std::jthread(
+            [raw, i]
+            {
+                Metrics::Tracer::instance().setThreadName("session io " + std::to_string(i));
+                raw->loop.run();
+            });
+        m_shards.push_back(std::move(shard));
+    }
+    // on a loop rather than the pool so that the destructor's join of the loops also ends publishing
+    m_shards.front()->loop.runEvery(m_options.snapshotInterval, [this] { publishSnapshot(); });
+    LOG_INFO(SessionManager, "Session manager started", LOG_MD(Workers, m_workers.size()), LOG_MD(IoThreads, m_shards.size()));
+}
+
+SessionManager::~SessionManager()
+{
+    {
+        std::scoped_lock lk(m_mutex);
+        for (auto& [id, session] : m_sessions)
+        {
+            session->stop();
+        }
+    }
+    // prepares use the loops, the disk pool and the workers: end the magnet fetches among them and wait for
+    // every one while all of that still runs
+    for (auto& shard : m_shards)
+    {
+        shard->loop.post([raw = shard.get()] { cancelStopped(*raw); });
+    }
+    {
+        std::unique_lock lk(m_mutex);
+        m_prepared.wait(lk, [this] { return m_preparing == 0; });
+    }
+    // a thread that has not reached run() yet still sees the stop once it gets there
+    for (auto& shard : m_shards)
+    {
+        shard->loop.stop();
+        shard->thread = {};
+    }
+}
+
+SessionManager::SessionId SessionManager::add(const std::string& peerId, const std::string& filePath)
+{
+    return add(std::make_shared<TorrentSession>(peerId, filePath));
+}
+
+SessionManager::SessionId SessionManager::add(std::shared_ptr<TorrentSession> session)
+{
+    SessionId id;
+    Shard* shard;
+    {
+        std::scoped_lock lk(m_mutex);
+        id             = m_nextId++;
+        shard          = m_shards[m_nextShard++ % m_shards.size()].get();
+        m_sessions[id] = session;
+        ++m_preparing;
+    }
+
+    session->m_busy = true;
+    shard->loop.post([shard, session] { shard->sessions.push_back(session); });
+    m_workers.spawn(prepare(std::move(session), shard->loop));
+    return id;
+}
+
+bool SessionManager::remove(SessionId id)
+{
+    std::shared_ptr<TorrentSession> session;
+    {
+        std::scoped_lock lk(m_mutex);
+        auto it = m_sessions.find(id);
+        if (it == m_sessions.end())
+        {
+            return false;
+        }
+        session = std::move(it->second);
+        m_sessions.erase(it);
+    }
+    session->stop();
+    return true;
+}
+
+bool SessionManager::setPaused(SessionId id, bool paused)
+{
+    auto session = find(id);
+    if (!session)
+    {
+        return false;
+    }
+    session->setPaused(paused);
+    return true;
+}
+
+std::shared_ptr<TorrentSession> SessionManager::find(SessionId id) const
+{
+    std::scoped_lock lk(m_mutex);
+    auto it = m_sessions.find(id);
+    return it == m_sessions.end() ? nullptr : it->second;
+}
+
+size_t SessionManager::size() const
+{
+    std::scoped_lock lk(m_mutex);
+    return m_sessions.size();
+}
+
+std::string SessionManager::newPeerId()
+{
+    return "-SK0001-" + std::to_string(100'000'000'000 + m_peerIds.fetch_add(1, std::memory_order_relaxed) % 900'000'000'000);
+}
+
+size_t SessionManager::saveState(const std::string& path) const
+{
+    std::vector<std::pair<SessionId, std::shared_ptr<TorrentSession>>> sessions;
+    {
+        std::scoped_lock lk(m_mutex);
+        sessions.assign(m_sessions.begin(), m_sessions.end());
+    }
+    std::sort(sessions.begin(), sessions.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    std::vector<StateFile::Entry> entries;
+    entries.reserve(sessions.size());
+    for (const auto& [id, session] : sessions)
+    {
+        auto status = session->status();
+        if (status.stopRequested)
+        {
+            continue;
+        }
+        // as in publishSnapshot, Running means prepare is done with the metadata; the others, magnets still
+        // fetching theirs included, keep their source and are prepared again on restore
+        bool prepared = status.state == SessionState::Running;
+        entries.push_back({session->m_filePath, prepared ? &session->metadata() : nullptr, status.paused});
+    }
+    StateFile::write(path, entries);
+    LOG_INFO(SessionManager, "State saved", LOG_MD(Path, path), LOG_MD(Sessions, entries.size()));
+    return entries.size();
+}
+
+SessionManager::RestoreResult SessionManager::restoreState(const std::string& path)
+{
+    TRACE_SCOPE("SessionManager::restoreState");
+    auto file = StateFile::open(path);
+    RestoreResult result;
+    for (size_t i = 0; i < file->size(); ++i)
+    {
+        std::shared_ptr<TorrentSession> session;
+        if (auto view = file->session(i))
+        {
+            session = std::make_shared<TorrentSession>(newPeerId(), std::string(view->source()), view->toMetadata());
+            ++result.restored;
+        }
+        else if (auto source = file->source(i))
+        {
+            // prepare parses the .torrent (or fetches a magnet's metadata) as for a new session
+            if (!file->sourceOnly(i))
+            {
+                LOG_WARNING(SessionManager, "State file session damaged, adding it from its source", LOG_MD(Source, *source));
+            }
+            session = std::make_shared<TorrentSession>(newPeerId(), std::string(*source));
+            ++result.reparsed;
+        }
+        else
+        {
+            LOG_WARNING(SessionManager, "State file session lost", LOG_MD(Path, path), LOG_MD(Index, i));
+            continue;
+        }
+        session->setPaused(file->paused(i));
+        add(std::move(session));
+    }
+    LOG_INFO(SessionManager, "State restored", LOG_MD(Path, path), LOG_MD(Restored, result.restored),
+        LOG_MD(Reparsed, result.reparsed));
+    return result;
+}
+
+void SessionManager::publishSnapshot()
+{
+    TRACE_SCOPE("SessionManager::publishSnapshot");
+    auto next        = std::make_shared<Snapshot>();
+    next->taken      = std::chrono::system_clock::now();
+    next->steals     = m_workers.steals();
+    next->diskQueue  = m_disk.queueDepth();
+    next->snapshotNo = m_snapshot.load(std::memory_order_relaxed)->snapshotNo + 1;
+    {
+        std::scoped_lock lk(m_mutex);
+        next->sessions.reserve(m_sessions.size());
+        for (const auto& [id, session] : m_sessions)
+        {
+            auto status = session->status();
+            // the metadata is written by prepare only, which has finished once the state moved past Preparing
+            bool prepared = status.state != SessionState::Created && status.state != SessionState::Preparing;
+            next->sessions.push_back({id, session->m_filePath, prepared ? session->metadata().name : std::string{}, status});
+        }
+    }
+    std::sort(next->sessions.begin(), next->sessions.end(), [](const auto& a, const auto& b) { return a.id < b.id; });
+    m_snapshot.store(std::move(next), std::memory_order_release);
+}
+
+void SessionManager::markFailed(TorrentSession& session, const std::exception& e)
+{
+    session.m_state = SessionState::Failed;
+    LOG_CRITICAL(SessionManager, "Session task failed", LOG_MD(FilePath, session.m_filePath), LOG_MD(Error, e.what()));
+}
+
+Async::Task<void> SessionManager::prepare(std::shared_ptr<TorrentSession> session, Net::EventLoop& loop)
+{
+    try
+    {
+        co_await session->prepareSession({m_disk, m_workers, loop});
+    }
+    catch (const std::exception& e)
+    {
+        markFailed(*session, e);
+    }
+    session->m_busy.store(false, std::memory_order_release);
+    // notified under the lock, so the destructor cannot go on before this is done with the manager
+    std::scoped_lock lk(m_mutex);
+    if (--m_preparing == 0)
+    {
+        m_prepared.notify_all();
+    }
+}
+
+void SessionManager::runStep(TorrentSession& session, Step step)
+{
+    TRACE_SCOPE("SessionManager::runStep");
+    try
+    {
+        // dispatched before a stop, or still queued when the manager goes away
+        if (session.m_stopRequested.load(std::memory_order_acquire))
+        {
+            session.m_busy.store(false, std::memory_order_release);
+            return;
+        }
+        switch (step)
+        {
+            case Step::Announce: session.announce(); break;
+            case Step::Tick:     session.tick(TorrentSession::Clock::now()); break;
+        }
+    }
+    catch (const std::exception& e)
+    {
+        markFailed(session, e);
+    }
+    session.m_busy.store(false, std::memory_order_release);
+}
+
+void SessionManager::dispatch(Batch batch)
+{
+    m_workers.post(
+        [batch = std::move(batch)]
+        {
+            for (const auto& [session, step] : batch)
+            {
+                runStep(*session, step);
+            }
+        });
+}
+
+void SessionManager::cancelStopped(Shard& shard)
+{
+    for (const auto& session : shard.sessions)
+    {
+        if (session->m_stopRequested.load(std::memory_order_acquire))
+        {
+            session->cancelPrepare();
+        }
+    }
+}
+
+void SessionManager::tickShard(Shard& shard)
+{
+    TRACE_SCOPE("SessionManager::tickShard");
+    auto now = TorrentSession::Clock::now();
+    Batch batch;
+    batch.reserve(m_options.batchSize);
+
+    auto& sessions = shard.sessions;
+    for (size_t i = 0; i < sessions.size();)
+    {
+        auto& session = sessions[i];
+        if (session->m_busy.load(std::memory_order_acquire))
+        {
+            if (session->m_stopRequested.load(std::memory_order_acquire))
+            {
+                session->cancelPrepare();
+            }
+            ++i;
+            continue;
+        }
+
+        auto state = session->m_state.load(std::memory_order_acquire);
+        if (session->m_stopRequested.load(std::memory_order_acquire) || state == SessionState::Failed)
+        {
+            if (state != SessionState::Failed)
+            {
+                session->m_state = SessionState::Stopped;
+            }
+            session = std::move(sessions.back());
+            sessions.pop_back();
+            continue;
+        }
+
+        if (state == SessionState::Running && !session->m_paused.load(std::memory_order_relaxed))
+        {
+            session->m_busy = true;
+            batch.emplace_back(session, now >= session->nextAnnounce() ? Step::Announce : Step::Tick);
+            if (batch.size() == m_options.batchSize)
+            {
+                dispatch(std::move(batch));
+                batch = {};
+                batch.reserve(m_options.batchSize);
+            }
+        }
+        ++i;
+    }
+
+    if (!batch.empty())
+    {
+        dispatch(std::move(batch));
+    }
+}
+
+}  // namespace Torrent::Core
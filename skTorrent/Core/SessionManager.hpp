@@ -0,0 +1,145 @@
+#ifndef SESSIONMANAGER_HPP
+#define SESSIONMANAGER_HPP
+
+#include "StateFile.hpp"
+#include "TorrentSession.hpp"
+
+#include <Async/DiskIo.hpp>
+#include <Async/Executor.hpp>
+#include <Net/EventLoop.hpp>
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace Torrent::Core {
+
+// Hosts any number of TorrentSessions on a fixed set of threads: a work-stealing executor for session work
+// (metadata parsing, announces), a small disk pool and a few event loops that own timers and, later, peer sockets. Sessions are
+// pinned to one loop; that loop's tick decides which sessions need work and hands it to the pool in batches.
+class SessionManager
+{
+public:
+    using SessionId = uint64_t;
+
+    struct SessionSnapshot
+    {
+        SessionId id = 0;
+        std::string source;
+        std::string name;  // empty until the metadata is known
+        SessionStatus status;
+    };
+
+    // Copy of every session's status, rebuilt every snapshotInterval and swapped in atomically; readers never
+    // take a lock the sessions or the io threads use.
+    struct Snapshot
+    {
+        std::chrono::system_clock::time_point taken;
+        std::vector<SessionSnapshot> sessions;
+        uint64_t steals     = 0;
+        size_t diskQueue    = 0;
+        uint64_t snapshotNo = 0;
+    };
+
+    struct RestoreResult
+    {
+        size_t restored = 0;  // straight from the state file
+        size_t reparsed = 0;  // saved before their metadata was known or damaged, added from their source again
+    };
+
+    struct Options
+    {
+        size_t workers   = std::max(2u, std::thread::hardware_concurrency());
+        size_t ioThreads   = 1;
+        size_t diskThreads = 2;
+        std::chrono::milliseconds tickInterval{1'000};
+        size_t batchSize = 128;
+        std::chrono::milliseconds snapshotInterval{250};
+    };
+
+    SessionManager();
+    explicit SessionManager(Options options);
+    ~SessionManager();
+    SessionManager(const SessionManager&) = delete;
+
+    SessionId add(std::shared_ptr<TorrentSession> session);
+    SessionId add(const std::string& peerId, const std::string& filePath);
+    // Requests the session to stop; it is dropped on its loop's next tick.
+    bool remove(SessionId id);
+    bool setPaused(SessionId id, bool paused);
+    std::shared_ptr<TorrentSession> find(SessionId id) const;
+    size_t size() const;
+    // Azureus style: client tag and twelve digits, unique within this manager.
+    std::string newPeerId();
+
+    // Writes every session not asked to stop to a state file: the metadata of running ones, the source only of
+    // those still preparing or failed.
+    size_t saveState(const std::string& path) const;
+    // Adds back every session of a state file written by saveState. Throws std::runtime_error if the file cannot
+    // be used at all.
+    RestoreResult restoreState(const std::string& path);
+    // The latest published snapshot; never null.
+    std::shared_ptr<const Snapshot> snapshot() const
+    {
+        return m_snapshot.load(std::memory_order_acquire);
+    }
+
+    Async::Executor& workers()
+    {
+        return m_workers;
+    }
+
+    Net::EventLoop& ioLoop(size_t index)
+    {
+        return m_shards[index]->loop;
+    }
+
+    size_t ioThreads() const
+    {
+        return m_shards.size();
+    }
+
+private:
+    enum class Step : uint8_t
+    {
+        Announce,
+        Tick
+    };
+
+    struct Shard
+    {
+        Net::EventLoop loop;
+        std::vector<std::shared_ptr<TorrentSession>> sessions;  // touched on the loop thread only
+        std::jthread thread;
+    };
+
+    using Batch = std::vector<std::pair<std::shared_ptr<TorrentSession>, Step>>;
+
+    void tickShard(Shard& shard);
+    static void cancelStopped(Shard& shard);
+    void publishSnapshot();
+    void dispatch(Batch batch);
+    Async::Task<void> prepare(std::shared_ptr<TorrentSession> session, Net::EventLoop& loop);
+    static void runStep(TorrentSession& session, Step step);
+    static void markFailed(TorrentSession& session, const std::exception& e);
+
+    Options m_options;
+    Async::Executor m_workers;
+    Async::DiskIo m_disk;
+    std::vector<std::unique_ptr<Shard>> m_shards;
+
+    mutable std::mutex m_mutex;
+    std::unordered_map<SessionId, std::shared_ptr<TorrentSession>> m_sessions;
+    SessionId m_nextId = 1;
+    size_t m_nextShard = 0;
+    size_t m_preparing = 0;  // prepare() tasks not finished yet
+    std::condition_variable m_prepared;
+    std::atomic<uint64_t> m_peerIds;
+
+    std::atomic<std::shared_ptr<const Snapshot>> m_snapshot{std::make_shared<const Snapshot>()};
+};
+
+}  // namespace Torrent::Core
+#endif  // SESSIONMANAGER_HPP
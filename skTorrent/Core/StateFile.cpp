@@ -0,0 +1,438 @@
+#include "StateFile.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace Torrent::Core {
+
+static_assert(std::endian::native == std::endian::little, "the state file is stored little endian");
+
+namespace {
+// CRC-32C (Castagnoli), eight table lookups per 8 input bytes
+constexpr auto kCrcTables = []
+{
+    std::array<std::array<uint32_t, 256>, 8> tables{};
+    for (uint32_t i = 0; i < 256; ++i)
+    {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; ++bit)
+        {
+            crc = (crc >> 1) ^ (0x82F6'3B78u & (0u - (crc & 1)));
+        }
+        tables[0][i] = crc;
+    }
+    for (uint32_t i = 0; i < 256; ++i)
+    {
+        for (size_t t = 1; t < 8; ++t)
+        {
+            tables[t][i] = (tables[t - 1][i] >> 8) ^ tables[0][tables[t - 1][i] & 0xFF];
+        }
+    }
+    return tables;
+}();
+
+std::span<const uint8_t> bytes(const void* data, size_t size)
+{
+    return {static_cast<const uint8_t*>(data), size};
+}
+
+uint32_t headerCrc(StateFormat::Header header)
+{
+    header.headerCrc = 0;
+    return crc32c(bytes(&header, sizeof(header)));
+}
+
+[[noreturn]] void corrupt(const std::string& path, const char* reason)
+{
+    throw std::runtime_error("State file " + path + " is unusable: " + reason);
+}
+
+// Appends one session's data block to the file image and fills in the ranges pointing into it.
+class BlockWriter
+{
+public:
+    explicit BlockWriter(std::string& out)
+        : m_out(out)
+    {}
+
+    StateFormat::Range string(std::string_view value)
+    {
+        StateFormat::Range range{m_out.size(), value.size()};
+        m_out.append(value);
+        return range;
+    }
+
+    template <typename T>
+    StateFormat::Range table(const std::vector<T>& rows)
+    {
+        align();
+        StateFormat::Range range{m_out.size(), rows.size() * sizeof(T)};
+        m_out.append(reinterpret_cast<const char*>(rows.data()), range.size);
+        return range;
+    }
+
+    void align()
+    {
+        m_out.resize((m_out.size() + 7) & ~size_t{7}, '\0');
+    }
+
+private:
+    std::string& m_out;
+};
+
+StateFormat::Session writeSession(std::string& out, const StateFile::Entry& entry)
+{
+    BlockWriter block(out);
+    StateFormat::Session record;
+    record.source    = block.string(entry.source);
+    record.sourceCrc = crc32c(bytes(entry.source.data(), entry.source.size()));
+    block.align();
+    if (!entry.meta)
+    {
+        record.flags = StateFormat::SourceOnly | (entry.paused ? uint32_t{StateFormat::Paused} : 0u);
+        return record;
+    }
+
+    const auto& meta    = *entry.meta;
+    record.data.offset  = out.size();
+    record.name         = block.string(meta.name);
+    record.announce     = block.string(meta.announce);
+    record.infoHash     = block.string(meta.infoHash);
+    record.infoHashV2   = block.string(meta.infoHashV2);
+    record.pieceLength  = meta.pieceLength;
+    record.totalSize    = meta.totalSize;
+    record.metaVersion  = meta.metaVersion;
+    record.flags        = entry.paused ? uint32_t{StateFormat::Paused} : 0u;
+    record.pieces       = {out.size(), 0};
+    for (const auto& hash : meta.pieceHashes)
+    {
+        if (hash.size() != 20)
+        {
+            throw std::runtime_error("Piece hash of " + meta.name + " is not 20 bytes");
+        }
+        out.append(hash);
+    }
+    record.pieces.size = out.size() - record.pieces.offset;
+
+    std::vector<StateFormat::File> files;
+    files.reserve(meta.files.size());
+    for (const auto& file : meta.files)
+    {
+        files.push_back({block.string(file.path), block.string(file.piecesRoot), file.size, file.padding ? 1u : 0u});
+    }
+    std::vector<StateFormat::Tracker> trackers;
+    for (size_t tier = 0; tier < meta.announceList.size(); ++tier)
+    {
+        for (const auto& url : meta.announceList[tier])
+        {
+            trackers.push_back({block.string(url), tier});
+        }
+    }
+    std::vector<StateFormat::Layer> layers;
+    layers.reserve(meta.pieceLayers.size());
+    for (const auto& [root, hashes] : meta.pieceLayers)
+    {
+        layers.push_back({block.string(root), block.string(hashes)});
+    }
+    record.files    = block.table(files);
+    record.trackers = block.table(trackers);
+    record.layers   = block.table(layers);
+
+    record.data.size = out.size() - record.data.offset;
+    record.dataCrc   = crc32c(bytes(out.data() + record.data.offset, record.data.size));
+    return record;
+}
+
+bool within(const StateFormat::Range& range, const StateFormat::Range& outer)
+{
+    return range.offset >= outer.offset && range.size <= outer.size && range.offset - outer.offset <= outer.size - range.size;
+}
+
+template <typename T>
+bool tableWithin(const StateFormat::Range& range, const StateFormat::Range& outer)
+{
+    return within(range, outer) && range.offset % alignof(T) == 0 && range.size % sizeof(T) == 0;
+}
+
+[[noreturn]] void fail(const std::string& what, const std::string& path, int error)
+{
+    throw std::runtime_error(what + ' ' + path + ": " + std::strerror(error));
+}
+
+// Returns once data is on the device, not only in the page cache.
+void writeDurably(const std::string& path, std::string_view data)
+{
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        fail("Cannot create state file", path, errno);
+    }
+    while (!data.empty())
+    {
+        ssize_t n = ::write(fd, data.data(), data.size());
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n < 0)
+        {
+            int error = errno;
+            ::close(fd);
+            fail("Cannot write state file", path, error);
+        }
+        data.remove_prefix(static_cast<size_t>(n));
+    }
+    if (::fsync(fd) != 0)
+    {
+        int error = errno;
+        ::close(fd);
+        fail("Cannot sync state file", path, error);
+    }
+    ::close(fd);
+}
+
+// makes a rename inside the directory durable
+void syncDirectory(const std::string& path)
+{
+    auto dir = std::filesystem::path(path).parent_path();
+    int fd   = ::open(dir.empty() ? "." : dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0 || ::fsync(fd) != 0)
+    {
+        int error = errno;
+        if (fd >= 0)
+        {
+            ::close(fd);
+        }
+        fail("Cannot sync the directory of", path, error);
+    }
+    ::close(fd);
+}
+}  // namespace
+
+uint32_t crc32c(std::span<const uint8_t> data, uint32_t crc)
+{
+    const auto& t = kCrcTables;
+    crc           = ~crc;
+    size_t i      = 0;
+    for (; i + 8 <= data.size(); i += 8)
+    {
+        uint64_t word;
+        std::memcpy(&word, data.data() + i, sizeof(word));
+        word ^= crc;
+        crc = t[7][word & 0xFF] ^ t[6][(word >> 8) & 0xFF] ^ t[5][(word >> 16) & 0xFF] ^ t[4][(word >> 24) & 0xFF] ^
+              t[3][(word >> 32) & 0xFF] ^ t[2][(word >> 40) & 0xFF] ^ t[1][(word >> 48) & 0xFF] ^ t[0][word >> 56];
+    }
+    for (; i < data.size(); ++i)
+    {
+        crc = t[0][(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+SessionView::File SessionView::file(size_t index) const
+{
+    const auto& file = table<StateFormat::File>(m_record->files)[index];
+    return {string(file.path), file.size, string(file.piecesRoot), file.padding != 0};
+}
+
+Metadata SessionView::toMetadata() const
+{
+    Metadata meta;
+    meta.announce    = string(m_record->announce);
+    meta.name        = string(m_record->name);
+    meta.pieceLength = m_record->pieceLength;
+    meta.totalSize   = m_record->totalSize;
+    meta.infoHash    = string(m_record->infoHash);
+    meta.metaVersion = m_record->metaVersion;
+    meta.infoHashV2  = string(m_record->infoHashV2);
+
+    meta.pieceHashes.reserve(pieceCount());
+    for (size_t i = 0; i < pieceCount(); ++i)
+    {
+        meta.pieceHashes.emplace_back(pieceHash(i));
+    }
+    meta.files.reserve(fileCount());
+    for (size_t i = 0; i < fileCount(); ++i)
+    {
+        auto view = file(i);
+        meta.files.push_back({std::string(view.path), view.size, std::string(view.piecesRoot), view.padding});
+    }
+    for (const auto& tracker : table<StateFormat::Tracker>(m_record->trackers))
+    {
+        meta.announceList.resize(std::max<size_t>(meta.announceList.size(), tracker.tier + 1));
+        meta.announceList[tracker.tier].emplace_back(string(tracker.url));
+    }
+    for (const auto& layer : table<StateFormat::Layer>(m_record->layers))
+    {
+        meta.pieceLayers.emplace(string(layer.root), string(layer.hashes));
+    }
+    return meta;
+}
+
+void StateFile::write(const std::string& path, std::span<const Entry> sessions)
+{
+    std::string out(sizeof(StateFormat::Header) + sessions.size() * sizeof(StateFormat::Session), '\0');
+    std::vector<StateFormat::Session> records;
+    records.reserve(sessions.size());
+    for (const auto& entry : sessions)
+    {
+        records.push_back(writeSession(out, entry));
+    }
+
+    StateFormat::Header header;
+    std::memcpy(header.magic, StateFormat::Magic.data(), sizeof(header.magic));
+    header.version   = StateFormat::Version;
+    header.sessions  = static_cast<uint32_t>(records.size());
+    header.fileSize  = out.size();
+    header.table     = {sizeof(header), records.size() * sizeof(StateFormat::Session)};
+    header.tableCrc  = crc32c(bytes(records.data(), header.table.size));
+    header.headerCrc = headerCrc(header);
+    std::memcpy(out.data(), &header, sizeof(header));
+    std::memcpy(out.data() + header.table.offset, records.data(), header.table.size);
+
+    // the new file is on the device before it replaces the old one, and the rename is before write() returns:
+    // a crash or power loss at any point leaves either the previous state file or the complete new one
+    auto temporary = path + ".tmp";
+    writeDurably(temporary, out);
+    if (::rename(temporary.c_str(), path.c_str()) != 0)
+    {
+        int error = errno;
+        ::unlink(temporary.c_str());
+        fail("Cannot replace state file", path, error);
+    }
+    syncDirectory(path);
+}
+
+std::shared_ptr<const StateFile> StateFile::open(const std::string& path)
+{
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        throw std::runtime_error("Cannot open state file " + path);
+    }
+    struct stat info{};
+    if (::fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(StateFormat::Header))
+    {
+        ::close(fd);
+        corrupt(path, "too short");
+    }
+    auto size  = static_cast<size_t>(info.st_size);
+    void* base = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED)
+    {
+        throw std::runtime_error("Cannot map state file " + path);
+    }
+    std::shared_ptr<const StateFile> file(new StateFile(static_cast<const uint8_t*>(base), size));
+
+    const auto& header = *reinterpret_cast<const StateFormat::Header*>(base);
+    if (std::memcmp(header.magic, StateFormat::Magic.data(), sizeof(header.magic)) != 0)
+    {
+        corrupt(path, "not a state file");
+    }
+    if (header.headerCrc != headerCrc(header))
+    {
+        corrupt(path, "header checksum mismatch");
+    }
+    if (header.version != StateFormat::Version)
+    {
+        corrupt(path, "unsupported version");
+    }
+    if (header.fileSize != size)
+    {
+        corrupt(path, "truncated");
+    }
+    if (header.table.size != uint64_t{header.sessions} * sizeof(StateFormat::Session) ||
+        !tableWithin<StateFormat::Session>(header.table, {0, size}))
+    {
+        corrupt(path, "session table out of bounds");
+    }
+    if (header.tableCrc != crc32c(bytes(file->m_base + header.table.offset, header.table.size)))
+    {
+        corrupt(path, "session table checksum mismatch");
+    }
+    const_cast<StateFile&>(*file).m_sessions = {
+        reinterpret_cast<const StateFormat::Session*>(file->m_base + header.table.offset), header.sessions};
+    return file;
+}
+
+StateFile::StateFile(const uint8_t* base, size_t size)
+    : m_base(base)
+    , m_size(size)
+{}
+
+StateFile::~StateFile()
+{
+    ::munmap(const_cast<uint8_t*>(m_base), m_size);
+}
+
+std::optional<std::string_view> StateFile::source(size_t index) const
+{
+    const auto& range = m_sessions[index].source;
+    if (!within(range, {0, m_size}) || m_sessions[index].sourceCrc != crc32c(bytes(m_base + range.offset, range.size)))
+    {
+        return std::nullopt;
+    }
+    return std::string_view(reinterpret_cast<const char*>(m_base + range.offset), range.size);
+}
+
+std::optional<SessionView> StateFile::session(size_t index) const
+{
+    const auto& record = m_sessions[index];
+    if (!valid(record))
+    {
+        return std::nullopt;
+    }
+    return SessionView(m_base, record);
+}
+
+bool StateFile::valid(const StateFormat::Session& record) const
+{
+    using namespace StateFormat;
+    const auto& data = record.data;
+    if (record.flags & SourceOnly)
+    {
+        return false;
+    }
+    if (!within(data, {0, m_size}) || record.dataCrc != crc32c(bytes(m_base + data.offset, data.size)) ||
+        !within(record.source, {0, m_size}))
+    {
+        return false;
+    }
+    for (const auto* range : {&record.name, &record.announce, &record.infoHash, &record.infoHashV2})
+    {
+        if (!within(*range, data))
+        {
+            return false;
+        }
+    }
+    if (!within(record.pieces, data) || record.pieces.size % 20 != 0 || !tableWithin<File>(record.files, data) ||
+        !tableWithin<Tracker>(record.trackers, data) || !tableWithin<Layer>(record.layers, data))
+    {
+        return false;
+    }
+
+    // a block that matches its checksum was written by us, but the nested ranges are cheap to check as well
+    SessionView view(m_base, record);
+    auto files    = view.table<File>(record.files);
+    auto trackers = view.table<Tracker>(record.trackers);
+    auto layers   = view.table<Layer>(record.layers);
+    return std::all_of(files.begin(), files.end(),
+               [&](const File& f) { return within(f.path, data) && within(f.piecesRoot, data); }) &&
+           std::all_of(trackers.begin(), trackers.end(),
+               [&](const Tracker& t) { return within(t.url, data) && t.tier < trackers.size(); }) &&
+           std::all_of(layers.begin(), layers.end(),
+               [&](const Layer& l) { return within(l.root, data) && within(l.hashes, data); });
+}
+
+}  // namespace Torrent::Core
@@ -0,0 +1,228 @@
+#ifndef STATEFILE_HPP
+#define STATEFILE_HPP
+
+#include <Utils/MetaUtils.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace Torrent::Core {
+
+// On-disk layout of the session state file. Every position is a byte offset from the start of the file, so the
+// file can be mapped anywhere and read in place. After the header comes the session table and then one data
+// block per session holding its strings, its packed 20-byte piece hashes and its file, tracker and piece layer
+// tables, all 8-byte aligned. The header and the table carry a CRC-32C; each data block carries its own so that a
+// damaged block costs only that session. The session's source sits just before its block under a checksum of its
+// own, so a damaged session can still be added again from its .torrent; a session saved before its metadata was
+// known has the source only. Little endian only.
+namespace StateFormat {
+constexpr std::string_view Magic = "SKSTATE\n";
+constexpr uint32_t Version       = 1;
+
+struct Range
+{
+    uint64_t offset = 0;
+    uint64_t size   = 0;
+};
+
+struct Header
+{
+    char magic[8]      = {};
+    uint32_t version   = 0;
+    uint32_t sessions  = 0;
+    uint64_t fileSize  = 0;
+    Range table;  // Session[sessions]
+    uint32_t tableCrc  = 0;
+    uint32_t headerCrc = 0;  // over the header with this field zeroed
+};
+
+enum SessionFlags : uint32_t
+{
+    Paused     = 1,
+    SourceOnly = 2  // no data block
+};
+
+struct Session
+{
+    Range source;  // outside data
+    Range name;
+    Range announce;
+    Range infoHash;
+    Range infoHashV2;
+    uint64_t pieceLength = 0;
+    uint64_t totalSize   = 0;
+    uint32_t metaVersion = 0;
+    uint32_t flags       = 0;
+    Range pieces;    // 20 bytes each
+    Range files;     // File[]
+    Range trackers;  // Tracker[], announce-list in tier order
+    Range layers;    // Layer[]
+    Range data;      // everything above lies inside
+    uint32_t dataCrc   = 0;
+    uint32_t sourceCrc = 0;
+};
+
+struct File
+{
+    Range path;
+    Range piecesRoot;
+    uint64_t size    = 0;
+    uint64_t padding = 0;
+};
+
+struct Tracker
+{
+    Range url;
+    uint64_t tier = 0;
+};
+
+struct Layer
+{
+    Range root;
+    Range hashes;
+};
+}  // namespace StateFormat
+
+uint32_t crc32c(std::span<const uint8_t> data, uint32_t crc = 0);
+
+// Read-only view of one session inside a mapped state file; valid while the StateFile lives.
+class SessionView
+{
+public:
+    struct File
+    {
+        std::string_view path;
+        uint64_t size = 0;
+        std::string_view piecesRoot;
+        bool padding = false;
+    };
+
+    SessionView(const uint8_t* base, const StateFormat::Session& record)
+        : m_base(base)
+        , m_record(&record)
+    {}
+
+    std::string_view source() const
+    {
+        return string(m_record->source);
+    }
+
+    std::string_view name() const
+    {
+        return string(m_record->name);
+    }
+
+    std::string_view infoHash() const
+    {
+        return string(m_record->infoHash);
+    }
+
+    uint64_t totalSize() const
+    {
+        return m_record->totalSize;
+    }
+
+    bool paused() const
+    {
+        return m_record->flags & StateFormat::Paused;
+    }
+
+    size_t pieceCount() const
+    {
+        return m_record->pieces.size / 20;
+    }
+
+    std::string_view pieceHash(size_t piece) const
+    {
+        return string(m_record->pieces).substr(piece * 20, 20);
+    }
+
+    size_t fileCount() const
+    {
+        return table<StateFormat::File>(m_record->files).size();
+    }
+
+    File file(size_t index) const;
+
+    // Copies everything into the owning form the sessions work with.
+    Metadata toMetadata() const;
+
+private:
+    friend class StateFile;
+
+    std::string_view string(const StateFormat::Range& range) const
+    {
+        return {reinterpret_cast<const char*>(m_base + range.offset), range.size};
+    }
+
+    template <typename T>
+    std::span<const T> table(const StateFormat::Range& range) const
+    {
+        return {reinterpret_cast<const T*>(m_base + range.offset), range.size / sizeof(T)};
+    }
+
+    const uint8_t* m_base;
+    const StateFormat::Session* m_record;
+};
+
+// A state file mapped read-only. Opening checks the header and the session table only; every session is checked
+// when it is asked for, so one damaged session does not hold up the others.
+class StateFile
+{
+public:
+    struct Entry
+    {
+        std::string_view source;
+        const Metadata* meta = nullptr;  // null to keep the source only
+        bool paused          = false;
+    };
+
+    // Writes to a temporary file next to path, syncs it, renames it over path and syncs the directory. Throws
+    // std::runtime_error on failure, leaving the previous file in place.
+    static void write(const std::string& path, std::span<const Entry> sessions);
+
+    // Throws std::runtime_error if the file is missing, of another version or its header or table is damaged.
+    static std::shared_ptr<const StateFile> open(const std::string& path);
+
+    ~StateFile();
+    StateFile(const StateFile&) = delete;
+
+    size_t size() const
+    {
+        return m_sessions.size();
+    }
+
+    // Empty when the session was written with its source only, its ranges point outside its data block or the
+    // block fails its checksum.
+    std::optional<SessionView> session(size_t index) const;
+
+    // The .torrent path or magnet URI a session was added from, for re-adding it when session() is empty. Empty
+    // when the source is damaged as well.
+    std::optional<std::string_view> source(size_t index) const;
+
+    bool paused(size_t index) const
+    {
+        return m_sessions[index].flags & StateFormat::Paused;
+    }
+
+    bool sourceOnly(size_t index) const
+    {
+        return m_sessions[index].flags & StateFormat::SourceOnly;
+    }
+
+private:
+    StateFile(const uint8_t* base, size_t size);
+
+    bool valid(const StateFormat::Session& record) const;
+
+    const uint8_t* m_base;
+    size_t m_size;
+    std::span<const StateFormat::Session> m_sessions;
+};
+
+}  // namespace Torrent::Core
+#endif  // STATEFILE_HPP
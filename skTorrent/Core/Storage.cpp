@@ -0,0 +1,296 @@
+#include "Storage.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace Torrent::Core {
+
+namespace {
+constexpr size_t kMoveChunk = 1 << 20;
+
+std::runtime_error ioError(const std::string& what, const std::string& path)
+{
+    return std::runtime_error(what + " " + path + ": " + std::strerror(errno));
+}
+}  // namespace
+
+Storage::Storage(const Metadata& meta, const std::string& savePath, std::span<const Priority> filePriorities)
+{
+    namespace fs = std::filesystem;
+    bool single  = meta.files.size() == 1 && meta.files.front().path == meta.name;
+    fs::path root = single ? fs::path(savePath) : fs::path(savePath) / meta.name;
+    m_partPath    = (fs::path(savePath) / ("." + meta.name + ".parts")).string();
+    if (!filePriorities.empty() && filePriorities.size() != meta.files.size())
+    {
+        throw std::runtime_error("Expected " + std::to_string(meta.files.size()) + " file priorities");
+    }
+
+    try
+    {
+        for (size_t i = 0; i < meta.files.size(); ++i)
+        {
+            const auto& entry = meta.files[i];
+            File file{(root / entry.path).string(), m_totalSize, entry.size, -1};
+            m_totalSize += entry.size;
+            if (!entry.padding && entry.size > 0)
+            {
+                bool skipped  = !filePriorities.empty() && filePriorities[i] == Priority::Skip;
+                file.deferred = skipped && !fs::exists(file.path);
+                if (!file.deferred)
+                {
+                    create(file);
+                }
+            }
+            m_files.push_back(std::move(file));
+        }
+        // bytes of deferred files from an earlier run
+        if (fs::exists(m_partPath))
+        {
+            m_partFd = ::open(m_partPath.c_str(), O_RDWR | O_CLOEXEC);
+            if (m_partFd < 0)
+            {
+                throw ioError("Failed to open", m_partPath);
+            }
+        }
+    }
+    catch (...)
+    {
+        for (auto& file : m_files)
+        {
+            if (file.fd >= 0)
+            {
+                ::close(file.fd);
+            }
+        }
+        throw;
+    }
+}
+
+Storage::~Storage()
+{
+    for (auto& file : m_files)
+    {
+        if (file.fd >= 0)
+        {
+            ::close(file.fd);
+        }
+    }
+    if (m_partFd >= 0)
+    {
+        ::close(m_partFd);
+    }
+}
+
+void Storage::create(File& file)
+{
+    std::filesystem::create_directories(std::filesystem::path(file.path).parent_path());
+    file.fd = ::open(file.path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (file.fd < 0 || ::ftruncate(file.fd, static_cast<off_t>(file.size)) != 0)
+    {
+        auto error = ioError("Failed to create", file.path);
+        if (file.fd >= 0)
+        {
+            ::close(file.fd);
+            file.fd = -1;
+        }
+        throw error;
+    }
+}
+
+bool Storage::allocated(size_t index) const
+{
+    std::scoped_lock lock(m_mutex);
+    return !m_files.at(index).deferred;
+}
+
+void Storage::allocate(size_t index)
+{
+    std::scoped_lock lock(m_mutex);
+    auto& file = m_files.at(index);
+    if (!file.deferred)
+    {
+        return;
+    }
+    create(file);
+    try
+    {
+        // copy the extents the partfile holds within the file; holes were never written
+        std::vector<uint8_t> buffer;
+        auto end = static_cast<off_t>(file.offset + file.size);
+        auto pos = static_cast<off_t>(file.offset);
+        while (m_partFd >= 0 && pos < end)
+        {
+            off_t data = ::lseek(m_partFd, pos, SEEK_DATA);
+            if (data < 0 || data >= end)
+            {
+                break;  // ENXIO: nothing past pos
+            }
+            off_t hole = std::min(::lseek(m_partFd, data, SEEK_HOLE), end);
+            buffer.resize(kMoveChunk);
+            for (off_t at = data; at < hole;)
+            {
+                auto chunk = std::span(buffer).first(static_cast<size_t>(std::min<off_t>(hole - at, kMoveChunk)));
+                size_t n   = readPart(static_cast<uint64_t>(at), chunk);
+                if (n == 0)
+                {
+                    break;
+                }
+                auto within = at - static_cast<off_t>(file.offset);
+                for (size_t done = 0; done < n;)
+                {
+                    ssize_t w = ::pwrite(file.fd, chunk.data() + done, n - done, within + static_cast<off_t>(done));
+                    if (w < 0)
+                    {
+                        throw ioError("Failed to write", file.path);
+                    }
+                    done += static_cast<size_t>(w);
+                }
+                at += static_cast<off_t>(n);
+            }
+            pos = hole;
+        }
+    }
+    catch (...)
+    {
+        ::close(file.fd);
+        file.fd = -1;
+        throw;
+    }
+    if (m_partFd >= 0)
+    {
+        // best effort: the bytes are in the file now
+        ::fallocate(m_partFd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, static_cast<off_t>(file.offset),
+            static_cast<off_t>(file.size));
+    }
+    file.deferred = false;
+}
+
+size_t Storage::readPart(uint64_t offset, std::span<uint8_t> out)
+{
+    size_t done = 0;
+    while (m_partFd >= 0 && done < out.size())
+    {
+        ssize_t n = ::pread(m_partFd, out.data() + done, out.size() - done, static_cast<off_t>(offset + done));
+        if (n < 0)
+        {
+            throw ioError("Failed to read", m_partPath);
+        }
+        if (n == 0)
+        {
+            break;
+        }
+        done += static_cast<size_t>(n);
+    }
+    return done;
+}
+
+void Storage::writePart(uint64_t offset, std::span<const uint8_t> data)
+{
+    if (m_partFd < 0)
+    {
+        m_partFd = ::open(m_partPath.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (m_partFd < 0)
+        {
+            throw ioError("Failed to create", m_partPath);
+        }
+    }
+    for (size_t done = 0; done < data.size();)
+    {
+        ssize_t n = ::pwrite(m_partFd, data.data() + done, data.size() - done, static_cast<off_t>(offset + done));
+        if (n < 0)
+        {
+            throw ioError("Failed to write", m_partPath);
+        }
+        done += static_cast<size_t>(n);
+    }
+}
+
+size_t Storage::fileAt(uint64_t offset) const
+{
+    auto it =
+        std::upper_bound(m_files.begin(), m_files.end(), offset, [](uint64_t off, const File& f) { return off < f.offset; });
+    return static_cast<size_t>(std::distance(m_files.begin(), it)) - 1;
+}
+
+Async::Task<void> Storage::read(Async::DiskIo& disk, uint64_t offset, std::span<uint8_t> out)
+{
+    if (offset + out.size() > m_totalSize)
+    {
+        throw std::runtime_error("Read past the end of the torrent");
+    }
+    for (size_t i = out.empty() ? m_files.size() : fileAt(offset); i < m_files.size() && !out.empty(); ++i)
+    {
+        const auto& file = m_files[i];
+        uint64_t within  = offset - file.offset;
+        if (within >= file.size)
+        {
+            continue;
+        }
+        auto chunk  = out.first(static_cast<size_t>(std::min<uint64_t>(out.size(), file.size - within)));
+        size_t done = 0;
+        int fd      = -1;
+        {
+            std::scoped_lock lock(m_mutex);
+            fd = file.fd;
+            if (file.deferred)
+            {
+                done = readPart(offset, chunk);
+            }
+        }
+        while (done < chunk.size() && fd >= 0)
+        {
+            size_t n = co_await disk.read(fd, within + done, chunk.subspan(done));
+            if (n == 0)
+            {
+                break;
+            }
+            done += n;
+        }
+        std::fill(chunk.begin() + static_cast<ptrdiff_t>(done), chunk.end(), uint8_t{0});
+        offset += chunk.size();
+        out     = out.subspan(chunk.size());
+    }
+}
+
+Async::Task<void> Storage::write(Async::DiskIo& disk, uint64_t offset, std::span<const uint8_t> data)
+{
+    if (offset + data.size() > m_totalSize)
+    {
+        throw std::runtime_error("Write past the end of the torrent");
+    }
+    for (size_t i = data.empty() ? m_files.size() : fileAt(offset); i < m_files.size() && !data.empty(); ++i)
+    {
+        const auto& file = m_files[i];
+        uint64_t within  = offset - file.offset;
+        if (within >= file.size)
+        {
+            continue;
+        }
+        auto chunk = data.first(static_cast<size_t>(std::min<uint64_t>(data.size(), file.size - within)));
+        int fd     = -1;
+        {
+            std::scoped_lock lock(m_mutex);
+            fd = file.fd;
+            if (file.deferred)
+            {
+                writePart(offset, chunk);
+            }
+        }
+        size_t done = 0;
+        while (done < chunk.size() && fd >= 0)
+        {
+            done += co_await disk.write(fd, within + done, chunk.subspan(done));
+        }
+        offset += chunk.size();
+        data    = data.subspan(chunk.size());
+    }
+}
+
+}  // namespace Torrent::Core
@@ -0,0 +1,99 @@
+#ifndef STORAGE_HPP
+#define STORAGE_HPP
+
+#include "PiecePicker.hpp"
+
+#include <Async/DiskIo.hpp>
+#include <Utils/MetaUtils.hpp>
+
+#include <mutex>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace Torrent::Core {
+
+// Maps the torrent's contiguous byte space onto its files below savePath: a single-file torrent is
+// savePath/name, anything else lives in savePath/name/. Files are created at full size up front; pad files are
+// never written and read back as zeros. I/O goes through the disk pool, so callers resume wherever that pool
+// resumes them.
+//
+// Files skipped at construction are not created unless they already exist. Whatever falls into them, typically
+// the edges of pieces shared with a wanted file, goes to the partfile savePath/.<name>.parts instead: a sparse
+// file laid out like the torrent, created on the first such write. allocate() creates a skipped file once it is
+// wanted and moves its bytes out of the partfile. Partfile I/O is small and runs inline under a lock, which
+// keeps it ordered with allocate().
+class Storage
+{
+public:
+    // filePriorities: one per Metadata::files entry, or empty for none skipped.
+    Storage(const Metadata& meta, const std::string& savePath, std::span<const Priority> filePriorities = {});
+    ~Storage();
+    Storage(const Storage&) = delete;
+
+    // Short files (EOF) read as zeros.
+    Async::Task<void> read(Async::DiskIo& disk, uint64_t offset, std::span<uint8_t> out);
+    Async::Task<void> write(Async::DiskIo& disk, uint64_t offset, std::span<const uint8_t> data);
+
+    // Offset of a file's first byte within the torrent.
+    uint64_t fileOffset(size_t index) const
+    {
+        return m_files.at(index).offset;
+    }
+
+    uint64_t fileSize(size_t index) const
+    {
+        return m_files.at(index).size;
+    }
+
+    size_t fileCount() const
+    {
+        return m_files.size();
+    }
+
+    const std::string& filePath(size_t index) const
+    {
+        return m_files.at(index).path;
+    }
+
+    uint64_t totalSize() const
+    {
+        return m_totalSize;
+    }
+
+    // False for files skipped at construction and not allocated since.
+    bool allocated(size_t index) const;
+    // Creates a skipped file at full size and moves its bytes out of the partfile. Blocks; call it off the loop.
+    void allocate(size_t index);
+
+    const std::string& partPath() const
+    {
+        return m_partPath;
+    }
+
+private:
+    struct File
+    {
+        std::string path;
+        uint64_t offset = 0;
+        uint64_t size   = 0;
+        int fd          = -1;     // -1 for pad, empty and deferred files
+        bool deferred   = false;  // skipped and not created: its bytes live in the partfile
+    };
+
+    // First file overlapping offset; files are sorted by offset.
+    size_t fileAt(uint64_t offset) const;
+    static void create(File& file);
+    // At torrent offsets, with m_mutex held. Reads stop where the partfile ends.
+    size_t readPart(uint64_t offset, std::span<uint8_t> out);
+    void writePart(uint64_t offset, std::span<const uint8_t> data);
+
+    std::vector<File> m_files;
+    uint64_t m_totalSize = 0;
+    std::string m_partPath;
+    int m_partFd = -1;
+    mutable std::mutex m_mutex;  // fd and deferred of every file, and the partfile
+};
+
+}  // namespace Torrent::Core
+#endif  // STORAGE_HPP
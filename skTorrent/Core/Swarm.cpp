@@ -0,0 +1,763 @@
+#include "Swarm.hpp"
+
+#include <Async/IoAwaitables.hpp>
+#include <Net/TcpStream.hpp>
+
+#include <Logger.hpp>
+
+#include <openssl/sha.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace Torrent::Core {
+
+namespace {
+constexpr auto kPressureBackoff = std::chrono::milliseconds(20);
+
+std::span<const uint8_t> bytes(const std::string& s)
+{
+    return {reinterpret_cast<const uint8_t*>(s.data()), s.size()};
+}
+
+bool hashMatches(std::span<const uint8_t> data, const std::string& expected)
+{
+    static auto& hashTime =
+        Metrics::Registry::global().histogram("sktorrent_piece_hash_microseconds", "Time to hash one piece");
+    static auto& hashedBytes = Metrics::Registry::global().counter("sktorrent_hashed_bytes_total", "Bytes hashed");
+    Metrics::ScopedTimer timer(hashTime);
+    hashedBytes.add(data.size());
+    unsigned char hash[SHA_DIGEST_LENGTH];
+    SHA1(data.data(), data.size(), hash);
+    return expected == std::string_view(reinterpret_cast<const char*>(hash), SHA_DIGEST_LENGTH);
+}
+
+Metrics::Registry& scope(const Swarm::Options& options)
+{
+    return options.metrics ? *options.metrics : Metrics::Registry::global();
+}
+
+Async::Task<void> readMessage(Net::Stream& stream, std::string& message)
+{
+    std::array<uint8_t, 4> header;
+    co_await Net::readExactly(stream, header);
+    uint32_t len = (uint32_t(header[0]) << 24) | (uint32_t(header[1]) << 16) | (uint32_t(header[2]) << 8) | header[3];
+    if (len > PeerWire::MaxMessageSize)
+    {
+        throw std::runtime_error("Peer message too large");
+    }
+    message.resize(len);
+    co_await Net::readExactly(stream, {reinterpret_cast<uint8_t*>(message.data()), message.size()});
+}
+}  // namespace
+
+Swarm::Swarm(Net::EventLoop& loop, Async::Executor& executor, Async::DiskIo& disk, const Metadata& meta, Storage& storage,
+    std::string peerId)
+    : Swarm(loop, executor, disk, meta, storage, std::move(peerId), Options{})
+{}
+
+Swarm::Swarm(Net::EventLoop& loop, Async::Executor& executor, Async::DiskIo& disk, const Metadata& meta, Storage& storage,
+    std::string peerId, Options options)
+    : m_loop(loop)
+    , m_executor(executor)
+    , m_disk(disk)
+    , m_meta(meta)
+    , m_storage(storage)
+    , m_peerId(std::move(peerId))
+    , m_options(std::move(options))
+    , m_memory(m_options.memory ? *m_options.memory : MemoryBudget::global())
+    , m_blocklist(m_options.blocklist ? *m_options.blocklist : IpBlocklist::global())
+    , m_picker(static_cast<uint32_t>(meta.pieceHashes.size()), meta.pieceLength, meta.totalSize, m_options.picker)
+    , m_priorities(meta)
+    , m_cache(m_memory, m_options.readCachePieces)
+    , m_downloadedBytes(scope(m_options).counter("sktorrent_downloaded_bytes_total", "Payload bytes of accepted blocks"))
+    , m_uploadedBytes(scope(m_options).counter("sktorrent_uploaded_bytes_total", "Payload bytes sent to peers"))
+{
+    if (meta.pieceHashes.empty())
+    {
+        throw std::runtime_error("Swarm needs v1 piece hashes; v2-only torrents are not supported");
+    }
+    if (!m_options.filePriorities.empty())
+    {
+        applyPriorities(m_priorities.set(m_options.filePriorities));
+    }
+}
+
+Swarm::~Swarm()
+{
+    if (m_tick)
+    {
+        m_loop.cancel(m_tick);
+    }
+}
+
+Swarm::Stats Swarm::stats() const
+{
+    Stats s = m_stats;
+    s.peers = m_peers.size();
+    return s;
+}
+
+Async::Task<uint32_t> Swarm::checkFiles()
+{
+    std::vector<uint8_t> buffer(m_meta.pieceLength);
+    std::vector<uint32_t> good;
+    for (uint32_t piece = 0; piece < m_picker.pieceCount(); ++piece)
+    {
+        auto data = std::span(buffer).first(m_picker.pieceSize(piece));
+        co_await m_storage.read(m_disk, pieceOffset(piece), data);
+        if (hashMatches(data, m_meta.pieceHashes[piece]))
+        {
+            good.push_back(piece);
+        }
+    }
+    co_await Async::resumeOn(m_loop);
+    for (auto piece : good)
+    {
+        pieceVerified(piece);
+    }
+    co_return static_cast<uint32_t>(good.size());
+}
+
+void Swarm::addPeer(const Net::Endpoint& endpoint)
+{
+    if (m_closing || m_peers.size() >= m_options.maxPeers || m_blocklist.blocked(endpoint))
+    {
+        return;
+    }
+    for (const auto& peer : m_peers)
+    {
+        if (peer->endpoint && *peer->endpoint == endpoint)
+        {
+            return;
+        }
+    }
+    auto peer      = std::make_shared<Peer>();
+    peer->stream   = m_options.streamFactory ? m_options.streamFactory() : std::make_unique<Net::TcpStream>(m_loop);
+    peer->endpoint = endpoint;
+    start(std::move(peer));
+}
+
+void Swarm::acceptPeer(std::unique_ptr<Net::Stream> stream)
+{
+    if (m_closing || m_peers.size() >= m_options.maxPeers)
+    {
+        return;
+    }
+    if (auto remote = stream->remoteEndpoint(); remote && m_blocklist.blocked(*remote))
+    {
+        return;
+    }
+    auto peer    = std::make_shared<Peer>();
+    peer->stream = std::move(stream);
+    start(std::move(peer));
+}
+
+void Swarm::start(PeerPtr peer)
+{
+    if (!m_tick)
+    {
+        m_tick = m_loop.runEvery(m_options.tickInterval, [this] { onTick(); });
+    }
+    peer->queued = MemoryCharge(m_memory, MemoryCategory::Network);
+    m_peers.push_back(peer);
+    m_tasks.add();
+    runPeer(std::move(peer));
+}
+
+Async::Detached Swarm::runPeer(PeerPtr peer)
+{
+    try
+    {
+        co_await talk(peer);
+    }
+    catch (const std::exception& e)
+    {
+        LOG_DEBUG(Swarm, "Peer dropped", LOG_MD(Error, e.what()));
+    }
+    disconnect(*peer);
+    m_tasks.done();
+}
+
+Async::Task<void> Swarm::talk(PeerPtr peer)
+{
+    auto& stream   = *peer->stream;
+    auto handshake = PeerWire::encodeHandshake(m_meta.infoHash, m_peerId, false);
+    if (peer->endpoint)
+    {
+        co_await stream.connect(*peer->endpoint);
+        co_await stream.write(bytes(handshake));
+    }
+
+    std::array<uint8_t, PeerWire::HandshakeSize> reply;
+    co_await Net::readExactly(stream, reply);
+    auto theirs = PeerWire::decodeHandshake({reinterpret_cast<const char*>(reply.data()), reply.size()});
+    if (!theirs || theirs->infoHash != m_meta.infoHash)
+    {
+        throw std::runtime_error("Handshake mismatch");
+    }
+    if (!peer->endpoint)
+    {
+        co_await stream.write(bytes(handshake));
+    }
+    if (m_closing || peer->closed)
+    {
+        co_return;
+    }
+
+    peer->ready = true;
+    peer->has.assign(m_picker.pieceCount(), false);
+    if (m_picker.haveCount() > 0)
+    {
+        send(peer, PeerWire::encodeBitfield(m_picker.havePieces()));
+    }
+    // no choking algorithm: whoever asks gets served, bounded by the upload rate limit
+    send(peer, PeerWire::encodeMessage(PeerWire::MessageId::Unchoke));
+
+    std::string message;
+    MemoryCharge received(m_memory, MemoryCategory::Network);
+    while (!peer->closed && !m_closing)
+    {
+        if (m_memory.pressure(MemoryCategory::Network) == MemoryPressure::Hard)
+        {
+            // leave the socket unread until outboxes drain: the peer's TCP window closes and it has to slow down
+            std::string().swap(message);
+            received.resize(0);
+            co_await Async::sleepFor(m_loop, kPressureBackoff);
+            continue;
+        }
+        co_await readMessage(stream, message);
+        received.resize(message.capacity());
+        if (!message.empty())
+        {
+            handleMessage(peer, message);
+        }
+    }
+}
+
+void Swarm::handleMessage(const PeerPtr& peer, std::string_view message)
+{
+    using PeerWire::MessageId;
+    auto payload = message.substr(1);
+    switch (static_cast<MessageId>(message[0]))
+    {
+    case MessageId::Choke:
+        peer->peerChoking = true;
+        for (const auto& block : peer->inflight)
+        {
+            m_picker.abort(block);
+        }
+        peer->inflight.clear();
+        break;
+    case MessageId::Unchoke:
+        peer->peerChoking = false;
+        fillRequests(peer);
+        break;
+    case MessageId::Have:
+    {
+        uint32_t piece = PeerWire::decodeHave(payload);
+        if (piece >= m_picker.pieceCount())
+        {
+            throw std::runtime_error("Have for a piece out of range");
+        }
+        if (!peer->has[piece])
+        {
+            peer->has[piece] = true;
+            m_picker.onHave(piece);
+            fillRequests(peer);
+        }
+        break;
+    }
+    case MessageId::Bitfield:
+    {
+        auto has = PeerWire::decodeBitfield(payload, m_picker.pieceCount());
+        m_picker.removePeer(peer->has);
+        peer->has = std::move(has);
+        m_picker.addPeer(peer->has);
+        fillRequests(peer);
+        break;
+    }
+    case MessageId::Request:
+    {
+        auto request = PeerWire::decodeRequest(payload);
+        if (request.piece >= m_picker.pieceCount() || request.length == 0 || request.length > PeerWire::BlockSize ||
+            uint64_t(request.begin) + request.length > m_picker.pieceSize(request.piece))
+        {
+            throw std::runtime_error("Invalid block request");
+        }
+        if (!m_picker.have(request.piece))
+        {
+            break;
+        }
+        peer->uploads.push_back({request.piece, request.begin, request.length});
+        if (!peer->serving)
+        {
+            peer->serving = true;
+            m_tasks.add();
+            serveLoop(peer);
+        }
+        break;
+    }
+    case MessageId::Cancel:
+    {
+        auto cancel = PeerWire::decodeRequest(payload);
+        std::erase(peer->uploads, PiecePicker::Block{cancel.piece, cancel.begin, cancel.length});
+        break;
+    }
+    case MessageId::Piece:
+        onBlockData(peer, PeerWire::decodePiece(payload));
+        fillRequests(peer);
+        break;
+    default:
+        // interest does not matter while everyone is unchoked; extensions are not spoken here
+        break;
+    }
+}
+
+void Swarm::onBlockData(const PeerPtr& peer, const PeerWire::BlockMessage& message)
+{
+    PiecePicker::Block block{message.piece, message.begin, message.length};
+    peer->bytesThisTick += message.length;
+    std::erase(peer->inflight, block);
+    if (block.piece >= m_picker.pieceCount() || !m_picker.onBlock(block))
+    {
+        m_stats.wasted += block.length;
+        return;
+    }
+    m_stats.downloaded += block.length;
+    m_downloadedBytes.add(block.length);
+
+    // a duplicate request of an urgent block is still out elsewhere
+    for (const auto& other : m_peers)
+    {
+        if (other != peer && std::erase(other->inflight, block) > 0)
+        {
+            send(other, PeerWire::encodeRequest(PeerWire::MessageId::Cancel, block.piece, block.offset, block.length));
+        }
+    }
+
+    auto& buffer = m_buffers[block.piece];
+    if (buffer.data.empty())
+    {
+        buffer.data.resize(m_picker.pieceSize(block.piece));
+        buffer.charge = MemoryCharge(m_memory, MemoryCategory::Pieces, buffer.data.size());
+    }
+    std::memcpy(buffer.data.data() + block.offset, message.data.data(), block.length);
+    if (m_picker.piecePending(block.piece))
+    {
+        auto data = std::move(buffer.data);
+        m_buffers.erase(block.piece);
+        MemoryCharge queued(m_memory, MemoryCategory::DiskWrite, data.size());
+        m_tasks.add();
+        finishPiece(block.piece, std::move(data), std::move(queued));
+    }
+}
+
+Async::Detached Swarm::finishPiece(uint32_t piece, std::vector<uint8_t> data, MemoryCharge queued)
+{
+    co_await m_executor.schedule();
+    bool good    = hashMatches(data, m_meta.pieceHashes[piece]);
+    bool written = false;
+    if (good)
+    {
+        try
+        {
+            co_await m_storage.write(m_disk, pieceOffset(piece), data);
+            written = true;
+        }
+        catch (const std::exception& e)
+        {
+            LOG_ERROR(Swarm, "Piece write failed", LOG_MD(Piece, piece), LOG_MD(Error, e.what()));
+        }
+    }
+    queued.resize(0);
+    co_await Async::resumeOn(m_loop);
+
+    if (good && written)
+    {
+        pieceVerified(piece);
+    }
+    else
+    {
+        m_picker.onPieceFailed(piece);
+        if (!good)
+        {
+            ++m_stats.hashFailures;
+            LOG_WARNING(Swarm, "Piece failed hash check", LOG_MD(Piece, piece));
+        }
+    }
+    fillAll();
+    m_tasks.done();
+}
+
+void Swarm::pieceVerified(uint32_t piece)
+{
+    if (m_picker.have(piece))
+    {
+        return;
+    }
+    m_picker.onPieceVerified(piece);
+    ++m_stats.piecesVerified;
+    for (const auto& peer : m_peers)
+    {
+        send(peer, PeerWire::encodeHave(piece));
+    }
+    for (auto waiter : std::exchange(m_waiters, {}))
+    {
+        waiter.resume();
+    }
+}
+
+void Swarm::fillRequests(const PeerPtr& peer)
+{
+    if (!peer->ready || peer->closed || m_closing)
+    {
+        return;
+    }
+    bool interested = m_picker.interesting(peer->has);
+    if (interested != peer->amInterested)
+    {
+        peer->amInterested = interested;
+        send(peer, PeerWire::encodeMessage(interested ? PeerWire::MessageId::Interested : PeerWire::MessageId::NotInterested));
+    }
+    if (!interested || peer->peerChoking)
+    {
+        return;
+    }
+
+    // pieces pile up in memory faster than they reach the disk: ask for less and finish what is started
+    auto pressure  = std::max(m_memory.pressure(MemoryCategory::Pieces), m_memory.pressure(MemoryCategory::DiskWrite));
+    uint32_t depth = pressure == MemoryPressure::None ? m_options.pipelineDepth : std::max(1u, m_options.pipelineDepth / 4);
+    auto now       = Clock::now();
+    bool fast      = peer->fast || !m_ranked;
+    while (peer->inflight.size() < depth)
+    {
+        auto block = m_picker.pick(peer->has, fast, now, pressure != MemoryPressure::Hard);
+        if (!block)
+        {
+            break;
+        }
+        if (std::find(peer->inflight.begin(), peer->inflight.end(), *block) != peer->inflight.end())
+        {
+            // a stalled block came back as a duplicate for the peer it stalls on
+            m_picker.abort(*block);
+            break;
+        }
+        peer->inflight.push_back(*block);
+        send(peer, PeerWire::encodeRequest(PeerWire::MessageId::Request, block->piece, block->offset, block->length));
+    }
+}
+
+void Swarm::applyPriorities(const std::vector<uint32_t>& pieces)
+{
+    for (auto piece : pieces)
+    {
+        m_picker.setPriority(piece, m_priorities.piece(piece));
+    }
+}
+
+Async::Task<void> Swarm::setFilePriority(size_t fileIndex, Priority priority)
+{
+    if (priority != Priority::Skip && !m_storage.allocated(fileIndex))
+    {
+        co_await m_executor.schedule();
+        m_storage.allocate(fileIndex);
+    }
+    co_await Async::resumeOn(m_loop);
+    applyPriorities(m_priorities.set(fileIndex, priority));
+    fillAll();
+}
+
+Async::Task<void> Swarm::setFilePriorities(std::vector<Priority> priorities)
+{
+    if (priorities.size() != m_storage.fileCount())
+    {
+        throw std::runtime_error("Expected " + std::to_string(m_storage.fileCount()) + " file priorities");
+    }
+    co_await m_executor.schedule();
+    for (size_t i = 0; i < priorities.size(); ++i)
+    {
+        if (priorities[i] != Priority::Skip)
+        {
+            m_storage.allocate(i);
+        }
+    }
+    co_await Async::resumeOn(m_loop);
+    applyPriorities(m_priorities.set(priorities));
+    fillAll();
+}
+
+void Swarm::fillAll()
+{
+    for (const auto& peer : std::vector(m_peers))
+    {
+        fillRequests(peer);
+    }
+}
+
+void Swarm::reclaimUrgent()
+{
+    if (!m_ranked)
+    {
+        return;
+    }
+    // blocks of urgent pieces queued behind a slow peer's pipeline would miss the deadline; hand them back
+    auto now = Clock::now();
+    for (const auto& peer : m_peers)
+    {
+        if (peer->fast)
+        {
+            continue;
+        }
+        std::erase_if(peer->inflight,
+            [&](const PiecePicker::Block& block)
+            {
+                if (!m_picker.urgent(block.piece, now))
+                {
+                    return false;
+                }
+                m_picker.abort(block);
+                send(peer, PeerWire::encodeRequest(PeerWire::MessageId::Cancel, block.piece, block.offset, block.length));
+                return true;
+            });
+    }
+}
+
+void Swarm::send(const PeerPtr& peer, std::string message)
+{
+    if (!peer->ready || peer->closed)
+    {
+        return;
+    }
+    peer->queued.resize(peer->queued.bytes() + message.size());
+    peer->outbox.push_back(std::move(message));
+    if (!peer->writing)
+    {
+        peer->writing = true;
+        m_tasks.add();
+        writeLoop(peer);
+    }
+}
+
+Async::Detached Swarm::writeLoop(PeerPtr peer)
+{
+    try
+    {
+        while (!peer->outbox.empty() && !peer->closed)
+        {
+            auto message = std::move(peer->outbox.front());
+            peer->outbox.pop_front();
+            co_await peer->stream->write(bytes(message));
+            peer->queued.resize(peer->queued.bytes() - message.size());
+        }
+    }
+    catch (const std::exception&)
+    {
+        // the reader sees the closed stream and tears the peer down
+        peer->stream->close();
+    }
+    peer->writing = false;
+    m_tasks.done();
+}
+
+Async::Detached Swarm::serveLoop(PeerPtr peer)
+{
+    while (!peer->closed && !peer->uploads.empty() && !m_closing)
+    {
+        auto request = peer->uploads.front();
+        if (m_options.uploadRateLimit > 0 && m_uploadTokens < request.length)
+        {
+            co_await Async::sleepFor(m_loop, m_options.tickInterval);
+            continue;
+        }
+        peer->uploads.pop_front();
+        m_uploadTokens -= request.length;
+
+        auto message  = PeerWire::encodePieceHeader(request.piece, request.offset, request.length);
+        size_t header = message.size();
+        message.resize(header + request.length);
+        auto* out = reinterpret_cast<uint8_t*>(message.data()) + header;
+
+        // peers ask for a piece block by block: read it whole once and serve the rest from the cache
+        auto cached    = m_cache.find(request.piece);
+        bool readWhole = !cached && m_cache.admits();
+        std::vector<uint8_t> whole;
+        bool failed = false;
+        try
+        {
+            if (readWhole)
+            {
+                whole.resize(m_picker.pieceSize(request.piece));
+                co_await m_storage.read(m_disk, pieceOffset(request.piece), whole);
+            }
+            else if (!cached)
+            {
+                co_await m_storage.read(m_disk, pieceOffset(request.piece) + request.offset, {out, request.length});
+            }
+        }
+        catch (const std::exception& e)
+        {
+            LOG_ERROR(Swarm, "Block read failed", LOG_MD(Piece, request.piece), LOG_MD(Error, e.what()));
+            failed = true;
+        }
+        co_await Async::resumeOn(m_loop);
+        if (failed)
+        {
+            peer->stream->close();
+            break;
+        }
+        if (readWhole)
+        {
+            cached = m_cache.insert(request.piece, std::move(whole));
+        }
+        if (cached)
+        {
+            std::memcpy(out, cached->data() + request.offset, request.length);
+        }
+        m_stats.uploaded += request.length;
+        m_uploadedBytes.add(request.length);
+        send(peer, std::move(message));
+    }
+    peer->serving = false;
+    m_tasks.done();
+}
+
+void Swarm::onTick()
+{
+    double seconds = std::chrono::duration<double>(m_options.tickInterval).count();
+    std::vector<Peer*> ranking;
+    for (const auto& peer : m_peers)
+    {
+        peer->rate          = 0.7 * peer->rate + 0.3 * static_cast<double>(peer->bytesThisTick) / seconds;
+        peer->bytesThisTick = 0;
+        ranking.push_back(peer.get());
+    }
+    std::sort(ranking.begin(), ranking.end(), [](const Peer* a, const Peer* b) { return a->rate > b->rate; });
+    size_t fastCount = std::max<size_t>(1, static_cast<size_t>(std::ceil(ranking.size() * m_options.fastPeerShare)));
+    m_ranked         = !ranking.empty() && ranking.front()->rate > 0;
+    for (size_t i = 0; i < ranking.size(); ++i)
+    {
+        ranking[i]->fast = i < fastCount && ranking[i]->rate > 0;
+    }
+
+    if (m_options.uploadRateLimit > 0)
+    {
+        // burst of at most one tick, so an idle peer does not look fast, but always room for one block
+        double refill  = static_cast<double>(m_options.uploadRateLimit) * seconds;
+        m_uploadTokens = std::min(m_uploadTokens + refill, std::max(refill, double(PeerWire::BlockSize)));
+    }
+    m_cache.trim();
+    // deadlines move into the urgent window and stalled urgent blocks become eligible for a second peer
+    reclaimUrgent();
+    fillAll();
+}
+
+void Swarm::disconnect(Peer& peer)
+{
+    peer.closed = true;
+    peer.stream->close();
+    for (const auto& block : peer.inflight)
+    {
+        m_picker.abort(block);
+    }
+    peer.inflight.clear();
+    m_picker.removePeer(peer.has);
+    peer.uploads.clear();
+    peer.outbox.clear();
+    peer.queued.resize(0);
+    std::erase_if(m_peers, [&](const PeerPtr& p) { return p.get() == &peer; });
+    fillAll();
+}
+
+std::pair<uint32_t, uint32_t> Swarm::piecesOf(size_t fileIndex, uint64_t offset, uint64_t length) const
+{
+    uint64_t begin = m_storage.fileOffset(fileIndex) + offset;
+    return {static_cast<uint32_t>(begin / m_meta.pieceLength), static_cast<uint32_t>((begin + length - 1) / m_meta.pieceLength)};
+}
+
+void Swarm::setDeadline(size_t fileIndex, uint64_t offset, uint64_t length, Clock::time_point deadline)
+{
+    uint64_t size = m_storage.fileSize(fileIndex);
+    if (offset >= size || length == 0)
+    {
+        return;
+    }
+    auto [first, last] = piecesOf(fileIndex, offset, std::min(length, size - offset));
+    for (uint32_t piece = first; piece <= last; ++piece)
+    {
+        m_picker.setDeadline(piece, deadline);
+    }
+    reclaimUrgent();
+    fillAll();
+}
+
+Async::Task<size_t> Swarm::read(size_t fileIndex, uint64_t offset, std::span<uint8_t> out,
+    std::optional<Clock::time_point> deadline)
+{
+    co_await Async::resumeOn(m_loop);
+    uint64_t size = m_storage.fileSize(fileIndex);
+    if (offset >= size || out.empty())
+    {
+        co_return 0;
+    }
+    out = out.first(static_cast<size_t>(std::min<uint64_t>(out.size(), size - offset)));
+
+    auto [first, last] = piecesOf(fileIndex, offset, out.size());
+    auto missing       = [&, first = first, last = last]
+    {
+        for (uint32_t piece = first; piece <= last; ++piece)
+        {
+            if (!m_picker.have(piece))
+            {
+                return true;
+            }
+        }
+        return false;
+    };
+    if (missing())
+    {
+        setDeadline(fileIndex, offset, out.size(), deadline.value_or(Clock::now()));
+    }
+    while (missing())
+    {
+        if (m_closing)
+        {
+            throw std::runtime_error("Swarm shut down");
+        }
+        co_await pieceChanged();
+    }
+
+    co_await m_storage.read(m_disk, m_storage.fileOffset(fileIndex) + offset, out);
+    co_await Async::resumeOn(m_loop);
+    co_return out.size();
+}
+
+size_t Swarm::readBlocking(size_t fileIndex, uint64_t offset, std::span<uint8_t> out)
+{
+    return Async::syncWait(read(fileIndex, offset, out));
+}
+
+Async::Task<void> Swarm::shutdown()
+{
+    co_await Async::resumeOn(m_loop);
+    m_closing = true;
+    if (m_tick)
+    {
+        m_loop.cancel(m_tick);
+        m_tick = 0;
+    }
+    for (const auto& peer : std::vector(m_peers))
+    {
+        peer->stream->close();
+    }
+    for (auto waiter : std::exchange(m_waiters, {}))
+    {
+        waiter.resume();
+    }
+    co_await m_tasks.wait();
+}
+
+}  // namespace Torrent::Core
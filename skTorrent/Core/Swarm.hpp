@@ -0,0 +1,225 @@
+#ifndef SWARM_HPP
+#define SWARM_HPP
+
+#include "FilePriorities.hpp"
+#include "IpFilter.hpp"
+#include "MemoryBudget.hpp"
+#include "PeerWire.hpp"
+#include "PiecePicker.hpp"
+#include "ReadCache.hpp"
+#include "Storage.hpp"
+
+#include <Async/DiskIo.hpp>
+#include <Async/Executor.hpp>
+#include <Async/WaitGroup.hpp>
+#include <Metrics/Metrics.hpp>
+#include <Net/EventLoop.hpp>
+#include <Net/Stream.hpp>
+#include <Utils/MetaUtils.hpp>
+
+#include <chrono>
+#include <coroutine>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Torrent::Core {
+
+// Peer connections and piece flow of one torrent. Downloads v1 pieces (hybrid torrents included) and serves
+// everything it has to anyone who asks; every peer is unchoked. Pieces are hashed on the executor and written
+// through the disk pool; everything else happens on the loop thread.
+//
+// Streaming: read() gives the pieces under a byte range of a file a deadline, so the picker fetches them first
+// from the fastest peers, and completes once they are verified. Pieces outside any deadline still download
+// rarest first in the background.
+//
+// Selective download: files take priorities, which become the priorities of the pieces under them; skipped
+// pieces are fetched only when read() asks for them. Give the storage the same priorities, so skipped files stay
+// unallocated and the edges of pieces they share with wanted files go to its partfile.
+//
+// Memory: outboxes and receive buffers, piece buffers, pieces on their way to disk and the read cache are charged
+// to a MemoryBudget. Under pressure the swarm stops reading sockets (Network), shortens its request pipelines and
+// starts no new pieces (Pieces, DiskWrite), and shrinks the cache (ReadCache).
+//
+// Apart from read() and readBlocking(), call everything on the loop thread (or before the loop runs). Await
+// shutdown() before destroying a swarm that has peers.
+class Swarm
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Options
+    {
+        size_t maxPeers          = 50;
+        uint32_t pipelineDepth   = 16;    // block requests in flight per peer
+        uint64_t uploadRateLimit = 0;     // bytes per second, 0 for none
+        double fastPeerShare     = 0.25;  // share of peers, by download rate, trusted with urgent blocks
+        size_t readCachePieces   = 8;     // whole pieces kept for serving, 0 to read block by block
+        std::chrono::milliseconds tickInterval{250};
+        PiecePicker::Options picker;
+        std::vector<Priority> filePriorities;  // one per Metadata::files entry, empty for all Normal
+        Net::StreamFactory streamFactory;      // TCP when empty
+        Metrics::Registry* metrics = nullptr;  // scope of the transfer counters, the global one when null
+        MemoryBudget* memory       = nullptr;  // the global budget when null
+        IpBlocklist* blocklist     = nullptr;  // checked by addPeer() and acceptPeer(), the global one when null
+    };
+
+    struct Stats
+    {
+        uint64_t downloaded     = 0;  // payload bytes of accepted blocks
+        uint64_t uploaded       = 0;
+        uint64_t wasted         = 0;  // duplicate or unrequested blocks
+        uint32_t piecesVerified = 0;
+        uint32_t hashFailures   = 0;
+        size_t peers            = 0;
+    };
+
+    Swarm(Net::EventLoop& loop, Async::Executor& executor, Async::DiskIo& disk, const Metadata& meta, Storage& storage,
+        std::string peerId);
+    Swarm(Net::EventLoop& loop, Async::Executor& executor, Async::DiskIo& disk, const Metadata& meta, Storage& storage,
+        std::string peerId, Options options);
+    ~Swarm();
+    Swarm(const Swarm&) = delete;
+
+    // Hashes whatever the storage already holds and marks good pieces as present; returns how many.
+    Async::Task<uint32_t> checkFiles();
+
+    void addPeer(const Net::Endpoint& endpoint);
+    void acceptPeer(std::unique_ptr<Net::Stream> stream);
+
+    // Deadline for the pieces under a byte range of Metadata::files[fileIndex].
+    void setDeadline(size_t fileIndex, uint64_t offset, uint64_t length, Clock::time_point deadline);
+
+    // Allocates the file first if the storage has it deferred, then updates the picker for the pieces whose
+    // priority changed. May be awaited from any thread and resumes on the loop thread.
+    Async::Task<void> setFilePriority(size_t fileIndex, Priority priority);
+    Async::Task<void> setFilePriorities(std::vector<Priority> priorities);
+
+    const FilePriorities& filePriorities() const
+    {
+        return m_priorities;
+    }
+
+    // Waits until the range is verified and reads it; returns the bytes read, fewer at the end of the file.
+    // Missing pieces get `deadline`, or now. May be awaited from any thread and resumes on the loop thread.
+    Async::Task<size_t> read(size_t fileIndex, uint64_t offset, std::span<uint8_t> out,
+        std::optional<Clock::time_point> deadline = std::nullopt);
+    // read() for plain threads; must not be called on the loop thread.
+    size_t readBlocking(size_t fileIndex, uint64_t offset, std::span<uint8_t> out);
+
+    // Closes every connection and waits for all work in flight; pending reads throw.
+    Async::Task<void> shutdown();
+
+    const PiecePicker& picker() const
+    {
+        return m_picker;
+    }
+
+    Stats stats() const;
+
+private:
+    struct Peer
+    {
+        std::unique_ptr<Net::Stream> stream;
+        std::optional<Net::Endpoint> endpoint;  // set for outgoing connections
+        std::vector<bool> has;
+        bool ready         = false;  // handshake done
+        bool peerChoking   = true;
+        bool amInterested  = false;
+        bool closed        = false;
+        bool writing       = false;
+        bool serving       = false;
+        std::vector<PiecePicker::Block> inflight;
+        std::deque<PiecePicker::Block> uploads;
+        std::deque<std::string> outbox;
+        MemoryCharge queued;  // the outbox
+        uint64_t bytesThisTick = 0;
+        double rate            = 0;  // bytes per second, smoothed
+        bool fast              = false;  // ranked among the fastest at the last tick
+    };
+
+    using PeerPtr = std::shared_ptr<Peer>;
+
+    // a piece being downloaded
+    struct PieceBuffer
+    {
+        std::vector<uint8_t> data;
+        MemoryCharge charge;
+    };
+
+    Async::Detached runPeer(PeerPtr peer);
+    void start(PeerPtr peer);
+    Async::Task<void> talk(PeerPtr peer);
+    void handleMessage(const PeerPtr& peer, std::string_view message);
+    void onBlockData(const PeerPtr& peer, const PeerWire::BlockMessage& message);
+    void fillRequests(const PeerPtr& peer);
+    void fillAll();
+    void reclaimUrgent();
+    void applyPriorities(const std::vector<uint32_t>& pieces);
+    void send(const PeerPtr& peer, std::string message);
+    Async::Detached writeLoop(PeerPtr peer);
+    Async::Detached serveLoop(PeerPtr peer);
+    Async::Detached finishPiece(uint32_t piece, std::vector<uint8_t> data, MemoryCharge queued);
+    void pieceVerified(uint32_t piece);
+    void onTick();
+    void disconnect(Peer& peer);
+    std::pair<uint32_t, uint32_t> piecesOf(size_t fileIndex, uint64_t offset, uint64_t length) const;
+
+    auto pieceChanged()
+    {
+        struct Awaiter
+        {
+            bool await_ready() noexcept
+            {
+                return false;
+            }
+
+            void await_suspend(std::coroutine_handle<> h)
+            {
+                swarm.m_waiters.push_back(h);
+            }
+
+            void await_resume() noexcept
+            {}
+
+            Swarm& swarm;
+        };
+        return Awaiter{*this};
+    }
+
+    uint64_t pieceOffset(uint32_t piece) const
+    {
+        return static_cast<uint64_t>(piece) * m_meta.pieceLength;
+    }
+
+    Net::EventLoop& m_loop;
+    Async::Executor& m_executor;
+    Async::DiskIo& m_disk;
+    const Metadata& m_meta;
+    Storage& m_storage;
+    std::string m_peerId;
+    Options m_options;
+    MemoryBudget& m_memory;
+    IpBlocklist& m_blocklist;
+
+    PiecePicker m_picker;
+    FilePriorities m_priorities;
+    ReadCache m_cache;
+    std::vector<PeerPtr> m_peers;
+    std::unordered_map<uint32_t, PieceBuffer> m_buffers;  // pieces being downloaded
+    std::vector<std::coroutine_handle<>> m_waiters;                 // readers waiting for pieces
+    Async::WaitGroup m_tasks;
+    Net::EventLoop::TimerId m_tick = 0;
+    double m_uploadTokens          = 0;
+    bool m_ranked                  = false;  // some peer has a measured rate
+    bool m_closing                 = false;
+    Stats m_stats;
+    Metrics::Counter& m_downloadedBytes;
+    Metrics::Counter& m_uploadedBytes;
+};
+
+}  // namespace Torrent::Core
+#endif  // SWARM_HPP
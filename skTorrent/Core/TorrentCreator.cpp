@@ -0,0 +1,540 @@
+#include "TorrentCreator.hpp"
+#include "MerkleTree.hpp"
+
+#include <Async/Executor.hpp>
+#include <Logger.hpp>
+#include <Metrics/Trace.hpp>
+#include <Utils/BencodeEncoder.hpp>
+
+#include <openssl/sha.h>
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <exception>
+#include <fcntl.h>
+#include <filesystem>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <unistd.h>
+
+namespace Torrent::Core {
+
+namespace {
+constexpr uint64_t kMinPiece    = 16 * 1'024;
+constexpr uint64_t kMaxPiece    = 16 * 1'024 * 1'024;
+constexpr uint64_t kTargetCount = 1'500;
+
+unsigned heightFor(uint64_t leaves)
+{
+    return static_cast<unsigned>(std::bit_width(std::bit_ceil(leaves)) - 1);
+}
+
+// Piece-aligned layouts (v2 and hybrid) put a pad region behind every file that does not end on a piece
+// boundary, except the last one. Pads read as zeros and are only written out for hybrid torrents.
+struct Region
+{
+    uint64_t offset = 0;  // in the concatenated stream
+    uint64_t size   = 0;
+    size_t file     = 0;
+    bool pad        = false;
+};
+
+// Everything the hashing workers touch. It is shared with the jobs so that a job the executor only starts after
+// the creator returned still finds it alive; such a job claims nothing and exits.
+struct HashJob
+{
+    std::filesystem::path root;
+    bool single = false;
+    std::vector<Metadata::FileEntry> files;
+    std::vector<Region> stream;
+    std::vector<uint64_t> padAfter;  // per file
+    uint64_t streamSize  = 0;
+    uint64_t pieceLength = 0;
+    size_t pieces        = 0;
+    bool v1              = false;
+    bool v2              = false;
+
+    std::string pieceHashes;                        // v1, 20 bytes per piece
+    std::vector<Merkle::Hash> roots;                // v2, per file
+    std::vector<std::vector<Merkle::Hash>> layers;  // v2, per file larger than one piece
+
+    std::atomic<size_t> next{0};
+    std::atomic<size_t> done{0};
+    std::atomic<bool> failed{false};
+    std::exception_ptr error;
+    std::mutex mutex;
+    std::condition_variable finished;
+};
+
+// One open file per worker; consecutive pieces mostly come from the same file.
+class FileCache
+{
+public:
+    explicit FileCache(const HashJob& job)
+        : m_job(job)
+    {}
+
+    ~FileCache()
+    {
+        close();
+    }
+
+    int get(size_t file)
+    {
+        if (m_fd >= 0 && m_file == file)
+        {
+            return m_fd;
+        }
+        close();
+        auto path = m_job.single ? m_job.root : m_job.root / m_job.files[file].path;
+        m_fd      = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (m_fd < 0)
+        {
+            throw std::runtime_error("Cannot open " + path.string() + ": " + std::strerror(errno));
+        }
+        m_file = file;
+        ::posix_fadvise(m_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+        return m_fd;
+    }
+
+    // Starts reading a later range of the open file in the background.
+    void prefetch(size_t file, uint64_t offset, uint64_t size) const
+    {
+        if (m_fd >= 0 && m_file == file)
+        {
+            ::posix_fadvise(m_fd, static_cast<off_t>(offset), static_cast<off_t>(size), POSIX_FADV_WILLNEED);
+        }
+    }
+
+private:
+    void close()
+    {
+        if (m_fd >= 0)
+        {
+            ::close(m_fd);
+            m_fd = -1;
+        }
+    }
+
+    const HashJob& m_job;
+    int m_fd      = -1;
+    size_t m_file = 0;
+};
+
+size_t firstRegion(const HashJob& job, uint64_t offset)
+{
+    auto it = std::upper_bound(job.stream.begin(), job.stream.end(), offset,
+        [](uint64_t value, const Region& region) { return value < region.offset; });
+    return static_cast<size_t>(it - job.stream.begin()) - 1;
+}
+
+void readPiece(const HashJob& job, FileCache& files, size_t piece, std::span<uint8_t> out)
+{
+    uint64_t position = piece * job.pieceLength;
+    size_t filled     = 0;
+    for (size_t r = firstRegion(job, position); filled < out.size(); ++r)
+    {
+        const auto& region = job.stream[r];
+        uint64_t within    = position + filled - region.offset;
+        size_t n           = static_cast<size_t>(std::min<uint64_t>(region.size - within, out.size() - filled));
+        if (region.pad)
+        {
+            std::memset(out.data() + filled, 0, n);
+            filled += n;
+            continue;
+        }
+        int fd = files.get(region.file);
+        for (size_t got = 0; got < n;)
+        {
+            ssize_t rc = ::pread(fd, out.data() + filled + got, n - got, static_cast<off_t>(within + got));
+            if (rc < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (rc <= 0)
+            {
+                throw std::runtime_error("Short read from " + job.files[region.file].path);
+            }
+            got += static_cast<size_t>(rc);
+        }
+        filled += n;
+    }
+}
+
+void hashPiece(HashJob& job, size_t piece, std::span<const uint8_t> data, std::vector<Merkle::Hash>& leaves)
+{
+    if (job.v1)
+    {
+        SHA1(data.data(), data.size(), reinterpret_cast<unsigned char*>(job.pieceHashes.data() + piece * SHA_DIGEST_LENGTH));
+    }
+    if (!job.v2)
+    {
+        return;
+    }
+
+    // aligned layout: a piece starts inside one file and anything after that file's end is padding
+    uint64_t position  = piece * job.pieceLength;
+    const auto& region = job.stream[firstRegion(job, position)];
+    uint64_t within    = position - region.offset;
+    auto bytes         = data.first(static_cast<size_t>(std::min<uint64_t>(data.size(), region.size - within)));
+    leaves.clear();
+    for (size_t offset = 0; offset < bytes.size(); offset += Merkle::BlockSize)
+    {
+        leaves.push_back(Merkle::sha256(bytes.subspan(offset, std::min<size_t>(Merkle::BlockSize, bytes.size() - offset))));
+    }
+    if (region.size <= job.pieceLength)
+    {
+        job.roots[region.file] = Merkle::reduce(leaves, 0, heightFor(leaves.size()));
+        return;
+    }
+    auto perPiece = static_cast<unsigned>(std::countr_zero(job.pieceLength / Merkle::BlockSize));
+    job.layers[region.file][static_cast<size_t>(within / job.pieceLength)] = Merkle::reduce(leaves, 0, perPiece);
+}
+
+void hashPieces(HashJob& job)
+{
+    size_t piece = job.next++;
+    if (piece >= job.pieces)
+    {
+        return;
+    }
+    std::vector<uint8_t> buffer(job.pieceLength);
+    std::vector<Merkle::Hash> leaves;
+    FileCache files(job);
+    while (piece < job.pieces)
+    {
+        size_t ahead = job.next++;
+        if (!job.failed.load(std::memory_order_relaxed))
+        {
+            try
+            {
+                if (ahead < job.pieces)
+                {
+                    uint64_t position  = ahead * job.pieceLength;
+                    const auto& region = job.stream[firstRegion(job, position)];
+                    files.prefetch(region.file, position - region.offset, job.pieceLength);
+                }
+                uint64_t start = piece * job.pieceLength;
+                auto data      = std::span(buffer).first(static_cast<size_t>(std::min(job.pieceLength, job.streamSize - start)));
+                readPiece(job, files, piece, data);
+                hashPiece(job, piece, data, leaves);
+            }
+            catch (...)
+            {
+                std::scoped_lock lk(job.mutex);
+                if (!job.failed.exchange(true))
+                {
+                    job.error = std::current_exception();
+                }
+            }
+        }
+        if (++job.done == job.pieces)
+        {
+            std::scoped_lock lk(job.mutex);
+            job.finished.notify_all();
+        }
+        piece = ahead;
+    }
+}
+
+void runOn(Async::Executor& executor, const std::shared_ptr<HashJob>& job)
+{
+    for (size_t i = 0; i < std::min(job->pieces, executor.size()); ++i)
+    {
+        executor.post([job] { hashPieces(*job); });
+    }
+    hashPieces(*job);
+    std::unique_lock lk(job->mutex);
+    job->finished.wait(lk, [&] { return job->done == job->pieces; });
+}
+
+std::shared_ptr<HashJob> layout(const std::string& root, const CreateOptions& options)
+{
+    auto job    = std::make_shared<HashJob>();
+    job->root   = root;
+    job->single = std::filesystem::is_regular_file(root);
+    job->files  = scanFiles(root);
+    job->v1     = options.format != TorrentFormat::V2;
+    job->v2     = options.format != TorrentFormat::V1;
+
+    job->padAfter.assign(job->files.size(), 0);
+    uint64_t total = 0;
+    for (const auto& file : job->files)
+    {
+        total += file.size;
+    }
+    if (total == 0)
+    {
+        throw std::runtime_error("Nothing to hash under " + root);
+    }
+    job->pieceLength = options.pieceLength ? options.pieceLength : autoPieceLength(total);
+    if (job->pieceLength < kMinPiece || !std::has_single_bit(job->pieceLength))
+    {
+        throw std::runtime_error("Piece length must be a power of two of at least 16 KiB");
+    }
+
+    for (size_t i = 0; i < job->files.size(); ++i)
+    {
+        uint64_t size = job->files[i].size;
+        if (size == 0)
+        {
+            continue;
+        }
+        job->stream.push_back({job->streamSize, size, i, false});
+        job->streamSize += size;
+        uint64_t tail    = size % job->pieceLength;
+        if (job->v2 && tail != 0)
+        {
+            job->padAfter[i] = job->pieceLength - tail;
+            job->stream.push_back({job->streamSize, job->padAfter[i], i, true});
+            job->streamSize += job->padAfter[i];
+        }
+    }
+    // nothing follows the last file with data, so it needs no pad
+    if (!job->stream.empty() && job->stream.back().pad)
+    {
+        job->padAfter[job->stream.back().file]  = 0;
+        job->streamSize                        -= job->stream.back().size;
+        job->stream.pop_back();
+    }
+    job->pieces = static_cast<size_t>((job->streamSize + job->pieceLength - 1) / job->pieceLength);
+
+    if (job->v1)
+    {
+        job->pieceHashes.resize(job->pieces * SHA_DIGEST_LENGTH);
+    }
+    if (job->v2)
+    {
+        job->roots.resize(job->files.size());
+        job->layers.resize(job->files.size());
+        for (size_t i = 0; i < job->files.size(); ++i)
+        {
+            if (job->files[i].size > job->pieceLength)
+            {
+                job->layers[i].resize(static_cast<size_t>((job->files[i].size + job->pieceLength - 1) / job->pieceLength));
+            }
+        }
+    }
+    return job;
+}
+
+Utils::Bencode::List pathList(std::string_view path)
+{
+    Utils::Bencode::List out;
+    for (size_t begin = 0;;)
+    {
+        size_t end = path.find('/', begin);
+        out.emplace_back(std::string(path.substr(begin, end - begin)));
+        if (end == std::string_view::npos)
+        {
+            return out;
+        }
+        begin = end + 1;
+    }
+}
+
+std::string toString(const Merkle::Hash& hash)
+{
+    return {reinterpret_cast<const char*>(hash.data()), hash.size()};
+}
+
+Utils::Bencode::Dict fileTree(const HashJob& job, Utils::Bencode::Dict& pieceLayers)
+{
+    using namespace Utils::Bencode;
+    Dict tree;
+    for (size_t i = 0; i < job.files.size(); ++i)
+    {
+        const auto& file = job.files[i];
+        Dict attrs{{"length", Value(file.size)}};
+        if (file.size > 0)
+        {
+            attrs.emplace("pieces root", Value(toString(job.roots[i])));
+        }
+        if (!job.layers[i].empty())
+        {
+            std::string layer;
+            for (const auto& hash : job.layers[i])
+            {
+                layer += toString(hash);
+            }
+            pieceLayers.emplace(toString(job.roots[i]), Value(std::move(layer)));
+        }
+
+        Dict* dir  = &tree;
+        auto parts = pathList(file.path);
+        for (size_t p = 0; p + 1 < parts.size(); ++p)
+        {
+            auto [it, added] = dir->try_emplace(parts[p].asStr(), Value(Dict{}));
+            dir              = &std::get<Dict>(it->second);
+        }
+        dir->emplace(parts.back().asStr(), Value(Dict{{"", Value(std::move(attrs))}}));
+    }
+    return tree;
+}
+
+std::string encodeTorrent(HashJob& job, const CreateOptions& options)
+{
+    using namespace Utils::Bencode;
+    auto name = std::filesystem::absolute(job.root).lexically_normal().filename().string();
+    if (name.empty())
+    {
+        name = std::filesystem::absolute(job.root).lexically_normal().parent_path().filename().string();
+    }
+
+    Dict info{{"name", Value(name)}, {"piece length", Value(job.pieceLength)}};
+    Dict pieceLayers;
+    if (job.v1)
+    {
+        info.emplace("pieces", Value(std::move(job.pieceHashes)));
+        if (job.single)
+        {
+            info.emplace("length", Value(job.files.front().size));
+        }
+        else
+        {
+            List files;
+            for (size_t i = 0; i < job.files.size(); ++i)
+            {
+                files.emplace_back(Dict{{"length", Value(job.files[i].size)}, {"path", Value(pathList(job.files[i].path))}});
+                if (uint64_t pad = job.padAfter[i])
+                {
+                    files.emplace_back(Dict{{"attr", Value(std::string("p"))}, {"length", Value(pad)},
+                        {"path", Value(List{Value(std::string(".pad")), Value(std::to_string(pad))})}});
+                }
+            }
+            info.emplace("files", Value(std::move(files)));
+        }
+    }
+    if (job.v2)
+    {
+        info.emplace("meta version", Value(uint64_t{2}));
+        info.emplace("file tree", Value(fileTree(job, pieceLayers)));
+    }
+    if (options.isPrivate)
+    {
+        info.emplace("private", Value(uint64_t{1}));
+    }
+
+    Dict torrent{{"info", Value(std::move(info))}};
+    if (job.v2)
+    {
+        torrent.emplace("piece layers", Value(std::move(pieceLayers)));
+    }
+    if (!options.trackers.empty() && !options.trackers.front().empty())
+    {
+        torrent.emplace("announce", Value(options.trackers.front().front()));
+    }
+    if (options.trackers.size() > 1 || (!options.trackers.empty() && options.trackers.front().size() > 1))
+    {
+        List tiers;
+        for (const auto& tier : options.trackers)
+        {
+            List urls;
+            for (const auto& url : tier)
+            {
+                urls.emplace_back(url);
+            }
+            tiers.emplace_back(std::move(urls));
+        }
+        torrent.emplace("announce-list", Value(std::move(tiers)));
+    }
+    if (!options.comment.empty())
+    {
+        torrent.emplace("comment", Value(options.comment));
+    }
+    if (!options.createdBy.empty())
+    {
+        torrent.emplace("created by", Value(options.createdBy));
+    }
+    if (options.creationDate != 0)
+    {
+        torrent.emplace("creation date", Value(options.creationDate));
+    }
+
+    std::string out;
+    encode(Value(std::move(torrent)), out);
+    return out;
+}
+}  // namespace
+
+uint64_t autoPieceLength(uint64_t totalSize)
+{
+    uint64_t length = kMinPiece;
+    while (length < kMaxPiece && totalSize / length > kTargetCount)
+    {
+        length *= 2;
+    }
+    return length;
+}
+
+std::vector<Metadata::FileEntry> scanFiles(const std::string& root)
+{
+    namespace fs = std::filesystem;
+    std::vector<Metadata::FileEntry> files;
+    if (fs::is_regular_file(root))
+    {
+        files.push_back({fs::path(root).filename().string(), fs::file_size(root), {}, false});
+        return files;
+    }
+    if (!fs::is_directory(root))
+    {
+        throw std::runtime_error("Not a file or directory: " + root);
+    }
+    for (const auto& entry : fs::recursive_directory_iterator(root))
+    {
+        if (entry.is_regular_file() && !entry.is_symlink())
+        {
+            files.push_back({entry.path().lexically_relative(root).generic_string(), entry.file_size(), {}, false});
+        }
+    }
+    // path comparison is per component, which is the order a v2 file tree's nested dictionaries give
+    std::sort(files.begin(), files.end(), [](const auto& a, const auto& b) { return fs::path(a.path) < fs::path(b.path); });
+    return files;
+}
+
+std::string createTorrent(const std::string& root, const CreateOptions& options, Async::Executor* executor)
+{
+    TRACE_SCOPE("createTorrent");
+    auto job   = layout(root, options);
+    auto start = std::chrono::steady_clock::now();
+    if (executor)
+    {
+        runOn(*executor, job);
+    }
+    else
+    {
+        // the caller hashes too
+        Async::Executor local(std::max(2u, std::thread::hardware_concurrency()) - 1);
+        runOn(local, job);
+    }
+    if (job->error)
+    {
+        std::rethrow_exception(job->error);
+    }
+
+    auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    LOG_INFO(TorrentCreator, "Hashed", LOG_MD(Root, root), LOG_MD(Files, job->files.size()), LOG_MD(Pieces, job->pieces),
+        LOG_MD(PieceLength, job->pieceLength), LOG_MD(MiBps, static_cast<double>(job->streamSize) / seconds / 1'048'576.0));
+
+    if (job->v2)
+    {
+        // files that fit in one piece got their root from that piece, bigger ones reduce their piece layer
+        for (size_t i = 0; i < job->files.size(); ++i)
+        {
+            if (!job->layers[i].empty())
+            {
+                auto perPiece = static_cast<unsigned>(std::countr_zero(job->pieceLength / Merkle::BlockSize));
+                auto blocks   = (job->files[i].size + Merkle::BlockSize - 1) / Merkle::BlockSize;
+                job->roots[i] = Merkle::reduce(job->layers[i], perPiece, heightFor(blocks) - perPiece);
+            }
+        }
+    }
+    return encodeTorrent(*job, options);
+}
+
+}  // namespace Torrent::Core
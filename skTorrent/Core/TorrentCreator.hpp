@@ -0,0 +1,48 @@
+#ifndef TORRENTCREATOR_HPP
+#define TORRENTCREATOR_HPP
+
+#include <Utils/MetaUtils.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Torrent::Async {
+class Executor;
+}
+
+namespace Torrent::Core {
+
+enum class TorrentFormat : uint8_t
+{
+    V1,
+    V2,
+    Hybrid  // v1 pieces over BEP 47 pad files plus the v2 file tree
+};
+
+struct CreateOptions
+{
+    TorrentFormat format = TorrentFormat::V1;
+    uint64_t pieceLength = 0;                        // power of two of at least 16 KiB; 0 picks one from the size
+    std::vector<std::vector<std::string>> trackers;  // BEP 12 tiers; the first tracker is also "announce"
+    std::string comment;
+    std::string createdBy = "skTorrent";
+    uint64_t creationDate = 0;  // seconds since the epoch; 0 leaves the key out
+    bool isPrivate        = false;
+};
+
+// Smallest power of two from 16 KiB to 16 MiB that keeps the piece count around 1'500.
+uint64_t autoPieceLength(uint64_t totalSize);
+
+// Regular files under root, or root alone when it is a file, ordered like a v2 file tree. Paths are relative to
+// root and '/'-separated; symlinks and special files are skipped.
+std::vector<Metadata::FileEntry> scanFiles(const std::string& root);
+
+// Hashes everything under root and returns the bencoded .torrent. Every worker of the executor and the caller
+// claim pieces in file order, each reading one piece while the kernel prefetches its next one, so disk reads
+// overlap hashing. Without an executor a local one sized to the machine is used. Throws std::runtime_error when
+// there is nothing to hash or a file cannot be read in full.
+std::string createTorrent(const std::string& root, const CreateOptions& options, Async::Executor* executor = nullptr);
+
+}  // namespace Torrent::Core
+#endif  // TORRENTCREATOR_HPP
@@ -1,58 +1,285 @@
 #include "TorrentSession.hpp"
-#include "RequestBuilder.hpp"
+#include "IpFilter.hpp"
+#include "MemoryBudget.hpp"
+#include "MetadataExchange.hpp"
+#include <Async/IoAwaitables.hpp>
+#include <Net/CurlTransport.hpp>
 #include <random>
 #include <iostream>
 
 #include <Logger.hpp>
+#include <Metrics/Trace.hpp>
 
 namespace Torrent::Core {
 
-TorrentSession::TorrentSession(const std::string& peerId, const std::string& filePath)
-    : m_peerId(peerId)
-    , m_filePath(filePath)
+namespace {
+constexpr auto kDefaultAnnounceInterval = std::chrono::seconds(1'800);
+constexpr auto kRetryAnnounceInterval   = std::chrono::seconds(60);
+constexpr uint16_t kListenPort          = 6'881;  // sessions do not own a listener yet
+
+std::string sessionLabel()
+{
+    static std::atomic<uint64_t> next{1};
+    return "session=\"" + std::to_string(next.fetch_add(1, std::memory_order_relaxed)) + '"';
+}
+
+Metrics::Histogram& parseTime()
+{
+    static auto& histogram = Metrics::Registry::global().histogram("sktorrent_metadata_parse_microseconds",
+        "Time to parse a .torrent file or a fetched info dictionary");
+    return histogram;
+}
+}  // namespace
+
+TorrentSession::TorrentSession(const std::string& peerId, const std::string& source)
+    : m_filePath(source)
+    , m_peerId(peerId)
+    , m_metrics(sessionLabel(), Metrics::Registry::global())
+    , m_announces(m_metrics.counter("sktorrent_announces_total", "Announces answered by a tracker"))
+    , m_failedAnnounces(m_metrics.counter("sktorrent_announce_failures_total", "Announces no tracker answered"))
+    , m_announceLatency(m_metrics.histogram("sktorrent_announce_latency_microseconds", "Time for a whole announce"))
+    , m_downloaded(m_metrics.counter("sktorrent_downloaded_bytes_total", "Payload bytes of accepted blocks"))
+    , m_uploaded(m_metrics.counter("sktorrent_uploaded_bytes_total", "Payload bytes sent to peers"))
 {
+    if (Utils::isMagnetUri(source))
+    {
+        m_magnet            = Utils::parseMagnetUri(source);
+        m_meta.infoHash     = m_magnet->infoHash;
+        m_meta.name         = m_magnet->displayName;
+        m_meta.announceList = m_magnet->trackers;
+        if (!m_meta.announceList.empty())
+        {
+            m_meta.announce = m_meta.announceList.front().front();
+        }
+    }
     LOG_INFO(TorrentSession, "Creating torrent session", LOG_MD(FilePath, m_filePath));
 }
 
-void TorrentSession::start()
+TorrentSession::TorrentSession(const std::string& peerId, const std::string& source, Metadata meta)
+    : TorrentSession(peerId, source)
+{
+    m_magnet.reset();
+    m_meta     = std::move(meta);
+    m_restored = true;
+}
+
+Async::Task<void> TorrentSession::prepareSession(SessionIo io)
 {
-    auto path = m_filePath;
-    m_thread  = std::jthread(
-        [this, path](std::stop_token)
+    m_state = SessionState::Preparing;
+    if (m_restored)
+    {
+        createTrackers();
+    }
+    else if (m_magnet)
+    {
+        co_await fetchMagnetMetadata(io);
+    }
+    else
+    {
+        auto data = co_await io.disk.readFile(m_filePath);
         {
-            try
-            {
-                prepareSession();
-            }
-            catch (const std::exception& e)
-            {
-                LOG_CRITICAL(TorrentSession, "Failed to prepare session", LOG_MD(FilePath, path), LOG_MD(Error, e.what()));
-            }
-        });
-    LOG_INFO(TorrentSession, "Session created", LOG_MD(FilePath, m_filePath));
+            Metrics::ScopedTimer timer(parseTime());
+            m_meta = Utils::parseMetadata(data);
+        }
+        createTrackers();
+    }
+    m_metadataCharge = MemoryCharge(MemoryBudget::global(), MemoryCategory::Metadata);
+    if (!m_metadataCharge.tryResize(footprint(m_meta)))
+    {
+        throw std::runtime_error("Metadata memory limit reached");
+    }
+    m_totalSize.store(m_meta.totalSize, std::memory_order_relaxed);
+    m_nextAnnounce.store(Clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+    m_state = SessionState::Running;
+    LOG_INFO(TorrentSession, "Session prepared", LOG_MD(FilePath, m_filePath), LOG_MD(Name, m_meta.name));
 }
 
-void TorrentSession::prepareSession()
+Async::Task<void> TorrentSession::fetchMagnetMetadata(SessionIo io)
 {
-    m_meta = Utils::fillMetadata(m_filePath);
-    getAnnounceRequest();
+    createTrackers();
+    auto hints = m_magnet->peers;
+    IpBlocklist::global().filter(hints);
+    m_peers.merge(hints);
+    announce();
+    if (m_peers.size() == 0)
+    {
+        throw std::runtime_error("No peers to fetch metadata from");
+    }
+
+    MetadataExchange exchange(io.loop, io.executor, m_meta.infoHash, m_peerId);
+    // published on the loop thread, where cancelPrepare() runs: a stop before this is seen here, a later one there
+    co_await Async::resumeOn(io.loop);
+    m_exchange = &exchange;
+    if (m_stopRequested.load(std::memory_order_acquire))
+    {
+        exchange.cancel();
+    }
+    std::string raw;
+    try
+    {
+        raw = co_await exchange.run({m_peers.peers().begin(), m_peers.peers().end()});
+    }
+    catch (...)
+    {
+        m_exchange = nullptr;
+        throw;
+    }
+    m_exchange = nullptr;
+    co_await io.executor.schedule();
+
+    Metadata info;
+    {
+        Metrics::ScopedTimer timer(parseTime());
+        info = Utils::parseInfoDict(raw);
+    }
+    info.announce     = std::move(m_meta.announce);
+    info.announceList = std::move(m_meta.announceList);
+    m_meta            = std::move(info);
+    // the announce above only looked for peers, without a size: the first one with it starts the download
+    m_nextEvent = AnnounceEvent::Started;
+    LOG_INFO(TorrentSession, "Magnet metadata ready", LOG_MD(Name, m_meta.name), LOG_MD(Pieces, m_meta.pieceHashes.size()));
+}
+
+void TorrentSession::cancelPrepare()
+{
+    if (m_exchange)
+    {
+        m_exchange->cancel();
+    }
+}
+
+void TorrentSession::createTrackers()
+{
+    m_trackers = std::make_unique<TrackerManager>(m_meta, std::make_unique<Net::CurlTrackerTransport>());
+    m_announceUrls.clear();
+    for (const auto& tier : m_trackers->tiers())
+    {
+        for (const auto& entry : tier)
+        {
+            m_announceUrls.try_emplace(entry.url, entry.url, m_meta.infoHash, m_peerId, kListenPort);
+        }
+    }
+}
+
+void TorrentSession::tick(Clock::time_point)
+{
+    // periodic per-session housekeeping runs here (choking, request timeouts, ...)
+}
+
+void TorrentSession::stop()
+{
+    m_stopRequested.store(true, std::memory_order_release);
+}
+
+void TorrentSession::setPaused(bool paused)
+{
+    m_paused.store(paused, std::memory_order_relaxed);
+}
+
+SessionStatus TorrentSession::status() const
+{
+    SessionStatus s;
+    s.state           = m_state.load(std::memory_order_acquire);
+    s.stopRequested   = m_stopRequested.load(std::memory_order_relaxed);
+    s.paused          = m_paused.load(std::memory_order_relaxed);
+    s.totalSize       = m_totalSize.load(std::memory_order_relaxed);
+    s.knownPeers      = m_knownPeers.load(std::memory_order_relaxed);
+    s.announces       = static_cast<uint32_t>(m_announces.value());
+    s.failedAnnounces = static_cast<uint32_t>(m_failedAnnounces.value());
+    return s;
+}
+
+TorrentSession::Clock::time_point TorrentSession::nextAnnounce() const
+{
+    return Clock::time_point(Clock::duration(m_nextAnnounce.load(std::memory_order_relaxed)));
+}
+
+bool TorrentSession::announce()
+{
+    TRACE_SCOPE("TorrentSession::announce");
+    if (!m_trackers)
+    {
+        return false;
+    }
+
+    bool ok;
+    {
+        Metrics::ScopedTimer timer(m_announceLatency);
+        ok = m_trackers->announce([this](const std::string& url) { return announceUrl(url); }, m_lastAnnounce);
+    }
+
+    std::chrono::seconds interval = kRetryAnnounceInterval;
+    if (ok)
+    {
+        interval = m_lastAnnounce.interval > 0 ? std::chrono::seconds(m_lastAnnounce.interval) : kDefaultAnnounceInterval;
+    }
+    m_nextAnnounce.store((Clock::now() + interval).time_since_epoch().count(), std::memory_order_relaxed);
+
+    if (!ok)
+    {
+        m_failedAnnounces.add();
+        return false;
+    }
+    m_announces.add();
+    m_nextEvent = AnnounceEvent::None;
+    mergeAnnouncedPeers();
+    return true;
 }
 
 std::string TorrentSession::getAnnounceRequest()
 {
-    RequestBuilder builder;
-    builder.setUrl(m_meta.announce);
+    return getAnnounceRequest(m_meta.announce);
+}
 
-    builder.addParameter("info_hash", Utils::urlEncode(m_meta.infoHash));
-    builder.addParameter("peer_id", Utils::urlEncode(m_peerId));
-    builder.addParameter("port", "6'881");
-    builder.addParameter("downloaded", "0");
-    builder.addParameter("uploaded", "0");
-    builder.addParameter("left", std::to_string(m_meta.totalSize));
-    builder.addParameter("event", "started");
+std::string TorrentSession::getAnnounceRequest(const std::string& trackerUrl)
+{
+    if (auto compiled = announceUrl(trackerUrl); !compiled.empty())
+    {
+        return std::string(compiled);
+    }
+    // not one of the session's trackers, e.g. before the metadata is known
+    AnnounceUrl url(trackerUrl, m_meta.infoHash, m_peerId, kListenPort);
+    return std::string(url.build(m_uploaded.value(), m_downloaded.value(), left(), m_nextEvent));
+}
 
-    auto request = builder.build();
+std::string_view TorrentSession::announceUrl(const std::string& trackerUrl)
+{
+    auto it = m_announceUrls.find(trackerUrl);
+    if (it == m_announceUrls.end())
+    {
+        return {};
+    }
+    return it->second.build(m_uploaded.value(), m_downloaded.value(), left(), m_nextEvent);
+}
 
-    return request;
+std::optional<uint64_t> TorrentSession::left() const
+{
+    // a magnet link's metadata carries no piece length until its info dictionary is in
+    if (m_magnet && m_meta.pieceLength == 0)
+    {
+        return std::nullopt;
+    }
+    return m_meta.totalSize;
+}
+
+size_t TorrentSession::handleAnnounceResponse(std::string_view body)
+{
+    parseAnnounceResponse(body, m_lastAnnounce);
+    if (!m_lastAnnounce.failureReason.empty())
+    {
+        LOG_WARNING(TorrentSession, "Tracker rejected announce", LOG_MD(Reason, m_lastAnnounce.failureReason));
+        return 0;
+    }
+    return mergeAnnouncedPeers();
+}
+
+size_t TorrentSession::mergeAnnouncedPeers()
+{
+    size_t blocked = IpBlocklist::global().filter(m_lastAnnounce.peers);
+    size_t added   = m_peers.merge(m_lastAnnounce.peers);
+    m_knownPeers.store(m_peers.size(), std::memory_order_relaxed);
+    LOG_INFO(TorrentSession, "Announce response", LOG_MD(Received, m_lastAnnounce.peers.size() + blocked),
+        LOG_MD(Blocked, blocked), LOG_MD(New, added), LOG_MD(Known, m_peers.size()));
+    return added;
 }
 }  // namespace Torrent::Core
@@ -1,27 +1,140 @@
 #ifndef TORRENTSESSION_HPP
 #define TORRENTSESSION_HPP
 
+#include "AnnounceUrl.hpp"
+#include "MemoryBudget.hpp"
+#include "PeerStore.hpp"
+#include "TrackerManager.hpp"
+#include "TrackerResponse.hpp"
+
+#include <Async/DiskIo.hpp>
+#include <Metrics/Metrics.hpp>
+#include <Net/EventLoop.hpp>
+#include <Utils/MagnetUri.hpp>
 #include <Utils/MetaUtils.hpp>
-#include <thread>
+#include <atomic>
+#include <chrono>
+#include <optional>
+#include <string>
+#include <unordered_map>
 
 namespace Torrent::Core {
 
+enum class SessionState : uint8_t
+{
+    Created,
+    Preparing,
+    Running,
+    Stopped,
+    Failed
+};
+
+struct SessionStatus
+{
+    SessionState state       = SessionState::Created;
+    bool stopRequested       = false;
+    bool paused              = false;
+    uint64_t totalSize       = 0;
+    uint64_t knownPeers      = 0;
+    uint32_t announces       = 0;
+    uint32_t failedAnnounces = 0;
+};
+
+class MetadataExchange;
+class SessionManager;
+
+// Threads a session's asynchronous work may use; the loop also carries its peer connections.
+struct SessionIo
+{
+    Async::DiskIo& disk;
+    Async::Executor& executor;
+    Net::EventLoop& loop;
+};
+
+// Session state lives behind atomics so status() and stop() never wait for the worker currently running a
+// session task. The session itself owns no threads: SessionManager schedules prepare/announce/tick on its pool.
 class TorrentSession
 {
 public:
-    explicit TorrentSession(const std::string& peerId, const std::string& filePath);
+    using Clock = std::chrono::steady_clock;
+
+    // source is a .torrent path or a magnet URI; a magnet session fetches its info dictionary from peers.
+    explicit TorrentSession(const std::string& peerId, const std::string& source);
+    // Resumes a session from metadata parsed earlier, e.g. out of a state file; prepare then skips the disk read,
+    // the parse and a magnet link's metadata fetch.
+    TorrentSession(const std::string& peerId, const std::string& source, Metadata meta);
     std::string getAnnounceRequest();
+    std::string getAnnounceRequest(const std::string& trackerUrl);
+    bool announce();
+    size_t handleAnnounceResponse(std::string_view body);
 
-    void prepareSession();
-    void start();
+    // Reads the .torrent off the disk pool, or for a magnet link announces and fetches the info dictionary from
+    // peers. announce/tick stay synchronous while trackers use curl.
+    Async::Task<void> prepareSession(SessionIo io);
+    void tick(Clock::time_point now);
     void stop();
-    void status();
+    // A paused session keeps its state but gets no announces or ticks until it is resumed.
+    void setPaused(bool paused);
+    SessionStatus status() const;
+
+    const Metadata& metadata() const
+    {
+        return m_meta;
+    }
+
+    // Peers learned from trackers and the magnet link; read it only while no task of this session runs.
+    std::span<const Net::Endpoint> peers() const
+    {
+        return m_peers.peers();
+    }
+
+    // Per-session scope under the global registry, labelled session="<n>" in creation order. A swarm given it as
+    // Swarm::Options::metrics counts its transfers here, and announces report them.
+    Metrics::Registry& metrics()
+    {
+        return m_metrics;
+    }
 
 private:
+    friend class SessionManager;
+
+    Async::Task<void> fetchMagnetMetadata(SessionIo io);
+    // Ends a magnet's metadata fetch once stop() was called; the session's loop thread only.
+    void cancelPrepare();
+    void createTrackers();
+    std::string_view announceUrl(const std::string& trackerUrl);
+    // Bytes still to download; unknown while a magnet link's metadata is fetched.
+    std::optional<uint64_t> left() const;
+    size_t mergeAnnouncedPeers();
+    Clock::time_point nextAnnounce() const;
+
     Metadata m_meta;
-    std::jthread m_thread;
+    PeerStore m_peers;
+    AnnounceResponse m_lastAnnounce;
+    std::unique_ptr<TrackerManager> m_trackers;
+    std::unordered_map<std::string, AnnounceUrl> m_announceUrls;  // by tracker URL, compiled with the trackers
+    AnnounceEvent m_nextEvent = AnnounceEvent::Started;
     std::string m_filePath;
+    std::optional<Utils::MagnetLink> m_magnet;
+    bool m_restored = false;
     std::string m_peerId;
+    MemoryCharge m_metadataCharge;  // once prepared
+    MetadataExchange* m_exchange = nullptr;  // while the magnet's metadata is fetched; loop thread only
+
+    std::atomic<SessionState> m_state{SessionState::Created};
+    std::atomic<bool> m_stopRequested{false};
+    std::atomic<bool> m_paused{false};
+    std::atomic<bool> m_busy{false};  // a task for this session is queued or running
+    std::atomic<uint64_t> m_totalSize{0};
+    std::atomic<uint64_t> m_knownPeers{0};
+    std::atomic<Clock::rep> m_nextAnnounce{0};
+
+    Metrics::Registry m_metrics;
+    Metrics::Counter& m_announces;
+    Metrics::Counter& m_failedAnnounces;
+    Metrics::Histogram& m_announceLatency;
+    Metrics::Counter& m_downloaded;
+    Metrics::Counter& m_uploaded;
 };
 }  // namespace Torrent::Core
 #endif  // TORRENTSESSION_HPP
@@ -0,0 +1,134 @@
+#include "TrackerManager.hpp"
+
+#include <Logger.hpp>
+
+#include <algorithm>
+#include <random>
+
+namespace Torrent::Core {
+
+TrackerManager::TrackerManager(const Metadata& meta, std::unique_ptr<ITrackerTransport> transport)
+    : TrackerManager(meta, std::move(transport), Options{}, std::random_device{}())
+{}
+
+TrackerManager::TrackerManager(
+    const Metadata& meta, std::unique_ptr<ITrackerTransport> transport, Options options, uint64_t seed)
+    : m_transport(std::move(transport))
+    , m_options(options)
+{
+    std::mt19937_64 rng(seed);
+
+    // BEP 12: when announce-list is present, announce is ignored
+    if (!meta.announceList.empty())
+    {
+        for (const auto& urls : meta.announceList)
+        {
+            auto& tier = m_tiers.emplace_back();
+            for (const auto& url : urls)
+            {
+                tier.push_back({url});
+            }
+            std::shuffle(tier.begin(), tier.end(), rng);
+        }
+    }
+    else if (!meta.announce.empty())
+    {
+        m_tiers.push_back({{meta.announce}});
+    }
+}
+
+void TrackerManager::markFailed(TrackerEntry& entry, std::chrono::steady_clock::time_point now)
+{
+    ++entry.failures;
+    auto shift    = std::min<uint32_t>(entry.failures - 1, 16);
+    auto backoff  = std::min<std::chrono::seconds>(m_options.backoffBase * (1LL << shift), m_options.backoffMax);
+    entry.retryAt = now + backoff;
+    LOG_WARNING(TrackerManager, "Tracker failed", LOG_MD(Url, entry.url), LOG_MD(Failures, entry.failures),
+        LOG_MD(BackoffSec, backoff.count()));
+}
+
+bool TrackerManager::announce(const UrlBuilder& buildUrl, AnnounceResponse& out)
+{
+    if (!m_transport)
+    {
+        LOG_ERROR(TrackerManager, "No tracker transport");
+        return false;
+    }
+
+    AnnounceResponse candidate;
+
+    auto accept = [&](std::string_view body)
+    {
+        try
+        {
+            parseAnnounceResponse(body, candidate);
+        }
+        catch (const std::exception& e)
+        {
+            LOG_WARNING(TrackerManager, "Malformed tracker response", LOG_MD(Error, e.what()));
+            return false;
+        }
+        if (!candidate.failureReason.empty())
+        {
+            out = candidate;
+            return false;
+        }
+        return true;
+    };
+
+    for (size_t t = 0; t < m_tiers.size(); ++t)
+    {
+        auto& tier = m_tiers[t];
+        auto now   = std::chrono::steady_clock::now();
+
+        // strings are overwritten in place and never dropped so that their buffers survive
+        m_eligible.clear();
+        for (size_t i = 0; i < tier.size(); ++i)
+        {
+            if (tier[i].retryAt <= now)
+            {
+                if (m_urls.size() <= m_eligible.size())
+                {
+                    m_urls.emplace_back();
+                }
+                m_urls[m_eligible.size()].assign(buildUrl(tier[i].url));
+                m_eligible.push_back(i);
+            }
+        }
+        if (m_eligible.empty())
+        {
+            continue;
+        }
+
+        std::span<const std::string> urls(m_urls.data(), m_eligible.size());
+        m_failed.assign(urls.size(), false);
+        auto result = m_transport->race(urls, m_options.timeout, accept, m_failed);
+
+        now = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < m_failed.size(); ++i)
+        {
+            if (m_failed[i])
+            {
+                markFailed(tier[m_eligible[i]], now);
+            }
+        }
+
+        if (result)
+        {
+            out = std::move(candidate);
+
+            auto winner      = tier.begin() + static_cast<std::ptrdiff_t>(m_eligible[result->index]);
+            winner->failures = 0;
+            winner->retryAt  = {};
+            std::rotate(tier.begin(), winner, winner + 1);
+            LOG_INFO(TrackerManager, "Announce succeeded", LOG_MD(Tier, t), LOG_MD(Url, tier.front().url),
+                LOG_MD(Peers, out.peers.size()));
+            return true;
+        }
+    }
+
+    LOG_WARNING(TrackerManager, "All trackers failed", LOG_MD(Tiers, m_tiers.size()));
+    return false;
+}
+
+}  // namespace Torrent::Core
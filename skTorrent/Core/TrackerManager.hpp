@@ -0,0 +1,84 @@
+#ifndef TRACKERMANAGER_HPP
+#define TRACKERMANAGER_HPP
+
+#include "TrackerResponse.hpp"
+
+#include <Utils/MetaUtils.hpp>
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace Torrent::Core {
+
+class ITrackerTransport
+{
+public:
+    struct Result
+    {
+        size_t index = 0;  // position in the urls passed to race()
+        std::string body;
+    };
+
+    using Accept = std::function<bool(std::string_view body)>;
+
+    virtual ~ITrackerTransport() = default;
+
+    // Issues every request concurrently and returns the first response that passes accept(). Requests that
+    // completed with an error (or were rejected) are flagged in failed; requests still in flight are not.
+    virtual std::optional<Result> race(std::span<const std::string> urls, std::chrono::milliseconds timeout,
+        const Accept& accept, std::vector<bool>& failed) = 0;
+};
+
+struct TrackerEntry
+{
+    std::string url;
+    uint32_t failures = 0;
+    std::chrono::steady_clock::time_point retryAt{};
+};
+
+// BEP 12 multi-tracker announce: trackers are shuffled once within their tier, every eligible tracker of a tier
+// is raced in parallel, the winner is moved to the front of its tier and failing trackers back off exponentially.
+class TrackerManager
+{
+public:
+    struct Options
+    {
+        std::chrono::milliseconds timeout{15'000};
+        std::chrono::seconds backoffBase{15};
+        std::chrono::seconds backoffMax{1'800};
+    };
+
+    // The returned view only has to stay valid until the builder is called again.
+    using UrlBuilder = std::function<std::string_view(const std::string& trackerUrl)>;
+
+    TrackerManager(const Metadata& meta, std::unique_ptr<ITrackerTransport> transport);
+    TrackerManager(const Metadata& meta, std::unique_ptr<ITrackerTransport> transport, Options options, uint64_t seed);
+
+    // Returns false when no tier produced a usable response; out then holds the last failure, if any.
+    bool announce(const UrlBuilder& buildUrl, AnnounceResponse& out);
+
+    const std::vector<std::vector<TrackerEntry>>& tiers() const
+    {
+        return m_tiers;
+    }
+
+private:
+    void markFailed(TrackerEntry& entry, std::chrono::steady_clock::time_point now);
+
+    std::vector<std::vector<TrackerEntry>> m_tiers;
+    std::unique_ptr<ITrackerTransport> m_transport;
+    Options m_options;
+
+    // Reused across announces so that building the requests of a tier does not allocate once warmed up.
+    std::vector<size_t> m_eligible;
+    std::vector<std::string> m_urls;
+    std::vector<bool> m_failed;
+};
+
+}  // namespace Torrent::Core
+#endif  // TRACKERMANAGER_HPP
@@ -0,0 +1,91 @@
+#include "TrackerResponse.hpp"
+
+#include <Utils/BencodeParser.hpp>
+#include <Utils/CompactPeers.hpp>
+
+#include <arpa/inet.h>
+
+namespace Torrent::Core {
+
+namespace {
+void parseDictPeers(std::string_view raw, std::vector<Net::Endpoint>& out)
+{
+    Utils::Bencode::Parser parser(raw);
+    auto value = parser.parse();
+    for (const auto& peer : value.asList())
+    {
+        const auto& dict = peer.asDict();
+        auto ip          = dict.find("ip");
+        auto port        = dict.find("port");
+        if (ip == dict.end() || port == dict.end())
+        {
+            continue;
+        }
+
+        uint8_t addr[16];
+        auto p = static_cast<uint16_t>(port->second.asInt());
+        if (inet_pton(AF_INET, ip->second.asStr().c_str(), addr) == 1)
+        {
+            out.push_back(Net::Endpoint::fromV4(addr, p));
+        }
+        else if (inet_pton(AF_INET6, ip->second.asStr().c_str(), addr) == 1)
+        {
+            out.push_back(Net::Endpoint::fromV6(addr, p));
+        }
+    }
+}
+}  // namespace
+
+void parseAnnounceResponse(std::string_view body, AnnounceResponse& out)
+{
+    namespace Bencode = Utils::Bencode;
+
+    out.reset();
+    Bencode::DictScanner scanner(body);
+    std::string_view key;
+    std::string_view value;
+    while (scanner.next(key, value))
+    {
+        if (key == "failure reason")
+        {
+            out.failureReason = Bencode::stringView(value);
+        }
+        else if (key == "warning message")
+        {
+            out.warningMessage = Bencode::stringView(value);
+        }
+        else if (key == "interval")
+        {
+            out.interval = static_cast<uint64_t>(Bencode::intValue(value));
+        }
+        else if (key == "min interval")
+        {
+            out.minInterval = static_cast<uint64_t>(Bencode::intValue(value));
+        }
+        else if (key == "complete")
+        {
+            out.complete = static_cast<uint64_t>(Bencode::intValue(value));
+        }
+        else if (key == "incomplete")
+        {
+            out.incomplete = static_cast<uint64_t>(Bencode::intValue(value));
+        }
+        else if (key == "peers")
+        {
+            if (value.front() == 'l')
+            {
+                parseDictPeers(value, out.peers);
+            }
+            else
+            {
+                Utils::decodeCompactPeers4(Bencode::stringView(value), out.peers);
+            }
+        }
+        else if (key == "peers6")
+        {
+            Utils::decodeCompactPeers6(Bencode::stringView(value), out.peers);
+        }
+    }
+}
+
+}  // namespace Torrent::Core
@@ -0,0 +1,39 @@
+#ifndef TRACKERRESPONSE_HPP
+#define TRACKERRESPONSE_HPP
+
+#include <Net/Endpoint.hpp>
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Torrent::Core {
+
+struct AnnounceResponse
+{
+    void reset()
+    {
+        failureReason.clear();
+        warningMessage.clear();
+        interval    = 0;
+        minInterval = 0;
+        complete    = 0;
+        incomplete  = 0;
+        peers.clear();
+    }
+
+    std::string failureReason;
+    std::string warningMessage;
+    uint64_t interval    = 0;
+    uint64_t minInterval = 0;
+    uint64_t complete    = 0;
+    uint64_t incomplete  = 0;
+    std::vector<Net::Endpoint> peers;
+};
+
+// Parses a tracker announce response in place. Compact peers/peers6 blobs are decoded straight from the
+// response buffer; only the non-compact (dictionary model) peer list goes through Bencode::Value.
+void parseAnnounceResponse(std::string_view body, AnnounceResponse& out);
+
+}  // namespace Torrent::Core
+#endif  // TRACKERRESPONSE_HPP
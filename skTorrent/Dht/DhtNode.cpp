@@ -0,0 +1,777 @@
+#include "DhtNode.hpp"
+
+#include <Core/IpFilter.hpp>
+#include <Core/PeerStore.hpp>
+#include <Utils/BencodeEncoder.hpp>
+#include <Utils/CompactPeers.hpp>
+#include <Utils/MetaUtils.hpp>
+
+#include <Logger.hpp>
+
+#include <algorithm>
+#include <iterator>
+#include <sys/epoll.h>
+
+namespace Torrent::Dht {
+
+namespace Bencode = Utils::Bencode;
+
+namespace {
+constexpr size_t kCompactNodeSize = 26;
+
+const Bencode::Value* field(const Bencode::Dict& dict, const std::string& key)
+{
+    auto it = dict.find(key);
+    return it == dict.end() ? nullptr : &it->second;
+}
+
+const std::string* stringField(const Bencode::Dict& dict, const std::string& key)
+{
+    const auto* v = field(dict, key);
+    return v && v->isStr() ? &v->asStr() : nullptr;
+}
+
+std::optional<NodeId> idField(const Bencode::Dict& dict, const std::string& key)
+{
+    const auto* s = stringField(dict, key);
+    if (!s || s->size() != 20)
+    {
+        return std::nullopt;
+    }
+    return nodeIdFrom(*s);
+}
+
+std::string compactEndpoint(const Net::Endpoint& ep)
+{
+    std::string out(ep.address.begin() + 12, ep.address.end());
+    out.push_back(static_cast<char>(ep.port >> 8));
+    out.push_back(static_cast<char>(ep.port & 0xff));
+    return out;
+}
+}  // namespace
+
+struct DhtNode::Lookup
+{
+    enum class State : uint8_t
+    {
+        Fresh,
+        InFlight,
+        Responded,
+        Failed
+    };
+
+    struct Candidate
+    {
+        NodeId id;
+        Net::Endpoint endpoint;
+        State state = State::Fresh;
+        std::string token;
+    };
+
+    void addCandidate(const NodeId& id, const Net::Endpoint& ep, const NodeId& self, size_t limit)
+    {
+        if (id == self)
+        {
+            return;
+        }
+        auto pos = std::find_if(candidates.begin(), candidates.end(),
+            [&](const Candidate& c) { return c.id == id || closer(target, id, c.id); });
+        if (pos != candidates.end() && pos->id == id)
+        {
+            return;
+        }
+        if (candidates.size() >= limit && pos == candidates.end())
+        {
+            return;
+        }
+        candidates.insert(pos, Candidate{id, ep, State::Fresh, {}});
+        if (candidates.size() > limit)
+        {
+            candidates.pop_back();
+        }
+    }
+
+    NodeId target;
+    bool wantPeers  = false;
+    bool finished   = false;
+    size_t inflight = 0;
+    std::vector<Candidate> candidates;
+    Core::PeerStore peers;
+    std::function<void(Lookup&)> onDone;
+};
+
+DhtNode::DhtNode(Net::EventLoop& loop, const Net::Endpoint& bindTo)
+    : DhtNode(loop, bindTo, Options{})
+{}
+
+DhtNode::DhtNode(Net::EventLoop& loop, const Net::Endpoint& bindTo, Options options, std::optional<NodeId> id)
+    : m_loop(loop)
+    , m_socket(bindTo)
+    , m_options(options)
+    , m_blocklist(m_options.blocklist ? *m_options.blocklist : Core::IpBlocklist::global())
+    , m_rng(std::random_device{}())
+    , m_id(id ? *id : randomNodeId(m_rng))
+    , m_table(m_id)
+{
+    rotateTokens();
+    rotateTokens();
+    m_rotationTimer = m_loop.runEvery(
+        std::chrono::duration_cast<std::chrono::milliseconds>(m_options.tokenRotation), [this] { rotateTokens(); });
+    m_refreshTimer = m_loop.runEvery(
+        std::chrono::duration_cast<std::chrono::milliseconds>(m_options.refreshInterval), [this] { refreshBuckets(); });
+    m_loop.add(m_socket.fd(), EPOLLIN, [this](uint32_t) { onReadable(); });
+    LOG_INFO(DhtNode, "DHT node started", LOG_MD(Endpoint, endpoint().toString()));
+}
+
+DhtNode::~DhtNode()
+{
+    m_loop.remove(m_socket.fd());
+    m_loop.cancel(m_rotationTimer);
+    m_loop.cancel(m_refreshTimer);
+    for (auto& [tid, pending] : m_pending)
+    {
+        m_loop.cancel(pending.timer);
+    }
+}
+
+void DhtNode::rotateTokens()
+{
+    m_prevSecret = m_secret;
+    std::uniform_int_distribution<int> byte(0, 255);
+    for (auto& b : m_secret)
+    {
+        b = static_cast<uint8_t>(byte(m_rng));
+    }
+
+    // the rotation period doubles as the idle horizon for rate-limit state
+    auto now = m_loop.now();
+    std::erase_if(m_rates, [&](const auto& entry) { return now - entry.second.last > m_options.tokenRotation; });
+
+    // stored peers are kept in announce order, so the stale ones form a prefix
+    for (auto it = m_peers.begin(); it != m_peers.end();)
+    {
+        auto& peers = it->second;
+        auto fresh  = std::find_if(peers.begin(), peers.end(),
+            [&](const StoredPeer& peer) { return now - peer.seen <= m_options.peerLifetime; });
+        peers.erase(peers.begin(), fresh);
+        it = peers.empty() ? m_peers.erase(it) : std::next(it);
+    }
+}
+
+std::string DhtNode::makeToken(const Net::Endpoint& from) const
+{
+    std::string material(reinterpret_cast<const char*>(m_secret.data()), m_secret.size());
+    material.append(reinterpret_cast<const char*>(from.address.data()), from.address.size());
+    return Utils::computeInfoHash(material).substr(0, 8);
+}
+
+bool DhtNode::checkToken(const Net::Endpoint& from, std::string_view token) const
+{
+    if (token == makeToken(from))
+    {
+        return true;
+    }
+    std::string material(reinterpret_cast<const char*>(m_prevSecret.data()), m_prevSecret.size());
+    material.append(reinterpret_cast<const char*>(from.address.data()), from.address.size());
+    return token == Utils::computeInfoHash(material).substr(0, 8);
+}
+
+bool DhtNode::allowQuery(const Net::Endpoint& from)
+{
+    auto now         = m_loop.now();
+    auto [it, isNew] = m_rates.try_emplace(from);
+    auto& bucket     = it->second;
+    if (isNew)
+    {
+        bucket.tokens = m_options.queryBurst;
+    }
+    else
+    {
+        double elapsed = std::chrono::duration<double>(now - bucket.last).count();
+        bucket.tokens  = std::min(m_options.queryBurst, bucket.tokens + elapsed * m_options.queryRate);
+    }
+    bucket.last = now;
+
+    if (bucket.tokens < 1.0)
+    {
+        return false;
+    }
+    bucket.tokens -= 1.0;
+    return true;
+}
+
+void DhtNode::onReadable()
+{
+    uint8_t buffer[2'048];
+    Net::Endpoint from;
+    while (true)
+    {
+        ssize_t n = m_socket.receiveFrom(from, buffer);
+        if (n < 0)
+        {
+            break;
+        }
+        handleMessage(from, std::string_view(reinterpret_cast<const char*>(buffer), static_cast<size_t>(n)));
+    }
+}
+
+void DhtNode::handleMessage(const Net::Endpoint& from, std::string_view packet)
+{
+    if (m_blocklist.blocked(from))
+    {
+        ++m_stats.blocked;
+        return;
+    }
+    Bencode::Value msg;
+    try
+    {
+        msg = Bencode::Parser(packet).parse();
+    }
+    catch (const std::exception& e)
+    {
+        LOG_DEBUG(DhtNode, "Dropping malformed packet", LOG_MD(From, from.toString()), LOG_MD(Error, e.what()));
+        return;
+    }
+    if (!msg.isDict())
+    {
+        return;
+    }
+
+    const auto& dict = msg.asDict();
+    const auto* type = stringField(dict, "y");
+    if (!type || !stringField(dict, "t"))
+    {
+        return;
+    }
+
+    if (*type == "q")
+    {
+        ++m_stats.queriesReceived;
+        if (!allowQuery(from))
+        {
+            ++m_stats.queriesDropped;
+            return;
+        }
+        handleQuery(from, dict);
+    }
+    else if (*type == "r" || *type == "e")
+    {
+        handleReply(from, dict, *type == "e");
+    }
+}
+
+void DhtNode::handleQuery(const Net::Endpoint& from, const Bencode::Dict& msg)
+{
+    const auto& tid    = *stringField(msg, "t");
+    const auto* method = stringField(msg, "q");
+    const auto* args   = field(msg, "a");
+    if (!method || !args || !args->isDict())
+    {
+        sendError(from, tid, 203, "Protocol Error");
+        return;
+    }
+
+    const auto& a = args->asDict();
+    auto sender   = idField(a, "id");
+    if (!sender)
+    {
+        sendError(from, tid, 203, "Protocol Error");
+        return;
+    }
+    if (from.isV4())
+    {
+        m_table.add(*sender, from, m_loop.now());
+    }
+
+    Bencode::Dict reply;
+    reply["id"] = std::string(asView(m_id));
+
+    if (*method == "ping")
+    {
+        sendReply(from, tid, std::move(reply));
+    }
+    else if (*method == "find_node")
+    {
+        auto target = idField(a, "target");
+        if (!target)
+        {
+            sendError(from, tid, 203, "Protocol Error");
+            return;
+        }
+        reply["nodes"] = compactNodes(*target);
+        sendReply(from, tid, std::move(reply));
+    }
+    else if (*method == "get_peers")
+    {
+        auto infoHash = idField(a, "info_hash");
+        if (!infoHash)
+        {
+            sendError(from, tid, 203, "Protocol Error");
+            return;
+        }
+        reply["token"] = makeToken(from);
+        reply["nodes"] = compactNodes(*infoHash);
+        if (auto it = m_peers.find(*infoHash); it != m_peers.end())
+        {
+            auto now = m_loop.now();
+            Bencode::List values;
+            for (const auto& peer : it->second)
+            {
+                if (now - peer.seen <= m_options.peerLifetime)
+                {
+                    values.emplace_back(compactEndpoint(peer.endpoint));
+                }
+            }
+            if (!values.empty())
+            {
+                reply["values"] = std::move(values);
+            }
+        }
+        sendReply(from, tid, std::move(reply));
+    }
+    else if (*method == "announce_peer")
+    {
+        auto infoHash     = idField(a, "info_hash");
+        const auto* token = stringField(a, "token");
+        const auto* port  = field(a, "port");
+        if (!infoHash || !token || !port || !port->isInt())
+        {
+            sendError(from, tid, 203, "Protocol Error");
+            return;
+        }
+        if (!checkToken(from, *token))
+        {
+            sendError(from, tid, 203, "Bad token");
+            return;
+        }
+
+        const auto* implied = field(a, "implied_port");
+        Net::Endpoint peer  = from;
+        if (!implied || !implied->isInt() || implied->asInt() == 0)
+        {
+            peer.port = static_cast<uint16_t>(port->asInt());
+        }
+
+        // a re-announce refreshes the peer and moves it to the back; when full the oldest one goes
+        auto& peers = m_peers[*infoHash];
+        auto known  = std::find_if(peers.begin(), peers.end(), [&](const StoredPeer& p) { return p.endpoint == peer; });
+        if (known != peers.end())
+        {
+            peers.erase(known);
+        }
+        else if (peers.size() >= m_options.maxPeersPerHash)
+        {
+            peers.erase(peers.begin());
+        }
+        peers.push_back({peer, m_loop.now()});
+        sendReply(from, tid, std::move(reply));
+    }
+    else
+    {
+        sendError(from, tid, 204, "Method Unknown");
+    }
+}
+
+void DhtNode::handleReply(const Net::Endpoint& from, const Bencode::Dict& msg, bool isError)
+{
+    const auto& tid = *stringField(msg, "t");
+    if (tid.size() != 2)
+    {
+        return;
+    }
+    uint16_t key = static_cast<uint16_t>((static_cast<uint8_t>(tid[0]) << 8) | static_cast<uint8_t>(tid[1]));
+
+    auto it = m_pending.find(key);
+    if (it == m_pending.end() || !(it->second.to == from))
+    {
+        return;
+    }
+    m_loop.cancel(it->second.timer);
+    auto handler = std::move(it->second.handler);
+    m_pending.erase(it);
+
+    ++m_stats.responsesReceived;
+    const auto* body = isError ? nullptr : field(msg, "r");
+    if (!body || !body->isDict())
+    {
+        handler(nullptr);
+        return;
+    }
+
+    if (auto id = idField(body->asDict(), "id"))
+    {
+        m_table.add(*id, from, m_loop.now());
+    }
+    handler(&body->asDict());
+}
+
+void DhtNode::send(const Net::Endpoint& to, const Bencode::Value& msg)
+{
+    thread_local std::string buffer;
+    buffer.clear();
+    Bencode::encode(msg, buffer);
+    m_socket.sendTo(to, std::span(reinterpret_cast<const uint8_t*>(buffer.data()), buffer.size()));
+}
+
+void DhtNode::sendQuery(const Net::Endpoint& to, const std::string& method, Bencode::Dict args, ResponseHandler handler)
+{
+    uint16_t tid = m_nextTid++;
+    while (m_pending.contains(tid))
+    {
+        tid = m_nextTid++;
+    }
+    std::string t{static_cast<char>(tid >> 8), static_cast<char>(tid & 0xff)};
+
+    Pending pending;
+    pending.to      = to;
+    pending.handler = std::move(handler);
+    pending.timer   = m_loop.runAfter(m_options.queryTimeout,
+        [this, tid]
+        {
+            auto it = m_pending.find(tid);
+            if (it == m_pending.end())
+            {
+                return;
+            }
+            auto expired = std::move(it->second.handler);
+            m_pending.erase(it);
+            ++m_stats.timeouts;
+            expired(nullptr);
+        });
+    m_pending.emplace(tid, std::move(pending));
+
+    args["id"] = std::string(asView(m_id));
+    Bencode::Dict msg;
+    msg["a"] = std::move(args);
+    msg["q"] = method;
+    msg["t"] = std::move(t);
+    msg["y"] = std::string("q");
+    send(to, msg);
+}
+
+void DhtNode::sendReply(const Net::Endpoint& to, const std::string& tid, Bencode::Dict reply)
+{
+    Bencode::Dict msg;
+    msg["r"] = std::move(reply);
+    msg["t"] = tid;
+    msg["y"] = std::string("r");
+    send(to, msg);
+}
+
+void DhtNode::sendError(const Net::Endpoint& to, const std::string& tid, uint64_t code, const std::string& message)
+{
+    Bencode::Dict msg;
+    msg["e"] = Bencode::List{Bencode::Value{code}, Bencode::Value{message}};
+    msg["t"] = tid;
+    msg["y"] = std::string("e");
+    send(to, msg);
+}
+
+std::string DhtNode::compactNodes(const NodeId& target)
+{
+    m_table.closest(target, RoutingTable::K, m_scratch);
+    std::string out;
+    out.reserve(m_scratch.size() * kCompactNodeSize);
+    for (const auto& node : m_scratch)
+    {
+        out.append(asView(node.id));
+        out.append(compactEndpoint(node.endpoint));
+    }
+    return out;
+}
+
+void DhtNode::bootstrap(const std::vector<Net::Endpoint>& nodes, DoneCallback done)
+{
+    auto remaining = std::make_shared<size_t>(nodes.size());
+    auto finish    = [this, done = std::move(done)]
+    {
+        findNode(m_id,
+            [this, done]
+            {
+                refreshBuckets(
+                    [this, done]
+                    {
+                        LOG_INFO(DhtNode, "Bootstrap complete", LOG_MD(Nodes, m_table.size()));
+                        if (done)
+                        {
+                            done();
+                        }
+                    });
+            });
+    };
+
+    if (nodes.empty())
+    {
+        finish();
+        return;
+    }
+
+    for (const auto& node : nodes)
+    {
+        Bencode::Dict args;
+        args["target"] = std::string(asView(m_id));
+        sendQuery(node, "find_node", std::move(args),
+            [remaining, finish](const Bencode::Dict*)
+            {
+                if (--*remaining == 0)
+                {
+                    finish();
+                }
+            });
+    }
+}
+
+void DhtNode::refreshBuckets(DoneCallback done)
+{
+    std::vector<NodeId> targets;
+    for (size_t i = 0; i <= m_table.depth(); ++i)
+    {
+        if (m_table.bucketSize(i) >= RoutingTable::K)
+        {
+            continue;
+        }
+        // random id sharing exactly i prefix bits with us
+        NodeId target = randomNodeId(m_rng);
+        for (size_t bit = 0; bit <= i; ++bit)
+        {
+            uint8_t mask = static_cast<uint8_t>(0x80 >> (bit % 8));
+            bool set     = (m_id[bit / 8] & mask) != 0;
+            if (bit == i)
+            {
+                set = !set;
+            }
+            target[bit / 8] = static_cast<uint8_t>(set ? (target[bit / 8] | mask) : (target[bit / 8] & ~mask));
+        }
+        targets.push_back(target);
+    }
+
+    if (targets.empty())
+    {
+        if (done)
+        {
+            done();
+        }
+        return;
+    }
+
+    auto remaining = std::make_shared<size_t>(targets.size());
+    for (const auto& target : targets)
+    {
+        findNode(target,
+            [remaining, done]
+            {
+                if (--*remaining == 0 && done)
+                {
+                    done();
+                }
+            });
+    }
+}
+
+void DhtNode::findNode(const NodeId& target, DoneCallback done)
+{
+    auto lookup    = std::make_shared<Lookup>();
+    lookup->target = target;
+    lookup->onDone = [done = std::move(done)](Lookup&)
+    {
+        if (done)
+        {
+            done();
+        }
+    };
+    startLookup(lookup);
+}
+
+void DhtNode::getPeers(const NodeId& infoHash, PeersCallback done)
+{
+    auto lookup       = std::make_shared<Lookup>();
+    lookup->target    = infoHash;
+    lookup->wantPeers = true;
+    lookup->onDone    = [done = std::move(done)](Lookup& l)
+    {
+        auto peers = l.peers.peers();
+        done(std::vector<Net::Endpoint>(peers.begin(), peers.end()));
+    };
+    startLookup(lookup);
+}
+
+void DhtNode::announce(const NodeId& infoHash, uint16_t port, PeersCallback done)
+{
+    auto lookup       = std::make_shared<Lookup>();
+    lookup->target    = infoHash;
+    lookup->wantPeers = true;
+    lookup->onDone    = [this, infoHash, port, done = std::move(done)](Lookup& l)
+    {
+        auto found = l.peers.peers();
+        auto peers = std::make_shared<std::vector<Net::Endpoint>>(found.begin(), found.end());
+        auto left  = std::make_shared<size_t>(0);
+
+        size_t sent = 0;
+        for (const auto& c : l.candidates)
+        {
+            if (sent == RoutingTable::K)
+            {
+                break;
+            }
+            if (c.state != Lookup::State::Responded || c.token.empty())
+            {
+                continue;
+            }
+            Bencode::Dict args;
+            args["info_hash"]    = std::string(asView(infoHash));
+            args["port"]         = Bencode::Value{static_cast<Bencode::Integer>(port)};
+            args["token"]        = c.token;
+            args["implied_port"] = Bencode::Value{Bencode::Integer{0}};
+            ++*left;
+            ++sent;
+            sendQuery(c.endpoint, "announce_peer", std::move(args),
+                [left, peers, done](const Bencode::Dict*)
+                {
+                    if (--*left == 0)
+                    {
+                        done(*peers);
+                    }
+                });
+        }
+        LOG_DEBUG(DhtNode, "Announcing", LOG_MD(Nodes, sent));
+        if (sent == 0)
+        {
+            done(*peers);
+        }
+    };
+    startLookup(lookup);
+}
+
+void DhtNode::startLookup(const std::shared_ptr<Lookup>& lookup)
+{
+    m_table.closest(lookup->target, m_options.maxLookupCandidates, m_scratch);
+    for (const auto& node : m_scratch)
+    {
+        lookup->addCandidate(node.id, node.endpoint, m_id, m_options.maxLookupCandidates);
+    }
+    stepLookup(lookup);
+}
+
+void DhtNode::stepLookup(const std::shared_ptr<Lookup>& lookup)
+{
+    if (lookup->finished)
+    {
+        return;
+    }
+
+    size_t responded = 0;
+    bool pending     = false;
+    for (auto& c : lookup->candidates)
+    {
+        if (responded >= RoutingTable::K)
+        {
+            break;
+        }
+        if (c.state == Lookup::State::Failed)
+        {
+            continue;
+        }
+        if (c.state == Lookup::State::Responded)
+        {
+            ++responded;
+            continue;
+        }
+
+        pending = true;
+        if (c.state == Lookup::State::InFlight || lookup->inflight >= m_options.alpha)
+        {
+            continue;
+        }
+
+        c.state = Lookup::State::InFlight;
+        ++lookup->inflight;
+
+        Bencode::Dict args;
+        args[lookup->wantPeers ? "info_hash" : "target"] = std::string(asView(lookup->target));
+        NodeId id = c.id;
+        sendQuery(c.endpoint, lookup->wantPeers ? "get_peers" : "find_node", std::move(args),
+            [this, lookup, id](const Bencode::Dict* reply) { onLookupReply(lookup, id, reply); });
+    }
+
+    // the K closest nodes have all answered (or failed): stragglers further out are not worth waiting for
+    if (!pending)
+    {
+        finishLookup(lookup);
+    }
+}
+
+void DhtNode::onLookupReply(const std::shared_ptr<Lookup>& lookup, const NodeId& from, const Bencode::Dict* reply)
+{
+    --lookup->inflight;
+    if (lookup->finished)
+    {
+        return;
+    }
+
+    auto it = std::find_if(
+        lookup->candidates.begin(), lookup->candidates.end(), [&](const Lookup::Candidate& c) { return c.id == from; });
+
+    if (!reply)
+    {
+        m_table.markFailed(from);
+        if (it != lookup->candidates.end())
+        {
+            it->state = Lookup::State::Failed;
+        }
+        stepLookup(lookup);
+        return;
+    }
+
+    if (it != lookup->candidates.end())
+    {
+        it->state = Lookup::State::Responded;
+        if (const auto* token = stringField(*reply, "token"))
+        {
+            it->token = *token;
+        }
+    }
+
+    if (const auto* nodes = stringField(*reply, "nodes"); nodes && nodes->size() % kCompactNodeSize == 0)
+    {
+        for (size_t i = 0; i < nodes->size(); i += kCompactNodeSize)
+        {
+            const auto* raw = reinterpret_cast<const uint8_t*>(nodes->data() + i);
+            auto port       = static_cast<uint16_t>((raw[24] << 8) | raw[25]);
+            auto endpoint   = Net::Endpoint::fromV4(raw + 20, port);
+            if (m_blocklist.blocked(endpoint))
+            {
+                ++m_stats.blocked;
+                continue;
+            }
+            lookup->addCandidate(nodeIdFrom(std::string_view(nodes->data() + i, 20)), endpoint, m_id,
+                m_options.maxLookupCandidates);
+        }
+    }
+
+    if (const auto* values = field(*reply, "values"); lookup->wantPeers && values && values->isList())
+    {
+        std::vector<Net::Endpoint> decoded;
+        for (const auto& v : values->asList())
+        {
+            if (v.isStr() && v.asStr().size() == 6)
+            {
+                Utils::decodeCompactPeers4(v.asStr(), decoded);
+            }
+        }
+        m_stats.blocked += m_blocklist.filter(decoded);
+        lookup->peers.merge(decoded);
+    }
+
+    stepLookup(lookup);
+}
+
+void DhtNode::finishLookup(const std::shared_ptr<Lookup>& lookup)
+{
+    lookup->finished = true;
+    if (lookup->onDone)
+    {
+        lookup->onDone(*lookup);
+    }
+}
+
+}  // namespace Torrent::Dht
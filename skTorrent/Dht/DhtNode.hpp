@@ -0,0 +1,164 @@
+#ifndef DHTNODE_HPP
+#define DHTNODE_HPP
+
+#include "RoutingTable.hpp"
+
+#include <Net/EventLoop.hpp>
+#include <Net/UdpSocket.hpp>
+#include <Utils/BencodeParser.hpp>
+
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Torrent::Core {
+class IpBlocklist;
+}
+
+namespace Torrent::Dht {
+
+// BEP 5 (IPv4) node: one UDP socket registered on the caller's event loop, KRPC queries/responses,
+// iterative lookups with at most alpha queries in flight, rotating announce tokens and a per-node query rate limit.
+// Announced peers are stored for peerLifetime after their last announce and pruned on the token rotation timer.
+// Packets from addresses the IP blocklist blocks are dropped unread, and blocked nodes and peers found by lookups
+// are left out.
+class DhtNode
+{
+public:
+    struct Options
+    {
+        size_t alpha = 3;
+        std::chrono::milliseconds queryTimeout{2'000};
+        std::chrono::seconds tokenRotation{300};
+        std::chrono::seconds refreshInterval{900};
+        std::chrono::seconds peerLifetime{30 * 60};
+        double queryRate             = 20.0;  // queries per second per remote node
+        double queryBurst            = 50.0;
+        size_t maxPeersPerHash       = 200;
+        size_t maxLookupCandidates   = RoutingTable::K * 8;
+        Core::IpBlocklist* blocklist = nullptr;  // the global one when null
+    };
+
+    struct Stats
+    {
+        uint64_t queriesReceived   = 0;
+        uint64_t queriesDropped    = 0;
+        uint64_t responsesReceived = 0;
+        uint64_t timeouts          = 0;
+        uint64_t blocked           = 0;  // packets, nodes and peers from blocked addresses
+    };
+
+    using PeersCallback = std::function<void(const std::vector<Net::Endpoint>& peers)>;
+    using DoneCallback  = std::function<void()>;
+
+    DhtNode(Net::EventLoop& loop, const Net::Endpoint& bindTo);
+    DhtNode(Net::EventLoop& loop, const Net::Endpoint& bindTo, Options options, std::optional<NodeId> id = std::nullopt);
+    ~DhtNode();
+    DhtNode(const DhtNode&) = delete;
+
+    void bootstrap(const std::vector<Net::Endpoint>& nodes, DoneCallback done = {});
+    // Looks up a random id inside every under-filled bucket so distant parts of the keyspace stay reachable.
+    void refreshBuckets(DoneCallback done = {});
+    void getPeers(const NodeId& infoHash, PeersCallback done);
+    void announce(const NodeId& infoHash, uint16_t port, PeersCallback done);
+
+    std::string makeToken(const Net::Endpoint& from) const;
+    bool checkToken(const Net::Endpoint& from, std::string_view token) const;
+    void rotateTokens();
+
+    const NodeId& id() const
+    {
+        return m_id;
+    }
+
+    const Net::Endpoint& endpoint() const
+    {
+        return m_socket.localEndpoint();
+    }
+
+    const RoutingTable& table() const
+    {
+        return m_table;
+    }
+
+    const Stats& stats() const
+    {
+        return m_stats;
+    }
+
+private:
+    struct Lookup;
+    using ResponseHandler = std::function<void(const Utils::Bencode::Dict* reply)>;
+
+    struct Pending
+    {
+        Net::Endpoint to;
+        ResponseHandler handler;
+        Net::EventLoop::TimerId timer = 0;
+    };
+
+    struct RateBucket
+    {
+        double tokens = 0;
+        Net::EventLoop::Clock::time_point last;
+    };
+
+    struct StoredPeer
+    {
+        Net::Endpoint endpoint;
+        Net::EventLoop::Clock::time_point seen;
+    };
+
+    struct EndpointHash
+    {
+        size_t operator()(const Net::Endpoint& ep) const
+        {
+            return Net::hashEndpoint(ep);
+        }
+    };
+
+    void onReadable();
+    void handleMessage(const Net::Endpoint& from, std::string_view packet);
+    void handleQuery(const Net::Endpoint& from, const Utils::Bencode::Dict& msg);
+    void handleReply(const Net::Endpoint& from, const Utils::Bencode::Dict& msg, bool isError);
+    bool allowQuery(const Net::Endpoint& from);
+
+    void sendQuery(const Net::Endpoint& to, const std::string& method, Utils::Bencode::Dict args, ResponseHandler handler);
+    void sendReply(const Net::Endpoint& to, const std::string& tid, Utils::Bencode::Dict reply);
+    void sendError(const Net::Endpoint& to, const std::string& tid, uint64_t code, const std::string& message);
+    void send(const Net::Endpoint& to, const Utils::Bencode::Value& msg);
+
+    std::string compactNodes(const NodeId& target);
+    void findNode(const NodeId& target, DoneCallback done);
+    void startLookup(const std::shared_ptr<Lookup>& lookup);
+    void stepLookup(const std::shared_ptr<Lookup>& lookup);
+    void onLookupReply(const std::shared_ptr<Lookup>& lookup, const NodeId& from, const Utils::Bencode::Dict* reply);
+    void finishLookup(const std::shared_ptr<Lookup>& lookup);
+
+    Net::EventLoop& m_loop;
+    Net::UdpSocket m_socket;
+    Options m_options;
+    Core::IpBlocklist& m_blocklist;
+    std::mt19937_64 m_rng;
+    NodeId m_id;
+    RoutingTable m_table;
+    Stats m_stats;
+
+    uint16_t m_nextTid = 0;
+    std::unordered_map<uint16_t, Pending> m_pending;
+
+    std::array<uint8_t, 8> m_secret{};
+    std::array<uint8_t, 8> m_prevSecret{};
+    Net::EventLoop::TimerId m_rotationTimer = 0;
+    Net::EventLoop::TimerId m_refreshTimer  = 0;
+
+    std::unordered_map<Net::Endpoint, RateBucket, EndpointHash> m_rates;
+    std::unordered_map<NodeId, std::vector<StoredPeer>, NodeIdHash> m_peers;  // oldest announce first
+    std::vector<NodeEntry> m_scratch;
+};
+
+}  // namespace Torrent::Dht
+#endif  // DHTNODE_HPP
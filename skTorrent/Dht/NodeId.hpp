@@ -0,0 +1,80 @@
+#ifndef NODEID_HPP
+#define NODEID_HPP
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <string_view>
+
+namespace Torrent::Dht {
+
+using NodeId = std::array<uint8_t, 20>;
+
+inline NodeId nodeIdFrom(std::string_view raw)
+{
+    NodeId id{};
+    std::memcpy(id.data(), raw.data(), std::min(raw.size(), id.size()));
+    return id;
+}
+
+inline std::string_view asView(const NodeId& id)
+{
+    return {reinterpret_cast<const char*>(id.data()), id.size()};
+}
+
+// Number of leading bits a and b share (160 when equal).
+inline size_t commonPrefix(const NodeId& a, const NodeId& b)
+{
+    for (size_t i = 0; i < a.size(); ++i)
+    {
+        uint8_t x = a[i] ^ b[i];
+        if (x != 0)
+        {
+            return i * 8 + static_cast<size_t>(std::countl_zero(x));
+        }
+    }
+    return 160;
+}
+
+// True when a is strictly closer to target than b in the XOR metric.
+inline bool closer(const NodeId& target, const NodeId& a, const NodeId& b)
+{
+    for (size_t i = 0; i < target.size(); ++i)
+    {
+        uint8_t da = a[i] ^ target[i];
+        uint8_t db = b[i] ^ target[i];
+        if (da != db)
+        {
+            return da < db;
+        }
+    }
+    return false;
+}
+
+template <typename Rng>
+NodeId randomNodeId(Rng& rng)
+{
+    NodeId id;
+    std::uniform_int_distribution<int> byte(0, 255);
+    for (auto& b : id)
+    {
+        b = static_cast<uint8_t>(byte(rng));
+    }
+    return id;
+}
+
+struct NodeIdHash
+{
+    size_t operator()(const NodeId& id) const
+    {
+        size_t h = 0;
+        std::memcpy(&h, id.data(), sizeof(h));
+        return h;
+    }
+};
+
+}  // namespace Torrent::Dht
+#endif  // NODEID_HPP
@@ -0,0 +1,121 @@
+#include "RoutingTable.hpp"
+
+#include <algorithm>
+
+namespace Torrent::Dht {
+
+RoutingTable::RoutingTable(const NodeId& self)
+    : m_self(self)
+    , m_buckets(Buckets)
+{}
+
+size_t RoutingTable::bucketIndex(const NodeId& id) const
+{
+    return std::min(commonPrefix(m_self, id), Buckets - 1);
+}
+
+int RoutingTable::find(const Bucket& bucket, const NodeId& id) const
+{
+    for (int i = 0; i < bucket.count; ++i)
+    {
+        if (bucket.ids[i] == id)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+bool RoutingTable::add(const NodeId& id, const Net::Endpoint& endpoint, Clock::time_point now)
+{
+    if (id == m_self)
+    {
+        return false;
+    }
+
+    auto& bucket = m_buckets[bucketIndex(id)];
+    int slot     = find(bucket, id);
+    if (slot < 0)
+    {
+        if (bucket.count < K)
+        {
+            slot = bucket.count++;
+            ++m_size;
+        }
+        else
+        {
+            // replace the least reliable node, but only if it has actually stopped responding
+            auto worst = std::max_element(bucket.fails.begin(), bucket.fails.end());
+            if (*worst < MaxFails)
+            {
+                return false;
+            }
+            slot = static_cast<int>(worst - bucket.fails.begin());
+        }
+        bucket.ids[slot] = id;
+    }
+
+    bucket.endpoints[slot] = endpoint;
+    bucket.lastSeen[slot]  = now;
+    bucket.fails[slot]     = 0;
+    return true;
+}
+
+void RoutingTable::markFailed(const NodeId& id)
+{
+    auto& bucket = m_buckets[bucketIndex(id)];
+    int slot     = find(bucket, id);
+    if (slot >= 0 && bucket.fails[slot] < 255)
+    {
+        ++bucket.fails[slot];
+    }
+}
+
+bool RoutingTable::contains(const NodeId& id) const
+{
+    return find(m_buckets[bucketIndex(id)], id) >= 0;
+}
+
+size_t RoutingTable::depth() const
+{
+    for (size_t i = Buckets; i-- > 0;)
+    {
+        if (m_buckets[i].count > 0)
+        {
+            return i;
+        }
+    }
+    return 0;
+}
+
+void RoutingTable::closest(const NodeId& target, size_t count, std::vector<NodeEntry>& out) const
+{
+    out.clear();
+    auto nearer = [&](const NodeEntry& a, const NodeEntry& b) { return closer(target, a.id, b.id); };
+
+    // bounded max-heap: the root is the furthest of the best candidates so far
+    for (const auto& bucket : m_buckets)
+    {
+        for (int i = 0; i < bucket.count; ++i)
+        {
+            if (bucket.fails[i] >= MaxFails)
+            {
+                continue;
+            }
+            if (out.size() < count)
+            {
+                out.push_back({bucket.ids[i], bucket.endpoints[i]});
+                std::push_heap(out.begin(), out.end(), nearer);
+            }
+            else if (!out.empty() && closer(target, bucket.ids[i], out.front().id))
+            {
+                std::pop_heap(out.begin(), out.end(), nearer);
+                out.back() = {bucket.ids[i], bucket.endpoints[i]};
+                std::push_heap(out.begin(), out.end(), nearer);
+            }
+        }
+    }
+    std::sort_heap(out.begin(), out.end(), nearer);
+}
+
+}  // namespace Torrent::Dht
@@ -0,0 +1,76 @@
+#ifndef ROUTINGTABLE_HPP
+#define ROUTINGTABLE_HPP
+
+#include "NodeId.hpp"
+
+#include <Net/Endpoint.hpp>
+
+#include <chrono>
+#include <vector>
+
+namespace Torrent::Dht {
+
+struct NodeEntry
+{
+    NodeId id;
+    Net::Endpoint endpoint;
+};
+
+// Kademlia routing table with one k-bucket per shared-prefix length. Each bucket keeps its ids, endpoints and
+// liveness data in parallel fixed-size arrays, so a closest-node scan walks contiguous id storage only.
+class RoutingTable
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr size_t K       = 8;
+    static constexpr size_t Buckets = 160;
+
+    static constexpr uint8_t MaxFails = 2;
+
+    explicit RoutingTable(const NodeId& self);
+
+    // Returns true when the node is (now) in the table.
+    bool add(const NodeId& id, const Net::Endpoint& endpoint, Clock::time_point now);
+    void markFailed(const NodeId& id);
+    bool contains(const NodeId& id) const;
+    void closest(const NodeId& target, size_t count, std::vector<NodeEntry>& out) const;
+
+    size_t size() const
+    {
+        return m_size;
+    }
+
+    size_t bucketSize(size_t index) const
+    {
+        return m_buckets[index].count;
+    }
+
+    // Index of the deepest non-empty bucket, i.e. how many prefix bits our closest neighbour shares with us.
+    size_t depth() const;
+
+    const NodeId& self() const
+    {
+        return m_self;
+    }
+
+private:
+    struct Bucket
+    {
+        uint8_t count = 0;
+        std::array<NodeId, K> ids{};
+        std::array<Net::Endpoint, K> endpoints{};
+        std::array<Clock::time_point, K> lastSeen{};
+        std::array<uint8_t, K> fails{};
+    };
+
+    size_t bucketIndex(const NodeId& id) const;
+    int find(const Bucket& bucket, const NodeId& id) const;
+
+    NodeId m_self;
+    std::vector<Bucket> m_buckets;
+    size_t m_size = 0;
+};
+
+}  // namespace Torrent::Dht
+#endif  // ROUTINGTABLE_HPP
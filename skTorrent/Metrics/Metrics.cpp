@@ -0,0 +1,192 @@
+#include "Metrics.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <stdexcept>
+#include <tuple>
+
+namespace Torrent::Metrics {
+
+uint64_t Counter::value() const
+{
+    uint64_t total = 0;
+    for (const auto& slot : m_slots)
+    {
+        total += slot.value.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+size_t Counter::slotIndex()
+{
+    static std::atomic<size_t> next{0};
+    thread_local size_t index = next.fetch_add(1, std::memory_order_relaxed) % Slots;
+    return index;
+}
+
+size_t Histogram::bucketOf(uint64_t value)
+{
+    constexpr uint64_t subBuckets = uint64_t{1} << SubBucketBits;
+    if (value < subBuckets)
+    {
+        return static_cast<size_t>(value);
+    }
+    unsigned exponent = static_cast<unsigned>(std::bit_width(value)) - 1;
+    unsigned shift    = exponent - SubBucketBits;
+    uint64_t sub      = (value >> shift) & (subBuckets - 1);
+    return static_cast<size_t>(((shift + 1) << SubBucketBits) + sub);
+}
+
+uint64_t Histogram::upperBound(size_t bucket)
+{
+    constexpr uint64_t subBuckets = uint64_t{1} << SubBucketBits;
+    if (bucket < subBuckets)
+    {
+        return bucket;
+    }
+    unsigned shift = static_cast<unsigned>(bucket >> SubBucketBits) - 1;
+    uint64_t sub   = bucket & (subBuckets - 1);
+    uint64_t lower = (subBuckets + sub) << shift;
+    return lower + ((uint64_t{1} << shift) - 1);
+}
+
+HistogramSnapshot Histogram::snapshot() const
+{
+    HistogramSnapshot s;
+    for (size_t i = 0; i < m_buckets.size(); ++i)
+    {
+        uint64_t count = m_buckets[i].load(std::memory_order_relaxed);
+        if (count > 0)
+        {
+            s.buckets.push_back({upperBound(i), count});
+            s.count += count;
+        }
+    }
+    // count comes from the buckets so it matches them; sum may already include a record that is still in flight
+    s.sum = m_sum.load(std::memory_order_relaxed);
+    return s;
+}
+
+uint64_t HistogramSnapshot::percentile(double q) const
+{
+    if (count == 0)
+    {
+        return 0;
+    }
+    auto rank     = static_cast<uint64_t>(std::ceil(std::clamp(q, 0.0, 1.0) * static_cast<double>(count)));
+    uint64_t seen = 0;
+    for (const auto& bucket : buckets)
+    {
+        seen += bucket.count;
+        if (seen >= std::max<uint64_t>(rank, 1))
+        {
+            return bucket.upperBound;
+        }
+    }
+    return buckets.back().upperBound;
+}
+
+const Sample* Snapshot::find(std::string_view name, std::string_view labels) const
+{
+    auto it = std::find_if(samples.begin(), samples.end(),
+        [&](const Sample& s) { return s.name == name && s.labels == labels; });
+    return it == samples.end() ? nullptr : &*it;
+}
+
+Registry& Registry::global()
+{
+    static Registry registry;
+    return registry;
+}
+
+Registry::Registry(std::string labels, Registry& parent)
+    : m_labels(std::move(labels))
+    , m_parent(&parent)
+{
+    std::scoped_lock lk(parent.m_mutex);
+    parent.m_children.push_back(this);
+}
+
+Registry::~Registry()
+{
+    if (m_parent)
+    {
+        std::scoped_lock lk(m_parent->m_mutex);
+        std::erase(m_parent->m_children, this);
+    }
+}
+
+template <typename T>
+T& Registry::get(std::string_view name, std::string_view help)
+{
+    std::scoped_lock lk(m_mutex);
+    auto it = m_metrics.find(name);
+    if (it == m_metrics.end())
+    {
+        it = m_metrics.emplace(std::string(name), Entry{std::string(help), std::make_unique<T>()}).first;
+    }
+    auto* metric = std::get_if<std::unique_ptr<T>>(&it->second.metric);
+    if (!metric)
+    {
+        throw std::runtime_error("Metric " + std::string(name) + " is registered with another kind");
+    }
+    return **metric;
+}
+
+Counter& Registry::counter(std::string_view name, std::string_view help)
+{
+    return get<Counter>(name, help);
+}
+
+Gauge& Registry::gauge(std::string_view name, std::string_view help)
+{
+    return get<Gauge>(name, help);
+}
+
+Histogram& Registry::histogram(std::string_view name, std::string_view help)
+{
+    return get<Histogram>(name, help);
+}
+
+void Registry::collect(std::vector<Sample>& out) const
+{
+    std::scoped_lock lk(m_mutex);
+    for (const auto& [name, entry] : m_metrics)
+    {
+        Sample& s = out.emplace_back();
+        s.name    = name;
+        s.labels  = m_labels;
+        s.help    = entry.help;
+        if (auto* counter = std::get_if<std::unique_ptr<Counter>>(&entry.metric))
+        {
+            s.kind  = Kind::Counter;
+            s.value = static_cast<double>((*counter)->value());
+        }
+        else if (auto* gauge = std::get_if<std::unique_ptr<Gauge>>(&entry.metric))
+        {
+            s.kind  = Kind::Gauge;
+            s.value = static_cast<double>((*gauge)->value());
+        }
+        else
+        {
+            s.kind      = Kind::Histogram;
+            s.histogram = std::get<std::unique_ptr<Histogram>>(entry.metric)->snapshot();
+        }
+    }
+    for (const auto* child : m_children)
+    {
+        child->collect(out);
+    }
+}
+
+Snapshot Registry::snapshot() const
+{
+    Snapshot s;
+    collect(s.samples);
+    std::stable_sort(s.samples.begin(), s.samples.end(),
+        [](const Sample& a, const Sample& b) { return std::tie(a.name, a.labels) < std::tie(b.name, b.labels); });
+    return s;
+}
+
+}  // namespace Torrent::Metrics
@@ -0,0 +1,196 @@
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+namespace Torrent::Metrics {
+
+// Monotonic count. A thread adds to its own cache-line slot, picked once per thread, so a counter bumped from
+// several threads never bounces a line between them; value() sums the slots.
+class Counter
+{
+public:
+    static constexpr size_t Slots = 16;
+
+    void add(uint64_t n = 1)
+    {
+        m_slots[slotIndex()].value.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    uint64_t value() const;
+
+private:
+    struct alignas(64) Slot
+    {
+        std::atomic<uint64_t> value{0};
+    };
+
+    static size_t slotIndex();
+
+    std::array<Slot, Slots> m_slots;
+};
+
+class Gauge
+{
+public:
+    void set(int64_t v)
+    {
+        m_value.store(v, std::memory_order_relaxed);
+    }
+
+    void add(int64_t n)
+    {
+        m_value.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    int64_t value() const
+    {
+        return m_value.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<int64_t> m_value{0};
+};
+
+struct HistogramSnapshot
+{
+    struct Bucket
+    {
+        uint64_t upperBound = 0;  // largest value the bucket holds
+        uint64_t count      = 0;
+    };
+
+    uint64_t count = 0;
+    uint64_t sum   = 0;
+    std::vector<Bucket> buckets;  // non-empty buckets, ascending
+
+    // Upper bound of the bucket holding the q-quantile, q in [0, 1]; 0 when empty.
+    uint64_t percentile(double q) const;
+};
+
+// Log-linear buckets in the manner of HdrHistogram: each power of two is split into 8 linear sub-buckets, so
+// a value is placed within 12.5% and the whole uint64_t range fits in a fixed array. Recording is two relaxed
+// atomic adds.
+class Histogram
+{
+public:
+    static constexpr unsigned SubBucketBits = 3;
+    static constexpr size_t BucketCount     = (64 - SubBucketBits + 1) << SubBucketBits;
+
+    void record(uint64_t value)
+    {
+        m_buckets[bucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+        m_sum.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    HistogramSnapshot snapshot() const;
+
+    static size_t bucketOf(uint64_t value);
+    static uint64_t upperBound(size_t bucket);
+
+private:
+    std::array<std::atomic<uint64_t>, BucketCount> m_buckets{};
+    std::atomic<uint64_t> m_sum{0};
+};
+
+// Records the microseconds between construction and destruction.
+class ScopedTimer
+{
+public:
+    explicit ScopedTimer(Histogram& histogram)
+        : m_histogram(histogram)
+        , m_start(std::chrono::steady_clock::now())
+    {}
+
+    ~ScopedTimer()
+    {
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - m_start);
+        m_histogram.record(static_cast<uint64_t>(elapsed.count()));
+    }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+
+private:
+    Histogram& m_histogram;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+enum class Kind : uint8_t
+{
+    Counter,
+    Gauge,
+    Histogram
+};
+
+struct Sample
+{
+    std::string name;
+    std::string labels;  // key="value" pairs joined by commas, empty for none
+    std::string help;
+    Kind kind    = Kind::Counter;
+    double value = 0;  // counters and gauges
+    HistogramSnapshot histogram;
+};
+
+struct Snapshot
+{
+    std::vector<Sample> samples;  // by name, then labels
+
+    const Sample* find(std::string_view name, std::string_view labels = {}) const;
+};
+
+// Named metrics of one scope. global() holds the process-wide ones; a scope created under a parent, such as a
+// session's, appears in the parent's snapshot with its labels. Registration takes a lock, so look metrics up
+// once and keep the reference; updates are lock-free.
+class Registry
+{
+public:
+    static Registry& global();
+
+    Registry() = default;
+    Registry(std::string labels, Registry& parent);
+    ~Registry();
+    Registry(const Registry&) = delete;
+
+    // Returns the existing metric when the name is taken; throws std::runtime_error if it has another kind.
+    Counter& counter(std::string_view name, std::string_view help);
+    Gauge& gauge(std::string_view name, std::string_view help);
+    Histogram& histogram(std::string_view name, std::string_view help);
+
+    Snapshot snapshot() const;
+
+    const std::string& labels() const
+    {
+        return m_labels;
+    }
+
+private:
+    struct Entry
+    {
+        std::string help;
+        std::variant<std::unique_ptr<Counter>, std::unique_ptr<Gauge>, std::unique_ptr<Histogram>> metric;
+    };
+
+    template <typename T>
+    T& get(std::string_view name, std::string_view help);
+    void collect(std::vector<Sample>& out) const;
+
+    std::string m_labels;
+    Registry* m_parent = nullptr;
+    mutable std::mutex m_mutex;
+    std::map<std::string, Entry, std::less<>> m_metrics;
+    std::vector<const Registry*> m_children;
+};
+
+}  // namespace Torrent::Metrics
+#endif  // METRICS_HPP
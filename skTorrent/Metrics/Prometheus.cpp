@@ -0,0 +1,181 @@
+#include "Prometheus.hpp"
+
+#include <Logger.hpp>
+
+#include <array>
+#include <charconv>
+#include <cstdio>
+#include <filesystem>
+#include <stdexcept>
+
+namespace Torrent::Metrics {
+
+namespace {
+// Histograms are exposed with the bounds 2^n - 1 for n up to this, about 19 hours in microseconds
+constexpr unsigned kLadderBits = 36;
+
+void appendNumber(std::string& out, double v)
+{
+    char buf[32];
+    auto result = std::to_chars(buf, buf + sizeof(buf), v);
+    out.append(buf, result.ptr);
+}
+
+void appendSeries(std::string& out, std::string_view name, std::string_view suffix, std::string_view labels,
+    std::string_view extra = {})
+{
+    out += name;
+    out += suffix;
+    if (!labels.empty() || !extra.empty())
+    {
+        out += '{';
+        out += labels;
+        if (!labels.empty() && !extra.empty())
+        {
+            out += ',';
+        }
+        out += extra;
+        out += '}';
+    }
+    out += ' ';
+}
+
+std::string_view typeName(Kind kind)
+{
+    switch (kind)
+    {
+    case Kind::Counter:
+        return "counter";
+    case Kind::Gauge:
+        return "gauge";
+    case Kind::Histogram:
+        return "histogram";
+    }
+    return "untyped";
+}
+
+Async::Detached serveScrape(const Registry& registry, std::unique_ptr<Net::TcpStream> stream)
+{
+    try
+    {
+        // the request itself does not matter; read up to the end of its headers
+        std::string request;
+        std::array<uint8_t, 1'024> buffer;
+        while (request.find("\r\n\r\n") == std::string::npos && request.size() < 8 * 1'024)
+        {
+            size_t n = co_await stream->read(buffer);
+            if (n == 0)
+            {
+                break;
+            }
+            request.append(reinterpret_cast<const char*>(buffer.data()), n);
+        }
+        auto body     = renderPrometheus(registry.snapshot());
+        auto response = "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " +
+                        std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+        co_await stream->write({reinterpret_cast<const uint8_t*>(response.data()), response.size()});
+    }
+    catch (const std::exception& e)
+    {
+        LOG_DEBUG(Metrics, "Scrape connection failed", LOG_MD(Error, e.what()));
+    }
+    stream->close();
+}
+}  // namespace
+
+std::string renderPrometheus(const Snapshot& snapshot)
+{
+    std::string out;
+    std::string_view current;
+    for (const auto& s : snapshot.samples)
+    {
+        if (s.name != current)
+        {
+            current = s.name;
+            out += "# HELP " + s.name + ' ' + s.help + '\n';
+            out += "# TYPE " + s.name + ' ';
+            out += typeName(s.kind);
+            out += '\n';
+        }
+        if (s.kind != Kind::Histogram)
+        {
+            appendSeries(out, s.name, "", s.labels);
+            appendNumber(out, s.value);
+            out += '\n';
+            continue;
+        }
+        // histogram buckets end on every power of two, so each bound of the ladder gets an exact count
+        uint64_t cumulative = 0;
+        auto bucket         = s.histogram.buckets.begin();
+        for (unsigned bits = 0; bits <= kLadderBits; ++bits)
+        {
+            uint64_t bound = (uint64_t{1} << bits) - 1;
+            for (; bucket != s.histogram.buckets.end() && bucket->upperBound <= bound; ++bucket)
+            {
+                cumulative += bucket->count;
+            }
+            appendSeries(out, s.name, "_bucket", s.labels, "le=\"" + std::to_string(bound) + '"');
+            out += std::to_string(cumulative) + '\n';
+        }
+        appendSeries(out, s.name, "_bucket", s.labels, "le=\"+Inf\"");
+        out += std::to_string(s.histogram.count) + '\n';
+        appendSeries(out, s.name, "_sum", s.labels);
+        out += std::to_string(s.histogram.sum) + '\n';
+        appendSeries(out, s.name, "_count", s.labels);
+        out += std::to_string(s.histogram.count) + '\n';
+    }
+    return out;
+}
+
+void writePrometheusFile(const Registry& registry, const std::string& path)
+{
+    auto text       = renderPrometheus(registry.snapshot());
+    auto tmp        = path + ".tmp";
+    std::FILE* file = std::fopen(tmp.c_str(), "wb");
+    if (!file)
+    {
+        throw std::runtime_error("Failed to open " + tmp);
+    }
+    bool ok = std::fwrite(text.data(), 1, text.size(), file) == text.size();
+    ok      = std::fclose(file) == 0 && ok;
+    std::error_code ec;
+    if (ok)
+    {
+        std::filesystem::rename(tmp, path, ec);
+    }
+    if (!ok || ec)
+    {
+        std::filesystem::remove(tmp, ec);
+        throw std::runtime_error("Failed to write " + path);
+    }
+}
+
+PrometheusFileExporter::PrometheusFileExporter(Net::EventLoop& loop, const Registry& registry, std::string path,
+    std::chrono::milliseconds interval)
+    : m_loop(loop)
+{
+    m_timer = m_loop.runEvery(interval,
+        [&registry, path = std::move(path)]
+        {
+            try
+            {
+                writePrometheusFile(registry, path);
+            }
+            catch (const std::exception& e)
+            {
+                LOG_WARNING(Metrics, "Metrics export failed", LOG_MD(Error, e.what()));
+            }
+        });
+}
+
+PrometheusFileExporter::~PrometheusFileExporter()
+{
+    m_loop.cancel(m_timer);
+}
+
+PrometheusServer::PrometheusServer(Net::EventLoop& loop, const Registry& registry, uint16_t port)
+    : m_listener(loop, Net::Endpoint::parse("127.0.0.1", port),
+          [&registry](std::unique_ptr<Net::TcpStream> stream) { serveScrape(registry, std::move(stream)); })
+{}
+
+}  // namespace Torrent::Metrics
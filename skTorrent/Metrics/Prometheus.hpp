@@ -0,0 +1,54 @@
+#ifndef PROMETHEUS_HPP
+#define PROMETHEUS_HPP
+
+#include "Metrics.hpp"
+
+#include <Net/EventLoop.hpp>
+#include <Net/TcpStream.hpp>
+
+#include <chrono>
+#include <string>
+
+namespace Torrent::Metrics {
+
+// Prometheus text exposition format 0.0.4. Every histogram lists the same cumulative buckets, le="2^n - 1" for n
+// from 0 to 36 and +Inf, empty ones included, so series neither appear nor vanish between scrapes.
+std::string renderPrometheus(const Snapshot& snapshot);
+
+// Writes a temporary file and renames it over path, so a reader never sees half a scrape; throws
+// std::runtime_error when the file cannot be written.
+void writePrometheusFile(const Registry& registry, const std::string& path);
+
+// Rewrites the file every interval from the loop. Create and destroy it on the loop thread or before the loop
+// runs.
+class PrometheusFileExporter
+{
+public:
+    PrometheusFileExporter(Net::EventLoop& loop, const Registry& registry, std::string path,
+        std::chrono::milliseconds interval);
+    ~PrometheusFileExporter();
+    PrometheusFileExporter(const PrometheusFileExporter&) = delete;
+
+private:
+    Net::EventLoop& m_loop;
+    Net::EventLoop::TimerId m_timer = 0;
+};
+
+// Answers every HTTP request on a loopback port with the registry's metrics, then closes the connection. Create
+// and destroy it on the loop thread or before the loop runs; port 0 picks a free one.
+class PrometheusServer
+{
+public:
+    PrometheusServer(Net::EventLoop& loop, const Registry& registry, uint16_t port = 0);
+
+    const Net::Endpoint& localEndpoint() const
+    {
+        return m_listener.localEndpoint();
+    }
+
+private:
+    Net::TcpListener m_listener;
+};
+
+}  // namespace Torrent::Metrics
+#endif  // PROMETHEUS_HPP
@@ -0,0 +1,248 @@
+#include "Trace.hpp"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+
+namespace Torrent::Metrics {
+
+namespace {
+int64_t steadyNanos()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void appendJsonString(std::string& out, std::string_view s)
+{
+    out += '"';
+    for (char c : s)
+    {
+        if (c == '"' || c == '\\')
+        {
+            out += '\\';
+            out += c;
+        }
+        else if (static_cast<unsigned char>(c) < 0x20)
+        {
+            char buf[8];
+            std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+            out += buf;
+        }
+        else
+        {
+            out += c;
+        }
+    }
+    out += '"';
+}
+
+void appendMicros(std::string& out, double micros)
+{
+    char buf[32];
+    int n = std::snprintf(buf, sizeof(buf), "%.3f", micros);
+    out.append(buf, static_cast<size_t>(n));
+}
+
+[[maybe_unused]] const bool startedFromEnvironment = []
+{
+    if (const char* path = std::getenv("SKTORRENT_TRACE"); path && *path)
+    {
+        Tracer::instance().start();
+        Tracer::instance().dumpOnExit(path);
+        return true;
+    }
+    return false;
+}();
+
+thread_local std::string t_threadName;
+}  // namespace
+
+Tracer& Tracer::instance()
+{
+    // never destroyed: threads still running at exit may record
+    static Tracer* tracer = new Tracer;
+    return *tracer;
+}
+
+void Tracer::start()
+{
+    std::scoped_lock lk(m_mutex);
+    if (!s_enabled.load(std::memory_order_relaxed))
+    {
+        m_startTicks = traceClock();
+        m_startNanos = steadyNanos();
+    }
+    s_enabled.store(true, std::memory_order_relaxed);
+}
+
+void Tracer::stop()
+{
+    s_enabled.store(false, std::memory_order_relaxed);
+}
+
+void Tracer::clear()
+{
+    std::scoped_lock lk(m_mutex);
+    for (const auto& thread : m_threads)
+    {
+        thread->cleared.store(thread->head.load(std::memory_order_acquire), std::memory_order_relaxed);
+    }
+}
+
+Tracer::ThreadBuffer& Tracer::localBuffer()
+{
+    if (!t_buffer)
+    {
+        std::scoped_lock lk(m_mutex);
+        t_buffer       = std::make_shared<ThreadBuffer>(m_nextTid++);
+        t_buffer->name = t_threadName;
+        m_threads.push_back(t_buffer);
+    }
+    return *t_buffer;
+}
+
+void Tracer::setThreadName(std::string_view name)
+{
+    t_threadName = name;
+    if (t_buffer)
+    {
+        std::scoped_lock lk(t_buffer->nameMutex);
+        t_buffer->name = name;
+    }
+}
+
+void Tracer::record(const char* name, uint64_t begin, uint64_t end)
+{
+    auto& buffer = localBuffer();
+    uint64_t at  = buffer.head.load(std::memory_order_relaxed);
+    auto& event  = buffer.events[at % RingEvents];
+    event.name.store(name, std::memory_order_relaxed);
+    event.begin.store(begin, std::memory_order_relaxed);
+    event.end.store(end, std::memory_order_relaxed);
+    buffer.head.store(at + 1, std::memory_order_release);
+}
+
+std::string Tracer::chromeTraceJson()
+{
+    struct Copy
+    {
+        const char* name;
+        uint64_t begin;
+        uint64_t end;
+    };
+
+    std::scoped_lock lk(m_mutex);
+    // ticks per nanosecond, measured over the whole recording
+    uint64_t ticks = traceClock() - m_startTicks;
+    int64_t nanos  = steadyNanos() - m_startNanos;
+    double rate    = nanos > 0 && ticks > 0 ? static_cast<double>(ticks) / static_cast<double>(nanos) : 1.0;
+    auto micros    = [&](uint64_t tick)
+    {
+        return static_cast<double>(static_cast<int64_t>(tick - m_startTicks)) / rate / 1'000.0;
+    };
+
+    std::string out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    auto pid        = std::to_string(::getpid());
+    bool first      = true;
+    auto separator  = [&]
+    {
+        if (!first)
+        {
+            out += ',';
+        }
+        first = false;
+    };
+
+    std::vector<Copy> events;
+    for (const auto& thread : m_threads)
+    {
+        auto tid = std::to_string(thread->tid);
+        {
+            std::scoped_lock nameLock(thread->nameMutex);
+            if (!thread->name.empty())
+            {
+                separator();
+                out += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" + pid + ",\"tid\":" + tid + ",\"args\":{\"name\":";
+                appendJsonString(out, thread->name);
+                out += "}}";
+            }
+        }
+
+        uint64_t head = thread->head.load(std::memory_order_acquire);
+        uint64_t from = std::max(thread->cleared.load(std::memory_order_relaxed), head - std::min<uint64_t>(head, RingEvents));
+        events.clear();
+        for (uint64_t i = from; i < head; ++i)
+        {
+            const auto& event = thread->events[i % RingEvents];
+            events.push_back({event.name.load(std::memory_order_relaxed), event.begin.load(std::memory_order_relaxed),
+                event.end.load(std::memory_order_relaxed)});
+        }
+        // the owner may have wrapped over the oldest slots while they were copied; the slot it writes next is
+        // suspect as well
+        uint64_t after = thread->head.load(std::memory_order_acquire);
+        uint64_t valid = after + 1 > RingEvents ? after + 1 - RingEvents : 0;
+        for (uint64_t i = std::max(from, valid); i < head; ++i)
+        {
+            const auto& event = events[i - from];
+            separator();
+            out += "{\"name\":";
+            appendJsonString(out, event.name);
+            out += ",\"ph\":\"X\",\"pid\":" + pid + ",\"tid\":" + tid + ",\"ts\":";
+            appendMicros(out, micros(event.begin));
+            out += ",\"dur\":";
+            appendMicros(out, static_cast<double>(event.end - event.begin) / rate / 1'000.0);
+            out += '}';
+        }
+    }
+    out += "]}\n";
+    return out;
+}
+
+void Tracer::writeChromeTrace(const std::string& path)
+{
+    auto json       = chromeTraceJson();
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file)
+    {
+        throw std::runtime_error("Failed to open " + path);
+    }
+    bool ok = std::fwrite(json.data(), 1, json.size(), file) == json.size();
+    if (std::fclose(file) != 0 || !ok)
+    {
+        throw std::runtime_error("Failed to write " + path);
+    }
+}
+
+void Tracer::dumpOnExit(std::string path)
+{
+    std::scoped_lock lk(m_mutex);
+    bool registered = !m_exitPath.empty();
+    m_exitPath      = std::move(path);
+    if (!registered)
+    {
+        std::atexit(
+            []
+            {
+                auto& tracer = instance();
+                std::string exitPath;
+                {
+                    std::scoped_lock lk(tracer.m_mutex);
+                    exitPath = tracer.m_exitPath;
+                }
+                try
+                {
+                    tracer.writeChromeTrace(exitPath);
+                }
+                catch (const std::exception&)
+                {
+                    // nothing left to report it to
+                }
+            });
+    }
+}
+
+}  // namespace Torrent::Metrics
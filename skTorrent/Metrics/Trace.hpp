@@ -0,0 +1,138 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+namespace Torrent::Metrics {
+
+// Timestamp counter; converted to wall time when a trace is written.
+inline uint64_t traceClock()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+
+// Records TRACE_SCOPE spans into a fixed ring per thread, overwriting the oldest, and writes them as Chrome
+// trace-event JSON that chrome://tracing and Perfetto load. Spans are attributed to the thread they end on,
+// so keep them out of coroutine frames that suspend.
+//
+// Setting SKTORRENT_TRACE=<file> starts tracing at startup and writes the file at exit.
+class Tracer
+{
+public:
+    static constexpr size_t RingEvents = 32 * 1'024;
+
+    static Tracer& instance();
+
+    static bool enabled()
+    {
+        return s_enabled.load(std::memory_order_relaxed);
+    }
+
+    void start();
+    void stop();
+    // Drops everything recorded so far.
+    void clear();
+
+    // Name shown for the calling thread.
+    void setThreadName(std::string_view name);
+
+    std::string chromeTraceJson();
+    // Throws std::runtime_error when the file cannot be written.
+    void writeChromeTrace(const std::string& path);
+    // Writes the trace to path when the process exits normally.
+    void dumpOnExit(std::string path);
+
+    // name must outlive the tracer, e.g. a string literal.
+    void record(const char* name, uint64_t begin, uint64_t end);
+
+private:
+    struct Event
+    {
+        std::atomic<const char*> name{nullptr};
+        std::atomic<uint64_t> begin{0};
+        std::atomic<uint64_t> end{0};
+    };
+
+    // Written by its thread only; the dump reads it concurrently and drops slots overwritten meanwhile.
+    struct ThreadBuffer
+    {
+        explicit ThreadBuffer(uint32_t id)
+            : tid(id)
+            , events(RingEvents)
+        {}
+
+        uint32_t tid;
+        std::vector<Event> events;
+        std::atomic<uint64_t> head{0};
+        std::atomic<uint64_t> cleared{0};  // events before this are gone
+        std::mutex nameMutex;
+        std::string name;
+    };
+
+    Tracer() = default;
+
+    // The ring is allocated on the first span, so naming threads costs nothing while tracing is off.
+    ThreadBuffer& localBuffer();
+
+    static inline std::atomic<bool> s_enabled{false};
+    static inline thread_local std::shared_ptr<ThreadBuffer> t_buffer;
+
+    std::mutex m_mutex;
+    std::vector<std::shared_ptr<ThreadBuffer>> m_threads;
+    uint32_t m_nextTid    = 1;
+    uint64_t m_startTicks = 0;
+    int64_t m_startNanos  = 0;
+    std::string m_exitPath;
+};
+
+class TraceScope
+{
+public:
+    explicit TraceScope(const char* name)
+        : m_name(Tracer::enabled() ? name : nullptr)
+    {
+        if (m_name)
+        {
+            m_begin = traceClock();
+        }
+    }
+
+    ~TraceScope()
+    {
+        if (m_name)
+        {
+            Tracer::instance().record(m_name, m_begin, traceClock());
+        }
+    }
+
+    TraceScope(const TraceScope&) = delete;
+
+private:
+    const char* m_name;
+    uint64_t m_begin = 0;
+};
+
+}  // namespace Torrent::Metrics
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+// Times the rest of the enclosing block; costs one branch while tracing is off.
+#define TRACE_SCOPE(name) ::Torrent::Metrics::TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
+
+#endif  // TRACE_HPP
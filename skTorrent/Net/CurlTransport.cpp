@@ -0,0 +1,124 @@
+#include "CurlTransport.hpp"
+
+#include <Logger.hpp>
+
+#include <curl/curl.h>
+#include <mutex>
+#include <stdexcept>
+
+namespace Torrent::Net {
+
+namespace {
+size_t writeBody(char* data, size_t size, size_t count, void* userData)
+{
+    static_cast<std::string*>(userData)->append(data, size * count);
+    return size * count;
+}
+
+void globalInit()
+{
+    static std::once_flag once;
+    std::call_once(once, [] { curl_global_init(CURL_GLOBAL_DEFAULT); });
+}
+}  // namespace
+
+CurlTrackerTransport::CurlTrackerTransport()
+{
+    globalInit();
+}
+
+CurlTrackerTransport::~CurlTrackerTransport()
+{
+    if (m_multi)
+    {
+        curl_multi_cleanup(static_cast<CURLM*>(m_multi));
+    }
+}
+
+std::optional<CurlTrackerTransport::Result> CurlTrackerTransport::race(std::span<const std::string> urls,
+    std::chrono::milliseconds timeout, const Accept& accept, std::vector<bool>& failed)
+{
+    // created on first use: thousands of idle sessions should not each hold a multi handle
+    if (!m_multi)
+    {
+        m_multi = curl_multi_init();
+        if (!m_multi)
+        {
+            throw std::runtime_error("Failed to create curl multi handle");
+        }
+    }
+    auto* multi = static_cast<CURLM*>(m_multi);
+    std::vector<CURL*> handles(urls.size(), nullptr);
+    std::vector<std::string> bodies(urls.size());
+
+    for (size_t i = 0; i < urls.size(); ++i)
+    {
+        CURL* easy = curl_easy_init();
+        if (!easy)
+        {
+            failed[i] = true;
+            continue;
+        }
+        curl_easy_setopt(easy, CURLOPT_URL, urls[i].c_str());
+        curl_easy_setopt(easy, CURLOPT_WRITEFUNCTION, writeBody);
+        curl_easy_setopt(easy, CURLOPT_WRITEDATA, &bodies[i]);
+        curl_easy_setopt(easy, CURLOPT_TIMEOUT_MS, static_cast<long>(timeout.count()));
+        curl_easy_setopt(easy, CURLOPT_NOSIGNAL, 1L);
+        curl_easy_setopt(easy, CURLOPT_FOLLOWLOCATION, 1L);
+        curl_easy_setopt(easy, CURLOPT_PRIVATE, reinterpret_cast<char*>(i));
+        curl_multi_add_handle(multi, easy);
+        handles[i] = easy;
+    }
+
+    std::optional<Result> result;
+    int running = 0;
+    do
+    {
+        curl_multi_perform(multi, &running);
+
+        int queued = 0;
+        while (CURLMsg* msg = curl_multi_info_read(multi, &queued))
+        {
+            if (msg->msg != CURLMSG_DONE)
+            {
+                continue;
+            }
+
+            char* priv = nullptr;
+            curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, &priv);
+            auto index = reinterpret_cast<size_t>(priv);
+
+            long status = 0;
+            curl_easy_getinfo(msg->easy_handle, CURLINFO_RESPONSE_CODE, &status);
+            if (msg->data.result == CURLE_OK && status == 200 && accept(bodies[index]))
+            {
+                result = Result{index, std::move(bodies[index])};
+                break;
+            }
+
+            LOG_DEBUG(CurlTrackerTransport, "Tracker request failed", LOG_MD(Url, urls[index]),
+                LOG_MD(Error, curl_easy_strerror(msg->data.result)), LOG_MD(Status, status));
+            failed[index] = true;
+        }
+
+        if (result || running == 0)
+        {
+            break;
+        }
+        curl_multi_poll(multi, nullptr, 0, 100, nullptr);
+    }
+    while (true);
+
+    // losers of the race are simply abandoned
+    for (CURL* easy : handles)
+    {
+        if (easy)
+        {
+            curl_multi_remove_handle(multi, easy);
+            curl_easy_cleanup(easy);
+        }
+    }
+    return result;
+}
+
+}  // namespace Torrent::Net
@@ -0,0 +1,24 @@
+#ifndef CURLTRANSPORT_HPP
+#define CURLTRANSPORT_HPP
+
+#include <Core/TrackerManager.hpp>
+
+namespace Torrent::Net {
+
+// HTTP tracker transport on top of a libcurl multi handle: all requests of a race share one thread.
+class CurlTrackerTransport: public Core::ITrackerTransport
+{
+public:
+    CurlTrackerTransport();
+    ~CurlTrackerTransport() override;
+    CurlTrackerTransport(const CurlTrackerTransport&) = delete;
+
+    std::optional<Result> race(std::span<const std::string> urls, std::chrono::milliseconds timeout,
+        const Accept& accept, std::vector<bool>& failed) override;
+
+private:
+    void* m_multi = nullptr;
+};
+
+}  // namespace Torrent::Net
+#endif  // CURLTRANSPORT_HPP
@@ -0,0 +1,64 @@
+#include "Endpoint.hpp"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdexcept>
+
+namespace Torrent::Net {
+
+std::string Endpoint::toString() const
+{
+    char buf[INET6_ADDRSTRLEN]{0};
+    if (isV4())
+    {
+        inet_ntop(AF_INET, address.data() + 12, buf, sizeof(buf));
+        return std::string(buf) + ":" + std::to_string(port);
+    }
+    inet_ntop(AF_INET6, address.data(), buf, sizeof(buf));
+    return "[" + std::string(buf) + "]:" + std::to_string(port);
+}
+
+socklen_t Endpoint::toSockaddr(sockaddr_storage& out) const
+{
+    out = {};
+    if (isV4())
+    {
+        auto* sin       = reinterpret_cast<sockaddr_in*>(&out);
+        sin->sin_family = AF_INET;
+        sin->sin_port   = htons(port);
+        std::memcpy(&sin->sin_addr, address.data() + 12, 4);
+        return sizeof(sockaddr_in);
+    }
+    auto* sin6        = reinterpret_cast<sockaddr_in6*>(&out);
+    sin6->sin6_family = AF_INET6;
+    sin6->sin6_port   = htons(port);
+    std::memcpy(&sin6->sin6_addr, address.data(), 16);
+    return sizeof(sockaddr_in6);
+}
+
+Endpoint Endpoint::fromSockaddr(const sockaddr_storage& addr)
+{
+    if (addr.ss_family == AF_INET)
+    {
+        const auto* sin = reinterpret_cast<const sockaddr_in*>(&addr);
+        return fromV4(reinterpret_cast<const uint8_t*>(&sin->sin_addr), ntohs(sin->sin_port));
+    }
+    const auto* sin6 = reinterpret_cast<const sockaddr_in6*>(&addr);
+    return fromV6(reinterpret_cast<const uint8_t*>(&sin6->sin6_addr), ntohs(sin6->sin6_port));
+}
+
+Endpoint Endpoint::parse(const std::string& ip, uint16_t port)
+{
+    uint8_t addr[16];
+    if (inet_pton(AF_INET, ip.c_str(), addr) == 1)
+    {
+        return fromV4(addr, port);
+    }
+    if (inet_pton(AF_INET6, ip.c_str(), addr) == 1)
+    {
+        return fromV6(addr, port);
+    }
+    throw std::runtime_error("Invalid IP address: " + ip);
+}
+
+}  // namespace Torrent::Net
@@ -0,0 +1,74 @@
+#ifndef ENDPOINT_HPP
+#define ENDPOINT_HPP
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <sys/socket.h>
+
+namespace Torrent::Net {
+
+// IPv4 addresses are stored IPv4-mapped (::ffff:a.b.c.d) so both families share one packed 18-byte layout.
+#pragma pack(push, 1)
+
+struct Endpoint
+{
+    std::array<uint8_t, 16> address{};
+    uint16_t port = 0;
+
+    static Endpoint fromV4(const uint8_t* addr, uint16_t port)
+    {
+        Endpoint ep;
+        ep.address[10] = 0xff;
+        ep.address[11] = 0xff;
+        std::memcpy(ep.address.data() + 12, addr, 4);
+        ep.port = port;
+        return ep;
+    }
+
+    static Endpoint fromV6(const uint8_t* addr, uint16_t port)
+    {
+        Endpoint ep;
+        std::memcpy(ep.address.data(), addr, 16);
+        ep.port = port;
+        return ep;
+    }
+
+    bool isV4() const
+    {
+        static constexpr uint8_t prefix[12] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff};
+        return std::memcmp(address.data(), prefix, sizeof(prefix)) == 0;
+    }
+
+    bool operator==(const Endpoint& other) const
+    {
+        return std::memcmp(this, &other, sizeof(Endpoint)) == 0;
+    }
+
+    std::string toString() const;
+    socklen_t toSockaddr(sockaddr_storage& out) const;
+    static Endpoint fromSockaddr(const sockaddr_storage& addr);
+    static Endpoint parse(const std::string& ip, uint16_t port);
+};
+
+#pragma pack(pop)
+
+static_assert(sizeof(Endpoint) == 18, "Endpoint must stay packed");
+
+inline uint64_t hashEndpoint(const Endpoint& ep)
+{
+    uint64_t lo = 0;
+    uint64_t hi = 0;
+    std::memcpy(&lo, ep.address.data(), 8);
+    std::memcpy(&hi, ep.address.data() + 8, 8);
+    uint64_t h  = (lo ^ 0x9e3779b97f4a7c15ULL) * 0xbf58476d1ce4e5b9ULL;
+    h          ^= (hi + ep.port) * 0x94d049bb133111ebULL;
+    h          ^= h >> 31;
+    h          *= 0xff51afd7ed558ccdULL;
+    h          ^= h >> 33;
+    return h;
+}
+
+}  // namespace Torrent::Net
+#endif  // ENDPOINT_HPP
@@ -0,0 +1,286 @@
+#include "EventLoop.hpp"
+
+#include <Logger.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <utility>
+
+namespace Torrent::Net {
+
+EventLoop::EventLoop()
+    : m_now(Clock::now())
+{
+    m_epoll = epoll_create1(EPOLL_CLOEXEC);
+    if (m_epoll < 0)
+    {
+        throw std::runtime_error(std::string("epoll_create1 failed: ") + std::strerror(errno));
+    }
+    m_wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_wakeFd < 0)
+    {
+        ::close(m_epoll);
+        throw std::runtime_error(std::string("eventfd failed: ") + std::strerror(errno));
+    }
+    add(m_wakeFd, EPOLLIN,
+        [this](uint32_t)
+        {
+            uint64_t v = 0;
+            while (::read(m_wakeFd, &v, sizeof(v)) > 0)
+            {
+            }
+        });
+}
+
+EventLoop::~EventLoop()
+{
+    ::close(m_wakeFd);
+    ::close(m_epoll);
+}
+
+void EventLoop::add(int fd, uint32_t events, IoHandler handler)
+{
+    epoll_event ev{};
+    ev.events  = events;
+    ev.data.fd = fd;
+    if (epoll_ctl(m_epoll, EPOLL_CTL_ADD, fd, &ev) < 0)
+    {
+        throw std::runtime_error(std::string("epoll_ctl(ADD) failed: ") + std::strerror(errno));
+    }
+    m_handlers[fd] = std::make_shared<IoHandler>(std::move(handler));
+}
+
+void EventLoop::modify(int fd, uint32_t events)
+{
+    epoll_event ev{};
+    ev.events  = events;
+    ev.data.fd = fd;
+    if (epoll_ctl(m_epoll, EPOLL_CTL_MOD, fd, &ev) < 0)
+    {
+        throw std::runtime_error(std::string("epoll_ctl(MOD) failed: ") + std::strerror(errno));
+    }
+}
+
+void EventLoop::remove(int fd)
+{
+    epoll_ctl(m_epoll, EPOLL_CTL_DEL, fd, nullptr);
+    m_handlers.erase(fd);
+    m_waiters.erase(fd);
+}
+
+void EventLoop::waitFor(int fd, uint32_t events, Task task)
+{
+    auto [it, isNew] = m_waiters.try_emplace(fd);
+    auto& waiters    = it->second;
+    if (events & EPOLLIN)
+    {
+        waiters.onReadable = std::move(task);
+    }
+    else
+    {
+        waiters.onWritable = std::move(task);
+    }
+
+    uint32_t mask = (waiters.onReadable ? uint32_t{EPOLLIN} : 0u) | (waiters.onWritable ? uint32_t{EPOLLOUT} : 0u);
+    epoll_event ev{};
+    ev.events  = mask;
+    ev.data.fd = fd;
+    if (epoll_ctl(m_epoll, isNew ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, fd, &ev) < 0)
+    {
+        m_waiters.erase(fd);
+        throw std::runtime_error(std::string("epoll_ctl(wait) failed: ") + std::strerror(errno));
+    }
+    waiters.mask = mask;
+}
+
+void EventLoop::dispatchWaiters(int fd, uint32_t events)
+{
+    auto it = m_waiters.find(fd);
+    if (it == m_waiters.end())
+    {
+        return;
+    }
+
+    // errors and hangups wake both sides: the retried syscall reports what happened
+    bool failed = (events & (EPOLLERR | EPOLLHUP)) != 0;
+    Task onReadable;
+    Task onWritable;
+    if (failed || (events & EPOLLIN))
+    {
+        onReadable = std::exchange(it->second.onReadable, nullptr);
+    }
+    if (failed || (events & EPOLLOUT))
+    {
+        onWritable = std::exchange(it->second.onWritable, nullptr);
+    }
+
+    uint32_t mask = (it->second.onReadable ? uint32_t{EPOLLIN} : 0u) | (it->second.onWritable ? uint32_t{EPOLLOUT} : 0u);
+    if (mask == 0)
+    {
+        epoll_ctl(m_epoll, EPOLL_CTL_DEL, fd, nullptr);
+        m_waiters.erase(it);
+    }
+    else if (mask != it->second.mask)
+    {
+        epoll_event ev{};
+        ev.events  = mask;
+        ev.data.fd = fd;
+        epoll_ctl(m_epoll, EPOLL_CTL_MOD, fd, &ev);
+        it->second.mask = mask;
+    }
+
+    if (onReadable)
+    {
+        onReadable();
+    }
+    if (onWritable)
+    {
+        onWritable();
+    }
+}
+
+EventLoop::TimerId EventLoop::runAfter(std::chrono::milliseconds delay, Task task)
+{
+    TimerId id   = m_nextTimer++;
+    m_timers[id] = Timer{std::move(task), std::chrono::milliseconds(0)};
+    m_deadlines.emplace(Clock::now() + delay, id);
+    return id;
+}
+
+EventLoop::TimerId EventLoop::runEvery(std::chrono::milliseconds interval, Task task)
+{
+    TimerId id   = m_nextTimer++;
+    m_timers[id] = Timer{std::move(task), interval};
+    m_deadlines.emplace(Clock::now() + interval, id);
+    return id;
+}
+
+void EventLoop::cancel(TimerId id)
+{
+    // the heap entry is dropped lazily when it expires
+    m_timers.erase(id);
+}
+
+void EventLoop::post(Task task)
+{
+    {
+        std::scoped_lock lk(m_postMutex);
+        m_posted.push_back(std::move(task));
+    }
+    wake();
+}
+
+void EventLoop::wake()
+{
+    uint64_t one = 1;
+    [[maybe_unused]] auto n = ::write(m_wakeFd, &one, sizeof(one));
+}
+
+void EventLoop::stop()
+{
+    m_stopped = true;
+    wake();
+}
+
+void EventLoop::runTimers()
+{
+    while (!m_deadlines.empty() && m_deadlines.top().first <= m_now)
+    {
+        auto [deadline, id] = m_deadlines.top();
+        m_deadlines.pop();
+
+        auto it = m_timers.find(id);
+        if (it == m_timers.end())
+        {
+            continue;
+        }
+
+        if (it->second.interval.count() > 0)
+        {
+            m_deadlines.emplace(m_now + it->second.interval, id);
+            auto task = it->second.task;
+            task();
+        }
+        else
+        {
+            auto task = std::move(it->second.task);
+            m_timers.erase(it);
+            task();
+        }
+    }
+}
+
+void EventLoop::runPosted()
+{
+    {
+        std::scoped_lock lk(m_postMutex);
+        m_running.swap(m_posted);
+    }
+    for (auto& task : m_running)
+    {
+        task();
+    }
+    m_running.clear();
+}
+
+void EventLoop::runOnce(std::chrono::milliseconds maxWait)
+{
+    m_now        = Clock::now();
+    auto timeout = maxWait;
+    if (!m_deadlines.empty())
+    {
+        auto untilTimer = std::chrono::ceil<std::chrono::milliseconds>(m_deadlines.top().first - m_now);
+        timeout         = std::clamp(untilTimer, std::chrono::milliseconds(0), maxWait);
+    }
+
+    epoll_event events[64];
+    int n = epoll_wait(m_epoll, events, 64, static_cast<int>(timeout.count()));
+    if (n < 0 && errno != EINTR)
+    {
+        throw std::runtime_error(std::string("epoll_wait failed: ") + std::strerror(errno));
+    }
+
+    m_now = Clock::now();
+    for (int i = 0; i < n; ++i)
+    {
+        auto it = m_handlers.find(events[i].data.fd);
+        if (it == m_handlers.end())
+        {
+            dispatchWaiters(events[i].data.fd, events[i].events);
+            continue;
+        }
+        // keep the handler alive even if it removes itself
+        auto handler = it->second;
+        (*handler)(events[i].events);
+    }
+
+    runPosted();
+    runTimers();
+}
+
+void EventLoop::run()
+{
+    // consumed when seen, never cleared on entry: another thread may have asked before this one got here
+    while (!m_stopped.exchange(false))
+    {
+        runOnce(std::chrono::milliseconds(1'000));
+    }
+    runPosted();
+}
+
+bool EventLoop::runUntil(const std::function<bool()>& pred, std::chrono::milliseconds timeout)
+{
+    auto deadline = Clock::now() + timeout;
+    while (!pred() && Clock::now() < deadline && !m_stopped.exchange(false))
+    {
+        runOnce(std::chrono::milliseconds(10));
+    }
+    return pred();
+}
+
+}  // namespace Torrent::Net
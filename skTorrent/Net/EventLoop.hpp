@@ -0,0 +1,98 @@
+#ifndef EVENTLOOP_HPP
+#define EVENTLOOP_HPP
+
+#include <atomic>
+#include <memory>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+namespace Torrent::Net {
+
+// Single-threaded epoll reactor with a timer heap. Everything except post() and stop() must be called
+// from the thread running the loop.
+class EventLoop
+{
+public:
+    using Clock     = std::chrono::steady_clock;
+    using IoHandler = std::function<void(uint32_t events)>;
+    using Task      = std::function<void()>;
+    using TimerId   = uint64_t;
+
+    EventLoop();
+    ~EventLoop();
+    EventLoop(const EventLoop&) = delete;
+
+    void add(int fd, uint32_t events, IoHandler handler);
+    void modify(int fd, uint32_t events);
+    // Also drops pending waitFor() waiters of fd.
+    void remove(int fd);
+
+    // One-shot readiness wait for fds not registered through add(). A read and a write waiter may be pending on
+    // the same fd at once; events is EPOLLIN or EPOLLOUT.
+    void waitFor(int fd, uint32_t events, Task task);
+
+    TimerId runAfter(std::chrono::milliseconds delay, Task task);
+    TimerId runEvery(std::chrono::milliseconds interval, Task task);
+    void cancel(TimerId id);
+
+    // Thread-safe: queue a task and wake the loop.
+    void post(Task task);
+
+    // Runs until stop(). A stop() that comes first, even before run() is entered, is not lost: it ends the next run.
+    void run();
+    // Runs until pred() holds, stop() or the timeout; returns pred().
+    bool runUntil(const std::function<bool()>& pred, std::chrono::milliseconds timeout);
+    // Thread-safe.
+    void stop();
+
+    Clock::time_point now() const
+    {
+        return m_now;
+    }
+
+private:
+    struct Timer
+    {
+        Task task;
+        std::chrono::milliseconds interval{0};
+    };
+
+    struct Waiters
+    {
+        Task onReadable;
+        Task onWritable;
+        uint32_t mask = 0;
+    };
+
+    using Deadline = std::pair<Clock::time_point, TimerId>;
+
+    void runOnce(std::chrono::milliseconds maxWait);
+    void runTimers();
+    void runPosted();
+    void wake();
+    void dispatchWaiters(int fd, uint32_t events);
+
+    int m_epoll  = -1;
+    int m_wakeFd = -1;
+    Clock::time_point m_now;
+    std::atomic<bool> m_stopped{false};
+
+    std::unordered_map<int, std::shared_ptr<IoHandler>> m_handlers;
+    std::unordered_map<int, Waiters> m_waiters;
+
+    TimerId m_nextTimer = 1;
+    std::priority_queue<Deadline, std::vector<Deadline>, std::greater<>> m_deadlines;
+    std::unordered_map<TimerId, Timer> m_timers;
+
+    std::mutex m_postMutex;
+    std::vector<Task> m_posted;
+    std::vector<Task> m_running;
+};
+
+}  // namespace Torrent::Net
+#endif  // EVENTLOOP_HPP
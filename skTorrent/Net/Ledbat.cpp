@@ -0,0 +1,101 @@
+#include "Ledbat.hpp"
+
+#include <algorithm>
+
+namespace Torrent::Net {
+
+namespace {
+// delays live on a wrapping 32-bit microsecond clock
+bool delayLess(uint32_t a, uint32_t b)
+{
+    return static_cast<int32_t>(a - b) < 0;
+}
+}  // namespace
+
+Ledbat::Ledbat()
+    : Ledbat(Options{})
+{}
+
+Ledbat::Ledbat(Options options)
+    : m_options(options)
+    , m_cwnd(static_cast<double>(options.minWindow) * options.mss)
+{}
+
+void Ledbat::addDelaySample(uint32_t sample, Clock::time_point now)
+{
+    if (m_baseCount == 0)
+    {
+        m_base[0]    = sample;
+        m_baseCount  = 1;
+        m_baseRolled = now;
+    }
+    else if (now - m_baseRolled >= m_options.baseInterval)
+    {
+        // shift the history: the oldest minimum drops out so a route change eventually raises the base
+        std::move_backward(m_base.begin(), m_base.end() - 1, m_base.end());
+        m_base[0]    = sample;
+        m_baseCount  = std::min(m_baseCount + 1, BaseHistory);
+        m_baseRolled = now;
+    }
+    else if (delayLess(sample, m_base[0]))
+    {
+        m_base[0] = sample;
+    }
+
+    m_current[m_currentPos] = sample;
+    m_currentPos            = (m_currentPos + 1) % CurrentFilter;
+    m_currentCount          = std::min(m_currentCount + 1, CurrentFilter);
+
+    uint32_t base = m_base[0];
+    for (size_t i = 1; i < m_baseCount; ++i)
+    {
+        base = delayLess(m_base[i], base) ? m_base[i] : base;
+    }
+    uint32_t current = m_current[0];
+    for (size_t i = 1; i < m_currentCount; ++i)
+    {
+        current = delayLess(m_current[i], current) ? m_current[i] : current;
+    }
+    m_queuingDelay = delayLess(current, base) ? 0 : current - base;
+}
+
+void Ledbat::onAck(uint32_t bytesAcked, uint32_t delaySample, uint32_t flightSize, Clock::time_point now)
+{
+    addDelaySample(delaySample, now);
+
+    double target    = static_cast<double>(m_options.target.count());
+    double offTarget = (target - m_queuingDelay) / target;
+    if (m_slowStart && m_queuingDelay > target / 2)
+    {
+        m_slowStart = false;
+    }
+
+    if (m_slowStart)
+    {
+        m_cwnd += bytesAcked;
+    }
+    else
+    {
+        m_cwnd += m_options.gain * offTarget * bytesAcked * m_options.mss / m_cwnd;
+    }
+
+    // no growth while the sender is application limited
+    double maxAllowed = static_cast<double>(flightSize) + std::max(bytesAcked, m_options.mss);
+    double minWindow  = static_cast<double>(m_options.minWindow) * m_options.mss;
+    m_cwnd            = std::clamp(std::min(m_cwnd, std::max(maxAllowed, minWindow)), minWindow,
+        static_cast<double>(m_options.maxWindow));
+}
+
+void Ledbat::onLoss()
+{
+    m_slowStart = false;
+    m_cwnd      = std::max(m_cwnd / 2, static_cast<double>(m_options.minWindow) * m_options.mss);
+}
+
+void Ledbat::onTimeout()
+{
+    m_slowStart = false;
+    m_cwnd      = m_options.mss;
+}
+
+}  // namespace Torrent::Net
@@ -0,0 +1,71 @@
+#ifndef LEDBAT_HPP
+#define LEDBAT_HPP
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+namespace Torrent::Net {
+
+// RFC 6817 delay-based congestion window. Delay samples are one-way delays in microseconds measured against
+// the peer's clock, so only their differences to the base (minimum) delay mean anything. A short slow start
+// runs until the queueing delay reaches half the target or the first loss.
+class Ledbat
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Options
+    {
+        std::chrono::microseconds target{100'000};
+        double gain        = 1.0;
+        uint32_t mss       = 1'380;
+        uint32_t minWindow = 2;  // in segments
+        uint32_t maxWindow = 1 << 20;
+        std::chrono::seconds baseInterval{60};  // one base history slot per interval
+    };
+
+    static constexpr size_t BaseHistory   = 2;
+    static constexpr size_t CurrentFilter = 4;
+
+    Ledbat();
+    explicit Ledbat(Options options);
+
+    // bytesAcked newly acknowledged; flightSize bytes outstanding before this ack
+    void onAck(uint32_t bytesAcked, uint32_t delaySample, uint32_t flightSize, Clock::time_point now);
+    void onLoss();
+    void onTimeout();
+
+    uint32_t window() const
+    {
+        return static_cast<uint32_t>(m_cwnd);
+    }
+
+    bool inSlowStart() const
+    {
+        return m_slowStart;
+    }
+
+    std::chrono::microseconds queuingDelay() const
+    {
+        return std::chrono::microseconds(m_queuingDelay);
+    }
+
+private:
+    void addDelaySample(uint32_t sample, Clock::time_point now);
+
+    Options m_options;
+    double m_cwnd;
+    bool m_slowStart = true;
+
+    std::array<uint32_t, CurrentFilter> m_current{};
+    size_t m_currentCount = 0;
+    size_t m_currentPos   = 0;
+    std::array<uint32_t, BaseHistory> m_base{};
+    size_t m_baseCount = 0;
+    Clock::time_point m_baseRolled{};
+    uint32_t m_queuingDelay = 0;
+};
+
+}  // namespace Torrent::Net
+#endif  // LEDBAT_HPP
@@ -0,0 +1,125 @@
+#include "LoopGroup.hpp"
+
+#include <Logger.hpp>
+#include <Metrics/Trace.hpp>
+
+#include <exception>
+#include <functional>
+#include <latch>
+#include <mutex>
+#include <pthread.h>
+#include <sched.h>
+
+namespace Torrent::Net {
+
+namespace {
+thread_local const LoopGroup* t_group = nullptr;
+thread_local size_t t_shard           = 0;
+}  // namespace
+
+bool pinToCore(size_t core)
+{
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0 || CPU_COUNT(&allowed) == 0)
+    {
+        return false;
+    }
+    // the n-th core of the allowed set, so pinning works inside a cpuset as well
+    size_t n = core % static_cast<size_t>(CPU_COUNT(&allowed));
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+    {
+        if (CPU_ISSET(cpu, &allowed) && n-- == 0)
+        {
+            cpu_set_t one;
+            CPU_ZERO(&one);
+            CPU_SET(cpu, &one);
+            return pthread_setaffinity_np(pthread_self(), sizeof(one), &one) == 0;
+        }
+    }
+    return false;
+}
+
+LoopGroup::LoopGroup()
+    : LoopGroup(Options{})
+{}
+
+LoopGroup::LoopGroup(Options options)
+{
+    for (size_t i = 0; i < std::max<size_t>(options.shards, 1); ++i)
+    {
+        m_shards.push_back(std::make_unique<Shard>());
+    }
+    // every shard is named, pinned and running when the constructor returns, so a LoopGroup destroyed right away
+    // never stops a thread that is still setting up
+    std::latch running(static_cast<std::ptrdiff_t>(m_shards.size()));
+    for (size_t i = 0; i < m_shards.size(); ++i)
+    {
+        m_shards[i]->thread = std::jthread(
+            [this, i, options, &running]
+            {
+                Metrics::Tracer::instance().setThreadName(options.name + " " + std::to_string(i));
+                if (options.pinThreads && !pinToCore(i))
+                {
+                    LOG_WARNING(LoopGroup, "Could not pin shard", LOG_MD(Shard, i));
+                }
+                t_group = this;
+                t_shard = i;
+                m_shards[i]->loop.post([&running] { running.count_down(); });
+                m_shards[i]->loop.run();
+            });
+    }
+    running.wait();
+    LOG_INFO(LoopGroup, "Network shards started", LOG_MD(Name, options.name), LOG_MD(Shards, m_shards.size()),
+        LOG_MD(Pinned, options.pinThreads));
+}
+
+LoopGroup::~LoopGroup()
+{
+    for (auto& shard : m_shards)
+    {
+        shard->loop.stop();
+        shard->thread = {};
+    }
+}
+
+size_t LoopGroup::shardFor(std::string_view key) const
+{
+    return std::hash<std::string_view>{}(key) % m_shards.size();
+}
+
+size_t LoopGroup::currentShard() const
+{
+    return t_group == this ? t_shard : m_shards.size();
+}
+
+void LoopGroup::runOnEach(const std::function<void(size_t shard)>& fn)
+{
+    std::latch done(static_cast<std::ptrdiff_t>(m_shards.size()));
+    std::mutex mutex;
+    std::exception_ptr error;
+    for (size_t i = 0; i < m_shards.size(); ++i)
+    {
+        m_shards[i]->loop.post(
+            [&, i]
+            {
+                try
+                {
+                    fn(i);
+                }
+                catch (...)
+                {
+                    std::scoped_lock lk(mutex);
+                    error = error ? error : std::current_exception();
+                }
+                done.count_down();
+            });
+    }
+    done.wait();
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+}
+
+}  // namespace Torrent::Net
@@ -0,0 +1,70 @@
+#ifndef LOOPGROUP_HPP
+#define LOOPGROUP_HPP
+
+#include "EventLoop.hpp"
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace Torrent::Net {
+
+// Pins the calling thread to one core, counted modulo the cores this process may run on; false if the kernel
+// refuses.
+bool pinToCore(size_t core);
+
+// Peer I/O sharded over several event loops, one thread each. A shard owns its epoll instance and everything
+// registered with it: sockets, buffers and timers of whatever lives on it are touched by that thread only. Shards
+// talk to each other through EventLoop::post and nothing else.
+class LoopGroup
+{
+public:
+    struct Options
+    {
+        size_t shards    = std::max(1u, std::thread::hardware_concurrency());
+        bool pinThreads  = true;   // shard i on core i
+        std::string name = "net";  // thread names, "<name> <i>"
+    };
+
+    LoopGroup();
+    // Returns once every shard's loop is running.
+    explicit LoopGroup(Options options);
+    // Stops every loop and joins its thread; whatever still lives on a shard must be gone by then.
+    ~LoopGroup();
+    LoopGroup(const LoopGroup&) = delete;
+
+    size_t size() const
+    {
+        return m_shards.size();
+    }
+
+    EventLoop& loop(size_t shard)
+    {
+        return m_shards[shard]->loop;
+    }
+
+    // Stable shard for a key such as an info hash.
+    size_t shardFor(std::string_view key) const;
+
+    // The calling thread's shard, or size() when called from outside the group.
+    size_t currentShard() const;
+
+    // Runs fn(shard) on every shard's thread and returns once all of them did; for setting up and tearing down
+    // per-shard state. Must not be called from a shard thread.
+    void runOnEach(const std::function<void(size_t shard)>& fn);
+
+private:
+    struct Shard
+    {
+        EventLoop loop;
+        std::jthread thread;
+    };
+
+    std::vector<std::unique_ptr<Shard>> m_shards;
+};
+
+}  // namespace Torrent::Net
+#endif  // LOOPGROUP_HPP
@@ -0,0 +1,21 @@
+#include "Stream.hpp"
+
+#include <stdexcept>
+
+namespace Torrent::Net {
+
+Async::Task<void> readExactly(Stream& stream, std::span<uint8_t> buffer)
+{
+    size_t done = 0;
+    while (done < buffer.size())
+    {
+        size_t n = co_await stream.read(buffer.subspan(done));
+        if (n == 0)
+        {
+            throw std::runtime_error("Connection closed");
+        }
+        done += n;
+    }
+}
+
+}  // namespace Torrent::Net
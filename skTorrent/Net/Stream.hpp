@@ -0,0 +1,42 @@
+#ifndef STREAM_HPP
+#define STREAM_HPP
+
+#include "Endpoint.hpp"
+
+#include <Async/Task.hpp>
+
+#include <functional>
+#include <memory>
+#include <optional>
+#include <span>
+
+namespace Torrent::Net {
+
+// Reliable byte stream to a peer. TCP and uTP both implement it so the peer protocol does not care which one
+// carries it. A stream belongs to one event loop and every call must come from that loop's thread.
+class Stream
+{
+public:
+    virtual ~Stream() = default;
+
+    virtual Async::Task<void> connect(const Endpoint& remote) = 0;
+    // At least one byte, or 0 once the peer finished sending. Throws on errors.
+    virtual Async::Task<size_t> read(std::span<uint8_t> buffer) = 0;
+    // Completes once all data is handed to the transport.
+    virtual Async::Task<void> write(std::span<const uint8_t> data) = 0;
+    // Wakes pending operations, which then fail or see end of stream; used for timeouts and teardown.
+    virtual void close() = 0;
+    // The address of the other end, if the transport knows it.
+    virtual std::optional<Endpoint> remoteEndpoint() const
+    {
+        return std::nullopt;
+    }
+};
+
+using StreamFactory = std::function<std::unique_ptr<Stream>()>;
+
+// Throws std::runtime_error("Connection closed") if the stream ends first.
+Async::Task<void> readExactly(Stream& stream, std::span<uint8_t> buffer);
+
+}  // namespace Torrent::Net
+#endif  // STREAM_HPP
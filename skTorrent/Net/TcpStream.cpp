@@ -0,0 +1,135 @@
+#include "TcpStream.hpp"
+
+#include <Async/IoAwaitables.hpp>
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace Torrent::Net {
+
+TcpStream::TcpStream(EventLoop& loop)
+    : m_loop(loop)
+{}
+
+TcpStream::TcpStream(EventLoop& loop, int fd)
+    : m_loop(loop)
+    , m_fd(fd)
+{}
+
+TcpStream::~TcpStream()
+{
+    if (m_fd >= 0)
+    {
+        ::close(m_fd);
+    }
+}
+
+Async::Task<void> TcpStream::connect(const Endpoint& remote)
+{
+    if (m_closed || m_fd >= 0)
+    {
+        throw std::runtime_error("Stream already used");
+    }
+    m_fd = ::socket(remote.isV4() ? AF_INET : AF_INET6, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (m_fd < 0)
+    {
+        throw std::runtime_error(std::string("socket failed: ") + std::strerror(errno));
+    }
+    co_await Async::asyncConnect(m_loop, m_fd, remote);
+}
+
+Async::Task<size_t> TcpStream::read(std::span<uint8_t> buffer)
+{
+    if (m_fd < 0)
+    {
+        throw std::runtime_error("Stream not connected");
+    }
+    co_return co_await Async::asyncRead(m_loop, m_fd, buffer);
+}
+
+Async::Task<void> TcpStream::write(std::span<const uint8_t> data)
+{
+    if (m_fd < 0)
+    {
+        throw std::runtime_error("Stream not connected");
+    }
+    co_await Async::asyncWriteAll(m_loop, m_fd, data);
+}
+
+void TcpStream::close()
+{
+    m_closed = true;
+    if (m_fd >= 0)
+    {
+        // also aborts a connect still in progress
+        ::shutdown(m_fd, SHUT_RDWR);
+    }
+}
+
+std::optional<Endpoint> TcpStream::remoteEndpoint() const
+{
+    sockaddr_storage addr{};
+    socklen_t len = sizeof(addr);
+    if (m_fd < 0 || ::getpeername(m_fd, reinterpret_cast<sockaddr*>(&addr), &len) != 0)
+    {
+        return std::nullopt;
+    }
+    return Endpoint::fromSockaddr(addr);
+}
+
+TcpListener::TcpListener(EventLoop& loop, const Endpoint& bindTo, AcceptHandler onAccept, bool reusePort)
+    : m_loop(loop)
+    , m_onAccept(std::move(onAccept))
+{
+    m_fd = ::socket(bindTo.isV4() ? AF_INET : AF_INET6, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (m_fd < 0)
+    {
+        throw std::runtime_error(std::string("socket failed: ") + std::strerror(errno));
+    }
+    int on = 1;
+    ::setsockopt(m_fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    if (reusePort && ::setsockopt(m_fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) != 0)
+    {
+        int error = errno;
+        ::close(m_fd);
+        throw std::runtime_error(std::string("SO_REUSEPORT failed: ") + std::strerror(error));
+    }
+
+    sockaddr_storage addr{};
+    socklen_t len = bindTo.toSockaddr(addr);
+    if (::bind(m_fd, reinterpret_cast<sockaddr*>(&addr), len) != 0 || ::listen(m_fd, 128) != 0)
+    {
+        int error = errno;
+        ::close(m_fd);
+        throw std::runtime_error(std::string("Failed to listen: ") + std::strerror(error));
+    }
+    len = sizeof(addr);
+    ::getsockname(m_fd, reinterpret_cast<sockaddr*>(&addr), &len);
+    m_local = Endpoint::fromSockaddr(addr);
+    m_loop.add(m_fd, EPOLLIN, [this](uint32_t) { onReadable(); });
+}
+
+TcpListener::~TcpListener()
+{
+    m_loop.remove(m_fd);
+    ::close(m_fd);
+}
+
+void TcpListener::onReadable()
+{
+    while (true)
+    {
+        int fd = ::accept4(m_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+        {
+            return;
+        }
+        m_onAccept(std::make_unique<TcpStream>(m_loop, fd));
+    }
+}
+
+}  // namespace Torrent::Net
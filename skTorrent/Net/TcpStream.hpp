@@ -0,0 +1,72 @@
+#ifndef TCPSTREAM_HPP
+#define TCPSTREAM_HPP
+
+#include "EventLoop.hpp"
+#include "Stream.hpp"
+
+#include <functional>
+#include <memory>
+#include <utility>
+
+namespace Torrent::Net {
+
+class TcpStream: public Stream
+{
+public:
+    explicit TcpStream(EventLoop& loop);
+    // Takes ownership of a connected non-blocking socket, e.g. from accept().
+    TcpStream(EventLoop& loop, int fd);
+    ~TcpStream() override;
+    TcpStream(const TcpStream&) = delete;
+
+    Async::Task<void> connect(const Endpoint& remote) override;
+    Async::Task<size_t> read(std::span<uint8_t> buffer) override;
+    Async::Task<void> write(std::span<const uint8_t> data) override;
+    void close() override;
+    std::optional<Endpoint> remoteEndpoint() const override;
+
+    int fd() const
+    {
+        return m_fd;
+    }
+
+    // Gives up the socket without closing it, e.g. to hand it to another loop.
+    int release()
+    {
+        return std::exchange(m_fd, -1);
+    }
+
+private:
+    EventLoop& m_loop;
+    int m_fd      = -1;
+    bool m_closed = false;
+};
+
+// Accepts connections on the loop; the handler runs on the loop thread. Create and destroy it on the loop
+// thread or before the loop runs. With reusePort several listeners, one per loop, may bind the same endpoint and
+// the kernel spreads incoming connections over them (SO_REUSEPORT).
+class TcpListener
+{
+public:
+    using AcceptHandler = std::function<void(std::unique_ptr<TcpStream>)>;
+
+    TcpListener(EventLoop& loop, const Endpoint& bindTo, AcceptHandler onAccept, bool reusePort = false);
+    ~TcpListener();
+    TcpListener(const TcpListener&) = delete;
+
+    const Endpoint& localEndpoint() const
+    {
+        return m_local;
+    }
+
+private:
+    void onReadable();
+
+    EventLoop& m_loop;
+    AcceptHandler m_onAccept;
+    int m_fd = -1;
+    Endpoint m_local;
+};
+
+}  // namespace Torrent::Net
+#endif  // TCPSTREAM_HPP
@@ -0,0 +1,60 @@
+#include "UdpSocket.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <unistd.h>
+
+namespace Torrent::Net {
+
+UdpSocket::UdpSocket(const Endpoint& bindTo)
+{
+    sockaddr_storage addr{};
+    socklen_t len = bindTo.toSockaddr(addr);
+
+    m_fd = ::socket(addr.ss_family, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (m_fd < 0)
+    {
+        throw std::runtime_error(std::string("socket failed: ") + std::strerror(errno));
+    }
+    if (::bind(m_fd, reinterpret_cast<sockaddr*>(&addr), len) < 0)
+    {
+        int err = errno;
+        ::close(m_fd);
+        throw std::runtime_error(std::string("bind failed: ") + std::strerror(err));
+    }
+
+    len = sizeof(addr);
+    ::getsockname(m_fd, reinterpret_cast<sockaddr*>(&addr), &len);
+    m_local = Endpoint::fromSockaddr(addr);
+}
+
+UdpSocket::~UdpSocket()
+{
+    if (m_fd >= 0)
+    {
+        ::close(m_fd);
+    }
+}
+
+bool UdpSocket::sendTo(const Endpoint& to, std::span<const uint8_t> data)
+{
+    sockaddr_storage addr{};
+    socklen_t len = to.toSockaddr(addr);
+    return ::sendto(m_fd, data.data(), data.size(), 0, reinterpret_cast<sockaddr*>(&addr), len) ==
+        static_cast<ssize_t>(data.size());
+}
+
+ssize_t UdpSocket::receiveFrom(Endpoint& from, std::span<uint8_t> buffer)
+{
+    sockaddr_storage addr{};
+    socklen_t len = sizeof(addr);
+    ssize_t n     = ::recvfrom(m_fd, buffer.data(), buffer.size(), 0, reinterpret_cast<sockaddr*>(&addr), &len);
+    if (n >= 0)
+    {
+        from = Endpoint::fromSockaddr(addr);
+    }
+    return n;
+}
+
+}  // namespace Torrent::Net
@@ -0,0 +1,38 @@
+#ifndef UDPSOCKET_HPP
+#define UDPSOCKET_HPP
+
+#include "Endpoint.hpp"
+
+#include <span>
+
+namespace Torrent::Net {
+
+// Non-blocking UDP socket. The address family follows the bind endpoint.
+class UdpSocket
+{
+public:
+    explicit UdpSocket(const Endpoint& bindTo);
+    ~UdpSocket();
+    UdpSocket(const UdpSocket&) = delete;
+
+    bool sendTo(const Endpoint& to, std::span<const uint8_t> data);
+    // Returns -1 when nothing is pending.
+    ssize_t receiveFrom(Endpoint& from, std::span<uint8_t> buffer);
+
+    int fd() const
+    {
+        return m_fd;
+    }
+
+    const Endpoint& localEndpoint() const
+    {
+        return m_local;
+    }
+
+private:
+    int m_fd = -1;
+    Endpoint m_local;
+};
+
+}  // namespace Torrent::Net
+#endif  // UDPSOCKET_HPP
@@ -0,0 +1,85 @@
+#include "UnixSocket.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace Torrent::Net {
+
+namespace {
+sockaddr_un toSockaddr(const std::string& path)
+{
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(addr.sun_path))
+    {
+        throw std::runtime_error("Invalid Unix socket path: " + path);
+    }
+    std::memcpy(addr.sun_path, path.data(), path.size());
+    return addr;
+}
+}  // namespace
+
+UnixListener::UnixListener(EventLoop& loop, const std::string& path, AcceptHandler onAccept)
+    : m_loop(loop)
+    , m_onAccept(std::move(onAccept))
+    , m_path(path)
+{
+    auto addr = toSockaddr(path);
+    m_fd      = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (m_fd < 0)
+    {
+        throw std::runtime_error(std::string("socket failed: ") + std::strerror(errno));
+    }
+    ::unlink(path.c_str());
+    if (::bind(m_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || ::listen(m_fd, 64) != 0)
+    {
+        int error = errno;
+        ::close(m_fd);
+        throw std::runtime_error("Failed to listen on " + path + ": " + std::strerror(error));
+    }
+    m_loop.add(m_fd, EPOLLIN, [this](uint32_t) { onReadable(); });
+}
+
+UnixListener::~UnixListener()
+{
+    m_loop.remove(m_fd);
+    ::close(m_fd);
+    ::unlink(m_path.c_str());
+}
+
+void UnixListener::onReadable()
+{
+    while (true)
+    {
+        int fd = ::accept4(m_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+        {
+            return;
+        }
+        m_onAccept(std::make_unique<TcpStream>(m_loop, fd));
+    }
+}
+
+int connectUnix(const std::string& path)
+{
+    auto addr = toSockaddr(path);
+    int fd    = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        throw std::runtime_error(std::string("socket failed: ") + std::strerror(errno));
+    }
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0)
+    {
+        int error = errno;
+        ::close(fd);
+        throw std::runtime_error("Failed to connect to " + path + ": " + std::strerror(error));
+    }
+    return fd;
+}
+
+}  // namespace Torrent::Net
@@ -0,0 +1,40 @@
+#ifndef UNIXSOCKET_HPP
+#define UNIXSOCKET_HPP
+
+#include "TcpStream.hpp"
+
+#include <string>
+
+namespace Torrent::Net {
+
+// Accepts connections on a Unix domain stream socket. Accepted sockets are handed out as TcpStreams, which only
+// rely on stream socket semantics. A stale socket file at path is replaced and the file is removed again on
+// destruction. Create and destroy it on the loop thread or before the loop runs.
+class UnixListener
+{
+public:
+    using AcceptHandler = TcpListener::AcceptHandler;
+
+    UnixListener(EventLoop& loop, const std::string& path, AcceptHandler onAccept);
+    ~UnixListener();
+    UnixListener(const UnixListener&) = delete;
+
+    const std::string& path() const
+    {
+        return m_path;
+    }
+
+private:
+    void onReadable();
+
+    EventLoop& m_loop;
+    AcceptHandler m_onAccept;
+    std::string m_path;
+    int m_fd = -1;
+};
+
+// Blocking connect for clients that do not run an event loop; returns the socket, throws std::runtime_error.
+int connectUnix(const std::string& path);
+
+}  // namespace Torrent::Net
+#endif  // UNIXSOCKET_HPP
@@ -0,0 +1,985 @@
+#include "Utp.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <deque>
+#include <stdexcept>
+#include <string>
+#include <sys/epoll.h>
+
+namespace Torrent::Net {
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+// The receiver buffers at most this many packets past a gap; the sender never has more in flight.
+constexpr uint16_t ReorderWindow = 512;
+constexpr size_t MaxInflight     = ReorderWindow - 1;
+constexpr size_t MaxBatch        = 256;
+constexpr size_t CompactAfter    = 64 * 1'024;
+constexpr auto MaxTimeout        = std::chrono::seconds(60);
+
+uint32_t micros(Clock::time_point t)
+{
+    return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(t.time_since_epoch()).count());
+}
+
+struct WaitSlot
+{
+    bool await_ready() noexcept
+    {
+        return false;
+    }
+
+    void await_suspend(std::coroutine_handle<> h) noexcept
+    {
+        slot = h;
+    }
+
+    void await_resume() noexcept
+    {}
+
+    std::coroutine_handle<>& slot;
+};
+
+void compact(std::string& buffer, size_t& offset)
+{
+    if (offset == buffer.size())
+    {
+        buffer.clear();
+        offset = 0;
+    }
+    else if (offset > CompactAfter && offset * 2 > buffer.size())
+    {
+        buffer.erase(0, offset);
+        offset = 0;
+    }
+}
+}  // namespace
+
+class UtpConnection: public std::enable_shared_from_this<UtpConnection>
+{
+public:
+    enum class State : uint8_t
+    {
+        Idle,
+        SynSent,
+        Connected,
+        Closed
+    };
+
+    explicit UtpConnection(UtpContext& context)
+        : m_context(&context)
+        , m_loop(&context.m_loop)
+        , m_cc(context.m_options.congestion)
+        , m_rto(context.m_options.minTimeout)
+    {}
+
+    ~UtpConnection()
+    {
+        releaseBuffers();
+    }
+
+    Async::Task<void> connect(const Endpoint& remote);
+    Async::Task<size_t> read(std::span<uint8_t> buffer);
+    Async::Task<void> write(std::span<const uint8_t> data);
+    void abort(const std::string& reason, bool sendReset);
+    void releaseHandle();
+
+    void accept(const Endpoint& remote, const Utp::Header& syn, uint16_t seq, Clock::time_point now);
+    // Returns true when the connection kept the buffer (out-of-order payload).
+    bool onPacket(const Utp::Header& h, std::span<const uint8_t> sack, Utp::PacketBuffer* buffer, size_t payloadOffset,
+        Clock::time_point now);
+    void afterReceive(Clock::time_point now);
+    void onTick(Clock::time_point now);
+    void detach();
+
+    bool finished() const
+    {
+        return m_state == State::Closed;
+    }
+
+    UtpContext::Key key() const
+    {
+        return {m_remote, m_recvId};
+    }
+
+    UtpStream::Stats stats() const
+    {
+        UtpStream::Stats s;
+        s.window       = m_cc.window();
+        s.rtt          = std::chrono::duration_cast<std::chrono::microseconds>(m_rtt);
+        s.queuingDelay = m_cc.queuingDelay();
+        s.bytesAcked   = m_bytesAcked;
+        s.retransmits  = m_retransmits;
+        return s;
+    }
+
+    Endpoint m_remote;
+    bool m_touched = false;
+
+private:
+    struct OutPacket
+    {
+        Utp::PacketBuffer* buffer = nullptr;
+        uint16_t seq              = 0;
+        uint32_t payload          = 0;
+        Clock::time_point sentAt{};
+        uint8_t transmissions = 0;
+        bool acked            = false;
+        bool lost             = false;
+    };
+
+    struct Slot
+    {
+        Utp::PacketBuffer* buffer = nullptr;
+        uint16_t offset           = 0;
+        bool fin                  = false;
+    };
+
+    Utp::Header header(Utp::PacketType type, uint16_t seq, Clock::time_point now);
+    void sendPacket(Utp::PacketType type, std::span<const uint8_t> payload, Clock::time_point now);
+    void transmit(OutPacket& packet, Clock::time_point now);
+    void sendAck(Clock::time_point now);
+    void flushSend(Clock::time_point now);
+    void handleAck(const Utp::Header& h, std::span<const uint8_t> sack, Clock::time_point now);
+    void deliver(const Utp::PacketBuffer& buffer, uint16_t offset, bool fin);
+    void updateRtt(Clock::duration sample);
+    void checkClosed();
+    uint32_t receiveWindow() const;
+    void wake(std::coroutine_handle<>& slot);
+    void wakeAll();
+    void releaseBuffers();
+
+    UtpContext* m_context;
+    EventLoop* m_loop;
+    State m_state = State::Idle;
+    std::string m_error;
+    uint16_t m_recvId = 0;
+    uint16_t m_sendId = 0;
+
+    // sender
+    uint16_t m_seqNr = 1;
+    std::deque<OutPacket> m_inflight;
+    uint32_t m_flightBytes = 0;
+    uint32_t m_peerWindow  = Utp::MaxPacketSize;
+    std::string m_sendQueue;
+    size_t m_sendOffset = 0;
+    Ledbat m_cc;
+    Clock::duration m_rtt{};
+    Clock::duration m_rttVar{};
+    Clock::duration m_rto;
+    Clock::time_point m_rtoDeadline{};
+    uint32_t m_timeouts    = 0;
+    uint16_t m_lastAck     = 0;
+    uint32_t m_dupAcks     = 0;
+    uint16_t m_recoverySeq = 0;
+    bool m_haveRtt         = false;
+    bool m_inRecovery      = false;
+    bool m_finQueued       = false;
+    bool m_finSent         = false;
+    bool m_finAcked        = false;
+    uint64_t m_bytesAcked  = 0;
+    uint64_t m_retransmits = 0;
+
+    // receiver
+    uint16_t m_ackNr = 0;
+    std::array<Slot, ReorderWindow> m_reorder{};
+    uint16_t m_reorderCount = 0;
+    uint16_t m_reorderMax   = 0;
+    uint32_t m_reorderBytes = 0;
+    std::string m_recvBuffer;
+    size_t m_recvOffset   = 0;
+    uint32_t m_replyMicro = 0;
+    uint32_t m_advertised = 0;
+    bool m_ackPending     = false;
+    bool m_eof            = false;
+    bool m_hasHandle      = true;
+    Clock::time_point m_releasedAt{};
+
+    std::coroutine_handle<> m_connectWaiter;
+    std::coroutine_handle<> m_readWaiter;
+    std::coroutine_handle<> m_writeWaiter;
+};
+
+Async::Task<void> UtpConnection::connect(const Endpoint& remote)
+{
+    if (m_state != State::Idle || !m_context)
+    {
+        throw std::runtime_error("Stream already used");
+    }
+    m_remote = remote;
+    m_recvId = m_context->freeConnectionId(remote);
+    m_sendId = static_cast<uint16_t>(m_recvId + 1);
+    m_context->registerConnection(shared_from_this());
+
+    m_state = State::SynSent;
+    sendPacket(Utp::PacketType::Syn, {}, Clock::now());
+    while (m_state == State::SynSent)
+    {
+        co_await WaitSlot{m_connectWaiter};
+    }
+    if (m_state != State::Connected)
+    {
+        throw std::runtime_error(m_error);
+    }
+}
+
+void UtpConnection::accept(const Endpoint& remote, const Utp::Header& syn, uint16_t seq, Clock::time_point now)
+{
+    m_remote     = remote;
+    m_recvId     = static_cast<uint16_t>(syn.connectionId + 1);
+    m_sendId     = syn.connectionId;
+    m_seqNr      = seq;
+    m_ackNr      = syn.seq;
+    m_lastAck    = static_cast<uint16_t>(seq - 1);
+    m_state      = State::Connected;
+    m_ackPending = true;
+    m_releasedAt = now;
+}
+
+Async::Task<size_t> UtpConnection::read(std::span<uint8_t> buffer)
+{
+    while (true)
+    {
+        size_t available = m_recvBuffer.size() - m_recvOffset;
+        if (available > 0)
+        {
+            size_t n = std::min(available, buffer.size());
+            std::memcpy(buffer.data(), m_recvBuffer.data() + m_recvOffset, n);
+            m_recvOffset += n;
+            compact(m_recvBuffer, m_recvOffset);
+            // the sender may be stalled on a closed window: announce the space on the next tick
+            if (m_advertised < 4 * Utp::MaxPayload)
+            {
+                m_ackPending = true;
+            }
+            co_return n;
+        }
+        if (m_eof)
+        {
+            co_return 0;
+        }
+        if (m_state == State::Closed)
+        {
+            throw std::runtime_error(m_error);
+        }
+        if (m_state != State::Connected)
+        {
+            throw std::runtime_error("Stream not connected");
+        }
+        co_await WaitSlot{m_readWaiter};
+    }
+}
+
+Async::Task<void> UtpConnection::write(std::span<const uint8_t> data)
+{
+    size_t done = 0;
+    while (done < data.size())
+    {
+        if (m_state != State::Connected || m_finQueued)
+        {
+            throw std::runtime_error(m_state == State::Closed ? m_error : "Stream not connected");
+        }
+        size_t queued = m_sendQueue.size() - m_sendOffset;
+        size_t limit  = m_context->m_options.sendBuffer;
+        if (queued >= limit)
+        {
+            co_await WaitSlot{m_writeWaiter};
+            continue;
+        }
+        size_t n = std::min(limit - queued, data.size() - done);
+        m_sendQueue.append(reinterpret_cast<const char*>(data.data()) + done, n);
+        done += n;
+        flushSend(Clock::now());
+    }
+}
+
+void UtpConnection::abort(const std::string& reason, bool sendReset)
+{
+    if (m_state == State::Closed)
+    {
+        return;
+    }
+    if (sendReset && m_context && m_state != State::Idle)
+    {
+        m_context->sendReset(m_remote, m_sendId, m_ackNr);
+    }
+    m_state = State::Closed;
+    m_error = reason;
+    wakeAll();
+}
+
+void UtpConnection::releaseHandle()
+{
+    m_hasHandle  = false;
+    m_releasedAt = Clock::now();
+    switch (m_state)
+    {
+        case State::Idle:    m_state = State::Closed; break;
+        case State::SynSent: abort("Connection closed", true); break;
+        case State::Connected:
+            m_finQueued = true;
+            flushSend(m_releasedAt);
+            checkClosed();
+            break;
+        case State::Closed: break;
+    }
+}
+
+void UtpConnection::detach()
+{
+    releaseBuffers();
+    m_context = nullptr;
+    if (m_state != State::Closed)
+    {
+        m_state = State::Closed;
+        m_error = "uTP context destroyed";
+        wakeAll();
+    }
+}
+
+Utp::Header UtpConnection::header(Utp::PacketType type, uint16_t seq, Clock::time_point now)
+{
+    Utp::Header h;
+    h.type          = type;
+    h.connectionId  = type == Utp::PacketType::Syn ? m_recvId : m_sendId;
+    h.timestamp     = micros(now);
+    h.timestampDiff = m_replyMicro;
+    h.window        = receiveWindow();
+    h.seq           = seq;
+    h.ack           = m_ackNr;
+    m_advertised    = h.window;
+    return h;
+}
+
+void UtpConnection::sendPacket(Utp::PacketType type, std::span<const uint8_t> payload, Clock::time_point now)
+{
+    auto* buffer = m_context->m_pool.acquire();
+    buffer->size    = static_cast<uint16_t>(Utp::HeaderSize + payload.size());
+    buffer->data[0] = static_cast<uint8_t>(static_cast<uint8_t>(type) << 4);
+    std::memcpy(buffer->data.data() + Utp::HeaderSize, payload.data(), payload.size());
+
+    if (m_inflight.empty())
+    {
+        m_rtoDeadline = now + m_rto;
+    }
+    m_inflight.push_back({buffer, m_seqNr, static_cast<uint32_t>(payload.size())});
+    m_seqNr        = static_cast<uint16_t>(m_seqNr + 1);
+    m_flightBytes += static_cast<uint32_t>(payload.size());
+    transmit(m_inflight.back(), now);
+}
+
+void UtpConnection::transmit(OutPacket& packet, Clock::time_point now)
+{
+    // timestamp, window and ack are refreshed on every (re)transmission
+    auto type = static_cast<Utp::PacketType>(packet.buffer->data[0] >> 4);
+    Utp::writeHeader(header(type, packet.seq, now), packet.buffer->data.data());
+    packet.sentAt = now;
+    packet.lost   = false;
+    if (++packet.transmissions > 1)
+    {
+        ++m_retransmits;
+        ++m_context->m_stats.retransmits;
+    }
+    m_context->send(m_remote, *packet.buffer);
+    m_ackPending = false;
+}
+
+void UtpConnection::sendAck(Clock::time_point now)
+{
+    std::array<uint8_t, Utp::HeaderSize + 2 + ReorderWindow / 8> packet{};
+    auto h      = header(Utp::PacketType::State, m_seqNr, now);
+    size_t size = Utp::HeaderSize;
+    if (m_reorderCount > 0)
+    {
+        // bit i stands for ack_nr + 2 + i
+        uint16_t first   = static_cast<uint16_t>(m_ackNr + 2);
+        size_t bits      = static_cast<uint16_t>(m_reorderMax - first) + 1;
+        size_t bytes     = (bits + 31) / 32 * 4;
+        h.extension      = Utp::SelectiveAckExtension;
+        packet[size]     = 0;
+        packet[size + 1] = static_cast<uint8_t>(bytes);
+        for (size_t i = 0; i < bits; ++i)
+        {
+            if (m_reorder[static_cast<uint16_t>(first + i) % ReorderWindow].buffer)
+            {
+                packet[size + 2 + i / 8] |= static_cast<uint8_t>(1 << (i % 8));
+            }
+        }
+        size += 2 + bytes;
+    }
+    Utp::writeHeader(h, packet.data());
+
+    Utp::PacketBuffer* buffer = m_context->m_pool.acquire();
+    std::memcpy(buffer->data.data(), packet.data(), size);
+    buffer->size = static_cast<uint16_t>(size);
+    m_context->send(m_remote, *buffer);
+    m_context->m_pool.release(buffer);
+    m_ackPending = false;
+}
+
+void UtpConnection::flushSend(Clock::time_point now)
+{
+    if (m_state != State::Connected)
+    {
+        return;
+    }
+
+    while (m_sendOffset < m_sendQueue.size() && m_inflight.size() < MaxInflight)
+    {
+        size_t n        = std::min(m_sendQueue.size() - m_sendOffset, Utp::MaxPayload);
+        uint32_t window = std::min(m_cc.window(), m_peerWindow);
+        // with nothing in flight one packet always goes out, which doubles as a zero-window probe
+        if (m_flightBytes > 0 && m_flightBytes + n > window)
+        {
+            break;
+        }
+        auto* data = reinterpret_cast<const uint8_t*>(m_sendQueue.data()) + m_sendOffset;
+        sendPacket(Utp::PacketType::Data, {data, n}, now);
+        m_sendOffset += n;
+    }
+    compact(m_sendQueue, m_sendOffset);
+
+    if (m_finQueued && !m_finSent && m_sendQueue.empty() && m_inflight.size() < MaxInflight)
+    {
+        sendPacket(Utp::PacketType::Fin, {}, now);
+        m_finSent = true;
+    }
+    if (m_writeWaiter && m_sendQueue.size() - m_sendOffset < m_context->m_options.sendBuffer)
+    {
+        wake(m_writeWaiter);
+    }
+}
+
+bool UtpConnection::onPacket(const Utp::Header& h, std::span<const uint8_t> sack, Utp::PacketBuffer* buffer,
+    size_t payloadOffset, Clock::time_point now)
+{
+    if (m_state == State::Closed)
+    {
+        return false;
+    }
+    m_replyMicro = micros(now) - h.timestamp;
+    m_peerWindow = h.window;
+
+    if (h.type == Utp::PacketType::Reset)
+    {
+        abort("Connection reset by peer", false);
+        return false;
+    }
+    if (h.type == Utp::PacketType::Syn)
+    {
+        // our SYN-ACK was lost
+        m_ackPending = true;
+        return false;
+    }
+    if (m_state == State::SynSent)
+    {
+        // the SYN-ACK does not consume a sequence number: the peer's first data packet carries h.seq
+        m_ackNr = static_cast<uint16_t>(h.seq - 1);
+        m_state = State::Connected;
+        wake(m_connectWaiter);
+    }
+
+    handleAck(h, sack, now);
+    if (m_state == State::Closed || (h.type != Utp::PacketType::Data && h.type != Utp::PacketType::Fin))
+    {
+        return false;
+    }
+
+    m_ackPending      = true;
+    uint16_t expected = static_cast<uint16_t>(m_ackNr + 1);
+    uint16_t distance = static_cast<uint16_t>(h.seq - expected);
+    if (Utp::seqLess(h.seq, expected) || distance >= ReorderWindow || (m_eof && h.seq != expected))
+    {
+        return false;
+    }
+
+    bool fin = h.type == Utp::PacketType::Fin;
+    if (distance > 0)
+    {
+        auto& slot = m_reorder[h.seq % ReorderWindow];
+        if (slot.buffer)
+        {
+            return false;
+        }
+        slot = {buffer, static_cast<uint16_t>(payloadOffset), fin};
+        if (m_reorderCount++ == 0 || Utp::seqLess(m_reorderMax, h.seq))
+        {
+            m_reorderMax = h.seq;
+        }
+        m_reorderBytes += static_cast<uint32_t>(buffer->size - payloadOffset);
+        return true;
+    }
+
+    deliver(*buffer, static_cast<uint16_t>(payloadOffset), fin);
+    m_ackNr = h.seq;
+    while (m_reorderCount > 0 && !m_eof)
+    {
+        auto& slot = m_reorder[static_cast<uint16_t>(m_ackNr + 1) % ReorderWindow];
+        if (!slot.buffer)
+        {
+            break;
+        }
+        m_reorderBytes -= static_cast<uint32_t>(slot.buffer->size - slot.offset);
+        deliver(*slot.buffer, slot.offset, slot.fin);
+        m_context->m_pool.release(slot.buffer);
+        slot = {};
+        --m_reorderCount;
+        m_ackNr = static_cast<uint16_t>(m_ackNr + 1);
+    }
+    wake(m_readWaiter);
+    checkClosed();
+    return false;
+}
+
+void UtpConnection::deliver(const Utp::PacketBuffer& buffer, uint16_t offset, bool fin)
+{
+    if (fin)
+    {
+        m_eof = true;
+        return;
+    }
+    m_recvBuffer.append(reinterpret_cast<const char*>(buffer.data.data()) + offset, buffer.size - offset);
+}
+
+void UtpConnection::handleAck(const Utp::Header& h, std::span<const uint8_t> sack, Clock::time_point now)
+{
+    // ignore acks for packets never sent
+    if (m_inflight.empty() || Utp::seqLess(static_cast<uint16_t>(m_seqNr - 1), h.ack))
+    {
+        return;
+    }
+
+    uint32_t flightBefore = m_flightBytes;
+    uint32_t acked        = 0;
+    bool progress         = false;
+    auto ackOne           = [&](OutPacket& p)
+    {
+        if (p.acked)
+        {
+            return;
+        }
+        p.acked        = true;
+        acked         += p.payload;
+        m_flightBytes -= p.payload;
+        m_bytesAcked  += p.payload;
+        if (p.transmissions == 1)
+        {
+            updateRtt(now - p.sentAt);
+        }
+        if (static_cast<Utp::PacketType>(p.buffer->data[0] >> 4) == Utp::PacketType::Fin)
+        {
+            m_finAcked = true;
+        }
+    };
+
+    while (!m_inflight.empty() && !Utp::seqLess(h.ack, m_inflight.front().seq))
+    {
+        ackOne(m_inflight.front());
+        m_context->m_pool.release(m_inflight.front().buffer);
+        m_inflight.pop_front();
+        progress = true;
+    }
+
+    bool lost = false;
+    if (!sack.empty())
+    {
+        uint16_t first = static_cast<uint16_t>(h.ack + 2);
+        for (auto& p : m_inflight)
+        {
+            size_t bit = static_cast<uint16_t>(p.seq - first);
+            if (bit < sack.size() * 8 && (sack[bit / 8] >> (bit % 8)) & 1)
+            {
+                ackOne(p);
+            }
+        }
+        // a packet with three or more selectively acked packets after it is treated as lost
+        size_t ackedAfter = 0;
+        for (auto it = m_inflight.rbegin(); it != m_inflight.rend(); ++it)
+        {
+            if (it->acked)
+            {
+                ++ackedAfter;
+            }
+            else if (ackedAfter >= 3 && (it->transmissions == 1 || now - it->sentAt > m_rtt))
+            {
+                it->lost = true;
+                lost     = true;
+            }
+        }
+    }
+
+    if (progress)
+    {
+        m_dupAcks     = 0;
+        m_timeouts    = 0;
+        m_rtoDeadline = now + m_rto;
+    }
+    else if (h.type == Utp::PacketType::State && h.ack == m_lastAck && acked == 0 && ++m_dupAcks == 3)
+    {
+        m_inflight.front().lost = true;
+        lost                    = true;
+    }
+    m_lastAck = h.ack;
+
+    if (acked > 0)
+    {
+        m_cc.onAck(acked, h.timestampDiff, flightBefore, now);
+    }
+    if (m_inRecovery && !Utp::seqLess(h.ack, m_recoverySeq))
+    {
+        m_inRecovery = false;
+    }
+    if (lost)
+    {
+        // one window reduction per round trip of losses
+        if (!m_inRecovery)
+        {
+            m_cc.onLoss();
+            m_inRecovery  = true;
+            m_recoverySeq = static_cast<uint16_t>(m_seqNr - 1);
+        }
+        for (auto& p : m_inflight)
+        {
+            if (p.lost && !p.acked)
+            {
+                transmit(p, now);
+            }
+        }
+    }
+    checkClosed();
+}
+
+void UtpConnection::updateRtt(Clock::duration sample)
+{
+    if (!m_haveRtt)
+    {
+        m_rtt     = sample;
+        m_rttVar  = sample / 2;
+        m_haveRtt = true;
+    }
+    else
+    {
+        auto delta = sample > m_rtt ? sample - m_rtt : m_rtt - sample;
+        m_rttVar  += (delta - m_rttVar) / 4;
+        m_rtt     += (sample - m_rtt) / 8;
+    }
+    m_rto = std::max<Clock::duration>(m_rtt + 4 * m_rttVar, m_context->m_options.minTimeout);
+}
+
+void UtpConnection::checkClosed()
+{
+    // both FINs are through: nothing left to deliver in either direction
+    if (m_state == State::Connected && m_finAcked && m_eof)
+    {
+        m_state = State::Closed;
+        m_error = "Connection closed";
+        wakeAll();
+    }
+}
+
+void UtpConnection::afterReceive(Clock::time_point now)
+{
+    if (m_state == State::Closed)
+    {
+        return;
+    }
+    bool needAck = m_ackPending;
+    flushSend(now);
+    // data packets carry the cumulative ack but never the selective one
+    if (needAck && (m_ackPending || m_reorderCount > 0))
+    {
+        sendAck(now);
+    }
+}
+
+void UtpConnection::onTick(Clock::time_point now)
+{
+    if (m_state == State::Closed)
+    {
+        return;
+    }
+    if (!m_hasHandle && now - m_releasedAt > m_context->m_options.lingerTimeout)
+    {
+        abort("Linger timeout", true);
+        return;
+    }
+
+    if (!m_inflight.empty() && now >= m_rtoDeadline)
+    {
+        ++m_context->m_stats.timeouts;
+        if (++m_timeouts > m_context->m_options.maxTimeouts)
+        {
+            abort(m_state == State::SynSent ? "uTP connect timed out" : "uTP connection timed out", true);
+            return;
+        }
+        m_cc.onTimeout();
+        m_inRecovery = false;
+        m_rto        = std::min<Clock::duration>(m_rto * 2, MaxTimeout);
+        for (auto& p : m_inflight)
+        {
+            if (!p.acked)
+            {
+                transmit(p, now);
+                break;
+            }
+        }
+        m_rtoDeadline = now + m_rto;
+    }
+
+    if (m_ackPending && m_state == State::Connected)
+    {
+        sendAck(now);
+    }
+    flushSend(now);
+}
+
+uint32_t UtpConnection::receiveWindow() const
+{
+    size_t buffered = m_recvBuffer.size() - m_recvOffset + m_reorderBytes;
+    size_t window   = m_context ? m_context->m_options.receiveWindow : 0;
+    return buffered >= window ? 0 : static_cast<uint32_t>(window - buffered);
+}
+
+void UtpConnection::wake(std::coroutine_handle<>& slot)
+{
+    // resumed from the loop's queue so a woken coroutine never re-enters the packet path
+    if (auto h = std::exchange(slot, nullptr))
+    {
+        m_loop->post([h] { h.resume(); });
+    }
+}
+
+void UtpConnection::wakeAll()
+{
+    wake(m_connectWaiter);
+    wake(m_readWaiter);
+    wake(m_writeWaiter);
+}
+
+void UtpConnection::releaseBuffers()
+{
+    if (!m_context)
+    {
+        return;
+    }
+    for (auto& p : m_inflight)
+    {
+        m_context->m_pool.release(p.buffer);
+    }
+    m_inflight.clear();
+    for (auto& slot : m_reorder)
+    {
+        if (slot.buffer)
+        {
+            m_context->m_pool.release(slot.buffer);
+            slot = {};
+        }
+    }
+    m_reorderCount = 0;
+}
+
+UtpStream::UtpStream(std::shared_ptr<UtpConnection> connection)
+    : m_connection(std::move(connection))
+{}
+
+UtpStream::~UtpStream()
+{
+    m_connection->releaseHandle();
+}
+
+Async::Task<void> UtpStream::connect(const Endpoint& remote)
+{
+    return m_connection->connect(remote);
+}
+
+Async::Task<size_t> UtpStream::read(std::span<uint8_t> buffer)
+{
+    return m_connection->read(buffer);
+}
+
+Async::Task<void> UtpStream::write(std::span<const uint8_t> data)
+{
+    return m_connection->write(data);
+}
+
+void UtpStream::close()
+{
+    m_connection->abort("Connection closed", true);
+}
+
+Endpoint UtpStream::remote() const
+{
+    return m_connection->m_remote;
+}
+
+UtpStream::Stats UtpStream::stats() const
+{
+    return m_connection->stats();
+}
+
+UtpContext::UtpContext(EventLoop& loop, const Endpoint& bindTo)
+    : UtpContext(loop, bindTo, Options{})
+{}
+
+UtpContext::UtpContext(EventLoop& loop, const Endpoint& bindTo, Options options)
+    : m_loop(loop)
+    , m_socket(bindTo)
+    , m_options(options)
+    , m_rng(std::random_device{}())
+{
+    m_loop.add(m_socket.fd(), EPOLLIN, [this](uint32_t) { onReadable(); });
+    m_tick = m_loop.runEvery(m_options.tickInterval, [this] { onTick(); });
+}
+
+UtpContext::~UtpContext()
+{
+    m_loop.cancel(m_tick);
+    m_loop.remove(m_socket.fd());
+    for (auto& [key, connection] : m_connections)
+    {
+        connection->detach();
+    }
+}
+
+std::unique_ptr<UtpStream> UtpContext::createStream()
+{
+    return std::unique_ptr<UtpStream>(new UtpStream(std::make_shared<UtpConnection>(*this)));
+}
+
+StreamFactory UtpContext::streamFactory()
+{
+    return [this] { return std::unique_ptr<Stream>(createStream()); };
+}
+
+void UtpContext::listen(AcceptHandler onAccept)
+{
+    m_onAccept = std::move(onAccept);
+}
+
+UtpContext::Stats UtpContext::stats() const
+{
+    Stats s            = m_stats;
+    s.connections      = m_connections.size();
+    s.packetsAllocated = m_pool.allocated();
+    return s;
+}
+
+void UtpContext::registerConnection(const std::shared_ptr<UtpConnection>& connection)
+{
+    m_connections[connection->key()] = connection;
+}
+
+uint16_t UtpContext::freeConnectionId(const Endpoint& remote)
+{
+    while (true)
+    {
+        auto id = static_cast<uint16_t>(m_rng());
+        if (!m_connections.contains({remote, id}) && !m_connections.contains({remote, static_cast<uint16_t>(id + 1)}))
+        {
+            return id;
+        }
+    }
+}
+
+void UtpContext::send(const Endpoint& to, const Utp::PacketBuffer& packet)
+{
+    m_socket.sendTo(to, {packet.data.data(), packet.size});
+    ++m_stats.packetsSent;
+}
+
+void UtpContext::sendReset(const Endpoint& to, uint16_t connectionId, uint16_t ack)
+{
+    Utp::Header h;
+    h.type         = Utp::PacketType::Reset;
+    h.connectionId = connectionId;
+    h.timestamp    = micros(Clock::now());
+    h.seq          = static_cast<uint16_t>(m_rng());
+    h.ack          = ack;
+    std::array<uint8_t, Utp::HeaderSize> packet;
+    Utp::writeHeader(h, packet.data());
+    m_socket.sendTo(to, packet);
+    ++m_stats.packetsSent;
+}
+
+void UtpContext::onReadable()
+{
+    auto now = Clock::now();
+    for (size_t i = 0; i < MaxBatch; ++i)
+    {
+        auto* buffer = m_pool.acquire();
+        Endpoint from;
+        ssize_t n = m_socket.receiveFrom(from, buffer->data);
+        if (n < 0)
+        {
+            m_pool.release(buffer);
+            break;
+        }
+        ++m_stats.packetsReceived;
+        buffer->size = static_cast<uint16_t>(n);
+
+        Utp::Header h;
+        std::span<const uint8_t> sack;
+        size_t payloadOffset = 0;
+        if (!Utp::readPacket({buffer->data.data(), static_cast<size_t>(n)}, h, sack, payloadOffset))
+        {
+            m_pool.release(buffer);
+            continue;
+        }
+
+        std::shared_ptr<UtpConnection> connection;
+        uint16_t id = h.type == Utp::PacketType::Syn ? static_cast<uint16_t>(h.connectionId + 1) : h.connectionId;
+        if (auto it = m_connections.find({from, id}); it != m_connections.end())
+        {
+            connection = it->second;
+        }
+        else if (h.type == Utp::PacketType::Syn && m_onAccept)
+        {
+            connection = std::make_shared<UtpConnection>(*this);
+            connection->accept(from, h, static_cast<uint16_t>(m_rng()), now);
+            registerConnection(connection);
+            m_onAccept(std::unique_ptr<UtpStream>(new UtpStream(connection)));
+        }
+
+        if (!connection)
+        {
+            if (h.type != Utp::PacketType::Reset)
+            {
+                sendReset(from, h.connectionId, h.seq);
+            }
+            m_pool.release(buffer);
+            continue;
+        }
+
+        if (!connection->onPacket(h, sack, buffer, payloadOffset, now))
+        {
+            m_pool.release(buffer);
+        }
+        if (!connection->m_touched)
+        {
+            connection->m_touched = true;
+            m_touched.push_back(std::move(connection));
+        }
+    }
+
+    for (auto& connection : m_touched)
+    {
+        connection->m_touched = false;
+        connection->afterReceive(now);
+    }
+    m_touched.clear();
+}
+
+void UtpContext::onTick()
+{
+    auto now = Clock::now();
+    for (auto& [key, connection] : m_connections)
+    {
+        connection->onTick(now);
+    }
+    std::erase_if(m_connections, [](const auto& entry) { return entry.second->finished(); });
+}
+
+}  // namespace Torrent::Net
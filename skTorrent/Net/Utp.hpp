@@ -0,0 +1,143 @@
+#ifndef UTP_HPP
+#define UTP_HPP
+
+#include "EventLoop.hpp"
+#include "Ledbat.hpp"
+#include "Stream.hpp"
+#include "UdpSocket.hpp"
+#include "UtpPacket.hpp"
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+namespace Torrent::Net {
+
+class UtpConnection;
+class UtpContext;
+
+// Handle to one uTP connection. Dropping it closes gracefully: queued data is still delivered, then a FIN is
+// sent and the connection lingers inside the context until that is acknowledged.
+class UtpStream: public Stream
+{
+public:
+    struct Stats
+    {
+        uint32_t window = 0;
+        std::chrono::microseconds rtt{0};
+        std::chrono::microseconds queuingDelay{0};
+        uint64_t bytesAcked  = 0;
+        uint64_t retransmits = 0;
+    };
+
+    ~UtpStream() override;
+
+    Async::Task<void> connect(const Endpoint& remote) override;
+    Async::Task<size_t> read(std::span<uint8_t> buffer) override;
+    Async::Task<void> write(std::span<const uint8_t> data) override;
+    // Aborts with a RESET; pending operations throw.
+    void close() override;
+    std::optional<Endpoint> remoteEndpoint() const override
+    {
+        return remote();
+    }
+
+    Endpoint remote() const;
+    Stats stats() const;
+
+private:
+    friend class UtpContext;
+
+    explicit UtpStream(std::shared_ptr<UtpConnection> connection);
+
+    std::shared_ptr<UtpConnection> m_connection;
+};
+
+// BEP 29 endpoint: every uTP connection of the process multiplexes over this one UDP socket. Packets read in
+// one readable event are processed as a batch and acknowledged once per connection, with selective ACKs
+// describing out-of-order arrivals. Must be created, used and destroyed on the loop thread (or before it runs).
+class UtpContext
+{
+public:
+    struct Options
+    {
+        Ledbat::Options congestion;
+        std::chrono::milliseconds minTimeout{500};
+        std::chrono::milliseconds tickInterval{20};
+        std::chrono::milliseconds lingerTimeout{10'000};
+        uint32_t maxTimeouts   = 6;
+        uint32_t receiveWindow = 1 << 20;
+        size_t sendBuffer      = 1 << 20;
+    };
+
+    struct Stats
+    {
+        uint64_t packetsSent     = 0;
+        uint64_t packetsReceived = 0;
+        uint64_t retransmits     = 0;
+        uint64_t timeouts        = 0;
+        size_t connections       = 0;
+        size_t packetsAllocated  = 0;
+    };
+
+    using AcceptHandler = std::function<void(std::unique_ptr<UtpStream>)>;
+
+    UtpContext(EventLoop& loop, const Endpoint& bindTo);
+    UtpContext(EventLoop& loop, const Endpoint& bindTo, Options options);
+    ~UtpContext();
+    UtpContext(const UtpContext&) = delete;
+
+    std::unique_ptr<UtpStream> createStream();
+    StreamFactory streamFactory();
+    void listen(AcceptHandler onAccept);
+
+    const Endpoint& localEndpoint() const
+    {
+        return m_socket.localEndpoint();
+    }
+
+    Stats stats() const;
+
+private:
+    friend class UtpConnection;
+
+    struct Key
+    {
+        Endpoint remote;
+        uint16_t connectionId;
+
+        bool operator==(const Key&) const = default;
+    };
+
+    struct KeyHash
+    {
+        size_t operator()(const Key& k) const
+        {
+            return hashEndpoint(k.remote) ^ (static_cast<uint64_t>(k.connectionId) * 0x9e3779b97f4a7c15ULL);
+        }
+    };
+
+    void onReadable();
+    void onTick();
+    void send(const Endpoint& to, const Utp::PacketBuffer& packet);
+    void sendReset(const Endpoint& to, uint16_t connectionId, uint16_t ack);
+    void registerConnection(const std::shared_ptr<UtpConnection>& connection);
+    uint16_t freeConnectionId(const Endpoint& remote);
+
+    EventLoop& m_loop;
+    UdpSocket m_socket;
+    Options m_options;
+    Utp::PacketPool m_pool;
+    std::unordered_map<Key, std::shared_ptr<UtpConnection>, KeyHash> m_connections;
+    std::vector<std::shared_ptr<UtpConnection>> m_touched;
+    AcceptHandler m_onAccept;
+    EventLoop::TimerId m_tick = 0;
+    std::mt19937 m_rng;
+    Stats m_stats;
+};
+
+}  // namespace Torrent::Net
+#endif  // UTP_HPP
@@ -0,0 +1,177 @@
+#ifndef UTPPACKET_HPP
+#define UTPPACKET_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <utility>
+
+namespace Torrent::Net::Utp {
+
+enum class PacketType : uint8_t
+{
+    Data  = 0,
+    Fin   = 1,
+    State = 2,
+    Reset = 3,
+    Syn   = 4
+};
+
+constexpr uint8_t Version               = 1;
+constexpr uint8_t SelectiveAckExtension = 1;
+constexpr size_t HeaderSize             = 20;
+constexpr size_t MaxPacketSize          = 1'400;
+constexpr size_t MaxPayload             = MaxPacketSize - HeaderSize;
+constexpr size_t BufferSize             = 1'500;
+
+struct Header
+{
+    PacketType type        = PacketType::Data;
+    uint8_t extension      = 0;
+    uint16_t connectionId  = 0;
+    uint32_t timestamp     = 0;  // microseconds, sender's clock
+    uint32_t timestampDiff = 0;  // sender's receive time minus our last timestamp
+    uint32_t window        = 0;
+    uint16_t seq           = 0;
+    uint16_t ack           = 0;
+};
+
+// Sequence numbers wrap at 16 bits.
+inline bool seqLess(uint16_t a, uint16_t b)
+{
+    return static_cast<int16_t>(a - b) < 0;
+}
+
+inline void writeHeader(const Header& h, uint8_t* out)
+{
+    auto put16 = [&](size_t at, uint16_t v)
+    {
+        out[at]     = static_cast<uint8_t>(v >> 8);
+        out[at + 1] = static_cast<uint8_t>(v);
+    };
+    auto put32 = [&](size_t at, uint32_t v)
+    {
+        put16(at, static_cast<uint16_t>(v >> 16));
+        put16(at + 2, static_cast<uint16_t>(v));
+    };
+    out[0] = static_cast<uint8_t>((static_cast<uint8_t>(h.type) << 4) | Version);
+    out[1] = h.extension;
+    put16(2, h.connectionId);
+    put32(4, h.timestamp);
+    put32(8, h.timestampDiff);
+    put32(12, h.window);
+    put16(16, h.seq);
+    put16(18, h.ack);
+}
+
+// Parses the header and walks the extension chain; sack stays empty when the packet carries none.
+inline bool readPacket(std::span<const uint8_t> packet, Header& h, std::span<const uint8_t>& sack, size_t& payloadOffset)
+{
+    if (packet.size() < HeaderSize || (packet[0] & 0x0f) != Version || (packet[0] >> 4) > 4)
+    {
+        return false;
+    }
+    auto get16 = [&](size_t at) { return static_cast<uint16_t>((packet[at] << 8) | packet[at + 1]); };
+    auto get32 = [&](size_t at) { return (static_cast<uint32_t>(get16(at)) << 16) | get16(at + 2); };
+
+    h.type          = static_cast<PacketType>(packet[0] >> 4);
+    h.extension     = packet[1];
+    h.connectionId  = get16(2);
+    h.timestamp     = get32(4);
+    h.timestampDiff = get32(8);
+    h.window        = get32(12);
+    h.seq           = get16(16);
+    h.ack           = get16(18);
+
+    sack        = {};
+    size_t pos  = HeaderSize;
+    uint8_t ext = h.extension;
+    while (ext != 0)
+    {
+        if (pos + 2 > packet.size() || pos + 2 + packet[pos + 1] > packet.size())
+        {
+            return false;
+        }
+        uint8_t next = packet[pos];
+        uint8_t len  = packet[pos + 1];
+        if (ext == SelectiveAckExtension)
+        {
+            sack = packet.subspan(pos + 2, len);
+        }
+        pos += 2 + len;
+        ext  = next;
+    }
+    payloadOffset = pos;
+    return true;
+}
+
+struct PacketBuffer
+{
+    PacketBuffer* next = nullptr;
+    uint16_t size      = 0;
+    std::array<uint8_t, BufferSize> data;
+};
+
+// Free list of datagram buffers shared by every connection of a context; nothing on the data path allocates
+// once the pool has warmed up.
+class PacketPool
+{
+public:
+    static constexpr size_t MaxCached = 1'024;
+
+    PacketPool()                  = default;
+    PacketPool(const PacketPool&) = delete;
+
+    ~PacketPool()
+    {
+        while (m_free)
+        {
+            delete std::exchange(m_free, m_free->next);
+        }
+    }
+
+    PacketBuffer* acquire()
+    {
+        if (m_free)
+        {
+            --m_cached;
+            auto* buffer = std::exchange(m_free, m_free->next);
+            buffer->size = 0;
+            return buffer;
+        }
+        ++m_allocated;
+        return new PacketBuffer;
+    }
+
+    void release(PacketBuffer* buffer)
+    {
+        if (m_cached >= MaxCached)
+        {
+            --m_allocated;
+            delete buffer;
+            return;
+        }
+        buffer->next = m_free;
+        m_free       = buffer;
+        ++m_cached;
+    }
+
+    size_t allocated() const
+    {
+        return m_allocated;
+    }
+
+    size_t cached() const
+    {
+        return m_cached;
+    }
+
+private:
+    PacketBuffer* m_free = nullptr;
+    size_t m_allocated   = 0;
+    size_t m_cached      = 0;
+};
+
+}  // namespace Torrent::Net::Utp
+#endif  // UTPPACKET_HPP
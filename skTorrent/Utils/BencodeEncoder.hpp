@@ -0,0 +1,74 @@
+#ifndef BENCODEENCODER_HPP
+#define BENCODEENCODER_HPP
+
+#include "BencodeParser.hpp"
+
+#include <charconv>
+#include <string>
+#include <string_view>
+
+namespace Torrent::Utils::Bencode {
+
+inline void encodeInt(int64_t v, std::string& out)
+{
+    char buf[24];
+    auto [ptr, ec] = std::to_chars(buf, buf + sizeof(buf), v);
+    out.push_back('i');
+    out.append(buf, ptr);
+    out.push_back('e');
+}
+
+inline void encodeString(std::string_view s, std::string& out)
+{
+    char buf[24];
+    auto [ptr, ec] = std::to_chars(buf, buf + sizeof(buf), s.size());
+    out.append(buf, ptr);
+    out.push_back(':');
+    out.append(s);
+}
+
+inline void encode(const Value& value, std::string& out)
+{
+    if (value.isInt())
+    {
+        char buf[24];
+        auto [ptr, ec] = std::to_chars(buf, buf + sizeof(buf), value.asInt());
+        out.push_back('i');
+        out.append(buf, ptr);
+        out.push_back('e');
+    }
+    else if (value.isStr())
+    {
+        encodeString(value.asStr(), out);
+    }
+    else if (value.isList())
+    {
+        out.push_back('l');
+        for (const auto& item : value.asList())
+        {
+            encode(item, out);
+        }
+        out.push_back('e');
+    }
+    else
+    {
+        // std::map keeps keys in the sorted order bencode requires
+        out.push_back('d');
+        for (const auto& [key, item] : value.asDict())
+        {
+            encodeString(key, out);
+            encode(item, out);
+        }
+        out.push_back('e');
+    }
+}
+
+inline std::string encode(const Value& value)
+{
+    std::string out;
+    encode(value, out);
+    return out;
+}
+
+}  // namespace Torrent::Utils::Bencode
+#endif  // BENCODEENCODER_HPP
@@ -7,6 +7,10 @@
 #include <stdexcept>
 #include <cstdint>
 #include <cctype>
+#include <string_view>
+#include <charconv>
+
+#include <Metrics/Trace.hpp>
 
 namespace Torrent::Utils::Bencode {
 struct Value;
@@ -69,6 +73,7 @@ public:
 
     Value parse()
     {
+        TRACE_SCOPE("Bencode::Parser::parse");
         return parseValue();
     }
 
@@ -183,5 +188,124 @@ private:
     }
 };
 
+// Zero-copy helpers: operate on raw bencoded bytes and hand out views into the input buffer.
+inline size_t skipValue(std::string_view data, size_t pos, int depth = 0)
+{
+    if (pos >= data.size())
+    {
+        throw std::runtime_error("Unexpected end of data");
+    }
+    if (depth > 64)
+    {
+        throw std::runtime_error("Nesting too deep");
+    }
+
+    char c = data[pos];
+    if (c == 'i')
+    {
+        size_t end = data.find('e', pos);
+        if (end == std::string_view::npos)
+        {
+            throw std::runtime_error("Unterminated integer");
+        }
+        return end + 1;
+    }
+    if (c == 'l' || c == 'd')
+    {
+        ++pos;
+        while (pos < data.size() && data[pos] != 'e')
+        {
+            if (c == 'd')
+            {
+                pos = skipValue(data, pos, depth + 1);
+            }
+            pos = skipValue(data, pos, depth + 1);
+        }
+        if (pos >= data.size())
+        {
+            throw std::runtime_error("Unterminated container");
+        }
+        return pos + 1;
+    }
+    if (std::isdigit(static_cast<unsigned char>(c)))
+    {
+        size_t len     = 0;
+        auto [ptr, ec] = std::from_chars(data.data() + pos, data.data() + data.size(), len);
+        if (ec != std::errc{} || ptr == data.data() + data.size() || *ptr != ':')
+        {
+            throw std::runtime_error("Expected ':' in string");
+        }
+        size_t start = static_cast<size_t>(ptr - data.data()) + 1;
+        if (len > data.size() - start)
+        {
+            throw std::runtime_error("String out of range");
+        }
+        return start + len;
+    }
+    throw std::runtime_error(std::string("Unexpected character: ") + c);
+}
+
+inline std::string_view stringView(std::string_view raw)
+{
+    size_t colon = raw.find(':');
+    if (raw.empty() || !std::isdigit(static_cast<unsigned char>(raw[0])) || colon == std::string_view::npos)
+    {
+        throw std::runtime_error("Expected bencoded string");
+    }
+    return raw.substr(colon + 1);
+}
+
+inline int64_t intValue(std::string_view raw)
+{
+    if (raw.size() < 3 || raw.front() != 'i' || raw.back() != 'e')
+    {
+        throw std::runtime_error("Expected bencoded integer");
+    }
+    int64_t v      = 0;
+    auto [ptr, ec] = std::from_chars(raw.data() + 1, raw.data() + raw.size() - 1, v);
+    if (ec != std::errc{} || ptr != raw.data() + raw.size() - 1)
+    {
+        throw std::runtime_error("Invalid bencoded integer");
+    }
+    return v;
+}
+
+class DictScanner
+{
+public:
+    explicit DictScanner(std::string_view data)
+        : m_data(data)
+    {
+        if (m_data.empty() || m_data[0] != 'd')
+        {
+            throw std::runtime_error("Expected dictionary");
+        }
+        m_pos = 1;
+    }
+
+    // Returns false once the closing 'e' is reached; key is the decoded key, value the raw encoded value.
+    bool next(std::string_view& key, std::string_view& value)
+    {
+        if (m_pos >= m_data.size())
+        {
+            throw std::runtime_error("Unterminated dictionary");
+        }
+        if (m_data[m_pos] == 'e')
+        {
+            return false;
+        }
+        size_t keyEnd = skipValue(m_data, m_pos);
+        key           = stringView(m_data.substr(m_pos, keyEnd - m_pos));
+        size_t valEnd = skipValue(m_data, keyEnd);
+        value         = m_data.substr(keyEnd, valEnd - keyEnd);
+        m_pos         = valEnd;
+        return true;
+    }
+
+private:
+    std::string_view m_data;
+    size_t m_pos = 0;
+};
+
 }  // namespace Torrent::Utils::Bencode
 #endif  // BENCODEPARSER_HPP
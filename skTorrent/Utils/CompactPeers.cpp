@@ -0,0 +1,49 @@
+#include "CompactPeers.hpp"
+
+#include <stdexcept>
+
+namespace Torrent::Utils {
+
+namespace {
+template <size_t AddrLen>
+size_t decodeCompact(std::string_view blob, std::vector<Net::Endpoint>& out)
+{
+    constexpr size_t stride = AddrLen + 2;
+    if (blob.size() % stride != 0)
+    {
+        throw std::runtime_error("Compact peer list has invalid length");
+    }
+
+    const size_t count = blob.size() / stride;
+    const size_t base  = out.size();
+    out.resize(base + count);
+
+    const auto* p = reinterpret_cast<const uint8_t*>(blob.data());
+    auto* dst     = out.data() + base;
+    for (size_t i = 0; i < count; ++i, p += stride)
+    {
+        uint16_t port = static_cast<uint16_t>((p[AddrLen] << 8) | p[AddrLen + 1]);
+        if constexpr (AddrLen == 4)
+        {
+            dst[i] = Net::Endpoint::fromV4(p, port);
+        }
+        else
+        {
+            dst[i] = Net::Endpoint::fromV6(p, port);
+        }
+    }
+    return count;
+}
+}  // namespace
+
+size_t decodeCompactPeers4(std::string_view blob, std::vector<Net::Endpoint>& out)
+{
+    return decodeCompact<4>(blob, out);
+}
+
+size_t decodeCompactPeers6(std::string_view blob, std::vector<Net::Endpoint>& out)
+{
+    return decodeCompact<16>(blob, out);
+}
+
+}  // namespace Torrent::Utils
@@ -0,0 +1,16 @@
+#ifndef COMPACTPEERS_HPP
+#define COMPACTPEERS_HPP
+
+#include <Net/Endpoint.hpp>
+
+#include <string_view>
+#include <vector>
+
+namespace Torrent::Utils {
+
+// BEP 23 (6 bytes per peer) and BEP 7 (18 bytes per peer) blobs, appended to out. Returns number decoded.
+size_t decodeCompactPeers4(std::string_view blob, std::vector<Net::Endpoint>& out);
+size_t decodeCompactPeers6(std::string_view blob, std::vector<Net::Endpoint>& out);
+
+}  // namespace Torrent::Utils
+#endif  // COMPACTPEERS_HPP
@@ -0,0 +1,201 @@
+#include "MagnetUri.hpp"
+
+#include <charconv>
+#include <stdexcept>
+
+namespace Torrent::Utils {
+
+namespace {
+int hexDigit(char c)
+{
+    if (c >= '0' && c <= '9')
+    {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f')
+    {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F')
+    {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+std::string decodeHexHash(std::string_view hex)
+{
+    std::string out(20, '\0');
+    for (size_t i = 0; i < 20; ++i)
+    {
+        int hi = hexDigit(hex[2 * i]);
+        int lo = hexDigit(hex[2 * i + 1]);
+        if (hi < 0 || lo < 0)
+        {
+            throw std::runtime_error("Invalid hex info hash in magnet link");
+        }
+        out[i] = static_cast<char>((hi << 4) | lo);
+    }
+    return out;
+}
+
+std::string decodeBase32Hash(std::string_view b32)
+{
+    std::string out;
+    out.reserve(20);
+    uint32_t buffer = 0;
+    int bits        = 0;
+    for (char c : b32)
+    {
+        int v = -1;
+        if (c >= 'A' && c <= 'Z')
+        {
+            v = c - 'A';
+        }
+        else if (c >= 'a' && c <= 'z')
+        {
+            v = c - 'a';
+        }
+        else if (c >= '2' && c <= '7')
+        {
+            v = c - '2' + 26;
+        }
+        if (v < 0)
+        {
+            throw std::runtime_error("Invalid base32 info hash in magnet link");
+        }
+        buffer  = (buffer << 5) | static_cast<uint32_t>(v);
+        bits   += 5;
+        if (bits >= 8)
+        {
+            bits -= 8;
+            out.push_back(static_cast<char>((buffer >> bits) & 0xff));
+        }
+    }
+    return out;
+}
+
+bool parsePeer(std::string_view text, Net::Endpoint& out)
+{
+    size_t colon = text.rfind(':');
+    if (colon == std::string_view::npos)
+    {
+        return false;
+    }
+    std::string_view host = text.substr(0, colon);
+    if (host.size() > 2 && host.front() == '[' && host.back() == ']')
+    {
+        host = host.substr(1, host.size() - 2);
+    }
+
+    uint16_t port  = 0;
+    auto portText  = text.substr(colon + 1);
+    auto [ptr, ec] = std::from_chars(portText.data(), portText.data() + portText.size(), port);
+    if (ec != std::errc{} || ptr != portText.data() + portText.size() || port == 0)
+    {
+        return false;
+    }
+    try
+    {
+        out = Net::Endpoint::parse(std::string(host), port);
+    }
+    catch (const std::exception&)
+    {
+        return false;
+    }
+    return true;
+}
+}  // namespace
+
+bool isMagnetUri(std::string_view uri)
+{
+    return uri.starts_with("magnet:?");
+}
+
+std::string urlDecode(std::string_view str)
+{
+    std::string out;
+    out.reserve(str.size());
+    for (size_t i = 0; i < str.size(); ++i)
+    {
+        if (str[i] == '%' && i + 2 < str.size() && hexDigit(str[i + 1]) >= 0 && hexDigit(str[i + 2]) >= 0)
+        {
+            out.push_back(static_cast<char>((hexDigit(str[i + 1]) << 4) | hexDigit(str[i + 2])));
+            i += 2;
+        }
+        else
+        {
+            out.push_back(str[i]);
+        }
+    }
+    return out;
+}
+
+MagnetLink parseMagnetUri(std::string_view uri)
+{
+    if (!isMagnetUri(uri))
+    {
+        throw std::runtime_error("Not a magnet link");
+    }
+
+    MagnetLink link;
+    std::string_view query = uri.substr(8);
+    while (!query.empty())
+    {
+        size_t amp           = query.find('&');
+        std::string_view arg = query.substr(0, amp);
+        query                = amp == std::string_view::npos ? std::string_view{} : query.substr(amp + 1);
+
+        size_t eq = arg.find('=');
+        if (eq == std::string_view::npos)
+        {
+            continue;
+        }
+        std::string_view key = arg.substr(0, eq);
+        std::string value    = urlDecode(arg.substr(eq + 1));
+
+        if (key == "xt" && value.starts_with("urn:btih:"))
+        {
+            std::string_view hash = std::string_view(value).substr(9);
+            if (hash.size() == 40)
+            {
+                link.infoHash = decodeHexHash(hash);
+            }
+            else if (hash.size() == 32)
+            {
+                link.infoHash = decodeBase32Hash(hash);
+            }
+            else
+            {
+                throw std::runtime_error("Invalid info hash length in magnet link");
+            }
+        }
+        else if (key == "dn")
+        {
+            link.displayName = std::move(value);
+        }
+        else if (key == "tr" || key.starts_with("tr."))
+        {
+            if (!value.empty())
+            {
+                link.trackers.push_back({std::move(value)});
+            }
+        }
+        else if (key == "x.pe")
+        {
+            Net::Endpoint ep;
+            if (parsePeer(value, ep))
+            {
+                link.peers.push_back(ep);
+            }
+        }
+    }
+
+    if (link.infoHash.empty())
+    {
+        throw std::runtime_error("Magnet link has no urn:btih info hash");
+    }
+    return link;
+}
+
+}  // namespace Torrent::Utils
@@ -0,0 +1,27 @@
+#ifndef MAGNETURI_HPP
+#define MAGNETURI_HPP
+
+#include <Net/Endpoint.hpp>
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Torrent::Utils {
+
+struct MagnetLink
+{
+    std::string infoHash;  // raw 20-byte SHA-1
+    std::string displayName;
+    std::vector<std::vector<std::string>> trackers;  // every tr= becomes its own tier
+    std::vector<Net::Endpoint> peers;                // x.pe= hints
+};
+
+bool isMagnetUri(std::string_view uri);
+// Accepts hex (40 chars) and base32 (32 chars) btih; throws std::runtime_error on anything else.
+MagnetLink parseMagnetUri(std::string_view uri);
+// Decodes %XX escapes only: a '+' is a plus sign in a URI, not a space as in form data.
+std::string urlDecode(std::string_view str);
+
+}  // namespace Torrent::Utils
+#endif  // MAGNETURI_HPP
@@ -4,28 +4,269 @@
 #include <openssl/sha.h>
 #include <openssl/crypto.h>
 #include <fstream>
+#include <array>
+#include <bit>
 
 #include <iostream>
 
+#include <Core/MerkleTree.hpp>
+#include <Metrics/Trace.hpp>
+
 namespace Torrent::Utils {
 
-std::string urlEncode(const std::string& str)
+namespace {
+constexpr size_t Sha256Size = 32;
+
+// BEP 52 file tree: directories are dicts keyed by path component, a file is a dict holding one empty key.
+void walkFileTree(const Bencode::Dict& tree, const std::string& prefix, std::vector<Metadata::FileEntry>& out)
 {
-    static const char hex[] = "0123456789ABCDEF";
-    std::string out;
+    for (const auto& [name, node] : tree)
+    {
+        if (!node.isDict())
+        {
+            throw std::runtime_error("Invalid file tree entry: " + prefix + name);
+        }
+        const auto& dict = node.asDict();
+        auto file        = dict.find("");
+        if (file == dict.end() || !file->second.isDict())
+        {
+            walkFileTree(dict, prefix + name + "/", out);
+            continue;
+        }
+
+        const auto& attrs = file->second.asDict();
+        auto length       = attrs.find("length");
+        auto root         = attrs.find("pieces root");
+        Metadata::FileEntry entry{prefix + name, length != attrs.end() ? length->second.asInt() : 0, {}, false};
+        if (root != attrs.end())
+        {
+            entry.piecesRoot = root->second.asStr();
+        }
+        if (entry.size > 0 && entry.piecesRoot.size() != Sha256Size)
+        {
+            throw std::runtime_error("Missing pieces root for " + entry.path);
+        }
+        out.push_back(std::move(entry));
+    }
+}
+
+void fillInfoV2(Metadata& meta, const Bencode::Dict& info)
+{
+    if (meta.pieceLength < 16'384 || (meta.pieceLength & (meta.pieceLength - 1)) != 0)
+    {
+        throw std::runtime_error("Invalid v2 piece length");
+    }
+    auto tree = info.find("file tree");
+    if (tree == info.end() || !tree->second.isDict())
+    {
+        throw std::runtime_error("v2 torrent without a file tree");
+    }
+
+    std::vector<Metadata::FileEntry> files;
+    walkFileTree(tree->second.asDict(), "", files);
+    if (meta.files.empty())
+    {
+        meta.files     = std::move(files);
+        meta.totalSize = 0;
+        for (const auto& file : meta.files)
+        {
+            meta.totalSize += file.size;
+        }
+        return;
+    }
+
+    // hybrid: keep the v1 layout, pad files included, and attach the v2 roots by path
+    std::map<std::string, std::string> roots;
+    for (auto& file : files)
+    {
+        roots.emplace(std::move(file.path), std::move(file.piecesRoot));
+    }
+    for (auto& file : meta.files)
+    {
+        auto it = roots.find(file.path);
+        if (it != roots.end())
+        {
+            file.piecesRoot = it->second;
+        }
+        else if (!file.padding && file.size > 0)
+        {
+            throw std::runtime_error("Hybrid torrent file missing from the file tree: " + file.path);
+        }
+    }
+}
+
+// Every layer has to hash up to the pieces root of a file in the torrent, one hash per piece of that file.
+void fillPieceLayers(Metadata& meta, const Bencode::Dict& layers)
+{
+    namespace Merkle = Core::Merkle;
+    std::map<std::string_view, uint64_t> sizes;  // pieces root -> file size
+    for (const auto& file : meta.files)
+    {
+        if (!file.piecesRoot.empty())
+        {
+            sizes.emplace(file.piecesRoot, file.size);
+        }
+    }
+
+    auto pieceHeight = static_cast<unsigned>(std::countr_zero(meta.pieceLength / Merkle::BlockSize));
+    for (const auto& [root, hashes] : layers)
+    {
+        if (!hashes.isStr() || hashes.asStr().size() % Sha256Size != 0)
+        {
+            throw std::runtime_error("Invalid piece layer");
+        }
+        auto file = sizes.find(root);
+        if (file == sizes.end())
+        {
+            throw std::runtime_error("Piece layer without a matching file");
+        }
+
+        std::string_view raw = hashes.asStr();
+        std::vector<Merkle::Hash> layer(raw.size() / Sha256Size);
+        for (size_t i = 0; i < layer.size(); ++i)
+        {
+            layer[i] = Merkle::fromString(raw.substr(i * Sha256Size, Sha256Size));
+        }
+        auto blocks     = (file->second + Merkle::BlockSize - 1) / Merkle::BlockSize;
+        auto treeHeight = static_cast<unsigned>(std::bit_width(std::bit_ceil(blocks)) - 1);
+        if (layer.size() != (file->second + meta.pieceLength - 1) / meta.pieceLength || treeHeight <= pieceHeight ||
+            Merkle::reduce(std::move(layer), pieceHeight, treeHeight - pieceHeight) != Merkle::fromString(root))
+        {
+            throw std::runtime_error("Piece layer does not match its pieces root");
+        }
+        meta.pieceLayers.emplace(root, raw);
+    }
+}
+
+void fillInfo(Metadata& meta, Bencode::Dict info)
+{
+    if (info.contains("name"))
+    {
+        meta.name = info["name"].asStr();
+    }
+
+    if (info.contains("piece length"))
+    {
+        meta.pieceLength = info["piece length"].asInt();
+    }
+
+    if (info.contains("pieces"))
+    {
+        std::string raw = info["pieces"].asStr();
+        for (size_t i = 0; i < raw.size(); i += 20)
+        {
+            meta.pieceHashes.push_back(raw.substr(i, 20));
+        }
+    }
+
+    if (info.contains("length"))
+    {
+        meta.totalSize = info["length"].asInt();
+        meta.files.push_back({meta.name, meta.totalSize, {}, false});
+    }
+    else if (info.contains("files"))
+    {
+        auto filesList = info["files"].asList();
+
+        for (const auto& file : filesList)
+        {
+            auto fileDict = file.asDict();
+            auto len      = fileDict["length"].asInt();
+            auto pathList = fileDict["path"].asList();
+            std::string path;
+            for (const auto& pathPart : pathList)
+            {
+                path += pathPart.asStr() + "/";
+            }
+
+            if (!path.empty())
+            {
+                path.pop_back();
+            }
+
+            bool padding = fileDict.contains("attr") && fileDict["attr"].isStr() &&
+                           fileDict["attr"].asStr().find('p') != std::string::npos;
+            meta.files.push_back({path, len, {}, padding});
+            meta.totalSize += len;
+        }
+    }
+
+    if (info.contains("meta version"))
+    {
+        meta.metaVersion = static_cast<uint32_t>(info["meta version"].asInt());
+    }
+    if (meta.isV2())
+    {
+        fillInfoV2(meta, info);
+    }
+}
+
+// v2-only torrents are addressed on the wire by the SHA-256 truncated to 20 bytes.
+void fillInfoHashes(Metadata& meta, const std::string& rawInfo)
+{
+    if (meta.isV2())
+    {
+        meta.infoHashV2 = computeInfoHashV2(rawInfo);
+        meta.infoHash   = meta.isHybrid() ? computeInfoHash(rawInfo) : meta.infoHashV2.substr(0, 20);
+    }
+    else
+    {
+        meta.infoHash = computeInfoHash(rawInfo);
+    }
+}
+
+Bencode::Value parseBencode(const std::string& data, const char* what)
+{
+    Bencode::Parser parser(data);
+    try
+    {
+        return parser.parse();
+    }
+    catch (const std::exception& e)
+    {
+        throw std::runtime_error(std::string("Failed to parse ") + what + ": " + e.what());
+    }
+    catch (...)
+    {
+        throw std::runtime_error(std::string("Failed to parse ") + what);
+    }
+}
+}  // namespace
+
+namespace {
+constexpr auto kUnreserved = []
+{
+    std::array<bool, 256> table{};
+    for (unsigned char c : std::string_view("ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_.~"))
+    {
+        table[c] = true;
+    }
+    return table;
+}();
+}  // namespace
+
+void urlEncode(std::string_view str, std::string& out)
+{
+    static constexpr char hex[] = "0123456789ABCDEF";
     for (unsigned char c : str)
     {
-        if (std::isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~')
+        if (kUnreserved[c])
         {
-            out.push_back(c);
+            out += static_cast<char>(c);
         }
         else
         {
-            out.push_back('%');
-            out.push_back(hex[c >> 4]);
-            out.push_back(hex[c & 15]);
+            const char escaped[3] = {'%', hex[c >> 4], hex[c & 15]};
+            out.append(escaped, 3);
         }
     }
+}
+
+std::string urlEncode(std::string_view str)
+{
+    std::string out;
+    out.reserve(str.size() * 3);
+    urlEncode(str, out);
     return out;
 }
 
@@ -108,14 +349,25 @@ std::string extractRawInfoSection(const std::string& data)
 
 std::string computeInfoHash(const std::string& rawInfoSection)
 {
+    TRACE_SCOPE("computeInfoHash");
     unsigned char hash[SHA_DIGEST_LENGTH];
     SHA1(reinterpret_cast<const unsigned char*>(rawInfoSection.data()), rawInfoSection.size(), hash);
 
     return std::string(reinterpret_cast<char*>(hash), SHA_DIGEST_LENGTH);
 }
 
+std::string computeInfoHashV2(const std::string& rawInfoSection)
+{
+    TRACE_SCOPE("computeInfoHashV2");
+    unsigned char hash[SHA256_DIGEST_LENGTH];
+    SHA256(reinterpret_cast<const unsigned char*>(rawInfoSection.data()), rawInfoSection.size(), hash);
+
+    return std::string(reinterpret_cast<char*>(hash), SHA256_DIGEST_LENGTH);
+}
+
 Metadata fillMetadata(const std::string& torrentFilePath)
 {
+    TRACE_SCOPE("fillMetadata");
     std::ifstream ifs(torrentFilePath, std::ios::binary);
     if (!ifs)
     {
@@ -123,90 +375,65 @@ Metadata fillMetadata(const std::string& torrentFilePath)
         throw std::runtime_error("Failed to open torrent file");
     }
     std::string data((std::istreambuf_iterator<char>(ifs)), (std::istreambuf_iterator<char>()));
+    return parseMetadata(data);
+}
 
+Metadata parseMetadata(const std::string& data)
+{
+    TRACE_SCOPE("parseMetadata");
     Metadata meta;
 
-    meta.infoHash = computeInfoHash(extractRawInfoSection(data));
-
-    Bencode::Parser parser(data);
-    Bencode::Value value;
-    try
-    {
-        value = parser.parse();
-    }
-    catch (const std::exception& e)
-    {
-        throw std::runtime_error("Failed to parse torrent file: " + std::string(e.what()));
-    }
-    catch (...)
-    {
-        throw std::runtime_error("Failed to parse torrent file");
-    }
-
-    auto dict = value.asDict();
+    auto rawInfo = extractRawInfoSection(data);
+    auto dict    = parseBencode(data, "torrent file").asDict();
 
     if (dict.contains("announce"))
     {
         meta.announce = dict["announce"].asStr();
     }
 
-    auto info = dict["info"].asDict();
-    if (info.contains("name"))
+    if (dict.contains("announce-list") && dict["announce-list"].isList())
     {
-        meta.name = info["name"].asStr();
-    }
-    if (info.contains("announce-list"))
-    {
-        auto announceList = info["announce-list"].asList();
-        for (auto announce : announceList)
-        {
-            meta.announceList.push_back(announce.asStr());
-        }
-    }
-
-    if (info.contains("piece length"))
-    {
-        meta.pieceLength = info["piece length"].asInt();
-    }
-
-    if (info.contains("pieces"))
-    {
-        std::string raw = info["pieces"].asStr();
-        for (size_t i = 0; i < raw.size(); i += 20)
-        {
-            meta.pieceHashes.push_back(raw.substr(i, 20));
-        }
-    }
-
-    if (info.contains("length"))
-    {
-        meta.totalSize = info["length"].asInt();
-        meta.files.push_back({meta.name, meta.totalSize});
-    }
-    else if (info.contains("files"))
-    {
-        auto filesList = info["files"].asList();
-
-        for (const auto& file : filesList)
+        for (const auto& tier : dict["announce-list"].asList())
         {
-            auto fileDict = file.asDict();
-            auto len      = fileDict["length"].asInt();
-            auto pathList = fileDict["path"].asList();
-            std::string path;
-            for (const auto& pathPart : pathList)
+            std::vector<std::string> urls;
+            if (tier.isList())
             {
-                path += pathPart.asStr() + "/";
+                for (const auto& url : tier.asList())
+                {
+                    if (url.isStr() && !url.asStr().empty())
+                    {
+                        urls.push_back(url.asStr());
+                    }
+                }
             }
-
-            if (!path.empty())
+            else if (tier.isStr() && !tier.asStr().empty())
             {
-                path.pop_back();
+                // non-conforming flat list: every tracker becomes its own tier
+                urls.push_back(tier.asStr());
             }
 
-            meta.files.push_back({path, len});
-            meta.totalSize += len;
+            if (!urls.empty())
+            {
+                meta.announceList.push_back(std::move(urls));
+            }
         }
     }
+
+    fillInfo(meta, dict["info"].asDict());
+    fillInfoHashes(meta, rawInfo);
+    if (meta.isV2() && dict.contains("piece layers") && dict["piece layers"].isDict())
+    {
+        fillPieceLayers(meta, dict["piece layers"].asDict());
+    }
+    return meta;
+}
+
+Metadata parseInfoDict(const std::string& rawInfo)
+{
+    TRACE_SCOPE("parseInfoDict");
+    Metadata meta;
+    fillInfo(meta, parseBencode(rawInfo, "info dictionary").asDict());
+    fillInfoHashes(meta, rawInfo);
     return meta;
 }
 }  // namespace Torrent::Utils
@@ -2,7 +2,9 @@
 #define METAUTILS_HPP
 
 #include <string>
+#include <string_view>
 #include <cstdint>
+#include <map>
 #include <vector>
 
 namespace Torrent {
@@ -12,6 +14,8 @@ struct Metadata
     {
         std::string path;
         uint64_t size = 0;
+        std::string piecesRoot;  // v2 merkle root, empty for v1-only and empty files
+        bool padding = false;    // BEP 47 pad file of a hybrid torrent
     };
 
     std::string announce;
@@ -22,17 +26,38 @@ struct Metadata
     uint64_t totalSize   = 0;
 
     std::vector<std::string> pieceHashes;
-    std::vector<std::string> announceList;
+    std::vector<std::vector<std::string>> announceList;  // BEP 12 tiers
     std::vector<FileEntry> files;
-    std::string infoHash;
+    std::string infoHash;  // SHA-1, or the truncated SHA-256 for v2-only torrents
+
+    uint32_t metaVersion = 1;
+    std::string infoHashV2;                          // SHA-256 of the info dictionary, v2 and hybrid only
+    std::map<std::string, std::string> pieceLayers;  // pieces root -> concatenated SHA-256 piece hashes
+
+    bool isV2() const
+    {
+        return metaVersion >= 2;
+    }
+
+    // Carries both the v1 piece hashes and the v2 file tree.
+    bool isHybrid() const
+    {
+        return isV2() && !pieceHashes.empty();
+    }
 };
 
 namespace Utils {
 
-std::string urlEncode(const std::string& str);
+std::string urlEncode(std::string_view str);
+// Appends the percent-encoding of str (RFC 3986 unreserved characters pass through) to out.
+void urlEncode(std::string_view str, std::string& out);
 Metadata fillMetadata(const std::string& torrentFilePath);
+Metadata parseMetadata(const std::string& data);
+// Info dictionary alone, e.g. fetched over ut_metadata; trackers are left empty.
+Metadata parseInfoDict(const std::string& rawInfo);
 std::string extractRawInfoSection(const std::string& data);
 std::string computeInfoHash(const std::string& rawInfoSection);
+std::string computeInfoHashV2(const std::string& rawInfoSection);
 size_t skipElement(const std::string& data, size_t pos);
 
 }  // namespace Utils